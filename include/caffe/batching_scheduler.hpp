@@ -0,0 +1,91 @@
+#ifndef CAFFE_BATCHING_SCHEDULER_HPP_
+#define CAFFE_BATCHING_SCHEDULER_HPP_
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/internal_thread.hpp"
+#include "caffe/layers/memory_data_layer.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/blocking_queue.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+struct BatchRequest {
+  const Blob<Dtype>* input;
+  const vector<Blob<Dtype>*>* output;
+  boost::posix_time::ptime submitted;
+  BlockingQueue<int> done;
+};
+
+struct BatchingStats {
+  int requests;
+  int batches;
+  float mean_batch_size;
+  // Latency from submission to completion, in milliseconds.
+  float latency_mean;
+  float latency_p50;
+  float latency_p90;
+  float latency_p99;
+};
+
+/**
+ * @brief Groups single-item requests into batches and runs one forward pass
+ *        per batch on a dedicated thread.
+ *
+ * A batch is run as soon as it holds max_batch_size requests, or when the
+ * oldest request in it has waited max_latency_us microseconds. The items are
+ * fed through the net input blob, or through a leading MemoryDataLayer, and
+ * every output blob is split along its first axis, one slice per request.
+ */
+template <typename Dtype>
+class BatchingScheduler : public InternalThread {
+ public:
+  BatchingScheduler(shared_ptr<Net<Dtype> > net, int max_batch_size,
+      int max_latency_us);
+  virtual ~BatchingScheduler();
+
+  /**
+   * @brief Runs input, a single item, through the net as part of a batch and
+   *        reshapes each blob of output to one item of the matching net
+   *        output. Blocks until done; thread-safe.
+   */
+  void Forward(const Blob<Dtype>& input, const vector<Blob<Dtype>*>& output);
+
+  // Shape of one item of the net input, without the batch axis.
+  inline const vector<int>& item_shape() const { return item_shape_; }
+  BatchingStats stats();
+  void ResetStats();
+
+ protected:
+  virtual void InternalThreadEntry();
+  void RunBatch(const vector<BatchRequest<Dtype>*>& batch);
+
+  shared_ptr<Net<Dtype> > net_;
+  // Set if the items are fed through a MemoryDataLayer.
+  shared_ptr<MemoryDataLayer<Dtype> > memory_data_layer_;
+  vector<int> item_shape_;
+  int max_batch_size_;
+  int max_latency_us_;
+  BlockingQueue<BatchRequest<Dtype>*> requests_;
+  Blob<Dtype> batch_data_;
+  Blob<Dtype> batch_labels_;
+
+  boost::mutex stats_mutex_;
+  int num_requests_;
+  int num_batches_;
+  // Latencies of the most recent requests, in milliseconds.
+  vector<float> latencies_;
+  // Oldest sample, overwritten next once latencies_ is full.
+  int latency_pos_;
+
+  DISABLE_COPY_AND_ASSIGN(BatchingScheduler);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_BATCHING_SCHEDULER_HPP_
@@ -8,7 +8,9 @@
 #include "caffe/common.hpp"
 #include "caffe/internal_thread.hpp"
 #include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/bounded_queue.hpp"
 #include "caffe/util/db.hpp"
+#include "caffe/util/format.hpp"
 
 namespace caffe {
 
@@ -25,10 +27,10 @@ class DataReader {
   explicit DataReader(const LayerParameter& param);
   ~DataReader();
 
-  inline BlockingQueue<std::string*>& free() const {
+  inline BoundedQueue<std::string*>& free() const {
     return queue_pair_->free_;
   }
-  inline BlockingQueue<std::string*>& full() const {
+  inline BoundedQueue<std::string*>& full() const {
     return queue_pair_->full_;
   }
 
@@ -39,8 +41,9 @@ class DataReader {
     explicit QueuePair(int size);
     ~QueuePair();
 
-    BlockingQueue<std::string*> free_;
-    BlockingQueue<std::string*> full_;
+    // Hold a fixed set of buffers, recycled between the reader and solver
+    BoundedQueue<std::string*> free_;
+    BoundedQueue<std::string*> full_;
 
   DISABLE_COPY_AND_ASSIGN(QueuePair);
   };
@@ -54,9 +57,19 @@ class DataReader {
    protected:
     void InternalThreadEntry();
     void read_one(db::Cursor* cursor, QueuePair* qp);
+    // Moves to the next record of the partition read, from the start of the
+    // source after the last record.
+    void next(db::Cursor* cursor);
+    void seek_partition(db::Cursor* cursor);
 
     const LayerParameter param_;
+    // Partition of the records read, from DataParameter, unless the db
+    // itself reads only the shards of the partition.
+    int num_partitions_;
+    int partition_;
     int read;
+    // Index of the current record in the source.
+    int64_t record_;
     BlockingQueue<shared_ptr<QueuePair> > new_queue_pairs_;
 
     friend class DataReader;
@@ -65,9 +78,11 @@ class DataReader {
   };
 
   // A source is uniquely identified by its layer name + path, in case
-  // the same database is read from two different locations in the net.
+  // the same database is read from two different locations in the net,
+  // and by the partition read.
   static inline string source_key(const LayerParameter& param) {
-    return param.name() + ":" + param.data_param().source();
+    return param.name() + ":" + param.data_param().source() + ":" +
+        format_int(param.data_param().partition());
   }
 
   const shared_ptr<QueuePair> queue_pair_;
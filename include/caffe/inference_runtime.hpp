@@ -0,0 +1,101 @@
+#ifndef CAFFE_INFERENCE_RUNTIME_HPP_
+#define CAFFE_INFERENCE_RUNTIME_HPP_
+
+#include <sched.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/internal_thread.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/blocking_queue.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class InferenceRuntime;
+
+template <typename Dtype>
+struct InferenceRequest {
+  const vector<Blob<Dtype>*>* input;
+  const vector<Blob<Dtype>*>* output;
+  BlockingQueue<int> done;
+};
+
+/**
+ * @brief One instance of the net, run by its own thread on its own cores.
+ */
+template <typename Dtype>
+class InferenceReplica : public InternalThread {
+ public:
+  InferenceReplica(InferenceRuntime<Dtype>* runtime, int id,
+      const cpu_set_t& cpu_set, const Net<Dtype>* weights_source);
+  virtual ~InferenceReplica();
+
+  inline shared_ptr<Net<Dtype> > net() const { return net_; }
+  inline const cpu_set_t& cpu_set() const { return cpu_set_; }
+
+ protected:
+  virtual void InternalThreadEntry();
+
+  InferenceRuntime<Dtype>* runtime_;
+  int id_;
+  // Replica whose weights are shared, or NULL to load them from the file.
+  const Net<Dtype>* weights_source_;
+  cpu_set_t cpu_set_;
+  shared_ptr<Net<Dtype> > net_;
+
+  DISABLE_COPY_AND_ASSIGN(InferenceReplica);
+};
+
+/**
+ * @brief Runs several replicas of a net in one process for throughput, each
+ *        on its own subset of the cores with its own OpenMP team.
+ *
+ * The cores are partitioned socket by socket. Each replica builds its net
+ * on its own thread, so its buffers are allocated on its node; the first
+ * replica of each socket loads the weights and the other replicas of the
+ * socket share them, once it has converted them to their final layout, so
+ * that no replica writes to memory used by another one. Requests go to
+ * whichever replica is idle.
+ */
+template <typename Dtype>
+class InferenceRuntime {
+ public:
+  InferenceRuntime(const NetParameter& param, const string& weights_file,
+      int num_replicas);
+  virtual ~InferenceRuntime();
+
+  /**
+   * @brief Copies input into the input blobs of an idle replica, runs it and
+   *        copies its output blobs into output, reshaping them as needed.
+   *
+   * Thread-safe; concurrent calls run on different replicas.
+   */
+  void Forward(const vector<Blob<Dtype>*>& input,
+      const vector<Blob<Dtype>*>& output);
+
+  inline int num_replicas() const { return replicas_.size(); }
+  inline shared_ptr<Net<Dtype> > net(int replica) const {
+    return replicas_[replica]->net();
+  }
+  inline const cpu_set_t& replica_cpu_set(int replica) const {
+    return replicas_[replica]->cpu_set();
+  }
+
+ protected:
+  NetParameter param_;
+  string weights_file_;
+  vector<shared_ptr<InferenceReplica<Dtype> > > replicas_;
+  BlockingQueue<InferenceRequest<Dtype>*> requests_;
+  BlockingQueue<int> ready_;
+
+  friend class InferenceReplica<Dtype>;
+
+  DISABLE_COPY_AND_ASSIGN(InferenceRuntime);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_INFERENCE_RUNTIME_HPP_
@@ -31,19 +31,22 @@ class BaseConvolutionLayer : public Layer<Dtype> {
  protected:
   // Helper functions that abstract away the column buffer and gemm arguments.
   // The last argument in forward_cpu_gemm is so that we can skip the im2col if
-  // we just called weight_cpu_gemm with the same input.
+  // the column buffer of the thread already holds the same input.
   void forward_cpu_gemm(const Dtype* input, const Dtype* weights,
       Dtype* output, bool skip_im2col = false);
   void forward_cpu_bias(Dtype* output, const Dtype* bias);
   void backward_cpu_gemm(const Dtype* input, const Dtype* weights,
       Dtype* output);
-  void weight_cpu_gemm(const Dtype* input, const Dtype* output, Dtype*
-      weights);
+  // Accumulates the weight gradient of num images into weights. The columns
+  // of up to weight_gemm_images_ images are gathered into one GEMM, so that
+  // the threads share the weight diff instead of each accumulating its own.
+  // If forward_weights is not NULL, also computes forward_cpu_gemm of each
+  // input with them into forward_output, reusing the same columns.
+  void weight_cpu_gemm(const Dtype* input, int input_dim, const Dtype* output,
+      int output_dim, int num, Dtype* weights,
+      const Dtype* forward_weights = NULL, Dtype* forward_output = NULL);
   void backward_cpu_bias(Dtype* bias, const Dtype* input);
 
-  void clear_weight_mt(void);
-  void sum_weight_mt(Dtype* weight_diff);
-
 #ifndef CPU_ONLY
   void forward_gpu_gemm(const Dtype* col_input, const Dtype* weights,
       Dtype* output, bool skip_im2col = false);
@@ -115,6 +118,17 @@ class BaseConvolutionLayer : public Layer<Dtype> {
           pad_.cpu_data(), stride_.cpu_data(), dilation_.cpu_data(), col_buff);
     }
   }
+  // 2D only: stores the rows of the columns col_stride elements apart.
+  inline void conv_im2col_cpu(const Dtype* data, Dtype* col_buff,
+      int col_stride) {
+    im2col_cpu(data, conv_in_channels_,
+        conv_input_shape_.cpu_data()[1], conv_input_shape_.cpu_data()[2],
+        kernel_shape_.cpu_data()[0], kernel_shape_.cpu_data()[1],
+        pad_.cpu_data()[0], pad_.cpu_data()[1],
+        stride_.cpu_data()[0], stride_.cpu_data()[1],
+        dilation_.cpu_data()[0], dilation_.cpu_data()[1], col_buff,
+        col_stride);
+  }
   inline void conv_col2im_cpu(const Dtype* col_buff, Dtype* data) {
     if (!force_nd_im2col_ && num_spatial_axes_ == 2) {
       col2im_cpu(col_buff, conv_in_channels_,
@@ -175,7 +189,10 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   Blob<Dtype> bias_multiplier_;
 
   std::vector<Dtype> col_buffer_mt_;   //  openmp
-  std::vector<Dtype> weight_diff_mt_;  // openmp
+  // Images per GEMM in weight_cpu_gemm, whose columns are laid side by side
+  // in col_buffer_mt_ and outputs in output_buffer_batch_.
+  int weight_gemm_images_;
+  std::vector<Dtype> output_buffer_batch_;
 };
 
 }  // namespace caffe
@@ -1,6 +1,7 @@
 #ifndef CAFFE_DATA_LAYERS_HPP_
 #define CAFFE_DATA_LAYERS_HPP_
 
+#include <stdint.h>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -9,6 +10,7 @@
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/bounded_queue.hpp"
 
 namespace caffe {
 
@@ -51,6 +53,26 @@ class Batch {
   Blob<Dtype> data_, label_;
 };
 
+/**
+ * @brief Time spent in each stage of the prefetch pipeline, in microseconds,
+ *        summed over the batches loaded so far.
+ */
+struct PrefetchStats {
+  int64_t batches;
+  // Waiting for records from the source.
+  int64_t read_us;
+  // Parsing and decoding records.
+  int64_t decode_us;
+  // Transforming the items into the batch.
+  int64_t transform_us;
+  // Forward blocked on the prefetch queue, or loading the batch itself
+  // without a prefetch thread.
+  int64_t wait_us;
+};
+
+// Adds us to a counter of PrefetchStats; safe to call from any thread.
+void AddPrefetchTime(int64_t* counter, double us);
+
 template <typename Dtype>
 class BasePrefetchingDataLayer :
     public BaseDataLayer<Dtype>, public InternalThread {
@@ -67,18 +89,23 @@ class BasePrefetchingDataLayer :
   virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
 
-  // Prefetches batches (asynchronously if to GPU memory)
-  static const int PREFETCH_COUNT = 3;
+  PrefetchStats prefetch_stats() const;
 
  protected:
   virtual void InternalThreadEntry();
   virtual void load_batch(Batch<Dtype>* batch) = 0;
 
   virtual void GetBatch();
-
-  Batch<Dtype> prefetch_[PREFETCH_COUNT];
-  BlockingQueue<Batch<Dtype>*> prefetch_free_;
-  BlockingQueue<Batch<Dtype>*> prefetch_full_;
+  // Pops the next loaded batch, loading it first if there is no prefetch
+  // thread, and records the time Forward waits for it
+  Batch<Dtype>* NextBatch();
+
+  // Batches are prefetched on the internal thread, in GPU mode or when
+  // data_param.cpu_prefetch is set, and loaded by Forward otherwise.
+  vector<shared_ptr<Batch<Dtype> > > prefetch_;
+  BoundedQueue<Batch<Dtype>*> prefetch_free_;
+  BoundedQueue<Batch<Dtype>*> prefetch_full_;
+  PrefetchStats stats_;
 
   Blob<Dtype> transformed_data_;
 };
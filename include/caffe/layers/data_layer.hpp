@@ -1,6 +1,11 @@
 #ifndef CAFFE_DATA_LAYER_HPP_
 #define CAFFE_DATA_LAYER_HPP_
 
+#ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
+#endif  // USE_OPENCV
+
+#include <string>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -10,10 +15,67 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/bounded_queue.hpp"
 #include "caffe/util/db.hpp"
 
 namespace caffe {
 
+// The records of one batch, parsed and decoded.
+class DecodedBatch {
+ public:
+  vector<Datum> datums_;
+#ifdef USE_OPENCV
+  // Decoded images of the encoded datums, empty for the others
+  vector<cv::Mat> images_;
+#endif  // USE_OPENCV
+};
+
+/**
+ * @brief Parses and decodes the records of every n-th batch read from a
+ * DataReader, on its own thread.
+ *
+ * The decoders of a layer take turns to read a batch from the reader, and
+ * the layer takes the decoded batches from them round-robin, so batches come
+ * out in the order they were read.
+ */
+class DataDecoder : public InternalThread {
+ public:
+  DataDecoder(DataReader* reader, const LayerParameter& param,
+      PrefetchStats* stats);
+  virtual ~DataDecoder();
+
+  // Starts decoding, next is the decoder reading after this one
+  void Start(DataDecoder* next, bool first);
+
+  inline BoundedQueue<DecodedBatch*>& free() { return free_; }
+  inline BoundedQueue<DecodedBatch*>& full() { return full_; }
+
+  // Reads batch_size records from reader
+  static void Read(DataReader* reader, int batch_size,
+      vector<string*>* records);
+  // Parses records into batch, decoding the encoded ones, and gives the
+  // records back to reader
+  static void Decode(DataReader* reader, const TransformationParameter& param,
+      vector<string*>* records, bool parallel, DecodedBatch* batch);
+
+ protected:
+  virtual void InternalThreadEntry();
+
+  DataReader* reader_;
+  const LayerParameter param_;
+  PrefetchStats* stats_;
+  DataDecoder* next_;
+  vector<shared_ptr<DecodedBatch> > batches_;
+  BoundedQueue<DecodedBatch*> free_;
+  BoundedQueue<DecodedBatch*> full_;
+  // Holds a token while it is this decoder's turn to read
+  BlockingQueue<int> turn_;
+  vector<string*> records_;
+
+DISABLE_COPY_AND_ASSIGN(DataDecoder);
+};
+
 template <typename Dtype>
 class DataLayer : public BasePrefetchingDataLayer<Dtype> {
  public:
@@ -32,6 +94,11 @@ class DataLayer : public BasePrefetchingDataLayer<Dtype> {
   virtual void load_batch(Batch<Dtype>* batch);
 
   DataReader reader_;
+  // Decode stage, decoding in load_batch if empty
+  vector<shared_ptr<DataDecoder> > decoders_;
+  int next_decoder_;
+  DecodedBatch decoded_;
+  vector<string*> records_;
 };
 
 }  // namespace caffe
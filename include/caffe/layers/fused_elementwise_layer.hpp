@@ -0,0 +1,123 @@
+#ifndef CAFFE_FUSED_ELEMENTWISE_LAYER_HPP_
+#define CAFFE_FUSED_ELEMENTWISE_LAYER_HPP_
+
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+namespace caffe {
+
+/**
+ * @brief Runs a chain of consecutive elementwise layers as a single pass
+ *        over memory.
+ *
+ * The chain may start with an Eltwise SUM layer, followed by any number of
+ * ReLU, Sigmoid, TanH, AbsVal, BNLL, ELU, Power, Exp, Log, and single-input
+ * Scale or Bias layers. This layer is not created by the LayerRegistry:
+ * Net builds it over already set up layers when NetParameter.fuse_elementwise
+ * is set. The original layers keep their parameters, so weight loading,
+ * snapshots and solvers see the unfused net.
+ *
+ * The data is processed in cache-sized tiles, each tile going through the
+ * whole chain before the next one is loaded, so the chain input is read
+ * only once. Intermediate top blobs not overwritten in place by the next layer
+ * are written from the tiles, so that they hold the same data as in the
+ * unfused net, but their diffs are not computed. Backward recomputes the
+ * intermediate values tile by tile from the chain input, which Forward saves
+ * when the chain overwrites it in place.
+ */
+template <typename Dtype>
+class FusedElementwiseLayer : public Layer<Dtype> {
+ public:
+  /**
+   * @param layers the chain, in execution order
+   * @param bottom_vecs,top_vecs the bottom and top blobs of each layer
+   * @param layer_need_backward whether Net runs Backward for each layer
+   */
+  FusedElementwiseLayer(const LayerParameter& param,
+      const vector<shared_ptr<Layer<Dtype> > >& layers,
+      const vector<vector<Blob<Dtype>*> >& bottom_vecs,
+      const vector<vector<Blob<Dtype>*> >& top_vecs,
+      const vector<bool>& layer_need_backward);
+
+  /**
+   * @brief Returns whether the layer may be part of a fused chain; Eltwise is
+   *        only accepted as the first layer of the chain (first == true).
+   */
+  static bool CanFuse(Layer<Dtype>* layer, const vector<Blob<Dtype>*>& bottom,
+      bool first);
+
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+
+  virtual inline const char* type() const { return "FusedElementwise"; }
+  virtual inline int MinBottomBlobs() const { return 1; }
+  virtual inline int ExactNumTopBlobs() const { return 1; }
+
+ protected:
+  virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  /// @brief Runs the chain layers one by one.
+  virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  virtual void Backward_cpu(const vector<Blob<Dtype>*>& top,
+      const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
+  /// @brief Runs the chain layers one by one.
+  virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
+      const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
+
+  enum OpType {
+    RELU, SIGMOID, TANH, ABSVAL, BNLL, ELU, POWER, EXP, LOG, SCALE, BIAS
+  };
+
+  /// One elementwise operation of the chain, y = f(x).
+  struct Op {
+    OpType type;
+    /// Position of the computing layer in layers_.
+    int layer_index;
+    // RELU: alpha = negative_slope; ELU: alpha; POWER: alpha = power,
+    // beta = scale, gamma = shift; EXP: y = gamma * exp(alpha * x);
+    // LOG: y = gamma * log(alpha * x + beta).
+    Dtype alpha, beta, gamma;
+    // SCALE and BIAS: per-channel parameters and the gradients to compute.
+    Blob<Dtype>* scale;
+    Blob<Dtype>* bias;
+    bool scale_grad, bias_grad;
+    int channel_dim, inner_dim;
+  };
+
+  void CompileOps();
+  /// @brief Computes y = op(x) for elements [start, start + n).
+  void OpForward(const Op& op, const int start, const int n,
+      const Dtype* x, Dtype* y) const;
+  /// @brief Computes dx = dy * op'(x) for elements [start, start + n),
+  ///        accumulating per-channel parameter gradients.
+  void OpBackward(const Op& op, const int start, const int n,
+      const Dtype* x, const Dtype* y, const Dtype* dy, Dtype* dx,
+      Dtype* scale_grad, Dtype* bias_grad) const;
+  /// @brief Loads tile [start, start + n) of the chain input into x.
+  void LoadInput(const vector<const Dtype*>& inputs, const int start,
+      const int n, Dtype* x) const;
+  int ScratchThreads();
+
+  vector<shared_ptr<Layer<Dtype> > > layers_;
+  vector<vector<Blob<Dtype>*> > bottom_vecs_, top_vecs_;
+  vector<bool> layer_need_backward_;
+  vector<Op> ops_;
+  /// Coefficients of the Eltwise SUM heading the chain, if any.
+  vector<Dtype> coeffs_;
+  /// Copies of chain inputs overwritten in place by the chain.
+  vector<shared_ptr<Blob<Dtype> > > saved_inputs_;
+  vector<bool> input_overwritten_;
+  /// Per-thread tiles for the values between ops, and per-thread
+  /// accumulators for parameter gradients.
+  Blob<Dtype> tiles_, param_grads_;
+  vector<int> param_grad_offsets_;
+  int param_grad_count_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_FUSED_ELEMENTWISE_LAYER_HPP_
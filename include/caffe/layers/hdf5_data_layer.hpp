@@ -7,23 +7,38 @@
 #include <vector>
 
 #include "caffe/blob.hpp"
+#include "caffe/internal_thread.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/bounded_queue.hpp"
 
 #include "caffe/layers/base_data_layer.hpp"
 
 namespace caffe {
 
+// Rows of each top read from a file, and the order to output them in.
+template <typename Dtype>
+class HDF5Chunk {
+ public:
+  vector<shared_ptr<Blob<Dtype> > > blobs_;
+  vector<unsigned int> permutation_;
+};
+
 /**
  * @brief Provides data to the Net from HDF5 files.
  *
+ * With chunk_rows set, rows are streamed from the files by chunks read on
+ * an internal thread, which moves on to the next file while the current one
+ * is being consumed. Memory is then bounded by prefetch + 1 chunks, and
+ * shuffling works within that budget.
+ *
  * TODO(dox): thorough documentation for Forward and proto params.
  */
 template <typename Dtype>
-class HDF5DataLayer : public Layer<Dtype> {
+class HDF5DataLayer : public Layer<Dtype>, public InternalThread {
  public:
   explicit HDF5DataLayer(const LayerParameter& param)
-      : Layer<Dtype>(param) {}
+      : Layer<Dtype>(param), current_chunk_(NULL) {}
   virtual ~HDF5DataLayer();
   virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
@@ -47,6 +62,12 @@ class HDF5DataLayer : public Layer<Dtype> {
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {}
   virtual void LoadHDF5FileData(const char* filename);
+  // Moves on to the rows of the next file, or of the next chunk.
+  void Next();
+  // Reads chunks of rows when streaming.
+  virtual void InternalThreadEntry();
+  void LoadHDF5Chunk(hid_t file_id, int row_begin, int num_rows,
+      HDF5Chunk<Dtype>* chunk);
 
   std::vector<std::string> hdf_filenames_;
   unsigned int num_files_;
@@ -55,6 +76,12 @@ class HDF5DataLayer : public Layer<Dtype> {
   std::vector<shared_ptr<Blob<Dtype> > > hdf_blobs_;
   std::vector<unsigned int> data_permutation_;
   std::vector<unsigned int> file_permutation_;
+
+  vector<shared_ptr<HDF5Chunk<Dtype> > > chunks_;
+  shared_ptr<BoundedQueue<HDF5Chunk<Dtype>*> > chunk_free_;
+  shared_ptr<BoundedQueue<HDF5Chunk<Dtype>*> > chunk_full_;
+  // Chunk whose rows are being output, its blobs are in hdf_blobs_.
+  HDF5Chunk<Dtype>* current_chunk_;
 };
 
 }  // namespace caffe
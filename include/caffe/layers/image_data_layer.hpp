@@ -1,6 +1,7 @@
 #ifndef CAFFE_IMAGE_DATA_LAYER_HPP_
 #define CAFFE_IMAGE_DATA_LAYER_HPP_
 
+#include <deque>
 #include <string>
 #include <utility>
 #include <vector>
@@ -11,12 +12,17 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/image_reader.hpp"
 
 namespace caffe {
 
 /**
  * @brief Provides data to the Net from image files.
  *
+ * The files are read by a pool of reader_threads, readahead files ahead of
+ * the image being decoded. With image_cache_size, the most recently decoded
+ * images are kept, e.g. for small datasets read again every epoch.
+ *
  * TODO(dox): thorough documentation for Forward and proto params.
  */
 template <typename Dtype>
@@ -37,8 +43,18 @@ class ImageDataLayer : public BasePrefetchingDataLayer<Dtype> {
   virtual void ShuffleImages();
   virtual void load_batch(Batch<Dtype>* batch);
 
+  // Returns the read of lines_id_, queuing the reads of the next lines. The
+  // read is NULL if the image was cached when queued.
+  shared_ptr<FileRead> NextRead();
+  cv::Mat DecodeImage(const shared_ptr<FileRead>& read, const string& filename);
+
   vector<std::pair<std::string, int> > lines_;
   int lines_id_;
+  shared_ptr<AsyncFileReader> reader_;
+  shared_ptr<ImageCache> image_cache_;
+  // Reads queued for the lines from lines_id_ on, up to read_id_.
+  std::deque<shared_ptr<FileRead> > reads_;
+  int read_id_;
 };
 
 
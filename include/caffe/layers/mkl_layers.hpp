@@ -1,7 +1,10 @@
 #ifndef CAFFE_MKL2017_LAYERS_HPP_
 #define CAFFE_MKL2017_LAYERS_HPP_
 
+#include <list>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "boost/enable_shared_from_this.hpp"
@@ -44,6 +47,40 @@ class MKLConvolutionLayer : public ConvolutionLayer<Dtype> {
           const vector<Blob<Dtype>*>& top);
 
  private:
+  // Primitives and layouts for one bottom shape, cached on Reshape.
+  struct Primitives {
+    shared_ptr<MKLData<Dtype> > fwd_bottom_data, fwd_top_data,
+                                fwd_filter_data, fwd_bias_data;
+    dnnPrimitive_t convolutionFwd;
+    shared_ptr<MKLDiff<Dtype> > bwdd_top_diff, bwdd_bottom_diff;
+    shared_ptr<MKLData<Dtype> > bwdd_filter_data;
+    dnnPrimitive_t convolutionBwdData;
+    shared_ptr<MKLDiff<Dtype> > bwdf_top_diff, bwdf_filter_diff;
+    shared_ptr<MKLDiff<Dtype> > bwdf2fwd_filter_diff;
+    shared_ptr<MKLData<Dtype> > bwdf_bottom_data;
+    dnnPrimitive_t convolutionBwdFilter;
+    shared_ptr<MKLDiff<Dtype> > bwdb_top_diff, bwdb_bias_diff;
+    dnnPrimitive_t convolutionBwdBias;
+    shared_ptr<MKLDiff<Dtype> > bwdf_filter_diff_iter, bwdb_bias_diff_iter;
+
+    Primitives()
+      : convolutionFwd(NULL), convolutionBwdData(NULL),
+        convolutionBwdFilter(NULL), convolutionBwdBias(NULL) {}
+  };
+  static const int kMaxCachedShapes = 4;
+
+  // Creates the primitives and layouts for the current shape.
+  void CreatePrimitives();
+  void DeletePrimitives(Primitives* primitives);
+  // Exchanges the current primitives and layouts with the given ones.
+  void SwapPrimitives(Primitives* primitives);
+
+  // Primitives of the inactive shapes, keyed by (num, height, width) of the
+  // bottom, most recently used first, and their index.
+  typedef std::list<std::pair<vector<int>, Primitives> > PrimitivesList;
+  PrimitivesList cached_primitives_;
+  std::map<vector<int>, typename PrimitivesList::iterator> cached_index_;
+
   /* Fwd step */
   shared_ptr<MKLData<Dtype> > fwd_bottom_data, fwd_top_data, fwd_filter_data,
                                  fwd_bias_data;
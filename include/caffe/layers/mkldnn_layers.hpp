@@ -10,7 +10,10 @@
 #include "caffe/layers/base_conv_layer.hpp"
 #include "caffe/layers/conv_layer.hpp"
 #include "caffe/layers/inner_product_layer.hpp"
+#include "caffe/layers/lrn_layer.hpp"
 #include "caffe/layers/neuron_layer.hpp"
+#include "caffe/layers/pooling_layer.hpp"
+#include "caffe/layers/relu_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/mkldnn_memory.hpp"
 #include "mkldnn.hpp"
@@ -63,12 +66,18 @@ private:
     virtual void compute_output_shape();
     virtual void init_properties(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
     void InitConvolution(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    void InitConvolutionBwd(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
 
     shared_ptr<MKLDNNData<Dtype> > fwd_bottom_data, fwd_top_data, fwd_weights_data, fwd_bias_data;
-    shared_ptr<convolution::primitive_desc> convFwd_pd;
+    shared_ptr<MKLDNNDiff<Dtype> > bwd_top_diff, bwd_bottom_diff, bwd_weights_diff, bwd_bias_diff;
+    // Separate buffers for the diffs accumulated over iter_size iterations.
+    shared_ptr<MKLDNNDiff<Dtype> > bwd_weights_diff_iter, bwd_bias_diff_iter;
+    shared_ptr<convolution::primitive_desc> convFwd_pd, convBwdData_pd, convBwdWeights_pd, convBwdBias_pd;
 
-    shared_ptr<convolution> convFwd;
+    shared_ptr<convolution> convFwd, convBwdData, convBwdWeights, convBwdBias;
     shared_ptr<memory> input_memory, weights_memory, bias_memory, output_memory;
+    shared_ptr<memory> top_diff_memory, bottom_diff_memory, weights_diff_memory, bias_diff_memory;
 
     uint32_t width_, height_, width_out_, height_out_, kernel_w_, kernel_h_, stride_w_, stride_h_;
     int  pad_w_, pad_h_;
@@ -92,12 +101,18 @@ protected:
     void Reshape(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
 private:
     void InitInnerProduct(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    void InitInnerProductBwd(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
 
     shared_ptr<MKLDNNData<Dtype> > fwd_bottom_data, fwd_top_data, fwd_weights_data, fwd_bias_data;
-    shared_ptr<inner_product::primitive_desc> ipFwd_pd;
+    shared_ptr<MKLDNNDiff<Dtype> > bwd_top_diff, bwd_bottom_diff, bwd_weights_diff, bwd_bias_diff;
+    // Separate buffers for the diffs accumulated over iter_size iterations.
+    shared_ptr<MKLDNNDiff<Dtype> > bwd_weights_diff_iter, bwd_bias_diff_iter;
+    shared_ptr<inner_product::primitive_desc> ipFwd_pd, ipBwdData_pd, ipBwdWeights_pd, ipBwdBias_pd;
 
-    shared_ptr<inner_product> ipFwd;
+    shared_ptr<inner_product> ipFwd, ipBwdData, ipBwdWeights, ipBwdBias;
     shared_ptr<memory> input_memory, weights_memory, bias_memory, output_memory;
+    shared_ptr<memory> top_diff_memory, bottom_diff_memory, weights_diff_memory, bias_diff_memory;
 
     uint32_t w_, h_;
 };
@@ -115,10 +130,16 @@ public:
         : Layer<Dtype>(param)
         , fwd_top_data(NULL)
         , fwd_bottom_data(NULL)
+        , bwd_top_diff(NULL)
+        , bwd_bottom_diff(NULL)
         , lrnFwd_pd(NULL)
+        , lrnBwd_pd(NULL)
         , lrnFwd(NULL)
+        , lrnBwd(NULL)
         , input_memory(NULL)
         , output_memory(NULL)
+        , top_diff_memory(NULL)
+        , bottom_diff_memory(NULL)
         , scratch_(NULL) {}
     virtual ~MKLDNNLRNLayer() {}
 protected:
@@ -136,17 +157,22 @@ protected:
     virtual inline int ExactNumTopBlobs() const { return 1; }
 private:
     void InitLRN(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    void InitLRNBwd(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
 
     Dtype alpha_, beta_, k_;
     int size_, num_, width_, height_, channels_;
 
     shared_ptr<MKLDNNData<Dtype> > fwd_top_data, fwd_bottom_data;
-    shared_ptr<lrn::primitive_desc> lrnFwd_pd;
+    shared_ptr<MKLDNNDiff<Dtype> > bwd_top_diff, bwd_bottom_diff;
+    shared_ptr<lrn::primitive_desc> lrnFwd_pd, lrnBwd_pd;
 
-    shared_ptr<lrn> lrnFwd;
-    shared_ptr<memory> input_memory, output_memory;
+    shared_ptr<lrn> lrnFwd, lrnBwd;
+    shared_ptr<memory> input_memory, output_memory, top_diff_memory, bottom_diff_memory;
 
     shared_ptr<memory> scratch_;
+    // MKLDNN primitives are single precision only: double runs LRNLayer.
+    shared_ptr<Layer<Dtype> > caffe_layer_;
 };
 
 // ===== MKLDNNPoolingLayer =======================================
@@ -157,11 +183,17 @@ public:
             : Layer<Dtype>(param)
             , fwd_top_data(NULL)
             , fwd_bottom_data(NULL)
+            , bwd_top_diff(NULL)
+            , bwd_bottom_diff(NULL)
             , poolingFwd_pd(NULL)
+            , poolingBwd_pd(NULL)
             , poolingFwd(NULL)
+            , poolingBwd(NULL)
             , indices_memory(NULL)
             , input_memory(NULL)
             , output_memory(NULL)
+            , top_diff_memory(NULL)
+            , bottom_diff_memory(NULL)
             , indices_pd(NULL)
             {}
     ~MKLDNNPoolingLayer() {}
@@ -187,6 +219,8 @@ protected:
 
 private:
     void InitPooling(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    void InitPoolingBwd(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
 
     uint32_t num_, channels_, width_, height_, width_out_, height_out_;
     uint32_t kernel_w_, kernel_h_;
@@ -195,12 +229,18 @@ private:
 
     Blob<uint32_t> max_idx_;
     bool global_pooling_;
+    // Set by InitPooling, backward uses the same algorithm.
+    pooling::algorithm pooling_algorithm_;
 
     shared_ptr<MKLDNNData<Dtype> > fwd_top_data, fwd_bottom_data;
-    shared_ptr<pooling::primitive_desc> poolingFwd_pd;
-    shared_ptr<pooling> poolingFwd;
+    shared_ptr<MKLDNNDiff<Dtype> > bwd_top_diff, bwd_bottom_diff;
+    shared_ptr<pooling::primitive_desc> poolingFwd_pd, poolingBwd_pd;
+    shared_ptr<pooling> poolingFwd, poolingBwd;
     shared_ptr<memory> indices_memory, input_memory, output_memory;
+    shared_ptr<memory> top_diff_memory, bottom_diff_memory;
     shared_ptr<memory::primitive_desc> indices_pd;
+    // MKLDNN primitives are single precision only: double runs PoolingLayer.
+    shared_ptr<Layer<Dtype> > caffe_layer_;
 
 };
 
@@ -218,10 +258,16 @@ public:
             : NeuronLayer<Dtype>(param)
             , fwd_top_data    (NULL)
             , fwd_bottom_data (NULL)
+            , bwd_top_diff(NULL)
+            , bwd_bottom_diff(NULL)
             , reluFwd_pd(NULL)
+            , reluBwd_pd(NULL)
             , reluFwd(NULL)
+            , reluBwd(NULL)
             , input_memory(NULL)
             , output_memory(NULL)
+            , top_diff_memory(NULL)
+            , bottom_diff_memory(NULL)
         {}
 
     ~MKLDNNReLULayer() {}
@@ -237,14 +283,248 @@ protected:
                                 , const vector<Blob<Dtype>*>& bottom);
 private:
     void InitReLU(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    void InitReLUBwd(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
     shared_ptr<MKLDNNData<Dtype> > fwd_top_data, fwd_bottom_data;
-    shared_ptr<relu::primitive_desc> reluFwd_pd;
+    shared_ptr<MKLDNNDiff<Dtype> > bwd_top_diff, bwd_bottom_diff;
+    shared_ptr<relu::primitive_desc> reluFwd_pd, reluBwd_pd;
 
-    shared_ptr<relu> reluFwd;
-    shared_ptr<memory> input_memory, output_memory;
+    shared_ptr<relu> reluFwd, reluBwd;
+    shared_ptr<memory> input_memory, output_memory, top_diff_memory, bottom_diff_memory;
+    // Copy of the input of an in-place ReLU with a negative slope.
+    shared_ptr<reorder> bottom_copy;
+    shared_ptr<memory> bottom_copy_memory;
+    // MKLDNN primitives are single precision only: double runs ReLULayer.
+    shared_ptr<Layer<Dtype> > caffe_layer_;
 
     uint32_t num_, width_, height_, channels_;
 };
 
+// =====  MKLDNNBatchNormLayer =======================================
+/**
+ * @brief Normalizes the input with the MKLDNN batch_normalization primitive.
+ *
+ * Keeps the parameters of BatchNormLayer (mean, variance and moving average
+ * factor) so the models trained by the Caffe engine can be used as they are.
+ */
+template <typename Dtype>
+class MKLDNNBatchNormLayer : public Layer<Dtype> {
+public:
+    explicit MKLDNNBatchNormLayer(const LayerParameter& param)
+            : Layer<Dtype>(param)
+            , fwd_top_data(NULL)
+            , fwd_bottom_data(NULL)
+            , bwd_top_diff(NULL)
+            , bwd_bottom_diff(NULL)
+            , bnFwd_pd(NULL)
+            , bnBwd_pd(NULL)
+            , bnFwd(NULL)
+            , bnBwd(NULL)
+            , input_memory(NULL)
+            , output_memory(NULL)
+            , mean_memory(NULL)
+            , variance_memory(NULL)
+            , top_diff_memory(NULL)
+            , bottom_diff_memory(NULL)
+        {}
+    ~MKLDNNBatchNormLayer() {}
+protected:
+    virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Reshape(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+
+    virtual inline const char* type() const { return "BatchNorm"; }
+    virtual inline int ExactNumBottomBlobs() const { return 1; }
+    virtual inline int ExactNumTopBlobs() const { return 1; }
+
+    virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Backward_cpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+    virtual void Backward_gpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+private:
+    void InitBatchNorm(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    void InitBatchNormBwd(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+
+    Dtype moving_average_fraction_, eps_;
+    bool use_global_stats_;
+    uint32_t num_, channels_, height_, width_;
+    Blob<Dtype> mean_, variance_;
+
+    shared_ptr<MKLDNNData<Dtype> > fwd_top_data, fwd_bottom_data;
+    shared_ptr<MKLDNNDiff<Dtype> > bwd_top_diff, bwd_bottom_diff;
+    shared_ptr<batch_normalization::primitive_desc> bnFwd_pd, bnBwd_pd;
+
+    shared_ptr<batch_normalization> bnFwd, bnBwd;
+    shared_ptr<memory> input_memory, output_memory, mean_memory, variance_memory
+                        , top_diff_memory, bottom_diff_memory;
+    // Copy of the input of an in-place BatchNorm, which backward needs.
+    shared_ptr<reorder> bottom_copy;
+    shared_ptr<memory> bottom_copy_memory;
+};
+
+// =====  MKLDNNConcatLayer =======================================
+/**
+ * @brief Concatenates the inputs along the channels axis with the MKLDNN
+ *        concat primitive.
+ */
+template <typename Dtype>
+class MKLDNNConcatLayer : public Layer<Dtype> {
+public:
+    explicit MKLDNNConcatLayer(const LayerParameter& param)
+            : Layer<Dtype>(param)
+            , fwd_top_data(NULL)
+            , concatFwd_pd(NULL)
+            , concatFwd(NULL)
+            , output_memory(NULL)
+        {}
+    ~MKLDNNConcatLayer() {}
+protected:
+    virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Reshape(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+
+    virtual inline const char* type() const { return "Concat"; }
+    virtual inline int MinBottomBlobs() const { return 1; }
+    virtual inline int ExactNumTopBlobs() const { return 1; }
+
+    virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Backward_cpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+    virtual void Backward_gpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+private:
+    void InitConcat(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+
+    uint32_t num_, channels_, height_, width_;
+    vector<int> bottom_channels_;
+
+    vector<shared_ptr<MKLDNNData<Dtype> > > fwd_bottom_data;
+    shared_ptr<MKLDNNData<Dtype> > fwd_top_data;
+    shared_ptr<concat::primitive_desc> concatFwd_pd;
+
+    shared_ptr<concat> concatFwd;
+    vector<shared_ptr<memory> > input_memory;
+    shared_ptr<memory> output_memory;
+};
+
+// =====  MKLDNNEltwiseLayer =======================================
+/**
+ * @brief Computes the weighted sum of the inputs with the MKLDNN sum
+ *        primitive; only the SUM operation is supported.
+ */
+template <typename Dtype>
+class MKLDNNEltwiseLayer : public Layer<Dtype> {
+public:
+    explicit MKLDNNEltwiseLayer(const LayerParameter& param)
+            : Layer<Dtype>(param)
+            , fwd_top_data(NULL)
+            , sumFwd_pd(NULL)
+            , sumFwd(NULL)
+            , output_memory(NULL)
+        {}
+    ~MKLDNNEltwiseLayer() {}
+protected:
+    virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Reshape(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+
+    virtual inline const char* type() const { return "Eltwise"; }
+    virtual inline int MinBottomBlobs() const { return 2; }
+    virtual inline int ExactNumTopBlobs() const { return 1; }
+
+    virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Backward_cpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+    virtual void Backward_gpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+private:
+    void InitEltwise(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+
+    vector<double> coeffs_;
+    uint32_t num_, channels_, height_, width_;
+
+    vector<shared_ptr<MKLDNNData<Dtype> > > fwd_bottom_data;
+    shared_ptr<MKLDNNData<Dtype> > fwd_top_data;
+    shared_ptr<sum::primitive_desc> sumFwd_pd;
+
+    shared_ptr<sum> sumFwd;
+    vector<shared_ptr<memory> > input_memory;
+    shared_ptr<memory> output_memory;
+};
+
+// =====  MKLDNNSoftmaxLayer =======================================
+/**
+ * @brief Computes the softmax of 2D or 4D input with the MKLDNN softmax
+ *        primitive.
+ */
+template <typename Dtype>
+class MKLDNNSoftmaxLayer : public Layer<Dtype> {
+public:
+    explicit MKLDNNSoftmaxLayer(const LayerParameter& param)
+            : Layer<Dtype>(param)
+            , fwd_top_data(NULL)
+            , fwd_bottom_data(NULL)
+            , softmaxFwd_pd(NULL)
+            , softmaxFwd(NULL)
+            , input_memory(NULL)
+            , output_memory(NULL)
+        {}
+    ~MKLDNNSoftmaxLayer() {}
+protected:
+    virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Reshape(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+
+    virtual inline const char* type() const { return "Softmax"; }
+    virtual inline int ExactNumBottomBlobs() const { return 1; }
+    virtual inline int ExactNumTopBlobs() const { return 1; }
+
+    virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Backward_cpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+    virtual void Backward_gpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+private:
+    void InitSoftmax(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+
+    int softmax_axis_;
+    vector<int> bottom_shape_;
+
+    shared_ptr<MKLDNNData<Dtype> > fwd_top_data, fwd_bottom_data;
+    shared_ptr<softmax::primitive_desc> softmaxFwd_pd;
+
+    shared_ptr<softmax> softmaxFwd;
+    shared_ptr<memory> input_memory, output_memory;
+};
+
+// =====  MKLDNNSplitLayer =======================================
+/**
+ * @brief Shares the input, in whatever layout it is stored, with all the
+ *        outputs.
+ */
+template <typename Dtype>
+class MKLDNNSplitLayer : public Layer<Dtype> {
+public:
+    explicit MKLDNNSplitLayer(const LayerParameter& param)
+            : Layer<Dtype>(param)
+        {}
+    ~MKLDNNSplitLayer() {}
+protected:
+    virtual void Reshape(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+
+    virtual inline const char* type() const { return "Split"; }
+    virtual inline int ExactNumBottomBlobs() const { return 1; }
+    virtual inline int MinTopBlobs() const { return 1; }
+
+    virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top);
+    virtual void Backward_cpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+    virtual void Backward_gpu(const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down
+                                , const vector<Blob<Dtype>*>& bottom);
+};
+
 }  // namespace caffe
 #endif  // #ifndef CAFFE_MKLDNN_LAYERS_HPP_
@@ -26,6 +26,19 @@ class SoftmaxLayer : public Layer<Dtype> {
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
 
+  /**
+   * @brief Computes the softmax like Forward_cpu and, when label is not NULL,
+   *        the multinomial logistic loss of the result in the same pass.
+   *
+   * label holds one class index per outer and inner position, as the second
+   * bottom of SoftmaxWithLossLayer. Positions labeled ignore_label are
+   * skipped if has_ignore_label is set. The summed loss and the number of
+   * positions it covers are returned in loss and count.
+   */
+  void ForwardWithLoss_cpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top, const Dtype* label,
+      bool has_ignore_label, int ignore_label, Dtype* loss, int* count);
+
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
@@ -35,8 +48,6 @@ class SoftmaxLayer : public Layer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
      const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
-  virtual void Forward_cpu_fast_case(const vector<Blob<Dtype>*>& bottom,
-     const vector<Blob<Dtype>*>& top);
 
   int outer_num_;
   int inner_num_;
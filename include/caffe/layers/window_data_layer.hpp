@@ -11,6 +11,7 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/image_reader.hpp"
 
 namespace caffe {
 
@@ -18,6 +19,11 @@ namespace caffe {
  * @brief Provides data to the Net from windows of images files, specified
  *        by a window data file.
  *
+ * The images of the windows of a batch are read in parallel by a pool of
+ * reader_threads, and decoded once for all their windows, in parallel on
+ * the OpenMP threads, which then crop the windows. The last
+ * image_cache_size decoded images are kept for the next batches.
+ *
  * TODO(dox): thorough documentation for Forward and proto params.
  */
 template <typename Dtype>
@@ -48,6 +54,8 @@ class WindowDataLayer : public BasePrefetchingDataLayer<Dtype> {
   bool has_mean_values_;
   bool cache_images_;
   vector<std::pair<std::string, Datum > > image_database_cache_;
+  shared_ptr<AsyncFileReader> reader_;
+  shared_ptr<ImageCache> image_cache_;
 };
 
 }  // namespace caffe
@@ -0,0 +1,62 @@
+#ifndef CAFFE_LAYERWISE_UPDATER_HPP_
+#define CAFFE_LAYERWISE_UPDATER_HPP_
+
+#include <vector>
+
+#include "caffe/internal_thread.hpp"
+#include "caffe/MultiSolver.hpp"
+#include "caffe/util/blocking_queue.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Applies solver updates layer by layer on a pool of threads, as soon
+ *        as the backward pass has produced the final gradients of a layer's
+ *        parameters, so that the update of late layers overlaps with the
+ *        backward pass of earlier ones.
+ *
+ * The updater disables the solver's own end-of-iteration update and waits
+ * for all pending updates before the next iteration starts. Each thread
+ * updates one parameter at a time, the solver's layer_wise_update_threads
+ * threads working on different parameters.
+ */
+template <typename Dtype>
+class LayerwiseUpdater : public MultiSolver<Dtype>::Callback {
+ public:
+  explicit LayerwiseUpdater(shared_ptr<MultiSolver<Dtype> > solver);
+  virtual ~LayerwiseUpdater();
+
+ protected:
+  virtual void on_start(int layer_id) {}
+  virtual void on_forward_finished(int layer_id) {}
+  virtual void on_backward_start(int layer_id) {}
+  virtual void on_gradients_ready(int layer_id);
+  virtual void on_start() {}
+  virtual void on_gradients_ready();
+
+  // One of the threads applying the queued updates.
+  class UpdateThread : public InternalThread {
+   public:
+    explicit UpdateThread(LayerwiseUpdater* updater) : updater_(updater) {}
+
+   protected:
+    virtual void InternalThreadEntry();
+
+    LayerwiseUpdater* updater_;
+  };
+
+  shared_ptr<MultiSolver<Dtype> > solver_;
+  vector<shared_ptr<UpdateThread> > threads_;
+  // Learnable params whose gradient is complete once the backward pass of
+  // the given layer has run, i.e. the lowest layer using each param.
+  vector<vector<int> > ready_params_;
+  BlockingQueue<int> pending_;
+  BlockingQueue<int> done_;
+  int in_flight_;
+
+  DISABLE_COPY_AND_ASSIGN(LayerwiseUpdater);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_LAYERWISE_UPDATER_HPP_
@@ -31,7 +31,7 @@ public:
     virtual bool layout_compare(shared_ptr<PrvMemDescr> other);
     virtual PrvDescrType get_descr_type() {return PRV_DESCR_MKLDNN;}
     virtual size_t prv_count();
-    virtual size_t prv_size() { return prv_size() * sizeof(Dtype); }
+    virtual size_t prv_size() { return prv_count() * sizeof(Dtype); }
     // ---------------------------------------
     shared_ptr<MKLDNNMemoryDescriptorBase<Dtype> > get_shared_ptr() {
         return this->shared_from_this();
@@ -121,5 +121,17 @@ public:
         : MKLDNNMemoryDescriptor<Dtype, true>(usr_memory_pd, prv_memory_pd ) {}
 };
 
+// Returns the MKLDNN descriptor of the blob private data (or diff),
+// or NULL if the blob does not currently hold MKLDNN private memory.
+template <typename Dtype, bool is_diff>
+shared_ptr<MKLDNNMemoryDescriptor<Dtype, is_diff> > get_mkldnn_prv_descriptor(Blob<Dtype>* blob);
+
+// Adds the parameter diff computed in diff_iter to the blob diff, which is
+// kept in the private layout of diff_descr when it needs conversion.
+// Used when iter_size > 1 and diffs are accumulated across iterations.
+template <typename Dtype>
+void accumulate_mkldnn_diff(Blob<Dtype>* blob, shared_ptr<MKLDNNDiff<Dtype> > diff_descr
+                            , shared_ptr<MKLDNNDiff<Dtype> > diff_iter);
+
 }  // namespace caffe
 #endif  // #ifndef CAFFE_MKLDNN_MEMORY_HPP_
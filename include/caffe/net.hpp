@@ -10,6 +10,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/layer.hpp"
+#include "caffe/layers/fused_elementwise_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
 
 namespace caffe {
@@ -50,7 +51,9 @@ class Net {
    * networks, note that (1) computing from one layer to another might entail
    * extra computation on unrelated branches, and (2) computation starting in
    * the middle may be incorrect if all of the layers of a fan-in are not
-   * included.
+   * included. Chains fused by NetParameter.fuse_elementwise only run fused
+   * when the range covers the whole chain, so running the net one layer at a
+   * time never fuses.
    */
   Dtype ForwardFromTo(int start, int end);
   Dtype ForwardFrom(int start);
@@ -106,6 +109,11 @@ class Net {
    *        additional memory) the pre-trained layers from another Net.
    */
   void ShareTrainedLayersWith(const Net* other);
+  /**
+   * @brief For an already initialized net, copies the pre-trained layers from
+   *        another Net into its own param blobs.
+   */
+  void CopyTrainedLayersFrom(const Net* other);
   // For an already initialized net, CopyTrainedLayersFrom() copies the already
   // trained layers from another net parameter instance.
   /**
@@ -116,6 +124,12 @@ class Net {
   void CopyTrainedLayersFrom(const string trained_filename);
   void CopyTrainedLayersFromBinaryProto(const string trained_filename);
   void CopyTrainedLayersFromHDF5(const string trained_filename);
+  /**
+   * @brief Maps the pre-trained layers of a weights map file (see
+   *        MappedWeights) directly into the param blobs instead of copying
+   *        them. Weights stored in another precision than Dtype are copied.
+   */
+  void CopyTrainedLayersFromMapped(const string trained_filename);
   /// @brief Writes the net to a proto.
   void ToProto(NetParameter* param, bool write_diff = false) const;
   /// @brief Writes the net to an HDF5 file.
@@ -246,6 +260,13 @@ class Net {
   void AppendParam(const NetParameter& param, const int layer_id,
                    const int param_id);
 
+  /// @brief Replaces chains of elementwise layers with fused layers for
+  ///        execution; see FusedElementwiseLayer.
+  void FuseElementwiseLayers();
+
+  /// @brief Helper for ShareTrainedLayersWith and CopyTrainedLayersFrom.
+  void ShareOrCopyTrainedLayers(const Net* other, bool copy);
+
   /// @brief Helper for displaying debug info in Forward.
   void ForwardDebugInfo(const int layer_id);
   /// @brief Helper for displaying debug info in Backward.
@@ -306,6 +327,11 @@ class Net {
   /// the weight decay multipliers for learnable_params_
   vector<float> params_weight_decay_;
   vector<bool> has_params_decay_;
+  /// Fused elementwise chains, the range of layer ids [first, last] each of
+  /// them replaces, and for every layer the fused chain it belongs to or -1.
+  vector<shared_ptr<FusedElementwiseLayer<Dtype> > > fused_layers_;
+  vector<pair<int, int> > fused_layer_ranges_;
+  vector<int> fused_layer_ids_;
   /// The bytes of memory used by this net
   size_t memory_used_;
   /// Whether to compute and display debug info for the net.
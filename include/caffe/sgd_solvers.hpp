@@ -1,6 +1,7 @@
 #ifndef CAFFE_SGD_SOLVERS_HPP_
 #define CAFFE_SGD_SOLVERS_HPP_
 
+#include <boost/thread/mutex.hpp>
 #include <string>
 #include <vector>
 
@@ -8,6 +9,25 @@
 
 namespace caffe {
 
+/**
+ * @brief Gradient preprocessing folded into the fused CPU update kernels:
+ *        iter_size normalization followed by L2 and/or L1 weight decay,
+ *        g = scale * diff + l2_decay * data + l1_decay * sign(data).
+ */
+template <typename Dtype>
+struct FusedGradient {
+  Dtype scale;
+  Dtype l2_decay;
+  Dtype l1_decay;
+
+  inline Dtype operator()(Dtype diff, Dtype data) const {
+    Dtype g = scale * diff;
+    g += l2_decay * data;
+    g += l1_decay * ((Dtype(0) < data) - (data < Dtype(0)));
+    return g;
+  }
+};
+
 /**
  * @brief Optimizes the parameters of a Net using
  *        stochastic gradient descent (SGD) with momentum.
@@ -32,6 +52,15 @@ class SGDSolver : public Solver<Dtype> {
   virtual void Regularize(int param_id);
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
   virtual void ClipGradients();
+  FusedGradient<Dtype> GetFusedGradient(int param_id);
+  /**
+   * @brief Single-pass CPU update of one parameter: reads data, diff and
+   *        history once, leaves the update value in diff and applies it to
+   *        data, equivalent to Normalize, Regularize, ComputeUpdateValue and
+   *        Blob::Update run in sequence.
+   */
+  virtual void FusedUpdate(int param_id, Dtype rate,
+      const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff);
   virtual void SnapshotSolverState(const string& model_filename);
   virtual void SnapshotSolverStateToBinaryProto(const string& model_filename);
   virtual void SnapshotSolverStateToHDF5(const string& model_filename);
@@ -42,6 +71,9 @@ class SGDSolver : public Solver<Dtype> {
   // temp maintains other information that might be needed in computation
   //   of gradients/updates and is not needed in snapshots
   vector<shared_ptr<Blob<Dtype> > > history_, update_, temp_;
+  // Guards current_step_, layer-wise updates call GetLearningRate from
+  // several threads.
+  boost::mutex learning_rate_mutex_;
 
   DISABLE_COPY_AND_ASSIGN(SGDSolver);
 };
@@ -57,6 +89,8 @@ class NesterovSolver : public SGDSolver<Dtype> {
 
  protected:
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  virtual void FusedUpdate(int param_id, Dtype rate,
+      const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff);
 
   DISABLE_COPY_AND_ASSIGN(NesterovSolver);
 };
@@ -72,6 +106,8 @@ class AdaGradSolver : public SGDSolver<Dtype> {
 
  protected:
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  virtual void FusedUpdate(int param_id, Dtype rate,
+      const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff);
   void constructor_sanity_check() {
     CHECK_EQ(0, this->param_.momentum())
         << "Momentum cannot be used with AdaGrad.";
@@ -92,6 +128,8 @@ class RMSPropSolver : public SGDSolver<Dtype> {
 
  protected:
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  virtual void FusedUpdate(int param_id, Dtype rate,
+      const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff);
   void constructor_sanity_check() {
     CHECK_EQ(0, this->param_.momentum())
         << "Momentum cannot be used with RMSProp.";
@@ -116,6 +154,8 @@ class AdaDeltaSolver : public SGDSolver<Dtype> {
  protected:
   void AdaDeltaPreSolve();
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  virtual void FusedUpdate(int param_id, Dtype rate,
+      const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff);
 
   DISABLE_COPY_AND_ASSIGN(AdaDeltaSolver);
 };
@@ -140,10 +180,64 @@ class AdamSolver : public SGDSolver<Dtype> {
  protected:
   void AdamPreSolve();
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  virtual void FusedUpdate(int param_id, Dtype rate,
+      const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff);
 
   DISABLE_COPY_AND_ASSIGN(AdamSolver);
 };
 
+/**
+ * @brief LARSSolver, SGD with momentum where each parameter blob gets its own
+ *        learning rate scaled by the trust ratio
+ *        lars_eta * ||w|| / ||g + weight_decay * w||. Described in [1].
+ *
+ * [1] Y. You, I. Gitman and B. Ginsburg, "Large Batch Training of
+ *     Convolutional Networks." arXiv preprint arXiv:1708.03888 (2017).
+ */
+template <typename Dtype>
+class LARSSolver : public SGDSolver<Dtype> {
+ public:
+  explicit LARSSolver(const SolverParameter& param)
+      : SGDSolver<Dtype>(param) {}
+  explicit LARSSolver(const string& param_file)
+      : SGDSolver<Dtype>(param_file) {}
+  virtual inline const char* type() const { return "LARS"; }
+
+ protected:
+  Dtype TrustRatio(Dtype sumsq_data, Dtype sumsq_diff);
+  virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  virtual void FusedUpdate(int param_id, Dtype rate,
+      const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff);
+
+  DISABLE_COPY_AND_ASSIGN(LARSSolver);
+};
+
+/**
+ * @brief LAMBSolver, Adam with decoupled L2 weight decay where the update
+ *        of each parameter blob is scaled by the trust ratio
+ *        ||w|| / ||update||. Described in [1].
+ *
+ * [1] Y. You et al., "Large Batch Optimization for Deep Learning: Training
+ *     BERT in 76 minutes." arXiv preprint arXiv:1904.00962 (2019).
+ */
+template <typename Dtype>
+class LAMBSolver : public AdamSolver<Dtype> {
+ public:
+  explicit LAMBSolver(const SolverParameter& param)
+      : AdamSolver<Dtype>(param) {}
+  explicit LAMBSolver(const string& param_file)
+      : AdamSolver<Dtype>(param_file) {}
+  virtual inline const char* type() const { return "LAMB"; }
+
+ protected:
+  virtual void Regularize(int param_id);
+  virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  virtual void FusedUpdate(int param_id, Dtype rate,
+      const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff);
+
+  DISABLE_COPY_AND_ASSIGN(LAMBSolver);
+};
+
 }  // namespace caffe
 
 #endif  // CAFFE_SGD_SOLVERS_HPP_
@@ -0,0 +1,49 @@
+#ifndef CAFFE_SNAPSHOT_WRITER_HPP_
+#define CAFFE_SNAPSHOT_WRITER_HPP_
+
+#include <string>
+
+#include "caffe/common.hpp"
+#include "caffe/internal_thread.hpp"
+#include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/io.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Serializes and writes snapshot protos on a separate thread, so that
+ *        training only pays for copying the parameters into the proto.
+ *
+ * Each file is written under a temporary name and renamed when complete, so
+ * an interrupted write never leaves a truncated snapshot behind.
+ */
+class SnapshotWriter : public InternalThread {
+ public:
+  struct Job {
+    shared_ptr<Message> proto;
+    string filename;
+  };
+
+  SnapshotWriter();
+  // Waits for the pending writes before stopping the thread.
+  virtual ~SnapshotWriter();
+
+  // Queues proto to be written to filename. The proto must not be modified
+  // by the caller afterwards.
+  void Write(shared_ptr<Message> proto, const string& filename);
+  // Blocks until all queued protos are on disk.
+  void Wait();
+
+ protected:
+  virtual void InternalThreadEntry();
+
+  BlockingQueue<shared_ptr<Job> > pending_;
+  BlockingQueue<shared_ptr<Job> > done_;
+  int in_flight_;
+
+  DISABLE_COPY_AND_ASSIGN(SnapshotWriter);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_SNAPSHOT_WRITER_HPP_
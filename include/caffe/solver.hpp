@@ -4,8 +4,11 @@
 #include <string>
 #include <vector>
 
+#include "caffe/internal_thread.hpp"
 #include "caffe/net.hpp"
+#include "caffe/snapshot_writer.hpp"
 #include "caffe/solver_factory.hpp"
+#include "caffe/util/blocking_queue.hpp"
 
 namespace caffe {
 
@@ -31,6 +34,9 @@ namespace caffe {
  */
 typedef boost::function<SolverAction::Enum()> ActionCallback;
 
+template <typename Dtype>
+class AsyncTester;
+
 /**
  * @brief An interface for classes that perform optimization on Net%s.
  *
@@ -104,24 +110,35 @@ class Solver {
   // function that produces a SolverState protocol buffer that needs to be
   // written to disk together with the learned net.
   void Snapshot();
+  // Blocks until snapshots written in the background are on disk.
+  void WaitForSnapshots();
 
   // Make and apply the update value for the current iteration.
   virtual void ApplyUpdate() = 0;
   virtual void ApplyUpdate(int param_id) = 0;
 
+  // Runs the test nets, or with test_async starts them on the test thread
+  // once the previous test is done and returns.
   void TestAll();
+  // Blocks until the test nets started by TestAll are done.
+  void WaitForTests();
 
  protected:
   string SnapshotFilename(const string extension);
   string SnapshotToBinaryProto();
   string SnapshotToHDF5();
-  // The test routine
-  void Test(const int test_net_id = 0);
+  // Writes a snapshot proto, in the background if snapshot_async is set.
+  void WriteSnapshotProto(shared_ptr<Message> proto, const string& filename);
+  // The test routine, tested_iter is the iteration of the tested weights
+  void Test(const int test_net_id, const int tested_iter);
   virtual void SnapshotSolverState(const string& model_filename) = 0;
   virtual void RestoreSolverStateFromHDF5(const string& state_file) = 0;
   virtual void RestoreSolverStateFromBinaryProto(const string& state_file) = 0;
   void DisplayOutputBlobs(const int net_id);
   void UpdateSmoothedLoss(Dtype loss, int start_iter, int average_loss);
+  // With data_cores = -1, periodically adjusts the cores reserved for data
+  // loading to the share of iteration time spent waiting for batches.
+  void TuneDataCores(double iteration_us);
 
   SolverParameter param_;
   int iter_;
@@ -145,9 +162,55 @@ class Solver {
 
   ForwardBackwardFunc forward_backward_;
 
+  // Created on the first asynchronous snapshot.
+  shared_ptr<SnapshotWriter> snapshot_writer_;
+  // Created on the first asynchronous test. Declared after the nets so that
+  // it stops before they are destroyed.
+  shared_ptr<AsyncTester<Dtype> > async_tester_;
+
+  // Iterations and time since the data cores were last tuned, and the time
+  // waited for batches then, -1 before the first interval.
+  int data_cores_iters_;
+  double data_cores_iteration_us_;
+  int64_t data_cores_wait_us_;
+
+  friend class AsyncTester<Dtype>;
+
   DISABLE_COPY_AND_ASSIGN(Solver);
 };
 
+/**
+ * @brief Runs the test nets of a Solver on a separate thread, so that
+ *        training continues during tests. The test nets work on their own
+ *        copy of the weights, which the Solver refreshes between tests.
+ *
+ * In CPU mode, the thread and its OpenMP team are bound to the test_cores
+ * reserved cores if any.
+ */
+template <typename Dtype>
+class AsyncTester : public InternalThread {
+ public:
+  explicit AsyncTester(Solver<Dtype>* solver);
+  // Waits for the pending test before stopping the thread.
+  virtual ~AsyncTester();
+
+  // Queues a test of the weights of iteration tested_iter, which must be in
+  // the test nets already.
+  void Test(int tested_iter);
+  // Blocks until the queued tests are done.
+  void Wait();
+
+ protected:
+  virtual void InternalThreadEntry();
+
+  Solver<Dtype>* solver_;
+  BlockingQueue<int> pending_;
+  BlockingQueue<int> done_;
+  int in_flight_;
+
+  DISABLE_COPY_AND_ASSIGN(AsyncTester);
+};
+
 /**
  * @brief Solver that only computes gradients, used as worker
  *        for multi-GPU training.
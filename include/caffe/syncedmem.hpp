@@ -10,6 +10,7 @@
 
 #include "boost/thread/mutex.hpp"
 #include "caffe/common.hpp"
+#include "caffe/util/host_memory_pool.hpp"
 
 namespace caffe {
 
@@ -18,6 +19,7 @@ namespace caffe {
 // The improvement in performance seems negligible in the single GPU case,
 // but might be more significant for parallel training. Most importantly,
 // it improved stability for large models on many GPUs.
+// On the CPU, memory comes from the caching HostMemoryPool.
 inline void CaffeMallocHost(void** ptr, size_t size, bool* use_cuda) {
 #ifndef CPU_ONLY
   if (Caffe::mode() == Caffe::GPU) {
@@ -26,11 +28,7 @@ inline void CaffeMallocHost(void** ptr, size_t size, bool* use_cuda) {
     return;
   }
 #endif
-#ifdef USE_MKL
-  *ptr = mkl_malloc(size ? size : 1, 64);
-#else
-  *ptr = malloc(size);
-#endif
+  *ptr = HostMemoryPool::Get().Allocate(size);
   *use_cuda = false;
   CHECK(*ptr) << "host allocation of size " << size << " failed";
 }
@@ -42,11 +40,7 @@ inline void CaffeFreeHost(void* ptr, bool use_cuda) {
     return;
   }
 #endif
-#ifdef USE_MKL
-  mkl_free(ptr);
-#else
-  free(ptr);
-#endif
+  HostMemoryPool::Get().Free(ptr);
 }
 
 // Base class
@@ -88,6 +82,9 @@ class SyncedMemory {
   ~SyncedMemory();
   const void* cpu_data();
   void set_cpu_data(void* data);
+  /// @brief Uses data, kept valid by owner, e.g. a mapped file, as the CPU
+  ///        data; the memory holds owner until it stops using data.
+  void set_cpu_data(void* data, shared_ptr<void> owner);
   const void* gpu_data();
   void set_gpu_data(void* data);
   void* mutable_cpu_data();
@@ -114,6 +111,7 @@ class SyncedMemory {
   const size_t size_;
   SyncedHead head_;
   bool own_cpu_data_;
+  shared_ptr<void> cpu_data_owner_;
   bool cpu_malloc_use_cuda_;
   bool own_gpu_data_;
   bool own_prv_data_;
@@ -0,0 +1,91 @@
+#ifndef CAFFE_UTIL_BOUNDED_QUEUE_HPP_
+#define CAFFE_UTIL_BOUNDED_QUEUE_HPP_
+
+#include <string>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Lock-free, fixed capacity, multi-producer multi-consumer queue.
+ *
+ * Elements live in a ring buffer of capacity rounded up to a power of two.
+ * Each slot carries a sequence number telling producers and consumers whether
+ * it is ready for them, so push and pop only take a compare-and-swap on the
+ * shared position. Blocking calls first spin for spin_count attempts, then
+ * sleep on a condition variable until the queue changes; the sleep is a
+ * boost interruption point, as for BlockingQueue.
+ *
+ * Same interface as BlockingQueue, except that push blocks while the queue is
+ * full. Use it where the number of elements in flight is bounded, e.g. queues
+ * recycling a fixed set of buffers.
+ */
+template<typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity, int spin_count = 1000);
+  ~BoundedQueue();
+
+  // Waits while the queue is full
+  void push(const T& t);
+
+  bool try_push(const T& t);
+
+  bool try_pop(T* t);
+
+  // Waits at most timeout_us microseconds for an element
+  bool try_pop(T* t, int timeout_us);
+
+  // This logs a message if the threads needs to be blocked
+  // useful for detecting e.g. when data feeding is too slow
+  T pop(const string& log_on_wait = "");
+
+  // Peeking must not race with pops from other threads
+  bool try_peek(T* t);
+
+  // Return element without removing it
+  T peek();
+
+  // Approximate when other threads are using the queue
+  size_t size() const;
+
+  inline size_t capacity() const { return mask_ + 1; }
+
+ protected:
+  struct Cell {
+    size_t sequence;
+    T data;
+  };
+  // Avoids false sharing between the producer and consumer positions.
+  static const int kCacheLine = 64;
+
+  void wait(int* waiting, bool for_element);
+  void notify(int* waiting, bool for_element);
+
+  /**
+   Move synchronization fields out instead of including boost/thread.hpp
+   to avoid a boost/NVCC issues (#1009, #1010) on OSX.
+   */
+  class sync;
+
+  char pad0_[kCacheLine];
+  size_t enqueue_pos_;
+  char pad1_[kCacheLine - sizeof(size_t)];
+  size_t dequeue_pos_;
+  char pad2_[kCacheLine - sizeof(size_t)];
+  // Threads sleeping for an element, or for a free slot.
+  int consumers_waiting_;
+  int producers_waiting_;
+
+  Cell* buffer_;
+  size_t mask_;
+  int spin_count_;
+  shared_ptr<sync> sync_;
+
+DISABLE_COPY_AND_ASSIGN(BoundedQueue);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_BOUNDED_QUEUE_HPP_
@@ -1,6 +1,7 @@
 #ifndef CAFFE_UTIL_CPU_INFO_HPP
 #define CAFFE_UTIL_CPU_INFO_HPP
 
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
 #include <sched.h>
 #include <cstdio>
@@ -108,6 +109,41 @@ class OpenMpManager {
   static bool isMajorThread(boost::thread::id currentThread);
   static unsigned getProcessorSpeedMHz();
 
+  // Splits the available cores, socket by socket, into numberOfPartitions
+  // groups and returns one CPU per core of the given group.
+  static void getPartitionCpuSet(unsigned partitionId,
+    unsigned numberOfPartitions, cpu_set_t *set);
+  static unsigned getSocketId(unsigned processorId);
+  // Limits the OpenMP teams the current thread starts to one thread per CPU
+  // of set and, unless thread binding is not allowed, binds the thread to
+  // the CPUs of set and each thread of its teams to its own CPU.
+  static void bindCurrentThreadToCpuSet(const cpu_set_t *set);
+
+  // Reserves the last numberOfCores available cores for the thread running
+  // test nets asynchronously, moving the data cores before them.
+  static void setNumberOfTestCores(unsigned numberOfCores);
+  static unsigned getNumberOfTestCores();
+  // Binds the current thread and its OpenMP team to the test cores, or to the
+  // compute cores when none are reserved.
+  static void bindCurrentThreadToTestCores();
+
+  // Reserves the last numberOfCores available cores before the test cores for
+  // data loading threads. bindOpenMpThreads binds the compute team to the
+  // other cores.
+  static void setNumberOfDataCores(unsigned numberOfCores);
+  static unsigned getNumberOfDataCores();
+  // Adds or removes one data core depending on the share of compute time
+  // spent waiting for data, and rebinds the compute team on a change.
+  static void tuneNumberOfDataCores(double waitRatio);
+  // Binds the current data loading thread, and its OpenMP team if
+  // bindOpenMpTeam, to the data cores if they changed since bindingVersion.
+  static void bindCurrentThreadToDataCores(unsigned *bindingVersion,
+    bool bindOpenMpTeam);
+  // Binds the current thread, and its OpenMP team if bindOpenMpTeam, to the
+  // compute cores, i.e. the ones reserved for neither data nor tests, instead
+  // of the core InternalThread binds background threads to.
+  static void bindCurrentThreadToComputeCores(bool bindOpenMpTeam);
+
  private:
   boost::thread::id mainThreadId;
   Collection &collection;
@@ -117,6 +153,16 @@ class OpenMpManager {
   cpu_set_t currentCpuSet;
   cpu_set_t currentCoreSet;
 
+  boost::mutex dataCoresMutex;
+  unsigned numberOfDataCores;
+  // Largest number of data cores found too few by tuneNumberOfDataCores.
+  unsigned insufficientDataCores;
+  // Incremented on every change of dataCoreSet.
+  unsigned dataCoresVersion;
+  cpu_set_t dataCoreSet;
+  unsigned numberOfTestCores;
+  cpu_set_t testCoreSet;
+
   explicit OpenMpManager(Collection *collection);
   OpenMpManager(const OpenMpManager &openMpManager);
   OpenMpManager &operator =(const OpenMpManager &openMpManager);
@@ -132,6 +178,8 @@ class OpenMpManager {
 
   bool isThreadsBindAllowed();
   void setOpenMpThreadNumberLimit();
+  void selectLogicalCores(unsigned begin, unsigned end, cpu_set_t *set);
+  void updateDataCoreSet(unsigned numberOfCores);
   void bindCurrentThreadToLogicalCoreCpu(unsigned logicalCoreId);
   void bindCurrentThreadToLogicalCoreCpus(unsigned logicalCoreId);
 };
@@ -0,0 +1,159 @@
+#ifndef CAFFE_UTIL_DB_RECORDIO_HPP
+#define CAFFE_UTIL_DB_RECORDIO_HPP
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "caffe/util/db.hpp"
+
+namespace caffe { namespace db {
+
+// Entry of the index of a RecordIO db.
+struct RecordIOShard {
+  string name;
+  int64_t records;
+  int64_t bytes;
+};
+
+// Reads the records of the shards given, or with num_partitions > 1 only the
+// records i with i % num_partitions == partition, i counting the records of
+// the shards in their given order whatever the shuffling.
+class RecordIOCursor : public Cursor {
+ public:
+  RecordIOCursor(const string& source, const vector<RecordIOShard>& shards,
+      bool shuffle_shards, int partition, int num_partitions);
+  ~RecordIOCursor() { CloseShard(); }
+  virtual void SeekToFirst();
+  virtual void Next();
+  virtual string key() {
+    return string(&buffer_[0] + record_ + kHeaderSize, key_size_);
+  }
+  virtual string value() {
+    return string(&buffer_[0] + record_ + kHeaderSize + key_size_,
+        value_size_);
+  }
+  virtual bool valid() { return valid_; }
+
+  static const uint32_t kMagic = 0xced7230a;
+  static const size_t kHeaderSize = 3 * sizeof(uint32_t);
+  // Size of the reads from a shard.
+  static const size_t kBlockSize = 4 << 20;
+
+ protected:
+  void OpenShard(int position);
+  void CloseShard();
+  // Makes at least size bytes from the current record available in the
+  // buffer, returns false at the end of the shard. Only the bytes listed in
+  // the index are read.
+  bool Fill(size_t size);
+  // Parses the first record of the partition from the current position,
+  // moving on to the next shards if the current one is finished.
+  void ReadRecord();
+
+  string source_;
+  vector<RecordIOShard> shards_;
+  bool shuffle_shards_;
+  int partition_;
+  int num_partitions_;
+  // Index of the first record of each shard.
+  vector<int64_t> shard_starts_;
+  vector<int> order_;
+  // Position of the current shard in order_.
+  int position_;
+  // Index of the current record.
+  int64_t index_;
+  int fd_;
+  int64_t file_offset_;
+  vector<char> buffer_;
+  // Offset of the current record in the buffer, and end of the data read.
+  size_t record_;
+  size_t end_;
+  uint32_t key_size_;
+  uint32_t value_size_;
+  bool valid_;
+
+  DISABLE_COPY_AND_ASSIGN(RecordIOCursor);
+};
+
+class RecordIO;
+
+class RecordIOTransaction : public Transaction {
+ public:
+  explicit RecordIOTransaction(RecordIO* db) : db_(db), records_(0) {
+    CHECK_NOTNULL(db_);
+  }
+  virtual void Put(const string& key, const string& value);
+  virtual void Commit();
+
+ private:
+  RecordIO* db_;
+  string batch_;
+  int64_t records_;
+
+  DISABLE_COPY_AND_ASSIGN(RecordIOTransaction);
+};
+
+/**
+ * @brief Directory of append-only shard files holding the records one after
+ *        the other, for sequential reads in large blocks.
+ *
+ * Each record is a header (magic, key size, value size) followed by the key
+ * and the value. A text index file lists the shards with their number of
+ * records and bytes; it is rewritten on every commit, so a partially written
+ * db can be read. Shards are closed once they reach shard_size bytes, the
+ * records of one commit always going to the same shard.
+ *
+ * Cursors read a shard a block at a time and advise the kernel to read the
+ * next block ahead. With set_shuffle_shards, cursors visit the shards in a
+ * random order on every SeekToFirst, the records of a shard staying in order.
+ * With set_partition, cursors only visit part of the shards, so that several
+ * readers can split the db without reading the records of the others. A db
+ * with fewer shards than partitions is split by record instead.
+ */
+class RecordIO : public DB {
+ public:
+  explicit RecordIO(int64_t shard_size = kDefaultShardSize)
+    : mode_(READ), shard_size_(shard_size), shuffle_shards_(false),
+      partition_(0), num_partitions_(1), file_(NULL) { }
+  virtual ~RecordIO() { Close(); }
+  virtual void Open(const string& source, Mode mode);
+  virtual void Close();
+  virtual RecordIOCursor* NewCursor();
+  virtual RecordIOTransaction* NewTransaction() {
+    CHECK_NE(mode_, READ) << "RecordIO db " << source_ << " opened for reading";
+    return new RecordIOTransaction(this);
+  }
+  // Applies to the cursors created afterwards.
+  void set_shuffle_shards(bool shuffle) { shuffle_shards_ = shuffle; }
+  // Applies to the cursors created afterwards, which then read the shards i
+  // with i % num_partitions == partition, or if there are fewer shards than
+  // partitions, the records i with i % num_partitions == partition.
+  void set_partition(int partition, int num_partitions);
+  inline const vector<RecordIOShard>& shards() const { return shards_; }
+
+  static const int64_t kDefaultShardSize = 64 << 20;
+
+ protected:
+  friend class RecordIOTransaction;
+  // Appends serialized records to the current shard and updates the index.
+  void Append(const string& records, int64_t count);
+  void ReadIndex();
+  void WriteIndex();
+
+  string source_;
+  Mode mode_;
+  int64_t shard_size_;
+  bool shuffle_shards_;
+  int partition_;
+  int num_partitions_;
+  vector<RecordIOShard> shards_;
+  // Shard being written, the last one of shards_.
+  FILE* file_;
+};
+
+}  // namespace db
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_DB_RECORDIO_HPP
@@ -0,0 +1,83 @@
+#ifndef CAFFE_UTIL_HOST_MEMORY_POOL_HPP_
+#define CAFFE_UTIL_HOST_MEMORY_POOL_HPP_
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "boost/thread/mutex.hpp"
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+struct HostMemoryStats {
+  size_t bytes_in_use;
+  size_t peak_bytes_in_use;
+  size_t bytes_cached;
+  size_t allocations;
+  // Allocations served from the cache.
+  size_t hits;
+
+  HostMemoryStats()
+    : bytes_in_use(0), peak_bytes_in_use(0), bytes_cached(0), allocations(0),
+      hits(0) {}
+  double hit_rate() const {
+    return allocations ? static_cast<double>(hits) / allocations : 0;
+  }
+};
+
+/**
+ * @brief Caching allocator behind CaffeMallocHost.
+ *
+ * Sizes are rounded up to size classes, four per power of two, and freed
+ * blocks are kept per class for reuse instead of being returned to the
+ * system, so that reshaping blobs and creating nets does not go through the
+ * system allocator every time. There is one arena per NUMA node; a block is
+ * served from the arena of the node the allocating thread runs on, and large
+ * blocks are bound to that node.
+ *
+ * The defaults can be changed with the environment variables
+ * CAFFE_HOST_POOL_MAX_CACHED_MB (0 disables caching) and
+ * CAFFE_HOST_POOL_HUGE_PAGES (1 backs large blocks with huge pages).
+ */
+class HostMemoryPool {
+ public:
+  static HostMemoryPool& Get();
+
+  void* Allocate(size_t size);
+  void Free(void* ptr);
+
+  // Returns all cached blocks to the system.
+  void ReleaseCached();
+  HostMemoryStats stats();
+
+  // Limit on the bytes kept in the cache; blocks freed beyond it are
+  // returned to the system.
+  void set_max_cached_bytes(size_t bytes);
+  // Whether to advise the kernel to back large blocks with huge pages.
+  void set_huge_pages(bool enable);
+  int num_nodes() const { return arenas_.size(); }
+
+ protected:
+  struct Arena {
+    boost::mutex mutex;
+    std::map<size_t, std::vector<void*> > free_blocks;
+  };
+
+  HostMemoryPool();
+  int CurrentNode() const;
+  void* SystemAllocate(size_t bytes, int node);
+  void SystemFree(void* block, size_t bytes);
+
+  std::vector<shared_ptr<Arena> > arenas_;
+  boost::mutex stats_mutex_;
+  HostMemoryStats stats_;
+  size_t max_cached_bytes_;
+  bool huge_pages_;
+
+  DISABLE_COPY_AND_ASSIGN(HostMemoryPool);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_HOST_MEMORY_POOL_HPP_
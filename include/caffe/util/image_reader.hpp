@@ -0,0 +1,109 @@
+#ifndef CAFFE_UTIL_IMAGE_READER_HPP_
+#define CAFFE_UTIL_IMAGE_READER_HPP_
+
+#ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
+#endif  // USE_OPENCV
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/thread/mutex.hpp"
+#include "caffe/common.hpp"
+#include "caffe/util/blocking_queue.hpp"
+
+namespace boost { class thread; }
+
+namespace caffe {
+
+// A file read queued on an AsyncFileReader.
+class FileRead {
+ public:
+  explicit FileRead(const string& path) : path_(path), ok_(false),
+      done_(false) {}
+  // Blocks until the file is read, returns false if it could not be. Only
+  // one thread may wait on a read.
+  bool Wait();
+  inline const string& path() const { return path_; }
+  inline const string& contents() const { return contents_; }
+
+ protected:
+  friend class AsyncFileReader;
+
+  string path_;
+  string contents_;
+  bool ok_;
+  bool done_;
+  BlockingQueue<int> ready_;
+
+  DISABLE_COPY_AND_ASSIGN(FileRead);
+};
+
+/**
+ * @brief Pool of threads reading whole files in the background, so that data
+ *        layers can request the files of the next items ahead of decoding
+ *        them and keep several reads in flight.
+ *
+ * With direct_io, files are opened with O_DIRECT to bypass the page cache,
+ * which is only filled once for data read once per epoch. Reads fall back to
+ * buffered I/O where O_DIRECT is not supported, e.g. on tmpfs.
+ */
+class AsyncFileReader {
+ public:
+  AsyncFileReader(int threads, bool direct_io);
+  ~AsyncFileReader();
+
+  // Queues a read of path, reads are started in the order they are queued.
+  shared_ptr<FileRead> Read(const string& path);
+
+  // Reads path on the calling thread.
+  static bool ReadFile(const string& path, bool direct_io, string* contents);
+
+  // Alignment of O_DIRECT buffers and sizes.
+  static const size_t kAlignment = 4096;
+
+ protected:
+  void Entry();
+
+  bool direct_io_;
+  BlockingQueue<shared_ptr<FileRead> > pending_;
+  vector<shared_ptr<boost::thread> > threads_;
+
+  DISABLE_COPY_AND_ASSIGN(AsyncFileReader);
+};
+
+#ifdef USE_OPENCV
+/**
+ * @brief Least recently used set of decoded images, so that an image used
+ *        several times in a short span, e.g. by several windows, is only
+ *        decoded once. Safe to use from several threads.
+ */
+class ImageCache {
+ public:
+  // Holds up to capacity images, none with 0.
+  explicit ImageCache(int capacity) : capacity_(capacity) {}
+
+  // Returns false if the image of key is not cached.
+  bool Get(const string& key, cv::Mat* image);
+  void Put(const string& key, const cv::Mat& image);
+  inline int size() const { return index_.size(); }
+
+ protected:
+  typedef std::list<std::pair<string, cv::Mat> > Entries;
+
+  int capacity_;
+  // Most recently used first
+  Entries entries_;
+  std::map<string, Entries::iterator> index_;
+  boost::mutex mutex_;
+
+  DISABLE_COPY_AND_ASSIGN(ImageCache);
+};
+#endif  // USE_OPENCV
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_IMAGE_READER_HPP_
@@ -141,6 +141,10 @@ cv::Mat ReadImageToCVMat(const string& filename,
 
 cv::Mat ReadImageToCVMat(const string& filename);
 
+// Decodes an image file read into buffer, like ReadImageToCVMat.
+cv::Mat DecodeImageToCVMat(const string& buffer,
+    const int height, const int width, const bool is_color);
+
 cv::Mat DecodeDatumToCVMatNative(const Datum& datum);
 cv::Mat DecodeDatumToCVMat(const Datum& datum, bool is_color);
 
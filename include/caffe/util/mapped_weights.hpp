@@ -0,0 +1,56 @@
+#ifndef CAFFE_UTIL_MAPPED_WEIGHTS_H_
+#define CAFFE_UTIL_MAPPED_WEIGHTS_H_
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+namespace caffe {
+
+/**
+ * @brief Read-only view of a flat weights file that is memory-mapped instead
+ *        of parsed, so that loading a model does not copy the weights and
+ *        processes serving the same model share one page-cache copy.
+ *
+ * The file holds a fixed header, an index and the raw blob data:
+ *   - header: magic, version, element size, index size and data offset;
+ *   - index: a binary NetParameter with the layer names and blob shapes;
+ *   - data: every blob of the index in layer order, each starting at a
+ *     multiple of kMappedWeightsAlignment bytes.
+ *
+ * The mapping is private, so writing to a mapped blob copies the touched
+ * pages instead of modifying the file.
+ */
+class MappedWeights {
+ public:
+  explicit MappedWeights(const string& filename);
+  ~MappedWeights();
+
+  const NetParameter& index() const { return index_; }
+  // Size in bytes of the stored values, i.e. sizeof(float) or sizeof(double).
+  int element_size() const { return element_size_; }
+  // Data of blob j of layer i of the index.
+  void* blob_data(int i, int j) const;
+
+ protected:
+  string filename_;
+  void* addr_;
+  size_t size_;
+  int element_size_;
+  NetParameter index_;
+  vector<vector<size_t> > offsets_;
+
+  DISABLE_COPY_AND_ASSIGN(MappedWeights);
+};
+
+const int kMappedWeightsAlignment = 64;
+
+// Writes the blobs of param as Dtype values in the mapped weights format.
+template <typename Dtype>
+void WriteMappedWeights(const NetParameter& param, const string& filename);
+
+}  // namespace caffe
+
+#endif   // CAFFE_UTIL_MAPPED_WEIGHTS_H_
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <cmath>  // for std::fabs and std::signbit
+#include <cstring>
 
 #include "glog/logging.h"
 
@@ -42,6 +43,11 @@ void caffe_cpu_copy(const int N, const Dtype* X, Dtype* Y);
 template <typename Dtype>
 void caffe_set(const int N, const Dtype alpha, Dtype *X);
 
+// Whether a CPU loop over N elements should run as an OpenMP parallel
+// region, by the rule caffe_cpu_copy follows: only from the main thread,
+// outside of other parallel regions and for N large enough to pay off.
+bool caffe_cpu_run_parallel(const int N);
+
 inline void caffe_memset(const size_t N, const int alpha, void* X) {
   memset(X, alpha, N);  // NOLINT(caffe/alt_fn)
 }
@@ -88,12 +94,22 @@ void caffe_rng_bernoulli(const int n, const Dtype p, int* r);
 template <typename Dtype>
 void caffe_rng_bernoulli(const int n, const Dtype p, unsigned int* r);
 
+// Transcendental functions. They use MKL VML when available and otherwise
+// vectorizable polynomial approximations in single precision; large inputs
+// are split across the OpenMP threads.
 template <typename Dtype>
 void caffe_exp(const int n, const Dtype* a, Dtype* y);
 
 template <typename Dtype>
 void caffe_log(const int n, const Dtype* a, Dtype* y);
 
+template <typename Dtype>
+void caffe_tanh(const int n, const Dtype* a, Dtype* y);
+
+// y[i] = 1 / (1 + exp(-a[i]))
+template <typename Dtype>
+void caffe_sigmoid(const int n, const Dtype* a, Dtype* y);
+
 template <typename Dtype>
 void caffe_abs(const int n, const Dtype* a, Dtype* y);
 
@@ -108,6 +124,11 @@ Dtype caffe_cpu_strided_dot(const int n, const Dtype* x, const int incx,
 template <typename Dtype>
 Dtype caffe_cpu_asum(const int n, const Dtype* x);
 
+// Returns the sum of the squares of the elements of vector x, bitwise
+// reproducible whatever the number of OpenMP threads
+template <typename Dtype>
+Dtype caffe_cpu_sumsq(const int n, const Dtype* x);
+
 // the branchless, type-safe version from
 // http://stackoverflow.com/questions/1903954/is-there-a-standard-sign-function-signum-sgn-in-c-c
 template<typename Dtype>
@@ -145,6 +166,33 @@ DEFINE_CAFFE_CPU_UNARY_FUNC(fabs, y[i] = std::fabs(x[i]));
 template <typename Dtype>
 void caffe_cpu_scale(const int n, const Dtype alpha, const Dtype *x, Dtype* y);
 
+// Conversion to and from bfloat16, the upper 16 bits of an IEEE float, with
+// round-to-nearest-even. Used to halve the size of gradients sent between
+// nodes, blobs themselves are never stored as bfloat16.
+inline uint16_t caffe_float_to_bf16(float f) {
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));  // NOLINT(caffe/alt_fn)
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    // keep NaN a (quiet) NaN instead of rounding it to infinity
+    return static_cast<uint16_t>((bits >> 16) | 0x40);
+  }
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float caffe_bf16_to_float(uint16_t h) {
+  const uint32_t bits = static_cast<uint32_t>(h) << 16;
+  float f;
+  memcpy(&f, &bits, sizeof(f));  // NOLINT(caffe/alt_fn)
+  return f;
+}
+
+template <typename Dtype>
+void caffe_cpu_to_bf16(const int n, const Dtype* x, uint16_t* y);
+
+template <typename Dtype>
+void caffe_cpu_from_bf16(const int n, const uint16_t* x, Dtype* y);
+
 #ifndef CPU_ONLY  // GPU
 
 // Decaf gpu gemm provides an interface that is almost the same as the cpu
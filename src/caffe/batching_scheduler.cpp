@@ -0,0 +1,197 @@
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <vector>
+
+#include "caffe/batching_scheduler.hpp"
+#include "caffe/util/cpu_info.hpp"
+
+namespace caffe {
+
+namespace {
+
+// Number of recent requests the latency percentiles are computed over.
+const int kMaxLatencySamples = 10000;
+
+float Percentile(const vector<float>& sorted, float p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const int index = static_cast<int>(p * (sorted.size() - 1) + 0.5f);
+  return sorted[index];
+}
+
+}  // namespace
+
+template <typename Dtype>
+BatchingScheduler<Dtype>::BatchingScheduler(shared_ptr<Net<Dtype> > net,
+    int max_batch_size, int max_latency_us)
+  : net_(net), max_batch_size_(max_batch_size),
+    max_latency_us_(max_latency_us), num_requests_(0), num_batches_(0),
+    latency_pos_(0) {
+  CHECK_GT(max_batch_size_, 0);
+  CHECK_GE(max_latency_us_, 0);
+  memory_data_layer_ = boost::dynamic_pointer_cast<MemoryDataLayer<Dtype> >(
+      net_->layers()[0]);
+  if (memory_data_layer_) {
+    item_shape_.push_back(memory_data_layer_->channels());
+    item_shape_.push_back(memory_data_layer_->height());
+    item_shape_.push_back(memory_data_layer_->width());
+  } else {
+    CHECK_EQ(net_->num_inputs(), 1)
+        << "Batching needs a net with one input blob or a MemoryDataLayer";
+    const vector<int>& shape = net_->input_blobs()[0]->shape();
+    CHECK_GT(shape.size(), 0) << "Batching needs a batch axis";
+    item_shape_.assign(shape.begin() + 1, shape.end());
+  }
+  StartInternalThread();
+}
+
+template <typename Dtype>
+BatchingScheduler<Dtype>::~BatchingScheduler() {
+  StopInternalThread();
+}
+
+template <typename Dtype>
+void BatchingScheduler<Dtype>::Forward(const Blob<Dtype>& input,
+    const vector<Blob<Dtype>*>& output) {
+  BatchRequest<Dtype> request;
+  request.input = &input;
+  request.output = &output;
+  request.submitted = boost::posix_time::microsec_clock::universal_time();
+  requests_.push(&request);
+  request.done.pop();
+}
+
+template <typename Dtype>
+void BatchingScheduler<Dtype>::InternalThreadEntry() {
+#ifdef _OPENMP
+  // InternalThread binds this thread to a single core, but it runs the
+  // whole net on each batch.
+  cpu::OpenMpManager::bindCurrentThreadToComputeCores(true);
+#endif
+  try {
+    while (!must_stop()) {
+      vector<BatchRequest<Dtype>*> batch(1, requests_.pop());
+      // The batch closes when it is full or when its oldest request is due.
+      const boost::posix_time::ptime deadline = batch[0]->submitted +
+          boost::posix_time::microseconds(max_latency_us_);
+      while (batch.size() < max_batch_size_) {
+        const int remaining_us = (deadline -
+            boost::posix_time::microsec_clock::universal_time())
+            .total_microseconds();
+        BatchRequest<Dtype>* request;
+        if (remaining_us <= 0 || !requests_.try_pop(&request, remaining_us)) {
+          break;
+        }
+        batch.push_back(request);
+      }
+      RunBatch(batch);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+template <typename Dtype>
+void BatchingScheduler<Dtype>::RunBatch(
+    const vector<BatchRequest<Dtype>*>& batch) {
+  const int num = batch.size();
+  vector<int> batch_shape(1, num);
+  batch_shape.insert(batch_shape.end(), item_shape_.begin(),
+      item_shape_.end());
+  Blob<Dtype>* data = memory_data_layer_ ? &batch_data_ :
+      net_->input_blobs()[0];
+  data->Reshape(batch_shape);
+  const int item_count = data->count(1);
+  for (int i = 0; i < num; ++i) {
+    CHECK_EQ(batch[i]->input->count(), item_count)
+        << "Input does not match one item of the net input";
+    caffe_copy(item_count, batch[i]->input->cpu_data(),
+        data->mutable_cpu_data() + i * item_count);
+  }
+  if (memory_data_layer_) {
+    batch_labels_.Reshape(vector<int>(1, num));
+    caffe_set(num, Dtype(0), batch_labels_.mutable_cpu_data());
+    memory_data_layer_->set_batch_size(num);
+    memory_data_layer_->Reset(batch_data_.mutable_cpu_data(),
+        batch_labels_.mutable_cpu_data(), num);
+  }
+
+  const vector<Blob<Dtype>*>& net_output = net_->Forward();
+  for (int i = 0; i < num; ++i) {
+    const vector<Blob<Dtype>*>& output = *batch[i]->output;
+    CHECK_EQ(output.size(), net_output.size())
+        << "Wrong number of output blobs";
+    for (int j = 0; j < output.size(); ++j) {
+      CHECK_EQ(net_output[j]->shape(0), num)
+          << "Output blob " << j << " is not batched";
+      vector<int> shape = net_output[j]->shape();
+      shape[0] = 1;
+      output[j]->Reshape(shape);
+      caffe_copy(output[j]->count(),
+          net_output[j]->cpu_data() + i * output[j]->count(),
+          output[j]->mutable_cpu_data());
+    }
+  }
+
+  const boost::posix_time::ptime now =
+      boost::posix_time::microsec_clock::universal_time();
+  {
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    ++num_batches_;
+    num_requests_ += num;
+    for (int i = 0; i < num; ++i) {
+      const float latency =
+          (now - batch[i]->submitted).total_microseconds() / 1000.f;
+      if (latencies_.size() < kMaxLatencySamples) {
+        latencies_.push_back(latency);
+      } else {
+        latencies_[latency_pos_] = latency;
+        latency_pos_ = (latency_pos_ + 1) % kMaxLatencySamples;
+      }
+    }
+  }
+  // Last, as the requests are gone once done.
+  for (int i = 0; i < num; ++i) {
+    batch[i]->done.push(num);
+  }
+}
+
+template <typename Dtype>
+BatchingStats BatchingScheduler<Dtype>::stats() {
+  BatchingStats stats;
+  vector<float> latencies;
+  {
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    stats.requests = num_requests_;
+    stats.batches = num_batches_;
+    latencies = latencies_;
+  }
+  stats.mean_batch_size = stats.batches ?
+      static_cast<float>(stats.requests) / stats.batches : 0;
+  std::sort(latencies.begin(), latencies.end());
+  stats.latency_mean = 0;
+  for (int i = 0; i < latencies.size(); ++i) {
+    stats.latency_mean += latencies[i];
+  }
+  if (!latencies.empty()) {
+    stats.latency_mean /= latencies.size();
+  }
+  stats.latency_p50 = Percentile(latencies, 0.5f);
+  stats.latency_p90 = Percentile(latencies, 0.9f);
+  stats.latency_p99 = Percentile(latencies, 0.99f);
+  return stats;
+}
+
+template <typename Dtype>
+void BatchingScheduler<Dtype>::ResetStats() {
+  boost::mutex::scoped_lock lock(stats_mutex_);
+  num_requests_ = 0;
+  num_batches_ = 0;
+  latencies_.clear();
+  latency_pos_ = 0;
+}
+
+INSTANTIATE_CLASS(BatchingScheduler);
+
+}  // namespace caffe
@@ -7,6 +7,7 @@
 #include "caffe/data_reader.hpp"
 #include "caffe/layers/data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/db_recordio.hpp"
 
 namespace caffe {
 
@@ -41,7 +42,8 @@ DataReader::~DataReader() {
 
 //
 
-DataReader::QueuePair::QueuePair(int size) {
+DataReader::QueuePair::QueuePair(int size)
+    : free_(size), full_(size) {
   // Initialize the free queue with requested number of datums
   for (int i = 0; i < size; ++i) {
     free_.push(new string("empty buffer"));
@@ -62,7 +64,13 @@ DataReader::QueuePair::~QueuePair() {
 
 DataReader::Body::Body(const LayerParameter& param)
     : param_(param),
+      num_partitions_(param.data_param().num_partitions()),
+      partition_(param.data_param().partition()),
+      record_(0),
       new_queue_pairs_() {
+  CHECK_GT(param_.data_param().num_partitions(), 0);
+  CHECK_LT(param_.data_param().partition(),
+      param_.data_param().num_partitions());
   StartInternalThread();
 }
 
@@ -73,9 +81,27 @@ DataReader::Body::~Body() {
 void DataReader::Body::InternalThreadEntry() {
   shared_ptr<db::DB> db(db::GetDB(param_.data_param().backend()));
   db->Open(param_.data_param().source(), db::READ);
+  if (param_.data_param().shuffle_shards()) {
+    CHECK_EQ(param_.data_param().backend(), DataParameter_DB_RECORDIO)
+        << "shuffle_shards requires the RECORDIO backend";
+    static_cast<db::RecordIO*>(db.get())->set_shuffle_shards(true);
+  }
+  // RecordIO partitions by shard, so that the records of the other
+  // partitions are not read at all, or by record itself if it has fewer
+  // shards than partitions.
+  if (param_.data_param().backend() == DataParameter_DB_RECORDIO) {
+    static_cast<db::RecordIO*>(db.get())->set_partition(partition_,
+        num_partitions_);
+    num_partitions_ = 1;
+    partition_ = 0;
+  }
   shared_ptr<db::Cursor> cursor(db->NewCursor());
+  CHECK(cursor->valid()) << "No records for partition "
+      << param_.data_param().partition() << " in "
+      << param_.data_param().source();
   vector<shared_ptr<QueuePair> > qps;
   try {
+    seek_partition(cursor.get());
     int solver_count = param_.phase() == TRAIN ? Caffe::solver_count() : 1;
 
     // To ensure deterministic runs, only start running once all solvers
@@ -109,10 +135,25 @@ void DataReader::Body::read_one(db::Cursor* cursor, QueuePair* qp) {
   qp->full_.push(data);
 
   // go to the next iter
+  next(cursor);
+  seek_partition(cursor);
+}
+
+void DataReader::Body::next(db::Cursor* cursor) {
   cursor->Next();
+  ++record_;
   if (!cursor->valid()) {
+    CHECK_GT(record_, partition_)
+        << "Fewer records than partitions in " << param_.data_param().source();
     DLOG(INFO) << "Restarting data prefetching from start.";
     cursor->SeekToFirst();
+    record_ = 0;
+  }
+}
+
+void DataReader::Body::seek_partition(db::Cursor* cursor) {
+  while (record_ % num_partitions_ != partition_) {
+    next(cursor);
   }
 }
 
@@ -0,0 +1,135 @@
+#include <boost/thread.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caffe/inference_runtime.hpp"
+#include "caffe/util/cpu_info.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+InferenceReplica<Dtype>::InferenceReplica(InferenceRuntime<Dtype>* runtime,
+    int id, const cpu_set_t& cpu_set, const Net<Dtype>* weights_source)
+  : runtime_(runtime), id_(id), weights_source_(weights_source),
+    cpu_set_(cpu_set) {
+}
+
+template <typename Dtype>
+InferenceReplica<Dtype>::~InferenceReplica() {
+  StopInternalThread();
+}
+
+template <typename Dtype>
+void InferenceReplica<Dtype>::InternalThreadEntry() {
+#ifdef _OPENMP
+  cpu::OpenMpManager::bindCurrentThreadToCpuSet(&cpu_set_);
+#endif
+  // Built on this thread so that the buffers are first touched, and
+  // allocated, on the cores of the replica.
+  net_.reset(new Net<Dtype>(runtime_->param_));
+  if (weights_source_) {
+    // Layers convert their weights to private layouts in place on their first
+    // forward pass. The leader has already run it, before this replica was
+    // started, so the shared weights are in their final layout and all
+    // replicas only read them from now on.
+    net_->ShareTrainedLayersWith(weights_source_);
+  } else if (!runtime_->weights_file_.empty()) {
+    net_->CopyTrainedLayersFrom(runtime_->weights_file_);
+  }
+  // Warm up on zeros rather than on uninitialized inputs, so that it does
+  // not depend on memory contents such as NaNs or denormals.
+  const vector<Blob<Dtype>*>& net_input = net_->input_blobs();
+  for (int i = 0; i < net_input.size(); ++i) {
+    caffe_set(net_input[i]->count(), Dtype(0),
+        net_input[i]->mutable_cpu_data());
+  }
+  net_->Forward();
+  runtime_->ready_.push(id_);
+
+  try {
+    while (!must_stop()) {
+      InferenceRequest<Dtype>* request = runtime_->requests_.pop();
+      const vector<Blob<Dtype>*>& input = *request->input;
+      const vector<Blob<Dtype>*>& output = *request->output;
+      const vector<Blob<Dtype>*>& net_input = net_->input_blobs();
+      CHECK_EQ(input.size(), net_input.size())
+          << "Wrong number of input blobs";
+      for (int i = 0; i < input.size(); ++i) {
+        net_input[i]->CopyFrom(*input[i], false, true);
+      }
+      const vector<Blob<Dtype>*>& net_output = net_->Forward();
+      CHECK_EQ(output.size(), net_output.size())
+          << "Wrong number of output blobs";
+      for (int i = 0; i < output.size(); ++i) {
+        output[i]->CopyFrom(*net_output[i], false, true);
+      }
+      request->done.push(id_);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+template <typename Dtype>
+InferenceRuntime<Dtype>::InferenceRuntime(const NetParameter& param,
+    const string& weights_file, int num_replicas)
+  : param_(param), weights_file_(weights_file) {
+  CHECK_GT(num_replicas, 0);
+  param_.mutable_state()->set_phase(TEST);
+  // First replica of each socket, which loads the weights.
+  std::map<unsigned, int> socket_leaders;
+  for (int i = 0; i < num_replicas; ++i) {
+    cpu_set_t cpu_set;
+    unsigned socket = 0;
+#ifdef _OPENMP
+    cpu::OpenMpManager::getPartitionCpuSet(i, num_replicas, &cpu_set);
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpu_set)) {
+        socket = cpu::OpenMpManager::getSocketId(cpu);
+        break;
+      }
+    }
+#else
+    CHECK_EQ(sched_getaffinity(0, sizeof(cpu_set), &cpu_set), 0);
+#endif
+    // The other replicas of the socket share the weights of the leader.
+    const Net<Dtype>* weights_source = NULL;
+    if (socket_leaders.count(socket)) {
+      weights_source = replicas_[socket_leaders[socket]]->net().get();
+    } else {
+      socket_leaders[socket] = i;
+    }
+    LOG(INFO) << "Starting inference replica " << i << " on "
+              << CPU_COUNT(&cpu_set) << " cores of socket " << socket;
+    replicas_.push_back(shared_ptr<InferenceReplica<Dtype> >(
+        new InferenceReplica<Dtype>(this, i, cpu_set, weights_source)));
+    replicas_.back()->StartInternalThread();
+    // Replicas start one at a time, so that the leader has converted the
+    // weights it shares on its warm-up forward pass before others use them.
+    ready_.pop();
+  }
+}
+
+template <typename Dtype>
+InferenceRuntime<Dtype>::~InferenceRuntime() {
+  for (int i = 0; i < replicas_.size(); ++i) {
+    replicas_[i]->StopInternalThread();
+  }
+}
+
+template <typename Dtype>
+void InferenceRuntime<Dtype>::Forward(const vector<Blob<Dtype>*>& input,
+    const vector<Blob<Dtype>*>& output) {
+  InferenceRequest<Dtype> request;
+  request.input = &input;
+  request.output = &output;
+  requests_.push(&request);
+  request.done.pop();
+}
+
+INSTANTIATE_CLASS(InferenceReplica);
+INSTANTIATE_CLASS(InferenceRuntime);
+
+}  // namespace caffe
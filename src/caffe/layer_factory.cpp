@@ -247,6 +247,8 @@ shared_ptr<Layer<Dtype> > GetBatchNormLayer(const LayerParameter& param) {
   if (engine == BatchNormParameter_Engine_DEFAULT) {
 #if defined(USE_MKL2017_AS_DEFAULT_ENGINE)
     engine = BatchNormParameter_Engine_MKL2017;
+#elif defined(USE_MKLDNN_AS_DEFAULT_ENGINE)
+    engine = BatchNormParameter_Engine_MKLDNN;
 #else
     engine = BatchNormParameter_Engine_CAFFE;
 #endif
@@ -257,6 +259,10 @@ shared_ptr<Layer<Dtype> > GetBatchNormLayer(const LayerParameter& param) {
 #if defined(MKL2017_SUPPORTED)
   } else if (engine == BatchNormParameter_Engine_MKL2017) {
     return shared_ptr<Layer<Dtype> >(new MKLBatchNormLayer<Dtype>(param));
+#endif
+#ifdef MKLDNN_SUPPORTED
+  } else if (engine == BatchNormParameter_Engine_MKLDNN) {
+    return shared_ptr<Layer<Dtype> >(new MKLDNNBatchNormLayer<Dtype>(param));
 #endif
   } else {
     LOG(FATAL) << "Layer " << param.name() << " has unknown engine.";
@@ -273,6 +279,8 @@ shared_ptr<Layer<Dtype> > GetSplitLayer(const LayerParameter& param) {
   if (engine == SplitParameter_Engine_DEFAULT) {
 #if defined(USE_MKL2017_AS_DEFAULT_ENGINE)
     engine = SplitParameter_Engine_MKL2017;
+#elif defined(USE_MKLDNN_AS_DEFAULT_ENGINE)
+    engine = SplitParameter_Engine_MKLDNN;
 #else
     engine = SplitParameter_Engine_CAFFE;
 #endif
@@ -283,6 +291,10 @@ shared_ptr<Layer<Dtype> > GetSplitLayer(const LayerParameter& param) {
 #if defined(MKL2017_SUPPORTED)
   } else if (engine == SplitParameter_Engine_MKL2017) {
     return shared_ptr<Layer<Dtype> >(new MKLSplitLayer<Dtype>(param));
+#endif
+#ifdef MKLDNN_SUPPORTED
+  } else if (engine == SplitParameter_Engine_MKLDNN) {
+    return shared_ptr<Layer<Dtype> >(new MKLDNNSplitLayer<Dtype>(param));
 #endif
   } else {
     LOG(FATAL) << "Layer " << param.name() << " has unknown engine.";
@@ -335,6 +347,9 @@ shared_ptr<Layer<Dtype> > GetConcatLayer(const LayerParameter& param) {
 #if defined(USE_MKL2017_AS_DEFAULT_ENGINE)
     if (param.concat_param().axis() == 1)
       engine = ConcatParameter_Engine_MKL2017;
+#elif defined(USE_MKLDNN_AS_DEFAULT_ENGINE)
+    if (param.concat_param().axis() == 1)
+      engine = ConcatParameter_Engine_MKLDNN;
 #endif
   }
   if (engine == ConcatParameter_Engine_CAFFE) {
@@ -342,6 +357,10 @@ shared_ptr<Layer<Dtype> > GetConcatLayer(const LayerParameter& param) {
 #if defined(MKL2017_SUPPORTED)
   } else if (engine == ConcatParameter_Engine_MKL2017) {
     return shared_ptr<Layer<Dtype> >(new MKLConcatLayer<Dtype>(param));
+#endif
+#ifdef MKLDNN_SUPPORTED
+  } else if (engine == ConcatParameter_Engine_MKLDNN) {
+    return shared_ptr<Layer<Dtype> >(new MKLDNNConcatLayer<Dtype>(param));
 #endif
   } else {
     LOG(FATAL) << "Layer " << param.name() << " has unknow engine.";
@@ -358,6 +377,9 @@ shared_ptr<Layer<Dtype> > GetEltwiseLayer(const LayerParameter& param) {
     engine = EltwiseParameter_Engine_CAFFE;
 #if defined(USE_MKL2017_AS_DEFAULT_ENGINE)
     engine = EltwiseParameter_Engine_MKL2017;
+#elif defined(USE_MKLDNN_AS_DEFAULT_ENGINE)
+    if (param.eltwise_param().operation() == EltwiseParameter_EltwiseOp_SUM)
+      engine = EltwiseParameter_Engine_MKLDNN;
 #endif
   }
   if (engine == EltwiseParameter_Engine_CAFFE) {
@@ -365,6 +387,10 @@ shared_ptr<Layer<Dtype> > GetEltwiseLayer(const LayerParameter& param) {
 #if defined(MKL2017_SUPPORTED)
   } else if (engine == EltwiseParameter_Engine_MKL2017) {
     return shared_ptr<Layer<Dtype> >(new MKLEltwiseLayer<Dtype>(param));
+#endif
+#ifdef MKLDNN_SUPPORTED
+  } else if (engine == EltwiseParameter_Engine_MKLDNN) {
+    return shared_ptr<Layer<Dtype> >(new MKLDNNEltwiseLayer<Dtype>(param));
 #endif
   } else {
     LOG(FATAL) << "Layer " << param.name() << " has unknow engine.";
@@ -405,6 +431,8 @@ shared_ptr<Layer<Dtype> > GetSoftmaxLayer(const LayerParameter& param) {
     engine = SoftmaxParameter_Engine_CAFFE;
 #ifdef USE_CUDNN
     engine = SoftmaxParameter_Engine_CUDNN;
+#elif defined(USE_MKLDNN_AS_DEFAULT_ENGINE)
+    engine = SoftmaxParameter_Engine_MKLDNN;
 #endif
   }
   if (engine == SoftmaxParameter_Engine_CAFFE) {
@@ -412,6 +440,10 @@ shared_ptr<Layer<Dtype> > GetSoftmaxLayer(const LayerParameter& param) {
 #ifdef USE_CUDNN
   } else if (engine == SoftmaxParameter_Engine_CUDNN) {
     return shared_ptr<Layer<Dtype> >(new CuDNNSoftmaxLayer<Dtype>(param));
+#endif
+#ifdef MKLDNN_SUPPORTED
+  } else if (engine == SoftmaxParameter_Engine_MKLDNN) {
+    return shared_ptr<Layer<Dtype> >(new MKLDNNSoftmaxLayer<Dtype>(param));
 #endif
   } else {
     LOG(FATAL) << "Layer " << param.name() << " has unknown engine.";
@@ -12,6 +12,9 @@
 
 namespace caffe {
 
+// Bytes of the columns and outputs gathered into one GEMM by weight_cpu_gemm.
+static const size_t kWeightGemmBytes = 8 << 20;
+
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
@@ -268,11 +271,36 @@ void BaseConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
   }
 #endif
 
-  int col_buffer_mt_size = num_of_threads_ * col_buffer_.count();
-  int weight_diff_mt_size = num_of_threads_ * this->blobs_[0]->count();
-
-  col_buffer_mt_.resize(col_buffer_mt_size);
-  weight_diff_mt_.resize(weight_diff_mt_size);
+  // The per-thread buffers are sized for all the threads rather than for
+  // this batch and never shrink, so that changing the batch size does not
+  // reallocate or clear them.
+  int max_threads = num_of_threads_;
+#ifdef _OPENMP
+  max_threads = std::max(max_threads, omp_get_max_threads());
+#endif
+  const size_t col_buffer_mt_size =
+      static_cast<size_t>(max_threads) * col_buffer_.count();
+  if (col_buffer_mt_.size() < col_buffer_mt_size) {
+    col_buffer_mt_.resize(col_buffer_mt_size);
+  }
+  // weight_cpu_gemm lays the columns of its images side by side in
+  // col_buffer_mt_, which holds max_threads of them, and their outputs in
+  // output_buffer_batch_; both together take at most kWeightGemmBytes.
+  // Strided im2col only exists in 2D.
+  const size_t output_count =
+      static_cast<size_t>(conv_out_channels_) * conv_out_spatial_dim_;
+  const size_t image_bytes =
+      (col_buffer_.count() + output_count) * sizeof(Dtype);
+  weight_gemm_images_ = std::max(1, std::min(max_threads,
+      static_cast<int>(kWeightGemmBytes / image_bytes)));
+  if (force_nd_im2col_ || num_spatial_axes_ != 2) {
+    weight_gemm_images_ = 1;
+  }
+  const size_t output_buffer_batch_size = (weight_gemm_images_ > 1) ?
+      weight_gemm_images_ * output_count : 0;
+  if (output_buffer_batch_.size() < output_buffer_batch_size) {
+    output_buffer_batch_.resize(output_buffer_batch_size);
+  }
 }
 
 template <typename Dtype>
@@ -288,7 +316,7 @@ void BaseConvolutionLayer<Dtype>::forward_cpu_gemm(const Dtype* input,
   }
   tid = tid % num_of_threads_;  //  just to be sure
 #endif
-  int col_data_buffer_size = col_buffer_mt_.size()/num_of_threads_;
+  int col_data_buffer_size = col_buffer_.count();
 
   Dtype* col_buff = const_cast<Dtype*>(input);
   if (!is_1x1_) {
@@ -327,7 +355,7 @@ void BaseConvolutionLayer<Dtype>::backward_cpu_gemm(const Dtype* output,
   }
   tid = tid % num_of_threads_;  //  just to be sure
 #endif
-  int col_data_buffer_size = col_buffer_mt_.size()/num_of_threads_;
+  int col_data_buffer_size = col_buffer_.count();
   Dtype* col_buff = & col_buffer_mt_[ tid* col_data_buffer_size];
 
   if (is_1x1_) {
@@ -346,72 +374,86 @@ void BaseConvolutionLayer<Dtype>::backward_cpu_gemm(const Dtype* output,
 
 
 template <typename Dtype>
-void BaseConvolutionLayer<Dtype>::clear_weight_mt(void) {
-  unsigned int weight_diff_size = weight_diff_mt_.size() / num_of_threads_;
-  caffe_memset(num_of_threads_*weight_diff_size*sizeof(Dtype),
-               0.,
-               &weight_diff_mt_[0]);
-}
-
-
-template <typename Dtype>
-void BaseConvolutionLayer<Dtype>::sum_weight_mt(Dtype* weight_diff) {
-  unsigned int weight_diff_size =  weight_diff_mt_.size() / num_of_threads_;
-  unsigned int col_per_thread = weight_diff_size/num_of_threads_;
-  int tid = 0;
+void BaseConvolutionLayer<Dtype>::weight_cpu_gemm(const Dtype* input,
+    int input_dim, const Dtype* output, int output_dim, int num,
+    Dtype* weights, const Dtype* forward_weights, Dtype* forward_output) {
+  const int col_rows = kernel_dim_ * group_;
+  for (int n0 = 0; n0 < num; n0 += weight_gemm_images_) {
+    const int images = std::min(weight_gemm_images_, num - n0);
+    // Width of the column and output matrices of the images together.
+    const int width = images * conv_out_spatial_dim_;
+    const Dtype* col_data = input + n0 * input_dim;
+    const Dtype* output_data = output + n0 * output_dim;
+    if (images == 1) {
+      if (!is_1x1_) {
+        conv_im2col_cpu(col_data, &col_buffer_mt_[0]);
+        col_data = &col_buffer_mt_[0];
+      }
+    } else {
+      // Lay the columns, and the outputs, of the images side by side, so
+      // that a single GEMM over all of them accumulates the gradient.
 #ifdef _OPENMP
-    if (omp_in_parallel()) {
-        tid = omp_get_thread_num();
-    }
+      #pragma omp parallel for num_threads(num_of_threads_)
 #endif
-    for (unsigned int j = 0; j < col_per_thread; ++j) {
-      for (unsigned int t = 0; t < num_of_threads_ ; ++t) {
-          weight_diff[tid*col_per_thread + j] +=
-            weight_diff_mt_[t*weight_diff_size + tid*col_per_thread + j];
+      for (int j = 0; j < images; ++j) {
+        const Dtype* image_input = input + (n0 + j) * input_dim;
+        Dtype* image_cols = &col_buffer_mt_[j * conv_out_spatial_dim_];
+        if (is_1x1_) {
+          for (int r = 0; r < col_rows; ++r) {
+            caffe_copy(conv_out_spatial_dim_,
+                image_input + r * conv_out_spatial_dim_,
+                image_cols + r * width);
+          }
+        } else {
+          conv_im2col_cpu(image_input, image_cols, width);
+        }
+        const Dtype* image_output = output + (n0 + j) * output_dim;
+        for (int c = 0; c < conv_out_channels_; ++c) {
+          caffe_copy(conv_out_spatial_dim_,
+              image_output + c * conv_out_spatial_dim_,
+              &output_buffer_batch_[c * width + j * conv_out_spatial_dim_]);
+        }
       }
+      col_data = &col_buffer_mt_[0];
+      output_data = &output_buffer_batch_[0];
     }
-
-    unsigned int j = col_per_thread*num_of_threads_ + tid;
-    if (j < weight_diff_size) {
-      for (unsigned int t = 0; t < num_of_threads_ ; ++t) {
-        weight_diff[j] += weight_diff_mt_[t * weight_diff_size + j];
-      }
+    for (int g = 0; g < group_; ++g) {
+      caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans,
+          conv_out_channels_ / group_, kernel_dim_, width,
+          (Dtype)1., output_data + conv_out_channels_ / group_ * width * g,
+          col_data + kernel_dim_ * width * g,
+          (Dtype)1., weights + weight_offset_ * g);
     }
-}
-
-template <typename Dtype>
-void BaseConvolutionLayer<Dtype>::weight_cpu_gemm(const Dtype* input,
-    const Dtype* output, Dtype* weights) {
-  int tid = 0;
+    if (!forward_weights) {
+      continue;
+    }
+    // forward_cpu_gemm of the images from the same columns. Side by side,
+    // the results go through output_buffer_batch_, which is no longer used.
+    Dtype* result = (images == 1) ?
+        forward_output + n0 * output_dim : &output_buffer_batch_[0];
+    for (int g = 0; g < group_; ++g) {
+      caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans,
+          conv_out_channels_ / group_, width, kernel_dim_,
+          (Dtype)1., forward_weights + weight_offset_ * g,
+          col_data + kernel_dim_ * width * g,
+          (Dtype)0., result + conv_out_channels_ / group_ * width * g);
+    }
+    if (images > 1) {
 #ifdef _OPENMP
-  tid = omp_get_thread_num();
-  if (tid >= num_of_threads_) {
-    LOG(FATAL) << "ConvLayer::weights_cpu_gemm: omp_thread_num() =" << tid
-               << " > OMP_num_THREADS = " << num_of_threads_;
-  }
-  tid = tid % num_of_threads_;  //  just to be sure
-  Dtype* weight_diff_data =
-    & weight_diff_mt_[tid * (weight_diff_mt_.size()/num_of_threads_)];
-#else
-  Dtype* weight_diff_data = weights;
+      #pragma omp parallel for num_threads(num_of_threads_)
 #endif
-  Dtype* col_buff = const_cast<Dtype*>(input);
-
-  if (!is_1x1_) {
-    int col_data_buffer_size = col_buffer_mt_.size()/num_of_threads_;
-    col_buff = & col_buffer_mt_[ tid* col_data_buffer_size];
-    conv_im2col_cpu(input, col_buff);
-  }
-  for (int g = 0; g < group_; ++g) {
-    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, conv_out_channels_ / group_,
-        kernel_dim_, conv_out_spatial_dim_,
-        (Dtype)1., output + output_offset_ * g, col_buff + col_offset_ * g,
-        (Dtype)1., weight_diff_data + weight_offset_ * g);
+      for (int j = 0; j < images; ++j) {
+        Dtype* image_output = forward_output + (n0 + j) * output_dim;
+        for (int c = 0; c < conv_out_channels_; ++c) {
+          caffe_copy(conv_out_spatial_dim_,
+              &output_buffer_batch_[c * width + j * conv_out_spatial_dim_],
+              image_output + c * conv_out_spatial_dim_);
+        }
+      }
+    }
   }
 }
 
-
-
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::backward_cpu_bias(Dtype* bias,
     const Dtype* input) {
@@ -7,7 +7,13 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
 #include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/cpu_info.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace caffe {
 
@@ -32,13 +38,27 @@ void BaseDataLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   DataLayerSetUp(bottom, top);
 }
 
+void AddPrefetchTime(int64_t* counter, double us) {
+  __atomic_fetch_add(counter, static_cast<int64_t>(us), __ATOMIC_RELAXED);
+}
+
+// Checked here, as the prefetch queues are built before LayerSetUp
+static int PrefetchCount(const LayerParameter& param) {
+  CHECK_GT(param.data_param().prefetch(), 0) << "Layer " << param.name()
+      << ": data_param.prefetch must be at least 1 batch";
+  return param.data_param().prefetch();
+}
+
 template <typename Dtype>
 BasePrefetchingDataLayer<Dtype>::BasePrefetchingDataLayer(
     const LayerParameter& param)
     : BaseDataLayer<Dtype>(param),
-      prefetch_free_(), prefetch_full_() {
-  for (int i = 0; i < PREFETCH_COUNT; ++i) {
-    prefetch_free_.push(&prefetch_[i]);
+      prefetch_(PrefetchCount(param)),
+      prefetch_free_(PrefetchCount(param)),
+      prefetch_full_(PrefetchCount(param)), stats_() {
+  for (int i = 0; i < prefetch_.size(); ++i) {
+    prefetch_[i].reset(new Batch<Dtype>());
+    prefetch_free_.push(prefetch_[i].get());
   }
 }
 
@@ -50,18 +70,18 @@ void BasePrefetchingDataLayer<Dtype>::LayerSetUp(
   // calls so that the prefetch thread does not accidentally make simultaneous
   // cudaMalloc calls when the main thread is running. In some GPUs this
   // seems to cause failures if we do not so.
-  for (int i = 0; i < PREFETCH_COUNT; ++i) {
-    prefetch_[i].data_.mutable_cpu_data();
+  for (int i = 0; i < prefetch_.size(); ++i) {
+    prefetch_[i]->data_.mutable_cpu_data();
     if (this->output_labels_) {
-      prefetch_[i].label_.mutable_cpu_data();
+      prefetch_[i]->label_.mutable_cpu_data();
     }
   }
 #ifndef CPU_ONLY
   if (Caffe::mode() == Caffe::GPU) {
-    for (int i = 0; i < PREFETCH_COUNT; ++i) {
-      prefetch_[i].data_.mutable_gpu_data();
+    for (int i = 0; i < prefetch_.size(); ++i) {
+      prefetch_[i]->data_.mutable_gpu_data();
       if (this->output_labels_) {
-        prefetch_[i].label_.mutable_gpu_data();
+        prefetch_[i]->label_.mutable_gpu_data();
       }
     }
   }
@@ -69,8 +89,9 @@ void BasePrefetchingDataLayer<Dtype>::LayerSetUp(
   DLOG(INFO) << "Initializing prefetch";
   this->data_transformer_->InitRand();
 
-  // Only if GPU mode on then we use background threads
-  if (Caffe::mode() == Caffe::GPU) {
+  // In CPU mode batches can also be loaded by Forward itself
+  if (Caffe::mode() == Caffe::GPU ||
+      this->layer_param_.data_param().cpu_prefetch()) {
     StartInternalThread();
   }
   DLOG(INFO) << "Prefetch initialized.";
@@ -84,10 +105,24 @@ void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
     CUDA_CHECK(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
   }
 #endif
+#ifdef _OPENMP
+  const int transform_threads =
+      this->layer_param_.data_param().transform_threads();
+  unsigned data_cores_version = 0;
+#endif
 
   try {
     while (!must_stop()) {
       Batch<Dtype>* batch = prefetch_free_.pop();
+#ifdef _OPENMP
+      // Follows the cores reserved for data loading, if any
+      cpu::OpenMpManager::bindCurrentThreadToDataCores(&data_cores_version,
+          true);
+      // Only affects the parallel regions of this thread, e.g. in load_batch
+      if (transform_threads > 0) {
+        omp_set_num_threads(transform_threads);
+      }
+#endif
       load_batch(batch);
 #ifndef CPU_ONLY
       if (Caffe::mode() == Caffe::GPU) {
@@ -95,6 +130,7 @@ void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
         CUDA_CHECK(cudaStreamSynchronize(stream));
       }
 #endif
+      __atomic_fetch_add(&stats_.batches, 1, __ATOMIC_RELAXED);
       prefetch_full_.push(batch);
     }
   } catch (boost::thread_interrupted&) {
@@ -107,27 +143,47 @@ void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
 #endif
 }
 
-// TODO: Make it properlly implemented/integrated with above solution
 template <typename Dtype>
 void BasePrefetchingDataLayer<Dtype>::GetBatch() {
   try {
       Batch<Dtype>* batch = prefetch_free_.pop();
       load_batch(batch);
+      __atomic_fetch_add(&stats_.batches, 1, __ATOMIC_RELAXED);
       prefetch_full_.push(batch);
   } catch (boost::thread_interrupted&) {
     // Interrupted exception is expected on shutdown
   }
 }
 
+template <typename Dtype>
+Batch<Dtype>* BasePrefetchingDataLayer<Dtype>::NextBatch() {
+  CPUTimer timer;
+  timer.Start();
+  // Without the prefetch thread the batch is loaded here
+  if (!is_started()) {
+    GetBatch();
+  }
+  Batch<Dtype>* batch = prefetch_full_.pop("Data layer prefetch queue empty");
+  AddPrefetchTime(&stats_.wait_us, timer.MicroSeconds());
+  return batch;
+}
+
+template <typename Dtype>
+PrefetchStats BasePrefetchingDataLayer<Dtype>::prefetch_stats() const {
+  PrefetchStats stats;
+  stats.batches = __atomic_load_n(&stats_.batches, __ATOMIC_RELAXED);
+  stats.read_us = __atomic_load_n(&stats_.read_us, __ATOMIC_RELAXED);
+  stats.decode_us = __atomic_load_n(&stats_.decode_us, __ATOMIC_RELAXED);
+  stats.transform_us =
+      __atomic_load_n(&stats_.transform_us, __ATOMIC_RELAXED);
+  stats.wait_us = __atomic_load_n(&stats_.wait_us, __ATOMIC_RELAXED);
+  return stats;
+}
 
 template <typename Dtype>
 void BasePrefetchingDataLayer<Dtype>::Forward_cpu(
     const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
-  // Here for CPU we do transformation
-  if (Caffe::mode() == Caffe::CPU) {
-    this->GetBatch();
-  }
-  Batch<Dtype>* batch = prefetch_full_.pop("Data layer prefetch queue empty");
+  Batch<Dtype>* batch = NextBatch();
   // Reshape to loaded data.
   top[0]->ReshapeLike(batch->data_);
   // Copy the data
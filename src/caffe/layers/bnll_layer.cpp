@@ -1,11 +1,15 @@
 #include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "caffe/layers/bnll_layer.hpp"
+#include "caffe/util/math_functions.hpp"
 
 namespace caffe {
 
 const float kBNLL_THRESHOLD = 50.;
+// Elements per block handed to caffe_exp and caffe_log.
+const int kBNLL_BLOCK_SIZE = 1024;
 
 template <typename Dtype>
 void BNLLLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -13,10 +17,25 @@ void BNLLLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
   const int count = bottom[0]->count();
-  for (int i = 0; i < count; ++i) {
-    top_data[i] = bottom_data[i] > 0 ?
-        bottom_data[i] + log(1. + exp(-bottom_data[i])) :
-        log(1. + exp(bottom_data[i]));
+  // y = max(x, 0) + log(1 + exp(-|x|))
+#ifdef _OPENMP
+  #pragma omp parallel for
+#endif
+  for (int block = 0; block < count; block += kBNLL_BLOCK_SIZE) {
+    const int n = std::min(kBNLL_BLOCK_SIZE, count - block);
+    const Dtype* x = bottom_data + block;
+    Dtype softplus[kBNLL_BLOCK_SIZE];
+    for (int i = 0; i < n; ++i) {
+      softplus[i] = -std::fabs(x[i]);
+    }
+    caffe_exp(n, softplus, softplus);
+    for (int i = 0; i < n; ++i) {
+      softplus[i] += Dtype(1);
+    }
+    caffe_log(n, softplus, softplus);
+    for (int i = 0; i < n; ++i) {
+      top_data[block + i] = std::max(x[i], Dtype(0)) + softplus[i];
+    }
   }
 }
 
@@ -29,10 +48,20 @@ void BNLLLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     const Dtype* top_diff = top[0]->cpu_diff();
     Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
     const int count = bottom[0]->count();
-    Dtype expval;
-    for (int i = 0; i < count; ++i) {
-      expval = exp(std::min(bottom_data[i], Dtype(kBNLL_THRESHOLD)));
-      bottom_diff[i] = top_diff[i] * expval / (expval + 1.);
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int block = 0; block < count; block += kBNLL_BLOCK_SIZE) {
+      const int n = std::min(kBNLL_BLOCK_SIZE, count - block);
+      Dtype expval[kBNLL_BLOCK_SIZE];
+      for (int i = 0; i < n; ++i) {
+        expval[i] = std::min(bottom_data[block + i], Dtype(kBNLL_THRESHOLD));
+      }
+      caffe_exp(n, expval, expval);
+      for (int i = 0; i < n; ++i) {
+        bottom_diff[block + i] =
+            top_diff[block + i] * expval[i] / (expval[i] + 1.);
+      }
     }
   }
 }
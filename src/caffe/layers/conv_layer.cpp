@@ -67,30 +67,10 @@ void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       }
     }
 
-    // OpenMP path is using bigger separate buffer to accumulate
-    // weight diffs, which are lateron add to weight_diff
-    // so bigger buffer (weight_diff_mt) hase to be cleared out
-    // before GEMM ops and results has to be summed up after GEMM ops.
-
     if (this->param_propagate_down_[0]) {
-#ifdef _OPENMP
-      this->clear_weight_mt();
-      #pragma omp parallel num_threads(this->num_of_threads_)
-#endif
-      {
-#ifdef _OPENMP
-        #pragma omp for
-#endif
-        for (int n = 0; n < this->num_; ++n) {
-          // gradient w.r.t. weight. Note that we will accumulate diffs.
-          this->weight_cpu_gemm(bottom_data + n * this->bottom_dim_,
-                top_diff + n * this->top_dim_, weight_diff);
-        }
-
-#ifdef _OPENMP
-        this->sum_weight_mt(weight_diff);
-#endif
-      }
+      // gradient w.r.t. weight. Note that we will accumulate diffs.
+      this->weight_cpu_gemm(bottom_data, this->bottom_dim_, top_diff,
+          this->top_dim_, this->num_, weight_diff);
     }
 
     if (propagate_down[i]) {
@@ -1,25 +1,135 @@
 #ifdef USE_OPENCV
 #include <opencv2/core/core.hpp>
 #endif  // USE_OPENCV
+#include <boost/thread.hpp>
 #include <stdint.h>
 
+#include <string>
 #include <vector>
 
 #include "caffe/data_transformer.hpp"
 #include "caffe/layers/data_layer.hpp"
 #include "caffe/util/benchmark.hpp"
+#include "caffe/util/cpu_info.hpp"
+#include "caffe/util/io.hpp"
 
 namespace caffe {
 
+DataDecoder::DataDecoder(DataReader* reader, const LayerParameter& param,
+    PrefetchStats* stats)
+  : reader_(reader), param_(param), stats_(stats), next_(NULL),
+    batches_(param.data_param().decode_prefetch()),
+    free_(param.data_param().decode_prefetch()),
+    full_(param.data_param().decode_prefetch()) {
+  for (int i = 0; i < batches_.size(); ++i) {
+    batches_[i].reset(new DecodedBatch());
+    free_.push(batches_[i].get());
+  }
+}
+
+DataDecoder::~DataDecoder() {
+  StopInternalThread();
+  // Records held by an interrupted read
+  for (int i = 0; i < records_.size(); ++i) {
+    reader_->free().push(records_[i]);
+  }
+}
+
+void DataDecoder::Start(DataDecoder* next, bool first) {
+  next_ = next;
+  if (first) {
+    turn_.push(0);
+  }
+  StartInternalThread();
+}
+
+void DataDecoder::InternalThreadEntry() {
+  const int batch_size = param_.data_param().batch_size();
+  CPUTimer timer;
+#ifdef _OPENMP
+  unsigned data_cores_version = 0;
+#endif
+  try {
+    while (!must_stop()) {
+      DecodedBatch* batch = free_.pop();
+#ifdef _OPENMP
+      cpu::OpenMpManager::bindCurrentThreadToDataCores(&data_cores_version,
+          false);
+#endif
+      turn_.pop();
+      timer.Start();
+      Read(reader_, batch_size, &records_);
+      AddPrefetchTime(&stats_->read_us, timer.MicroSeconds());
+      next_->turn_.push(0);
+      timer.Start();
+      Decode(reader_, param_.transform_param(), &records_, false, batch);
+      AddPrefetchTime(&stats_->decode_us, timer.MicroSeconds());
+      full_.push(batch);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+void DataDecoder::Read(DataReader* reader, int batch_size,
+    vector<string*>* records) {
+  while (records->size() < batch_size) {
+    records->push_back(reader->full().pop("Waiting for data"));
+  }
+}
+
+void DataDecoder::Decode(DataReader* reader,
+    const TransformationParameter& param, vector<string*>* records,
+    bool parallel, DecodedBatch* batch) {
+  const int num = records->size();
+  batch->datums_.resize(num);
+#ifdef USE_OPENCV
+  batch->images_.resize(num);
+#endif  // USE_OPENCV
+#ifdef _OPENMP
+  #pragma omp parallel for if (parallel && num > 1)
+#endif
+  for (int i = 0; i < num; ++i) {
+    Datum& datum = batch->datums_[i];
+    datum.ParseFromString(*(*records)[i]);
+#ifdef USE_OPENCV
+    // Same decoding as DataTransformer::Transform does for encoded datums
+    if (datum.encoded()) {
+      CHECK(!(param.force_color() && param.force_gray()))
+          << "cannot set both force_color and force_gray";
+      if (param.force_color() || param.force_gray()) {
+        batch->images_[i] = DecodeDatumToCVMat(datum, param.force_color());
+      } else {
+        batch->images_[i] = DecodeDatumToCVMatNative(datum);
+      }
+      CHECK(batch->images_[i].data) << "Could not decode datum";
+      // Only the label is used from now on
+      datum.clear_data();
+    } else {
+      batch->images_[i].release();
+    }
+#endif  // USE_OPENCV
+  }
+  for (int i = 0; i < num; ++i) {
+    reader->free().push((*records)[i]);
+  }
+  records->clear();
+}
+
 template <typename Dtype>
 DataLayer<Dtype>::DataLayer(const LayerParameter& param)
   : BasePrefetchingDataLayer<Dtype>(param),
-    reader_(param) {
+    reader_(param), next_decoder_(0) {
 }
 
 template <typename Dtype>
 DataLayer<Dtype>::~DataLayer() {
   this->StopInternalThread();
+  // Before the reader they use
+  decoders_.clear();
+  for (int i = 0; i < records_.size(); ++i) {
+    reader_.free().push(records_[i]);
+  }
 }
 
 template <typename Dtype>
@@ -37,8 +147,8 @@ void DataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
   top_shape[0] = batch_size;
 
   top[0]->Reshape(top_shape);
-  for (int i = 0; i < this->PREFETCH_COUNT; ++i) {
-    this->prefetch_[i].data_.Reshape(top_shape);
+  for (int i = 0; i < this->prefetch_.size(); ++i) {
+    this->prefetch_[i]->data_.Reshape(top_shape);
   }
   LOG(INFO) << "output data size: " << top[0]->num() << ","
       << top[0]->channels() << "," << top[0]->height() << ","
@@ -47,38 +157,57 @@ void DataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
   if (this->output_labels_) {
     vector<int> label_shape(1, batch_size);
     top[1]->Reshape(label_shape);
-    for (int i = 0; i < this->PREFETCH_COUNT; ++i) {
-      this->prefetch_[i].label_.Reshape(label_shape);
+    for (int i = 0; i < this->prefetch_.size(); ++i) {
+      this->prefetch_[i]->label_.Reshape(label_shape);
     }
   }
+
+  // Start the decode stage, now that the first record has been peeked at
+  const int decode_threads = this->layer_param_.data_param().decode_threads();
+  CHECK(decode_threads == 0 ||
+        this->layer_param_.data_param().decode_prefetch() > 0)
+      << "data_param.decode_prefetch must be at least 1 batch";
+  for (int i = 0; i < decode_threads; ++i) {
+    decoders_.push_back(shared_ptr<DataDecoder>(new DataDecoder(&reader_,
+        this->layer_param_, &this->stats_)));
+  }
+  for (int i = 0; i < decode_threads; ++i) {
+    decoders_[i]->Start(decoders_[(i + 1) % decode_threads].get(), i == 0);
+  }
 }
 
-// This function is called on prefetch thread
+// This function is called on prefetch thread, or by Forward without one
 template<typename Dtype>
 void DataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
-  CPUTimer batch_timer;
-  batch_timer.Start();
-  double read_time = 0;
-  double trans_time = 0;
-  CPUTimer timer;
-  CPUTimer trans_timer;
   CHECK(batch->data_.count());
-
-#ifndef _OPENMP
-  CHECK(this->transformed_data_.count());
-#endif
+  const int batch_size = this->layer_param_.data_param().batch_size();
+  CPUTimer timer;
+  DecodedBatch* decoded = &decoded_;
+  if (decoders_.empty()) {
+    timer.Start();
+    DataDecoder::Read(&reader_, batch_size, &records_);
+    AddPrefetchTime(&this->stats_.read_us, timer.MicroSeconds());
+    timer.Start();
+    DataDecoder::Decode(&reader_, this->transform_param_, &records_, true,
+        decoded);
+    AddPrefetchTime(&this->stats_.decode_us, timer.MicroSeconds());
+  } else {
+    decoded = decoders_[next_decoder_]->full().pop("Waiting for data");
+  }
+  timer.Start();
 
   // Reshape according to the first datum of each batch
   // on single input batches allows for inputs of varying dimension.
-  const int batch_size = this->layer_param_.data_param().batch_size();
-  Datum datum;
-  datum.ParseFromString(*(reader_.full().peek()));
-  // Use data_transformer to infer the expected blob shape from datum.
-  vector<int> top_shape = this->data_transformer_->InferBlobShape(datum);
-#ifndef _OPENMP
-  this->transformed_data_.Reshape(top_shape);
-#endif
+#ifdef USE_OPENCV
+  vector<int> item_shape = decoded->images_[0].empty() ?
+      this->data_transformer_->InferBlobShape(decoded->datums_[0]) :
+      this->data_transformer_->InferBlobShape(decoded->images_[0]);
+#else
+  vector<int> item_shape =
+      this->data_transformer_->InferBlobShape(decoded->datums_[0]);
+#endif  // USE_OPENCV
   // Reshape batch according to the batch_size.
+  vector<int> top_shape = item_shape;
   top_shape[0] = batch_size;
   batch->data_.Reshape(top_shape);
 
@@ -89,54 +218,38 @@ void DataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
     top_label = batch->label_.mutable_cpu_data();
   }
 
-  trans_timer.Start();
+  // Drawn in item order, so that results do not depend on the threads
+  vector<PreclcRandomNumbers> rand_numbers(batch_size);
+  for (int item_id = 0; item_id < batch_size; ++item_id) {
+    this->data_transformer_->GenerateRandNumbers(rand_numbers[item_id]);
+  }
 #ifdef _OPENMP
-  #pragma omp parallel if (batch_size > 1)
-  #pragma omp single nowait
+  #pragma omp parallel for if (batch_size > 1)
 #endif
   for (int item_id = 0; item_id < batch_size; ++item_id) {
-    timer.Start();
-    // get a datum
-    string* data = (reader_.full().pop("Waiting for data"));
-    timer.Stop();
-    read_time += timer.MicroSeconds();
+    if (this->output_labels_) {
+      top_label[item_id] = decoded->datums_[item_id].label();
+    }
     // Apply data transformations (mirror, scale, crop...)
-    int offset = batch->data_.offset(item_id);
-
-#ifdef _OPENMP
-    PreclcRandomNumbers precalculated_rand_numbers;
-    this->data_transformer_->GenerateRandNumbers(precalculated_rand_numbers);
-    #pragma omp task firstprivate(offset, precalculated_rand_numbers, data, item_id)
-#endif
-    {
-      Datum datum;
-      datum.ParseFromString(*data);
-      (reader_.free()).push(data);    
-      // Copy label. We need to copy it before we release datum
-      if (this->output_labels_) {
-        top_label[item_id] = datum.label();
-      }
-#ifdef _OPENMP
-      Blob<Dtype> tmp_data;
-      tmp_data.Reshape(top_shape);
-      tmp_data.set_cpu_data(top_data + offset);
-      this->data_transformer_->Transform(datum, &tmp_data,
-                                              precalculated_rand_numbers);
-#else
-      this->transformed_data_.set_cpu_data(top_data + offset);
-      this->data_transformer_->Transform(datum, &(this->transformed_data_));
-#endif
+    Blob<Dtype> item_data;
+    item_data.Reshape(item_shape);
+    item_data.set_cpu_data(top_data + batch->data_.offset(item_id));
+#ifdef USE_OPENCV
+    if (!decoded->images_[item_id].empty()) {
+      this->data_transformer_->Transform(decoded->images_[item_id],
+          &item_data, rand_numbers[item_id]);
+      continue;
     }
+#endif  // USE_OPENCV
+    this->data_transformer_->Transform(decoded->datums_[item_id], &item_data,
+        rand_numbers[item_id]);
+  }
+  AddPrefetchTime(&this->stats_.transform_us, timer.MicroSeconds());
+
+  if (!decoders_.empty()) {
+    decoders_[next_decoder_]->free().push(decoded);
+    next_decoder_ = (next_decoder_ + 1) % decoders_.size();
   }
-  trans_timer.Stop();
-  batch_timer.Stop();
-  // Due to multithreaded nature of transformation,
-  // time it takes to execute them we get from subtracting
-  // read batch of images time from total batch read&transform time
-  trans_time = trans_timer.MicroSeconds() - read_time;
-  DLOG(INFO) << "Prefetch batch: " << batch_timer.MilliSeconds() << " ms.";
-  DLOG(INFO) << "     Read time: " << read_time / 1000 << " ms.";
-  DLOG(INFO) << "Transform time: " << trans_time / 1000 << " ms.";
 }
 
 INSTANTIATE_CLASS(DataLayer);
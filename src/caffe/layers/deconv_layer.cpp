@@ -63,34 +63,20 @@ void DeconvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     }
 
 
-    if (this->param_propagate_down_[0] || propagate_down[i]) {
+    if (this->param_propagate_down_[0]) {
+      // Gradient w.r.t. weight. Note that we will accumulate diffs.
+      // The gradient w.r.t. bottom data, if necessary, reuses its im2col.
+      this->weight_cpu_gemm(top_diff, this->top_dim_, bottom_data,
+          this->bottom_dim_, this->num_, weight_diff,
+          propagate_down[i] ? weight : NULL, bottom_diff);
+    } else if (propagate_down[i]) {
 #ifdef _OPENMP
-      this->clear_weight_mt();
-      #pragma omp parallel num_threads(this->num_of_threads_)
-#endif
-      {
-#ifdef _OPENMP
-        #pragma omp for
-#endif
-        for (int n = 0; n < this->num_; ++n) {
-          if (this->param_propagate_down_[0]) {
-              // Gradient w.r.t. weight. Note that we will accumulate diffs.
-              this->weight_cpu_gemm(top_diff + n * this->top_dim_,
-                bottom_data + n * this->bottom_dim_, weight_diff);
-          }
-
-          if (propagate_down[i]) {
-            // Gradient w.r.t. bottom data, if necessary, reusing
-            // the column buffer. we might have just computed above.
-            this->forward_cpu_gemm(top_diff + n*this->top_dim_,
-                                   weight,
-                                   bottom_diff + n*this->bottom_dim_,
-                                   this->param_propagate_down_[0]);
-          }
-        }
-#ifdef _OPENMP
-        this->sum_weight_mt(weight_diff);
+      #pragma omp parallel for num_threads(this->num_of_threads_)
 #endif
+      for (int n = 0; n < this->num_; ++n) {
+        // Gradient w.r.t. bottom data, if necessary.
+        this->forward_cpu_gemm(top_diff + n * this->top_dim_, weight,
+            bottom_diff + n * this->bottom_dim_);
       }
     }
   }
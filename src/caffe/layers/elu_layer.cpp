@@ -2,9 +2,13 @@
 #include <vector>
 
 #include "caffe/layers/elu_layer.hpp"
+#include "caffe/util/math_functions.hpp"
 
 namespace caffe {
 
+// Elements per block handed to caffe_exp.
+const int kELU_BLOCK_SIZE = 1024;
+
 template <typename Dtype>
 void ELULayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
@@ -15,9 +19,18 @@ void ELULayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-  for (int i = 0; i < count; ++i) {
-    top_data[i] = std::max(bottom_data[i], Dtype(0))
-        + alpha * (exp(std::min(bottom_data[i], Dtype(0))) - Dtype(1));
+  for (int block = 0; block < count; block += kELU_BLOCK_SIZE) {
+    const int n = std::min(kELU_BLOCK_SIZE, count - block);
+    const Dtype* x = bottom_data + block;
+    Dtype exp_x[kELU_BLOCK_SIZE];
+    for (int i = 0; i < n; ++i) {
+      exp_x[i] = std::min(x[i], Dtype(0));
+    }
+    caffe_exp(n, exp_x, exp_x);
+    for (int i = 0; i < n; ++i) {
+      top_data[block + i] = std::max(x[i], Dtype(0))
+          + alpha * (exp_x[i] - Dtype(1));
+    }
   }
 }
 
@@ -0,0 +1,630 @@
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "caffe/layers/absval_layer.hpp"
+#include "caffe/layers/bias_layer.hpp"
+#include "caffe/layers/bnll_layer.hpp"
+#include "caffe/layers/eltwise_layer.hpp"
+#include "caffe/layers/elu_layer.hpp"
+#include "caffe/layers/exp_layer.hpp"
+#include "caffe/layers/fused_elementwise_layer.hpp"
+#include "caffe/layers/log_layer.hpp"
+#include "caffe/layers/power_layer.hpp"
+#include "caffe/layers/relu_layer.hpp"
+#include "caffe/layers/scale_layer.hpp"
+#include "caffe/layers/sigmoid_layer.hpp"
+#include "caffe/layers/tanh_layer.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+// Elements per tile; the tiles of all stages of one thread should stay in L2.
+const int kFusedTileSize = 1024;
+const float kFusedBNLLThreshold = 50.;
+
+template <typename Dtype>
+FusedElementwiseLayer<Dtype>::FusedElementwiseLayer(
+    const LayerParameter& param,
+    const vector<shared_ptr<Layer<Dtype> > >& layers,
+    const vector<vector<Blob<Dtype>*> >& bottom_vecs,
+    const vector<vector<Blob<Dtype>*> >& top_vecs,
+    const vector<bool>& layer_need_backward)
+    : Layer<Dtype>(param), layers_(layers), bottom_vecs_(bottom_vecs),
+      top_vecs_(top_vecs), layer_need_backward_(layer_need_backward),
+      param_grad_count_(0) {
+  CHECK_GE(layers_.size(), 2) << "A fused chain needs at least two layers.";
+  CHECK_EQ(layers_.size(), bottom_vecs_.size());
+  CHECK_EQ(layers_.size(), top_vecs_.size());
+  CHECK_EQ(layers_.size(), layer_need_backward_.size());
+  for (int i = 0; i < layers_.size(); ++i) {
+    CHECK(CanFuse(layers_[i].get(), bottom_vecs_[i], i == 0))
+        << "Layer " << layers_[i]->layer_param().name()
+        << " cannot be fused.";
+    CHECK_EQ(top_vecs_[i].size(), 1);
+    if (i > 0) {
+      CHECK_EQ(bottom_vecs_[i][0], top_vecs_[i - 1][0])
+          << "Fused layers must form a chain.";
+    }
+  }
+  CompileOps();
+}
+
+template <typename Dtype>
+bool FusedElementwiseLayer<Dtype>::CanFuse(Layer<Dtype>* layer,
+    const vector<Blob<Dtype>*>& bottom, bool first) {
+  if (layer->IsShared()) {
+    return false;
+  }
+  if (dynamic_cast<EltwiseLayer<Dtype>*>(layer)) {
+    return first && layer->layer_param().eltwise_param().operation() ==
+        EltwiseParameter_EltwiseOp_SUM;
+  }
+  if (dynamic_cast<ScaleLayer<Dtype>*>(layer) ||
+      dynamic_cast<BiasLayer<Dtype>*>(layer)) {
+    // The scale or bias must be a learned parameter, not a second bottom.
+    return bottom.size() == 1;
+  }
+  // Only the reference implementations: MKL and MKLDNN layers report the
+  // same types but keep their data in private layouts.
+  return dynamic_cast<ReLULayer<Dtype>*>(layer) ||
+      dynamic_cast<SigmoidLayer<Dtype>*>(layer) ||
+      dynamic_cast<TanHLayer<Dtype>*>(layer) ||
+      dynamic_cast<AbsValLayer<Dtype>*>(layer) ||
+      dynamic_cast<BNLLLayer<Dtype>*>(layer) ||
+      dynamic_cast<ELULayer<Dtype>*>(layer) ||
+      dynamic_cast<PowerLayer<Dtype>*>(layer) ||
+      dynamic_cast<ExpLayer<Dtype>*>(layer) ||
+      dynamic_cast<LogLayer<Dtype>*>(layer);
+}
+
+template <typename Dtype>
+void FusedElementwiseLayer<Dtype>::CompileOps() {
+  ops_.clear();
+  coeffs_.assign(bottom_vecs_[0].size(), Dtype(1));
+  for (int i = 0; i < layers_.size(); ++i) {
+    Layer<Dtype>* layer = layers_[i].get();
+    const LayerParameter& param = layer->layer_param();
+    if (dynamic_cast<EltwiseLayer<Dtype>*>(layer)) {
+      const EltwiseParameter& eltwise_param = param.eltwise_param();
+      if (eltwise_param.coeff_size()) {
+        CHECK_EQ(eltwise_param.coeff_size(), coeffs_.size());
+        for (int j = 0; j < coeffs_.size(); ++j) {
+          coeffs_[j] = eltwise_param.coeff(j);
+        }
+      }
+      continue;
+    }
+    Op op;
+    op.layer_index = i;
+    op.alpha = op.beta = op.gamma = Dtype(0);
+    op.scale = op.bias = NULL;
+    op.scale_grad = op.bias_grad = false;
+    op.channel_dim = op.inner_dim = 1;
+    if (dynamic_cast<ReLULayer<Dtype>*>(layer)) {
+      op.type = RELU;
+      op.alpha = param.relu_param().negative_slope();
+    } else if (dynamic_cast<SigmoidLayer<Dtype>*>(layer)) {
+      op.type = SIGMOID;
+    } else if (dynamic_cast<TanHLayer<Dtype>*>(layer)) {
+      op.type = TANH;
+    } else if (dynamic_cast<AbsValLayer<Dtype>*>(layer)) {
+      op.type = ABSVAL;
+    } else if (dynamic_cast<BNLLLayer<Dtype>*>(layer)) {
+      op.type = BNLL;
+    } else if (dynamic_cast<ELULayer<Dtype>*>(layer)) {
+      op.type = ELU;
+      op.alpha = param.elu_param().alpha();
+    } else if (dynamic_cast<PowerLayer<Dtype>*>(layer)) {
+      op.type = POWER;
+      op.alpha = param.power_param().power();
+      op.beta = param.power_param().scale();
+      op.gamma = param.power_param().shift();
+    } else if (dynamic_cast<ExpLayer<Dtype>*>(layer)) {
+      // Same constants as ExpLayer::LayerSetUp.
+      op.type = EXP;
+      const Dtype base = param.exp_param().base();
+      const Dtype log_base = (base == Dtype(-1)) ? Dtype(1) : log(base);
+      const Dtype shift = param.exp_param().shift();
+      op.alpha = log_base * param.exp_param().scale();
+      op.gamma = (shift == Dtype(0)) ? Dtype(1) :
+          ((base != Dtype(-1)) ? pow(base, shift) : exp(shift));
+    } else if (dynamic_cast<LogLayer<Dtype>*>(layer)) {
+      // Same constants as LogLayer::LayerSetUp.
+      op.type = LOG;
+      const Dtype base = param.log_param().base();
+      op.alpha = param.log_param().scale();
+      op.beta = param.log_param().shift();
+      op.gamma = (base == Dtype(-1)) ? Dtype(1) : Dtype(1) / log(base);
+    } else if (dynamic_cast<ScaleLayer<Dtype>*>(layer)) {
+      op.type = SCALE;
+      op.scale = layer->blobs()[0].get();
+      op.scale_grad = layer_need_backward_[i] && layer->param_propagate_down(0);
+      if (param.scale_param().bias_term()) {
+        op.bias = layer->blobs()[1].get();
+        op.bias_grad =
+            layer_need_backward_[i] && layer->param_propagate_down(1);
+      }
+    } else if (dynamic_cast<BiasLayer<Dtype>*>(layer)) {
+      op.type = BIAS;
+      op.bias = layer->blobs()[0].get();
+      op.bias_grad = layer_need_backward_[i] && layer->param_propagate_down(0);
+    } else {
+      LOG(FATAL) << "Unsupported layer " << param.name() << " of type "
+          << layer->type();
+    }
+    ops_.push_back(op);
+  }
+  CHECK(!ops_.empty()) << "A fused chain needs at least one elementwise op.";
+}
+
+template <typename Dtype>
+void FusedElementwiseLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
+    const vector<Blob<Dtype>*>& top) {
+  // The chain layers keep their own shape checks and internal buffers.
+  for (int i = 0; i < layers_.size(); ++i) {
+    layers_[i]->Reshape(bottom_vecs_[i], top_vecs_[i]);
+  }
+  for (int k = 0; k < ops_.size(); ++k) {
+    Op& op = ops_[k];
+    if (op.type != SCALE && op.type != BIAS) {
+      continue;
+    }
+    const Blob<Dtype>* input = bottom_vecs_[op.layer_index][0];
+    const Blob<Dtype>* param = op.scale ? op.scale : op.bias;
+    const LayerParameter& layer_param =
+        layers_[op.layer_index]->layer_param();
+    const int param_axis = (op.type == SCALE) ?
+        layer_param.scale_param().axis() : layer_param.bias_param().axis();
+    const int axis = (param->num_axes() == 0) ?
+        0 : input->CanonicalAxisIndex(param_axis);
+    op.channel_dim = param->count();
+    op.inner_dim = input->count(axis + param->num_axes());
+  }
+
+  bool need_backward = false;
+  for (int i = 0; i < layer_need_backward_.size(); ++i) {
+    need_backward |= layer_need_backward_[i];
+  }
+  input_overwritten_.assign(bottom.size(), false);
+  saved_inputs_.resize(bottom.size());
+  for (int j = 0; j < bottom.size(); ++j) {
+    for (int i = 0; i < top_vecs_.size(); ++i) {
+      if (top_vecs_[i][0] == bottom[j]) {
+        input_overwritten_[j] = need_backward;
+      }
+    }
+    if (input_overwritten_[j]) {
+      if (!saved_inputs_[j]) {
+        saved_inputs_[j].reset(new Blob<Dtype>());
+      }
+      saved_inputs_[j]->ReshapeLike(*bottom[j]);
+    }
+  }
+
+  param_grad_offsets_.resize(ops_.size());
+  param_grad_count_ = 0;
+  for (int k = 0; k < ops_.size(); ++k) {
+    param_grad_offsets_[k] = param_grad_count_;
+    param_grad_count_ += ((ops_[k].scale_grad ? 1 : 0) +
+        (ops_[k].bias_grad ? 1 : 0)) * ops_[k].channel_dim;
+  }
+}
+
+template <typename Dtype>
+int FusedElementwiseLayer<Dtype>::ScratchThreads() {
+#ifdef _OPENMP
+  const int num_threads = omp_get_max_threads();
+#else
+  const int num_threads = 1;
+#endif
+  // Input and output of every op, plus one tile for the diff.
+  tiles_.Reshape(num_threads, ops_.size() + 2, 1, kFusedTileSize);
+  param_grads_.Reshape(num_threads, std::max(param_grad_count_, 1), 1, 1);
+  return num_threads;
+}
+
+template <typename Dtype>
+void FusedElementwiseLayer<Dtype>::LoadInput(
+    const vector<const Dtype*>& inputs, const int start, const int n,
+    Dtype* x) const {
+  if (inputs.size() == 1 && coeffs_[0] == Dtype(1)) {
+    std::copy(inputs[0] + start, inputs[0] + start + n, x);
+    return;
+  }
+  for (int i = 0; i < n; ++i) {
+    x[i] = coeffs_[0] * inputs[0][start + i];
+  }
+  for (int j = 1; j < inputs.size(); ++j) {
+    const Dtype coeff = coeffs_[j];
+    const Dtype* input = inputs[j] + start;
+    for (int i = 0; i < n; ++i) {
+      x[i] += coeff * input[i];
+    }
+  }
+}
+
+template <typename Dtype>
+void FusedElementwiseLayer<Dtype>::OpForward(const Op& op, const int start,
+    const int n, const Dtype* x, Dtype* y) const {
+  switch (op.type) {
+  case RELU:
+    for (int i = 0; i < n; ++i) {
+      y[i] = std::max(x[i], Dtype(0)) + op.alpha * std::min(x[i], Dtype(0));
+    }
+    break;
+  case SIGMOID:
+    caffe_sigmoid(n, x, y);
+    break;
+  case TANH:
+    caffe_tanh(n, x, y);
+    break;
+  case ABSVAL:
+    for (int i = 0; i < n; ++i) {
+      y[i] = std::fabs(x[i]);
+    }
+    break;
+  case BNLL:
+    // y = max(x, 0) + log(1 + exp(-|x|)); y does not alias x.
+    for (int i = 0; i < n; ++i) {
+      y[i] = -std::fabs(x[i]);
+    }
+    caffe_exp(n, y, y);
+    for (int i = 0; i < n; ++i) {
+      y[i] += Dtype(1);
+    }
+    caffe_log(n, y, y);
+    for (int i = 0; i < n; ++i) {
+      y[i] += std::max(x[i], Dtype(0));
+    }
+    break;
+  case ELU:
+    for (int i = 0; i < n; ++i) {
+      y[i] = std::min(x[i], Dtype(0));
+    }
+    caffe_exp(n, y, y);
+    for (int i = 0; i < n; ++i) {
+      y[i] = std::max(x[i], Dtype(0)) + op.alpha * (y[i] - Dtype(1));
+    }
+    break;
+  case POWER:
+    if (op.alpha * op.beta == Dtype(0)) {
+      const Dtype value =
+          (op.alpha == Dtype(0)) ? Dtype(1) : pow(op.gamma, op.alpha);
+      for (int i = 0; i < n; ++i) {
+        y[i] = value;
+      }
+    } else if (op.alpha == Dtype(1)) {
+      for (int i = 0; i < n; ++i) {
+        y[i] = op.gamma + op.beta * x[i];
+      }
+    } else if (op.alpha == Dtype(2)) {
+      for (int i = 0; i < n; ++i) {
+        const Dtype v = op.gamma + op.beta * x[i];
+        y[i] = v * v;
+      }
+    } else {
+      for (int i = 0; i < n; ++i) {
+        y[i] = pow(op.gamma + op.beta * x[i], op.alpha);
+      }
+    }
+    break;
+  case EXP:
+    caffe_cpu_scale(n, op.alpha, x, y);
+    caffe_exp(n, y, y);
+    for (int i = 0; i < n; ++i) {
+      y[i] *= op.gamma;
+    }
+    break;
+  case LOG:
+    for (int i = 0; i < n; ++i) {
+      y[i] = op.alpha * x[i] + op.beta;
+    }
+    caffe_log(n, y, y);
+    for (int i = 0; i < n; ++i) {
+      y[i] *= op.gamma;
+    }
+    break;
+  case SCALE:
+  case BIAS: {
+    const Dtype* scale = op.scale ? op.scale->cpu_data() : NULL;
+    const Dtype* bias = op.bias ? op.bias->cpu_data() : NULL;
+    // Walk the tile in runs of elements sharing the same channel.
+    for (int i = 0; i < n; ) {
+      const int index = start + i;
+      const int c = (index / op.inner_dim) % op.channel_dim;
+      const int run = std::min(n - i, op.inner_dim - index % op.inner_dim);
+      const Dtype a = scale ? scale[c] : Dtype(1);
+      const Dtype b = bias ? bias[c] : Dtype(0);
+      for (int r = i; r < i + run; ++r) {
+        y[r] = a * x[r] + b;
+      }
+      i += run;
+    }
+    break;
+  }
+  default:
+    LOG(FATAL) << "Unknown fused op " << op.type;
+  }
+}
+
+template <typename Dtype>
+void FusedElementwiseLayer<Dtype>::OpBackward(const Op& op, const int start,
+    const int n, const Dtype* x, const Dtype* y, const Dtype* dy, Dtype* dx,
+    Dtype* scale_grad, Dtype* bias_grad) const {
+  switch (op.type) {
+  case RELU:
+    for (int i = 0; i < n; ++i) {
+      dx[i] = dy[i] * ((x[i] > 0) + op.alpha * (x[i] <= 0));
+    }
+    break;
+  case SIGMOID:
+    for (int i = 0; i < n; ++i) {
+      dx[i] = dy[i] * y[i] * (1. - y[i]);
+    }
+    break;
+  case TANH:
+    for (int i = 0; i < n; ++i) {
+      dx[i] = dy[i] * (1 - y[i] * y[i]);
+    }
+    break;
+  case ABSVAL:
+    for (int i = 0; i < n; ++i) {
+      dx[i] = dy[i] * caffe_sign(x[i]);
+    }
+    break;
+  case BNLL:
+    for (int i = 0; i < n; ++i) {
+      const Dtype expval = exp(std::min(x[i], Dtype(kFusedBNLLThreshold)));
+      dx[i] = dy[i] * expval / (expval + 1.);
+    }
+    break;
+  case ELU:
+    for (int i = 0; i < n; ++i) {
+      dx[i] = dy[i] * ((x[i] > 0) + (op.alpha + y[i]) * (x[i] <= 0));
+    }
+    break;
+  case POWER: {
+    const Dtype diff_scale = op.alpha * op.beta;
+    if (diff_scale == Dtype(0) || op.alpha == Dtype(1)) {
+      for (int i = 0; i < n; ++i) {
+        dx[i] = dy[i] * diff_scale;
+      }
+    } else {
+      for (int i = 0; i < n; ++i) {
+        dx[i] = dy[i] * diff_scale *
+            pow(op.gamma + op.beta * x[i], op.alpha - Dtype(1));
+      }
+    }
+    break;
+  }
+  case EXP:
+    for (int i = 0; i < n; ++i) {
+      dx[i] = dy[i] * y[i] * op.alpha;
+    }
+    break;
+  case LOG:
+    for (int i = 0; i < n; ++i) {
+      dx[i] = dy[i] * op.gamma * op.alpha / (op.alpha * x[i] + op.beta);
+    }
+    break;
+  case SCALE:
+  case BIAS: {
+    const Dtype* scale = op.scale ? op.scale->cpu_data() : NULL;
+    for (int i = 0; i < n; ) {
+      const int index = start + i;
+      const int c = (index / op.inner_dim) % op.channel_dim;
+      const int run = std::min(n - i, op.inner_dim - index % op.inner_dim);
+      if (op.scale_grad) {
+        Dtype sum = 0;
+        for (int r = i; r < i + run; ++r) {
+          sum += dy[r] * x[r];
+        }
+        scale_grad[c] += sum;
+      }
+      if (op.bias_grad) {
+        Dtype sum = 0;
+        for (int r = i; r < i + run; ++r) {
+          sum += dy[r];
+        }
+        bias_grad[c] += sum;
+      }
+      const Dtype a = scale ? scale[c] : Dtype(1);
+      for (int r = i; r < i + run; ++r) {
+        dx[r] = a * dy[r];
+      }
+      i += run;
+    }
+    break;
+  }
+  default:
+    LOG(FATAL) << "Unknown fused op " << op.type;
+  }
+}
+
+template <typename Dtype>
+void FusedElementwiseLayer<Dtype>::Forward_cpu(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  const int count = top[0]->count();
+  vector<const Dtype*> inputs(bottom.size());
+  vector<Dtype*> saved(bottom.size(), NULL);
+  for (int j = 0; j < bottom.size(); ++j) {
+    inputs[j] = bottom[j]->cpu_data();
+    if (input_overwritten_[j]) {
+      saved[j] = saved_inputs_[j]->mutable_cpu_data();
+    }
+  }
+  // Intermediate tops are written too, unless the next layer overwrites
+  // them in place, so that they hold the values of the unfused net.
+  vector<Dtype*> layer_tops(layers_.size(), NULL);
+  for (int i = 0; i + 1 < layers_.size(); ++i) {
+    if (top_vecs_[i][0] != top_vecs_[i + 1][0]) {
+      layer_tops[i] = top_vecs_[i][0]->mutable_cpu_data();
+    }
+  }
+  // The output of an Eltwise heading the chain is the loaded input.
+  Dtype* eltwise_top = (ops_[0].layer_index > 0) ? layer_tops[0] : NULL;
+  Dtype* top_data = top[0]->mutable_cpu_data();
+  const int num_ops = ops_.size();
+  const int num_tiles = (count + kFusedTileSize - 1) / kFusedTileSize;
+  const int num_threads = ScratchThreads();
+  Dtype* tiles = tiles_.mutable_cpu_data();
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+  for (int t = 0; t < num_tiles; ++t) {
+#ifdef _OPENMP
+    const int tid = omp_get_thread_num();
+#else
+    const int tid = 0;
+#endif
+    Dtype* stage[2];
+    stage[0] = tiles + tid * (num_ops + 2) * kFusedTileSize;
+    stage[1] = stage[0] + kFusedTileSize;
+    const int start = t * kFusedTileSize;
+    const int n = std::min(kFusedTileSize, count - start);
+    for (int j = 0; j < saved.size(); ++j) {
+      if (saved[j]) {
+        std::copy(inputs[j] + start, inputs[j] + start + n, saved[j] + start);
+      }
+    }
+    LoadInput(inputs, start, n, stage[0]);
+    if (eltwise_top) {
+      std::copy(stage[0], stage[0] + n, eltwise_top + start);
+    }
+    for (int k = 0; k < num_ops; ++k) {
+      Dtype* y = (k == num_ops - 1) ? top_data + start : stage[(k + 1) % 2];
+      OpForward(ops_[k], start, n, stage[k % 2], y);
+      Dtype* layer_top = layer_tops[ops_[k].layer_index];
+      if (layer_top && k < num_ops - 1) {
+        std::copy(y, y + n, layer_top + start);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void FusedElementwiseLayer<Dtype>::Backward_cpu(
+    const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down,
+    const vector<Blob<Dtype>*>& bottom) {
+  const int num_ops = ops_.size();
+  int first_op = num_ops;
+  for (int k = num_ops - 1; k >= 0; --k) {
+    if (layer_need_backward_[ops_[k].layer_index]) {
+      first_op = k;
+    }
+  }
+  const bool input_diff = layer_need_backward_[0];
+  if (first_op == num_ops && !input_diff) {
+    return;
+  }
+
+  const int count = top[0]->count();
+  vector<const Dtype*> inputs(bottom.size());
+  vector<Dtype*> bottom_diffs(bottom.size(), NULL);
+  for (int j = 0; j < bottom.size(); ++j) {
+    inputs[j] = input_overwritten_[j] ?
+        saved_inputs_[j]->cpu_data() : bottom[j]->cpu_data();
+    if (input_diff && propagate_down[j]) {
+      bottom_diffs[j] = bottom[j]->mutable_cpu_diff();
+    }
+  }
+  const Dtype* top_diff = top[0]->cpu_diff();
+  const int num_tiles = (count + kFusedTileSize - 1) / kFusedTileSize;
+  const int num_threads = ScratchThreads();
+  Dtype* tiles = tiles_.mutable_cpu_data();
+  Dtype* param_grads = param_grads_.mutable_cpu_data();
+  caffe_set(param_grads_.count(), Dtype(0), param_grads);
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(num_threads) schedule(static)
+#endif
+  for (int t = 0; t < num_tiles; ++t) {
+#ifdef _OPENMP
+    const int tid = omp_get_thread_num();
+#else
+    const int tid = 0;
+#endif
+    // stage + k * kFusedTileSize holds the input of op k.
+    Dtype* stage = tiles + tid * (num_ops + 2) * kFusedTileSize;
+    Dtype* diff = stage + (num_ops + 1) * kFusedTileSize;
+    Dtype* grads = param_grads + tid * param_grads_.channels();
+    const int start = t * kFusedTileSize;
+    const int n = std::min(kFusedTileSize, count - start);
+    LoadInput(inputs, start, n, stage);
+    for (int k = 0; k < num_ops; ++k) {
+      OpForward(ops_[k], start, n, stage + k * kFusedTileSize,
+          stage + (k + 1) * kFusedTileSize);
+    }
+    const Dtype* dy = top_diff + start;
+    for (int k = num_ops - 1; k >= first_op; --k) {
+      Dtype* scale_grad = grads + param_grad_offsets_[k];
+      Dtype* bias_grad =
+          scale_grad + (ops_[k].scale_grad ? ops_[k].channel_dim : 0);
+      OpBackward(ops_[k], start, n, stage + k * kFusedTileSize,
+          stage + (k + 1) * kFusedTileSize, dy, diff, scale_grad, bias_grad);
+      dy = diff;
+    }
+    for (int j = 0; j < bottom_diffs.size(); ++j) {
+      if (bottom_diffs[j]) {
+        Dtype* bottom_diff = bottom_diffs[j] + start;
+        for (int i = 0; i < n; ++i) {
+          bottom_diff[i] = coeffs_[j] * dy[i];
+        }
+      }
+    }
+  }
+
+  // Reduce the per-thread parameter gradients into the parameter diffs,
+  // accumulating like the unfused Scale and Bias layers do.
+  for (int k = first_op; k < num_ops; ++k) {
+    const Op& op = ops_[k];
+    for (int p = 0; p < 2; ++p) {
+      const bool has_grad = (p == 0) ? op.scale_grad : op.bias_grad;
+      if (!has_grad) {
+        continue;
+      }
+      const int offset = param_grad_offsets_[k] +
+          ((p == 1 && op.scale_grad) ? op.channel_dim : 0);
+      Blob<Dtype>* param = (p == 0) ? op.scale : op.bias;
+      Dtype* param_diff = param->mutable_cpu_diff();
+      for (int tid = 0; tid < num_threads; ++tid) {
+        caffe_axpy(op.channel_dim, Dtype(1),
+            param_grads + tid * param_grads_.channels() + offset, param_diff);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void FusedElementwiseLayer<Dtype>::Forward_gpu(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  for (int i = 0; i < layers_.size(); ++i) {
+    layers_[i]->Forward(bottom_vecs_[i], top_vecs_[i]);
+  }
+}
+
+template <typename Dtype>
+void FusedElementwiseLayer<Dtype>::Backward_gpu(
+    const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down,
+    const vector<Blob<Dtype>*>& bottom) {
+  for (int i = layers_.size() - 1; i >= 0; --i) {
+    if (!layer_need_backward_[i]) {
+      continue;
+    }
+    // Inside the chain a bottom needs backward exactly when its producer
+    // does.
+    const vector<bool> layer_propagate_down = (i == 0) ? propagate_down :
+        vector<bool>(1, layer_need_backward_[i - 1]);
+    layers_[i]->Backward(top_vecs_[i], layer_propagate_down, bottom_vecs_[i]);
+  }
+}
+
+INSTANTIATE_CLASS(FusedElementwiseLayer);
+
+}  // namespace caffe
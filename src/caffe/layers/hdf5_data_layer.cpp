@@ -1,11 +1,12 @@
 /*
 TODO:
-- load file in a separate thread ("prefetch")
 - can be smarter about the memcpy call instead of doing it row-by-row
   :: use util functions caffe_copy, and Blob->offset()
   :: don't forget to update hdf5_daa_layer.cu accordingly
 - add ability to shuffle filenames if flag is set
 */
+#include <boost/thread.hpp>
+#include <algorithm>
 #include <fstream>  // NOLINT(readability/streams)
 #include <string>
 #include <vector>
@@ -16,16 +17,24 @@ TODO:
 
 #include "caffe/layers/hdf5_data_layer.hpp"
 #include "caffe/util/hdf5.hpp"
+#include "caffe/util/rng.hpp"
 
 namespace caffe {
 
+// The HDF5 library is usually not built thread safe, streaming layers take
+// turns to access it.
+static boost::mutex hdf5_mutex_;
+
 template <typename Dtype>
-HDF5DataLayer<Dtype>::~HDF5DataLayer<Dtype>() { }
+HDF5DataLayer<Dtype>::~HDF5DataLayer<Dtype>() {
+  this->StopInternalThread();
+}
 
 // Load data and label from HDF5 filename into the class property blobs.
 template <typename Dtype>
 void HDF5DataLayer<Dtype>::LoadHDF5FileData(const char* filename) {
   DLOG(INFO) << "Loading HDF5 file: " << filename;
+  boost::mutex::scoped_lock lock(hdf5_mutex_);
   hid_t file_id = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
   if (file_id < 0) {
     LOG(FATAL) << "Failed opening HDF5 file: " << filename;
@@ -106,9 +115,48 @@ void HDF5DataLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
     std::random_shuffle(file_permutation_.begin(), file_permutation_.end());
   }
 
-  // Load the first HDF5 file and initialize the line counter.
-  LoadHDF5FileData(hdf_filenames_[file_permutation_[current_file_]].c_str());
-  current_row_ = 0;
+  const int chunk_rows = this->layer_param_.hdf5_data_param().chunk_rows();
+  if (chunk_rows > 0) {
+    // Without any row, the streaming thread would never fill a chunk
+    int total_rows = 0;
+    {
+      boost::mutex::scoped_lock lock(hdf5_mutex_);
+      for (int i = 0; i < num_files_; ++i) {
+        const char* filename = hdf_filenames_[i].c_str();
+        hid_t file_id = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+        if (file_id < 0) {
+          LOG(FATAL) << "Failed opening HDF5 file: " << filename;
+        }
+        total_rows += hdf5_get_nd_dataset_shape(file_id,
+            this->layer_param_.top(0).c_str(), 1, INT_MAX)[0];
+        herr_t status = H5Fclose(file_id);
+        CHECK_GE(status, 0) << "Failed to close HDF5 file: " << filename;
+      }
+    }
+    CHECK_GT(total_rows, 0) << "No rows in the HDF5 files listed in "
+        << source;
+    // Start streaming, the first chunk gives the shapes of the tops
+    this->StopInternalThread();
+    const int num_chunks = this->layer_param_.hdf5_data_param().prefetch() + 1;
+    chunks_.resize(num_chunks);
+    chunk_free_.reset(new BoundedQueue<HDF5Chunk<Dtype>*>(num_chunks));
+    chunk_full_.reset(new BoundedQueue<HDF5Chunk<Dtype>*>(num_chunks));
+    for (int i = 0; i < num_chunks; ++i) {
+      chunks_[i].reset(new HDF5Chunk<Dtype>());
+      for (int j = 0; j < this->layer_param_.top_size(); ++j) {
+        chunks_[i]->blobs_.push_back(
+            shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+      }
+      chunk_free_->push(chunks_[i].get());
+    }
+    current_chunk_ = NULL;
+    this->StartInternalThread();
+    Next();
+  } else {
+    // Load the first HDF5 file and initialize the line counter.
+    LoadHDF5FileData(hdf_filenames_[file_permutation_[current_file_]].c_str());
+    current_row_ = 0;
+  }
 
   // Reshape blobs.
   const int batch_size = this->layer_param_.hdf5_data_param().batch_size();
@@ -124,28 +172,123 @@ void HDF5DataLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   }
 }
 
+template <typename Dtype>
+void HDF5DataLayer<Dtype>::Next() {
+  if (this->layer_param_.hdf5_data_param().chunk_rows() > 0) {
+    if (current_chunk_) {
+      chunk_free_->push(current_chunk_);
+    }
+    current_chunk_ = chunk_full_->pop("Waiting for HDF5 data");
+    hdf_blobs_ = current_chunk_->blobs_;
+    data_permutation_ = current_chunk_->permutation_;
+  } else {
+    if (num_files_ > 1) {
+      ++current_file_;
+      if (current_file_ == num_files_) {
+        current_file_ = 0;
+        if (this->layer_param_.hdf5_data_param().shuffle()) {
+          std::random_shuffle(file_permutation_.begin(),
+                              file_permutation_.end());
+        }
+        DLOG(INFO) << "Looping around to first file.";
+      }
+      LoadHDF5FileData(
+          hdf_filenames_[file_permutation_[current_file_]].c_str());
+    }
+    if (this->layer_param_.hdf5_data_param().shuffle())
+      std::random_shuffle(data_permutation_.begin(), data_permutation_.end());
+  }
+  current_row_ = 0;
+}
+
+template <typename Dtype>
+void HDF5DataLayer<Dtype>::LoadHDF5Chunk(hid_t file_id, int row_begin,
+    int num_rows, HDF5Chunk<Dtype>* chunk) {
+  const int MIN_DATA_DIM = 1;
+  const int MAX_DATA_DIM = INT_MAX;
+  for (int i = 0; i < this->layer_param_.top_size(); ++i) {
+    hdf5_load_nd_dataset_rows(file_id, this->layer_param_.top(i).c_str(),
+        MIN_DATA_DIM, MAX_DATA_DIM, row_begin, num_rows,
+        chunk->blobs_[i].get());
+  }
+  chunk->permutation_.resize(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    chunk->permutation_[i] = i;
+  }
+  if (this->layer_param_.hdf5_data_param().shuffle()) {
+    shuffle(chunk->permutation_.begin(), chunk->permutation_.end());
+  }
+}
+
+template <typename Dtype>
+void HDF5DataLayer<Dtype>::InternalThreadEntry() {
+  const HDF5DataParameter& param = this->layer_param_.hdf5_data_param();
+  const int chunk_rows = param.chunk_rows();
+  vector<unsigned int> files(file_permutation_);
+  hid_t file_id = -1;
+  try {
+    while (!must_stop()) {
+      for (int f = 0; f < files.size(); ++f) {
+        const string& filename = hdf_filenames_[files[f]];
+        vector<int> chunk_begins;
+        {
+          boost::mutex::scoped_lock lock(hdf5_mutex_);
+          DLOG(INFO) << "Streaming HDF5 file: " << filename;
+          file_id = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+          if (file_id < 0) {
+            LOG(FATAL) << "Failed opening HDF5 file: " << filename;
+          }
+          const int num = hdf5_get_nd_dataset_shape(file_id,
+              this->layer_param_.top(0).c_str(), 1, INT_MAX)[0];
+          for (int i = 1; i < this->layer_param_.top_size(); ++i) {
+            CHECK_EQ(hdf5_get_nd_dataset_shape(file_id,
+                this->layer_param_.top(i).c_str(), 1, INT_MAX)[0], num);
+          }
+          for (int row = 0; row < num; row += chunk_rows) {
+            chunk_begins.push_back(row);
+          }
+          if (param.shuffle()) {
+            shuffle(chunk_begins.begin(), chunk_begins.end());
+          }
+          // Rows are read up to the end of the file
+          chunk_begins.push_back(num);
+        }
+        for (int c = 0; c < chunk_begins.size() - 1; ++c) {
+          HDF5Chunk<Dtype>* chunk = chunk_free_->pop();
+          {
+            boost::mutex::scoped_lock lock(hdf5_mutex_);
+            LoadHDF5Chunk(file_id, chunk_begins[c], std::min(chunk_rows,
+                chunk_begins.back() - chunk_begins[c]), chunk);
+          }
+          chunk_full_->push(chunk);
+        }
+        {
+          boost::mutex::scoped_lock lock(hdf5_mutex_);
+          herr_t status = H5Fclose(file_id);
+          CHECK_GE(status, 0) << "Failed to close HDF5 file: " << filename;
+          file_id = -1;
+        }
+      }
+      if (param.shuffle()) {
+        shuffle(files.begin(), files.end());
+      }
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+    if (file_id >= 0) {
+      boost::mutex::scoped_lock lock(hdf5_mutex_);
+      H5Fclose(file_id);
+    }
+  }
+}
+
 template <typename Dtype>
 void HDF5DataLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const int batch_size = this->layer_param_.hdf5_data_param().batch_size();
   for (int i = 0; i < batch_size; ++i, ++current_row_) {
     if (current_row_ == hdf_blobs_[0]->shape(0)) {
-      if (num_files_ > 1) {
-        ++current_file_;
-        if (current_file_ == num_files_) {
-          current_file_ = 0;
-          if (this->layer_param_.hdf5_data_param().shuffle()) {
-            std::random_shuffle(file_permutation_.begin(),
-                                file_permutation_.end());
-          }
-          DLOG(INFO) << "Looping around to first file.";
-        }
-        LoadHDF5FileData(
-            hdf_filenames_[file_permutation_[current_file_]].c_str());
-      }
-      current_row_ = 0;
-      if (this->layer_param_.hdf5_data_param().shuffle())
-        std::random_shuffle(data_permutation_.begin(), data_permutation_.end());
+      Next();
     }
     for (int j = 0; j < this->layer_param_.top_size(); ++j) {
       int data_dim = top[j]->count() / top[j]->shape(0);
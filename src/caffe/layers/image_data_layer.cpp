@@ -1,6 +1,7 @@
 #ifdef USE_OPENCV
 #include <opencv2/core/core.hpp>
 
+#include <algorithm>
 #include <fstream>  // NOLINT(readability/streams)
 #include <iostream>  // NOLINT(readability/streams)
 #include <string>
@@ -11,6 +12,7 @@
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/layers/image_data_layer.hpp"
 #include "caffe/util/benchmark.hpp"
+#include "caffe/util/image_reader.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/math_functions.hpp"
 #include "caffe/util/rng.hpp"
@@ -66,6 +68,14 @@ void ImageDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
     CHECK_GT(lines_.size(), skip) << "Not enough points to skip";
     lines_id_ = skip;
   }
+  reader_.reset(new AsyncFileReader(
+      this->layer_param_.image_data_param().reader_threads(),
+      this->layer_param_.image_data_param().direct_io()));
+  if (this->layer_param_.image_data_param().image_cache_size() > 0) {
+    image_cache_.reset(new ImageCache(
+        this->layer_param_.image_data_param().image_cache_size()));
+  }
+  read_id_ = lines_id_;
   // Read an image, and use it to initialize the top blob.
   cv::Mat cv_img = ReadImageToCVMat(root_folder + lines_[lines_id_].first,
                                     new_height, new_width, is_color);
@@ -77,8 +87,8 @@ void ImageDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
   const int batch_size = this->layer_param_.image_data_param().batch_size();
   CHECK_GT(batch_size, 0) << "Positive batch size required";
   top_shape[0] = batch_size;
-  for (int i = 0; i < this->PREFETCH_COUNT; ++i) {
-    this->prefetch_[i].data_.Reshape(top_shape);
+  for (int i = 0; i < this->prefetch_.size(); ++i) {
+    this->prefetch_[i]->data_.Reshape(top_shape);
   }
   top[0]->Reshape(top_shape);
 
@@ -88,8 +98,8 @@ void ImageDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
   // label
   vector<int> label_shape(1, batch_size);
   top[1]->Reshape(label_shape);
-  for (int i = 0; i < this->PREFETCH_COUNT; ++i) {
-    this->prefetch_[i].label_.Reshape(label_shape);
+  for (int i = 0; i < this->prefetch_.size(); ++i) {
+    this->prefetch_[i]->label_.Reshape(label_shape);
   }
 }
 
@@ -100,6 +110,59 @@ void ImageDataLayer<Dtype>::ShuffleImages() {
   shuffle(lines_.begin(), lines_.end(), prefetch_rng);
 }
 
+template <typename Dtype>
+shared_ptr<FileRead> ImageDataLayer<Dtype>::NextRead() {
+  // Reads do not go past the end of the list, which may be shuffled before
+  // the next epoch, so reads_ is empty when lines_id_ wraps around.
+  if (reads_.empty()) {
+    read_id_ = lines_id_;
+  }
+  const string& root_folder =
+      this->layer_param_.image_data_param().root_folder();
+  const int readahead = std::max<int>(
+      this->layer_param_.image_data_param().readahead(), 1);
+  while (static_cast<int>(reads_.size()) < readahead &&
+      read_id_ < lines_.size()) {
+    const string path = root_folder + lines_[read_id_].first;
+    cv::Mat cv_img;
+    if (image_cache_ && image_cache_->Get(path, &cv_img)) {
+      reads_.push_back(shared_ptr<FileRead>());
+    } else {
+      reads_.push_back(reader_->Read(path));
+    }
+    ++read_id_;
+  }
+  shared_ptr<FileRead> read = reads_.front();
+  reads_.pop_front();
+  return read;
+}
+
+template <typename Dtype>
+cv::Mat ImageDataLayer<Dtype>::DecodeImage(const shared_ptr<FileRead>& read,
+    const string& filename) {
+  const ImageDataParameter& image_data_param =
+      this->layer_param_.image_data_param();
+  const string path = image_data_param.root_folder() + filename;
+  cv::Mat cv_img;
+  if (image_cache_ && image_cache_->Get(path, &cv_img)) {
+    return cv_img;
+  }
+  // Without a read, the image was cached when queued but has been evicted
+  string contents;
+  bool ok = read ? read->Wait() :
+      AsyncFileReader::ReadFile(path, image_data_param.direct_io(), &contents);
+  if (ok) {
+    cv_img = DecodeImageToCVMat(read ? read->contents() : contents,
+        image_data_param.new_height(), image_data_param.new_width(),
+        image_data_param.is_color());
+  }
+  CHECK(cv_img.data) << "Could not load " << filename;
+  if (image_cache_) {
+    image_cache_->Put(path, cv_img);
+  }
+  return cv_img;
+}
+
 template <typename Dtype>
 void ImageDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   CPUTimer batch_timer;
@@ -111,18 +174,13 @@ void ImageDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   CHECK(this->transformed_data_.count());
   ImageDataParameter image_data_param = this->layer_param_.image_data_param();
   const int batch_size = image_data_param.batch_size();
-  const int new_height = image_data_param.new_height();
-  const int new_width = image_data_param.new_width();
-  const bool is_color = image_data_param.is_color();
-  string root_folder = image_data_param.root_folder();
 
   // Reshape according to the first image of each batch
   // on single input batches allows for inputs of varying dimension.
-  cv::Mat cv_img = ReadImageToCVMat(root_folder + lines_[lines_id_].first,
-      new_height, new_width, is_color);
-  CHECK(cv_img.data) << "Could not load " << lines_[lines_id_].first;
+  // The first image is then used for the first item.
+  cv::Mat first_img = DecodeImage(NextRead(), lines_[lines_id_].first);
   // Use data_transformer to infer the expected blob shape from a cv_img.
-  vector<int> top_shape = this->data_transformer_->InferBlobShape(cv_img);
+  vector<int> top_shape = this->data_transformer_->InferBlobShape(first_img);
   this->transformed_data_.Reshape(top_shape);
   // Reshape batch according to the batch_size.
   top_shape[0] = batch_size;
@@ -142,10 +200,13 @@ void ImageDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
     // get a blob
     timer.Start();
     CHECK_GT(lines_size, lines_id_);
+    shared_ptr<FileRead> read;
+    if (item_id > 0) {
+      read = NextRead();
+    }
 #ifndef _OPENMP
-    cv::Mat cv_img = ReadImageToCVMat(root_folder + lines_[lines_id_].first,
-        new_height, new_width, is_color);
-    CHECK(cv_img.data) << "Could not load " << lines_[lines_id_].first;
+    cv::Mat cv_img = item_id > 0 ?
+        DecodeImage(read, lines_[lines_id_].first) : first_img;
     read_time += timer.MicroSeconds();
     timer.Start();
 // Apply transformations (mirror, crop...) to the image
@@ -162,12 +223,11 @@ void ImageDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
     std::string img_file_name = lines_[lines_id_].first;
     PreclcRandomNumbers precalculated_rand_numbers;
     this->data_transformer_->GenerateRandNumbers(precalculated_rand_numbers);
-    #pragma omp task firstprivate(offset, img_file_name, \
+    #pragma omp task firstprivate(item_id, offset, img_file_name, read, \
                                                     precalculated_rand_numbers)
     {
-        cv::Mat cv_img = ReadImageToCVMat(root_folder + img_file_name,
-            new_height, new_width, is_color);
-        CHECK(cv_img.data) << "Could not load " << img_file_name;
+        cv::Mat cv_img = item_id > 0 ?
+            DecodeImage(read, img_file_name) : first_img;
 
         Blob<Dtype> tmp_data;
         tmp_data.Reshape(top_shape);
@@ -1,6 +1,7 @@
 #ifdef MKL2017_SUPPORTED
 #include <algorithm>
 #include <cstdlib>
+#include <map>
 #include <vector>
 
 #include "caffe/filler.hpp"
@@ -23,25 +24,10 @@ template <typename Dtype>
 MKLConvolutionLayer<Dtype>::MKLConvolutionLayer(
   const LayerParameter& param)
       : ConvolutionLayer<Dtype>(param),
-        fwd_bottom_data(new MKLData<Dtype>()),
-        fwd_top_data(new MKLData<Dtype>()),
-        fwd_filter_data(new MKLData<Dtype>()),
-        fwd_bias_data(new MKLData<Dtype>()),
         convolutionFwd(NULL),
-        bwdd_top_diff(new MKLDiff<Dtype>()),
-        bwdd_bottom_diff(new MKLDiff<Dtype>()),
-        bwdd_filter_data(new MKLData<Dtype>()),
         convolutionBwdData(static_cast<dnnPrimitive_t>(NULL)),
-        bwdf_top_diff(new MKLDiff<Dtype>()),
-        bwdf_filter_diff(new MKLDiff<Dtype>()),
-        bwdf2fwd_filter_diff(new MKLDiff<Dtype>()),
-        bwdf_bottom_data(new MKLData<Dtype>()),
         convolutionBwdFilter(static_cast<dnnPrimitive_t>(NULL)),
-        bwdb_top_diff(new MKLDiff<Dtype>()),
-        bwdb_bias_diff(new MKLDiff<Dtype>()),
-        convolutionBwdBias(static_cast<dnnPrimitive_t>(NULL)),
-        bwdf_filter_diff_iter(new MKLDiff<Dtype>()),
-        bwdb_bias_diff_iter(new MKLDiff<Dtype>()) {}
+        convolutionBwdBias(static_cast<dnnPrimitive_t>(NULL)) {}
 
 template <typename Dtype>
 void MKLConvolutionLayer<Dtype>::compute_output_shape() {
@@ -54,11 +40,45 @@ void MKLConvolutionLayer<Dtype>::compute_output_shape() {
 
 template <typename Dtype>
 MKLConvolutionLayer<Dtype>::~MKLConvolutionLayer() {
-    dnnDelete<Dtype>(convolutionFwd);
-    dnnDelete<Dtype>(convolutionBwdData);
-    dnnDelete<Dtype>(convolutionBwdFilter);
-    if (this->bias_term_)
-        dnnDelete<Dtype>(convolutionBwdBias);
+  Primitives current;
+  SwapPrimitives(&current);
+  DeletePrimitives(&current);
+  for (typename PrimitivesList::iterator it = cached_primitives_.begin();
+       it != cached_primitives_.end(); ++it) {
+    DeletePrimitives(&it->second);
+  }
+}
+
+template <typename Dtype>
+void MKLConvolutionLayer<Dtype>::DeletePrimitives(Primitives* primitives) {
+  dnnDelete<Dtype>(primitives->convolutionFwd);
+  dnnDelete<Dtype>(primitives->convolutionBwdData);
+  dnnDelete<Dtype>(primitives->convolutionBwdFilter);
+  if (this->bias_term_)
+    dnnDelete<Dtype>(primitives->convolutionBwdBias);
+}
+
+template <typename Dtype>
+void MKLConvolutionLayer<Dtype>::SwapPrimitives(Primitives* primitives) {
+  std::swap(fwd_bottom_data, primitives->fwd_bottom_data);
+  std::swap(fwd_top_data, primitives->fwd_top_data);
+  std::swap(fwd_filter_data, primitives->fwd_filter_data);
+  std::swap(fwd_bias_data, primitives->fwd_bias_data);
+  std::swap(convolutionFwd, primitives->convolutionFwd);
+  std::swap(bwdd_top_diff, primitives->bwdd_top_diff);
+  std::swap(bwdd_bottom_diff, primitives->bwdd_bottom_diff);
+  std::swap(bwdd_filter_data, primitives->bwdd_filter_data);
+  std::swap(convolutionBwdData, primitives->convolutionBwdData);
+  std::swap(bwdf_top_diff, primitives->bwdf_top_diff);
+  std::swap(bwdf_filter_diff, primitives->bwdf_filter_diff);
+  std::swap(bwdf2fwd_filter_diff, primitives->bwdf2fwd_filter_diff);
+  std::swap(bwdf_bottom_data, primitives->bwdf_bottom_data);
+  std::swap(convolutionBwdFilter, primitives->convolutionBwdFilter);
+  std::swap(bwdb_top_diff, primitives->bwdb_top_diff);
+  std::swap(bwdb_bias_diff, primitives->bwdb_bias_diff);
+  std::swap(convolutionBwdBias, primitives->convolutionBwdBias);
+  std::swap(bwdf_filter_diff_iter, primitives->bwdf_filter_diff_iter);
+  std::swap(bwdb_bias_diff_iter, primitives->bwdb_bias_diff_iter);
 }
 
 template <typename Dtype>
@@ -81,6 +101,11 @@ void MKLConvolutionLayer<Dtype>::LayerSetUp(
 
   this->bottom_shape_ = &bottom[0]->shape();
   compute_output_shape();
+  CreatePrimitives();
+}
+
+template <typename Dtype>
+void MKLConvolutionLayer<Dtype>::CreatePrimitives() {
   int status;
   size_t n, g;
   size_t iw, ih, ic;
@@ -125,6 +150,22 @@ void MKLConvolutionLayer<Dtype>::LayerSetUp(
   size_t convolutionStrides[2] = {this->stride_w_, this->stride_h_};
   int    inputOffset[2] = {-this->pad_w_, -this->pad_h_};
 
+  fwd_bottom_data.reset(new MKLData<Dtype>());
+  fwd_top_data.reset(new MKLData<Dtype>());
+  fwd_filter_data.reset(new MKLData<Dtype>());
+  fwd_bias_data.reset(new MKLData<Dtype>());
+  bwdd_top_diff.reset(new MKLDiff<Dtype>());
+  bwdd_bottom_diff.reset(new MKLDiff<Dtype>());
+  bwdd_filter_data.reset(new MKLData<Dtype>());
+  bwdf_top_diff.reset(new MKLDiff<Dtype>());
+  bwdf_filter_diff.reset(new MKLDiff<Dtype>());
+  bwdf2fwd_filter_diff.reset(new MKLDiff<Dtype>());
+  bwdf_bottom_data.reset(new MKLData<Dtype>());
+  bwdb_top_diff.reset(new MKLDiff<Dtype>());
+  bwdb_bias_diff.reset(new MKLDiff<Dtype>());
+  bwdf_filter_diff_iter.reset(new MKLDiff<Dtype>());
+  bwdb_bias_diff_iter.reset(new MKLDiff<Dtype>());
+
   // Names are for debugging purposes only.
   fwd_bottom_data ->name = "fwd_bottom_data   @ " + this->layer_param_.name();
   fwd_top_data    ->name = "fwd_top_data      @ " + this->layer_param_.name();
@@ -290,95 +331,40 @@ void MKLConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
       this->num_ == bottom[0]->num())
     return;
 
-  // Free MKL primitives
-  dnnDelete<Dtype>(convolutionFwd);
-  dnnDelete<Dtype>(convolutionBwdData);
+  // Keep the primitives and layouts of the previous shape, so that
+  // alternating between a few batch sizes does not recreate them every time.
+  if (cached_primitives_.size() >= kMaxCachedShapes) {
+    // Evict the least recently used shape.
+    DeletePrimitives(&cached_primitives_.back().second);
+    cached_index_.erase(cached_primitives_.back().first);
+    cached_primitives_.pop_back();
+  }
+  vector<int> shape(3);
+  shape[0] = this->num_;
+  shape[1] = this->height_;
+  shape[2] = this->width_;
+  cached_primitives_.push_front(std::make_pair(shape, Primitives()));
+  cached_index_[shape] = cached_primitives_.begin();
+  SwapPrimitives(&cached_primitives_.front().second);
 
-  // Reinit layer params
   this->width_ = bottom[0]->width();
   this->height_ = bottom[0]->height();
   this->num_ = bottom[0]->num();
-
   this->bottom_shape_ = &bottom[0]->shape();
   compute_output_shape();
-  int status;
-  size_t n, g;
-  size_t ic, oc, kw, kh;
-  size_t dimension = 4;
 
-  g  = this->group_;
-  n  = this->num_;
-  ic = this->channels_;
-  kw = this->kernel_w_;
-  kh = this->kernel_h_;
-
-  oc = this->num_output_;
-
-  size_t bdata_sizes[4] = {this->width_, this->height_, ic, n};
-
-  /* starting with MKL 2017 Gold in case of groups filter layout
-   * becomes 5D, i.e. groups become a separate dimension */
-  size_t g_mkl2017 = g;
-  size_t f_dimension = dimension + (g != 1);
-  if (getMKLBuildDate() < 20160701) {
-      g_mkl2017 = 1;
-      f_dimension = dimension;
-  }
-
-  size_t fdata_sizes[5] = {kw, kh, ic/g, oc/g_mkl2017, g_mkl2017};
-
-  size_t tdata_sizes[4] = {this->width_out_, this->height_out_, oc, n};
-
-  size_t convolutionStrides[2] = {this->stride_w_, this->stride_h_};
-  int    inputOffset[2] = {-this->pad_w_, -this->pad_h_};
-
-  // Recreate MKL primitives
-  if (this->bias_term_) {
-    status = dnnGroupsConvolutionCreateForwardBias<Dtype>(
-      &convolutionFwd,
-      NULL,
-      dnnAlgorithmConvolutionDirect,
-      g,
-      dimension,
-      bdata_sizes,
-      tdata_sizes,
-      fdata_sizes,
-      convolutionStrides,
-      inputOffset,
-      dnnBorderZeros);
+  shape[0] = this->num_;
+  shape[1] = this->height_;
+  shape[2] = this->width_;
+  typename std::map<vector<int>, typename PrimitivesList::iterator>::iterator
+      it = cached_index_.find(shape);
+  if (it != cached_index_.end()) {
+    SwapPrimitives(&it->second->second);
+    cached_primitives_.erase(it->second);
+    cached_index_.erase(it);
   } else {
-    status = dnnGroupsConvolutionCreateForward<Dtype>(
-      &convolutionFwd,
-      NULL,
-      dnnAlgorithmConvolutionDirect,
-      g,
-      dimension,
-      bdata_sizes,
-      tdata_sizes,
-      fdata_sizes,
-      convolutionStrides,
-      inputOffset,
-      dnnBorderZeros);
+    CreatePrimitives();
   }
-  CHECK_EQ(status, 0)
-          << "Failed dnnCreateConvolution<Dtype>(dnnForward) with status "
-          << status << "\n";
-
-  status = dnnGroupsConvolutionCreateBackwardData<Dtype>(
-    &convolutionBwdData,
-    NULL,
-    dnnAlgorithmConvolutionDirect,
-    g,
-    dimension,
-    bdata_sizes,
-    tdata_sizes,
-    fdata_sizes,
-    convolutionStrides,
-    inputOffset,
-    dnnBorderZeros);
-  CHECK_EQ(status, 0)
-          << "Failed dnnConvolutionCreateBackwardData with status "
-          << status << "\n";
 }
 
 template <typename Dtype>
@@ -0,0 +1,258 @@
+#ifdef MKLDNN_SUPPORTED
+#include <vector>
+
+#include "caffe/layer.hpp"
+#include "caffe/layers/mkldnn_layers.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+void MKLDNNBatchNormLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom
+                                            ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNBatchNormLayer<Dtype>::LayerSetUp: " << this->layer_param_.name();
+
+    Layer<Dtype>::LayerSetUp(bottom, top);
+
+    BatchNormParameter param = this->layer_param_.batch_norm_param();
+    moving_average_fraction_ = param.moving_average_fraction();
+    use_global_stats_ = this->phase_ == TEST;
+    if (param.has_use_global_stats())
+        use_global_stats_ = param.use_global_stats();
+    eps_ = param.eps();
+    channels_ = bottom[0]->channels();
+
+    // Same parameters as BatchNormLayer: mean, variance and the moving
+    // average factor they are scaled by.
+    if (this->blobs_.size() > 0) {
+        LOG(INFO) << "Skipping parameter initialization";
+    } else {
+        this->blobs_.resize(3);
+        vector<int> sz;
+        sz.push_back(channels_);
+        this->blobs_[0].reset(new Blob<Dtype>(sz));
+        this->blobs_[1].reset(new Blob<Dtype>(sz));
+        sz[0] = 1;
+        this->blobs_[2].reset(new Blob<Dtype>(sz));
+        for (int i = 0; i < 3; ++i) {
+            caffe_set(this->blobs_[i]->count(), Dtype(0),
+                        this->blobs_[i]->mutable_cpu_data());
+        }
+    }
+}
+
+template <typename Dtype>
+void MKLDNNBatchNormLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNBatchNormLayer<Dtype>::Reshape: " << this->layer_param_.name();
+
+    CHECK_EQ(4, bottom[0]->num_axes()) << "Input must have 4 axes, "
+        << "corresponding to (num, channels, height, width)";
+    CHECK_EQ(bottom[0]->channels(), channels_);
+
+    const uint32_t num = bottom[0]->num();
+    const uint32_t height = bottom[0]->height();
+    const uint32_t width = bottom[0]->width();
+    // The primitive is built for one input shape: have Forward recreate it
+    // when the shape changes.
+    if (bnFwd_pd != NULL && (num != num_ || height != height_ || width != width_)) {
+        bnFwd_pd.reset();
+        bnBwd_pd.reset();
+    }
+    num_ = num;
+    height_ = height;
+    width_ = width;
+
+    top[0]->ReshapeLike(*bottom[0]);
+
+    vector<int> sz(1, channels_);
+    mean_.Reshape(sz);
+    variance_.Reshape(sz);
+}
+
+template <typename Dtype>
+void MKLDNNBatchNormLayer<Dtype>::InitBatchNorm(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top)
+{
+    if (std::is_same<Dtype, double>::value) NOT_IMPLEMENTED;
+
+    auto propagation = this->phase_ == TEST ? prop_kind::forward_scoring : prop_kind::forward_training;
+    // With global stats mean and variance are inputs of the primitive,
+    // otherwise the primitive computes them from the batch.
+    unsigned flags = use_global_stats_ ? batch_normalization::use_global_stats : 0u;
+
+    uint32_t n  = this->num_;
+    uint32_t iw = this->width_;
+    uint32_t ih = this->height_;
+    uint32_t ic = this->channels_;
+
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+    memory::precision mpcsn = memory::precision::f32;
+    // ---- Initialize memory descriptors -------------
+    shared_ptr<memory::desc> input_md, output_md;
+    shared_ptr<memory::primitive_desc> usr_mpd(NULL), prv_mpd(NULL);
+    shared_ptr<MKLDNNMemoryDescriptor<Dtype, false> > mem_descr
+        = get_mkldnn_prv_descriptor<Dtype, false>(bottom[0]);
+    if (mem_descr != NULL) {
+        input_md.reset(new memory::desc(mem_descr->prv_memory_pd()->desc()));
+        usr_mpd = mem_descr->usr_memory_pd();
+        prv_mpd = mem_descr->prv_memory_pd();
+    } else {
+        input_md.reset(new memory::desc({{n, ic, ih, iw}}, mpcsn, memory::format::nchw));
+        usr_mpd.reset(new memory::primitive_desc(*input_md, cpu_engine));
+    }
+    output_md = input_md;
+    fwd_bottom_data.reset(new MKLDNNData<Dtype>(usr_mpd, prv_mpd));
+    fwd_top_data.reset(new MKLDNNData<Dtype>(usr_mpd, prv_mpd));
+
+    fwd_bottom_data->name = "fwd_bottom_data   @ " + this->layer_param_.name();
+    fwd_top_data->name =    "fwd_top_data      @ " + this->layer_param_.name();
+
+    // ---- Initialize batch normalization primitive descriptor -------------
+    batch_normalization::desc bnFwd_desc(propagation, *input_md, *output_md, eps_, flags);
+    bnFwd_pd.reset(new batch_normalization::primitive_desc(bnFwd_desc, cpu_engine));
+
+    // ---- Create memory  ---------------------
+    memory::primitive_desc stats_mpd({{ic}, mpcsn, memory::format::x}, cpu_engine);
+    mean_memory.reset(new memory(stats_mpd, mean_.mutable_cpu_data()));
+    variance_memory.reset(new memory(stats_mpd, variance_.mutable_cpu_data()));
+
+    input_memory = fwd_bottom_data->create_input_memory(bottom[0]);
+    if (fwd_top_data->conversion_needed())
+        top[0]->set_prv_data_descriptor(fwd_top_data);
+    output_memory = fwd_top_data->create_output_memory(top[0]);
+
+    // ---- Create batch normalization --------------------
+    bnFwd.reset(new batch_normalization(*bnFwd_pd, *input_memory
+                        , *mean_memory, *variance_memory, *output_memory));
+
+    // Without global stats backward needs the input, which in place is
+    // overwritten by the output: keep a copy of it.
+    bottom_copy.reset();
+    bottom_copy_memory.reset();
+    if (top[0] == bottom[0] && !use_global_stats_) {
+        shared_ptr<memory::primitive_desc> data_mpd = prv_mpd ? prv_mpd : usr_mpd;
+        bottom_copy_memory.reset(new memory(*data_mpd));
+        reorder::primitive_desc copy_pd(*data_mpd, *data_mpd);
+        bottom_copy.reset(new reorder(copy_pd, *input_memory, *bottom_copy_memory));
+    }
+    // The backward primitive uses the memories created here.
+    bnBwd_pd.reset();
+}
+
+template <typename Dtype>
+void MKLDNNBatchNormLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
+                                            ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNBatchNormLayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+
+    if (use_global_stats_) {
+        // use the stored mean/variance estimates.
+        const Dtype scale_factor = this->blobs_[2]->cpu_data()[0] == 0 ?
+            0 : 1 / this->blobs_[2]->cpu_data()[0];
+        caffe_cpu_scale(mean_.count(), scale_factor,
+            this->blobs_[0]->cpu_data(), mean_.mutable_cpu_data());
+        caffe_cpu_scale(variance_.count(), scale_factor,
+            this->blobs_[1]->cpu_data(), variance_.mutable_cpu_data());
+    }
+
+    if (bnFwd_pd == NULL) {
+        InitBatchNorm(bottom, top);
+    } else {
+        fwd_bottom_data->sync_blob_prv_data(bottom[0]);
+        if (fwd_top_data->conversion_needed())
+            top[0]->set_prv_data_descriptor(fwd_top_data);
+    }
+
+    if (bottom_copy)
+        stream().submit({*bottom_copy, *bnFwd}).wait();
+    else
+        stream().submit({*bnFwd}).wait();
+
+    if (!use_global_stats_) {
+        // compute and save moving average
+        this->blobs_[2]->mutable_cpu_data()[0] *= moving_average_fraction_;
+        this->blobs_[2]->mutable_cpu_data()[0] += 1;
+        caffe_cpu_axpby(mean_.count(), Dtype(1), mean_.cpu_data(),
+            moving_average_fraction_, this->blobs_[0]->mutable_cpu_data());
+        int m = bottom[0]->count() / channels_;
+        Dtype bias_correction_factor = m > 1 ? Dtype(m)/(m-1) : 1;
+        caffe_cpu_axpby(variance_.count(), bias_correction_factor,
+            variance_.cpu_data(), moving_average_fraction_,
+            this->blobs_[1]->mutable_cpu_data());
+    }
+}
+
+template <typename Dtype>
+void MKLDNNBatchNormLayer<Dtype>::InitBatchNormBwd(const vector<Blob<Dtype>*>& top
+                                            ,const vector<bool>& propagate_down
+                                            ,const vector<Blob<Dtype>*>& bottom)
+{
+    unsigned flags = use_global_stats_ ? batch_normalization::use_global_stats : 0u;
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+
+    // ---- Diffs use the layout of the data -------------
+    memory::desc data_md(fwd_bottom_data->prv_memory_pd() ?
+            fwd_bottom_data->prv_memory_pd()->desc() : fwd_bottom_data->usr_memory_pd()->desc());
+    bwd_top_diff.reset(new MKLDNNDiff<Dtype>(fwd_top_data->usr_memory_pd(), fwd_top_data->prv_memory_pd()));
+    bwd_bottom_diff.reset(new MKLDNNDiff<Dtype>(fwd_bottom_data->usr_memory_pd(), fwd_bottom_data->prv_memory_pd()));
+
+    bwd_top_diff->name =    "bwd_top_diff      @ " + this->layer_param_.name();
+    bwd_bottom_diff->name = "bwd_bottom_diff   @ " + this->layer_param_.name();
+
+    // ---- Initialize batch normalization primitive descriptor -------------
+    batch_normalization::desc bnBwd_desc(prop_kind::backward_data, data_md, data_md, eps_, flags);
+    bnBwd_pd.reset(new batch_normalization::primitive_desc(bnBwd_desc, cpu_engine));
+
+    // ---- Create memory  ---------------------
+    top_diff_memory = bwd_top_diff->create_input_memory(top[0]);
+    if (bwd_bottom_diff->conversion_needed())
+        bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+    bottom_diff_memory = bwd_bottom_diff->create_output_memory(bottom[0]);
+
+    // ---- Create batch normalization --------------------
+    // The mean and variance are the ones Forward used: the batch statistics,
+    // or the stored estimates with global stats.
+    shared_ptr<memory> src_memory = bottom_copy_memory ? bottom_copy_memory : input_memory;
+    bnBwd.reset(new batch_normalization(*bnBwd_pd, *src_memory, *mean_memory
+                        , *variance_memory, *top_diff_memory, *bottom_diff_memory));
+}
+
+template <typename Dtype>
+void MKLDNNBatchNormLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
+                                            ,const vector<bool>& propagate_down
+                                            ,const vector<Blob<Dtype>*>& bottom)
+{
+    VLOG(1) << "MKLDNNBatchNormLayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+    if (!propagate_down[0])
+        return;
+    if (bnBwd_pd == NULL) {
+        InitBatchNormBwd(top, propagate_down, bottom);
+    } else {
+        bwd_top_diff->sync_blob_prv_data(top[0]);
+        if (bwd_bottom_diff->conversion_needed())
+            bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+    }
+
+    stream().submit({*bnBwd}).wait();
+}
+
+#ifdef CPU_ONLY
+STUB_GPU(MKLDNNBatchNormLayer);
+#else
+template <typename Dtype>
+void MKLDNNBatchNormLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom
+                                            ,const vector<Blob<Dtype>*>& top)
+{ NOT_IMPLEMENTED; }
+
+template <typename Dtype>
+void MKLDNNBatchNormLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top
+                                            ,const vector<bool>& propagate_down
+                                            ,const vector<Blob<Dtype>*>& bottom)
+{ NOT_IMPLEMENTED; }
+#endif
+
+INSTANTIATE_CLASS(MKLDNNBatchNormLayer);
+}  // namespace caffe
+#endif  // #ifdef MKLDNN_SUPPORTED
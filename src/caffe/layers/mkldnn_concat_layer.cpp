@@ -0,0 +1,196 @@
+#ifdef MKLDNN_SUPPORTED
+#include <vector>
+
+#include "caffe/layer.hpp"
+#include "caffe/layers/mkldnn_layers.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+void MKLDNNConcatLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNConcatLayer<Dtype>::LayerSetUp: " << this->layer_param_.name();
+
+    Layer<Dtype>::LayerSetUp(bottom, top);
+
+    const ConcatParameter& concat_param = this->layer_param_.concat_param();
+    CHECK(!(concat_param.has_axis() && concat_param.has_concat_dim()))
+        << "Either axis or concat_dim should be specified; not both.";
+    int concat_axis = concat_param.has_concat_dim() ?
+        static_cast<int>(concat_param.concat_dim()) :
+        bottom[0]->CanonicalAxisIndex(concat_param.axis());
+    CHECK_EQ(concat_axis, 1) << "MKLDNNConcatLayer supports only concatenation along channels";
+}
+
+template <typename Dtype>
+void MKLDNNConcatLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom
+                                    ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNConcatLayer<Dtype>::Reshape: " << this->layer_param_.name();
+
+    const uint32_t num = bottom[0]->num();
+    const uint32_t height = bottom[0]->height();
+    const uint32_t width = bottom[0]->width();
+    vector<int> bottom_channels(bottom.size());
+    channels_ = 0;
+    for (int i = 0; i < bottom.size(); ++i) {
+        CHECK_EQ(4, bottom[i]->num_axes()) << "Input must have 4 axes, "
+            << "corresponding to (num, channels, height, width)";
+        CHECK_EQ(num, bottom[i]->num());
+        CHECK_EQ(height, bottom[i]->height());
+        CHECK_EQ(width, bottom[i]->width());
+        bottom_channels[i] = bottom[i]->channels();
+        channels_ += bottom_channels[i];
+    }
+    // The primitive is built for one set of input shapes: have Forward
+    // recreate it when they change.
+    if (concatFwd_pd != NULL && (num != num_ || height != height_ || width != width_
+                                 || bottom_channels != bottom_channels_))
+        concatFwd_pd.reset();
+    num_ = num;
+    height_ = height;
+    width_ = width;
+    bottom_channels_ = bottom_channels;
+    top[0]->Reshape(num_, channels_, height_, width_);
+}
+
+template <typename Dtype>
+void MKLDNNConcatLayer<Dtype>::InitConcat(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top)
+{
+    if (std::is_same<Dtype, double>::value) NOT_IMPLEMENTED;
+
+    uint32_t n  = this->num_;
+    uint32_t iw = this->width_;
+    uint32_t ih = this->height_;
+    uint32_t oc = this->channels_;
+
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+    memory::precision mpcsn = memory::precision::f32;
+    memory::format mfmt_nchw = memory::format::nchw;
+    typedef typename memory::primitive_desc MemPD; // short name for memory::primitive_desc
+
+    // ---- Choose the layout of the inputs -------------
+    // Inputs are kept in the private format of the first input when all the
+    // private inputs share it, the others are converted to it; in any other
+    // case all the inputs are read in nchw.
+    memory::format cmfmt = mfmt_nchw;
+    shared_ptr<MKLDNNMemoryDescriptor<Dtype, false> > first_descr
+        = get_mkldnn_prv_descriptor<Dtype, false>(bottom[0]);
+    if (first_descr != NULL) {
+        cmfmt = static_cast<memory::format>(first_descr->prv_memory_pd()->desc().data.format);
+        for (int i = 1; i < bottom.size(); ++i) {
+            shared_ptr<MKLDNNMemoryDescriptor<Dtype, false> > mem_descr
+                = get_mkldnn_prv_descriptor<Dtype, false>(bottom[i]);
+            if (mem_descr != NULL && mem_descr->prv_memory_pd()->desc().data.format
+                                        != first_descr->prv_memory_pd()->desc().data.format) {
+                cmfmt = mfmt_nchw;
+                break;
+            }
+        }
+    }
+
+    // ---- Initialize memory descriptors -------------
+    vector<MemPD> srcs_mpd;
+    fwd_bottom_data.clear();
+    for (int i = 0; i < bottom.size(); ++i) {
+        tensor::dims input_tz = {n, static_cast<uint32_t>(bottom[i]->channels()), ih, iw};
+        shared_ptr<MemPD> usr_input_mpd(new MemPD({{input_tz}, mpcsn, mfmt_nchw}, cpu_engine));
+        shared_ptr<MemPD> prv_input_mpd(NULL);
+        if (cmfmt != mfmt_nchw)
+            prv_input_mpd.reset(new MemPD({{input_tz}, mpcsn, cmfmt}, cpu_engine));
+        fwd_bottom_data.push_back(shared_ptr<MKLDNNData<Dtype> >(
+                    new MKLDNNData<Dtype>(usr_input_mpd, prv_input_mpd)));
+        fwd_bottom_data[i]->name = "fwd_bottom_data   @ " + this->layer_param_.name();
+        srcs_mpd.push_back(prv_input_mpd ? *prv_input_mpd : *usr_input_mpd);
+    }
+
+    tensor::dims output_tz = {n, oc, ih, iw};
+    shared_ptr<MemPD> usr_output_mpd(new MemPD({{output_tz}, mpcsn, mfmt_nchw}, cpu_engine));
+    shared_ptr<MemPD> prv_output_mpd(NULL);
+    if (cmfmt != mfmt_nchw)
+        prv_output_mpd.reset(new MemPD({{output_tz}, mpcsn, cmfmt}, cpu_engine));
+    fwd_top_data.reset(new MKLDNNData<Dtype>(usr_output_mpd, prv_output_mpd));
+    fwd_top_data->name = "fwd_top_data      @ " + this->layer_param_.name();
+
+    // ---- Initialize concat primitive descriptor -------------
+    memory::desc output_md(prv_output_mpd ? prv_output_mpd->desc() : usr_output_mpd->desc());
+    concatFwd_pd.reset(new concat::primitive_desc(output_md, 1, srcs_mpd));
+
+    // ---- Create memory  ---------------------
+    input_memory.clear();
+    vector<primitive::at> srcs;
+    for (int i = 0; i < bottom.size(); ++i) {
+        input_memory.push_back(fwd_bottom_data[i]->create_input_memory(bottom[i]));
+        srcs.push_back(*input_memory[i]);
+    }
+    if (fwd_top_data->conversion_needed())
+        top[0]->set_prv_data_descriptor(fwd_top_data);
+    output_memory = fwd_top_data->create_output_memory(top[0]);
+
+    // ---- Create concat --------------------
+    concatFwd.reset(new concat(*concatFwd_pd, srcs, *output_memory));
+}
+
+template <typename Dtype>
+void MKLDNNConcatLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNConcatLayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+
+    if (concatFwd_pd == NULL) {
+        InitConcat(bottom, top);
+    } else {
+        for (int i = 0; i < bottom.size(); ++i)
+            fwd_bottom_data[i]->sync_blob_prv_data(bottom[i]);
+        if (fwd_top_data->conversion_needed())
+            top[0]->set_prv_data_descriptor(fwd_top_data);
+    }
+
+    stream().submit({*concatFwd}).wait();
+}
+
+template <typename Dtype>
+void MKLDNNConcatLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{
+    VLOG(1) << "MKLDNNConcatLayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+
+    // Slices the channels of the top diff in the user layout.
+    const Dtype* top_diff = top[0]->cpu_diff();
+    const int spatial_dim = height_ * width_;
+    int offset_channel = 0;
+    for (int i = 0; i < bottom.size(); ++i) {
+        const int bottom_channels = bottom[i]->channels();
+        if (propagate_down[i]) {
+            Dtype* bottom_diff = bottom[i]->mutable_cpu_diff();
+            for (int n = 0; n < num_; ++n) {
+                caffe_copy(bottom_channels * spatial_dim
+                    , top_diff + (n * channels_ + offset_channel) * spatial_dim
+                    , bottom_diff + n * bottom_channels * spatial_dim);
+            }
+        }
+        offset_channel += bottom_channels;
+    }
+}
+
+#ifdef CPU_ONLY
+STUB_GPU(MKLDNNConcatLayer);
+#else
+template <typename Dtype>
+void MKLDNNConcatLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{ NOT_IMPLEMENTED; }
+
+template <typename Dtype>
+void MKLDNNConcatLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{ NOT_IMPLEMENTED; }
+#endif
+
+INSTANTIATE_CLASS(MKLDNNConcatLayer);
+}  // namespace caffe
+#endif  // #ifdef MKLDNN_SUPPORTED
@@ -172,6 +172,11 @@ void MKLDNNConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bott
                                                 , const vector<Blob<Dtype>*>& top)
 {
     VLOG(1) << "MKLDNNConvolutionLayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+    if (std::is_same<Dtype, double>::value) {
+        // MKLDNN primitives are single precision only.
+        ConvolutionLayer<Dtype>::Forward_cpu(bottom, top);
+        return;
+    }
 
     if( convFwd_pd == NULL) {
         InitConvolution(bottom, top);
@@ -186,12 +191,123 @@ void MKLDNNConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bott
     stream().submit({*convFwd}).wait();
 }
 
+template <typename Dtype>
+void MKLDNNConvolutionLayer<Dtype>::InitConvolutionBwd(const vector<Blob<Dtype>*>& top
+                                                    , const vector<bool>& propagate_down
+                                                    , const vector<Blob<Dtype>*>& bottom)
+{
+    tensor::dims convolutionStrides {this->stride_h_, this->stride_w_};
+    tensor::nd_offset padding {this->pad_h_, this->pad_w_};
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+
+    // ---- Backward primitives work on the layouts chosen for forward -------------
+    // so that the weights diff can be applied to the weights as they are.
+    memory::desc prv_input_md(convFwd_pd->data.src_primitive_desc.memory_desc);
+    memory::desc prv_weights_md(convFwd_pd->data.weights_primitive_desc.memory_desc);
+    memory::desc prv_bias_md(convFwd_pd->data.bias_primitive_desc.memory_desc);
+    memory::desc prv_output_md(convFwd_pd->data.dst_primitive_desc.memory_desc);
+
+    // ---- Initialize convolution primitive descriptors -------------
+    convolution::desc convBwdData_desc(prop_kind::backward_data, convolution::direct, prv_input_md
+                                    , prv_weights_md, prv_bias_md
+                                    , prv_output_md, convolutionStrides
+                                    , padding, padding_kind::zero);
+    convBwdData_pd.reset(new convolution::primitive_desc(convBwdData_desc, cpu_engine));
+    convolution::desc convBwdWeights_desc(prop_kind::backward_weights, convolution::direct, prv_input_md
+                                    , prv_weights_md, prv_bias_md
+                                    , prv_output_md, convolutionStrides
+                                    , padding, padding_kind::zero);
+    convBwdWeights_pd.reset(new convolution::primitive_desc(convBwdWeights_desc, cpu_engine));
+    convolution::desc convBwdBias_desc(prop_kind::backward_bias, convolution::direct, prv_input_md
+                                    , prv_weights_md, prv_bias_md
+                                    , prv_output_md, convolutionStrides
+                                    , padding, padding_kind::zero);
+    convBwdBias_pd.reset(new convolution::primitive_desc(convBwdBias_desc, cpu_engine));
+
+    // ---- Diffs have the same usr and prv layouts as the data -------------
+    bwd_top_diff.reset(new MKLDNNDiff<Dtype>(fwd_top_data->usr_memory_pd(), fwd_top_data->prv_memory_pd()));
+    bwd_bottom_diff.reset(new MKLDNNDiff<Dtype>(fwd_bottom_data->usr_memory_pd(), fwd_bottom_data->prv_memory_pd()));
+    bwd_weights_diff.reset(new MKLDNNDiff<Dtype>(fwd_weights_data->usr_memory_pd(), fwd_weights_data->prv_memory_pd()));
+    bwd_bias_diff.reset(new MKLDNNDiff<Dtype>(fwd_bias_data->usr_memory_pd(), fwd_bias_data->prv_memory_pd()));
+    bwd_weights_diff_iter.reset(new MKLDNNDiff<Dtype>(fwd_weights_data->usr_memory_pd(), fwd_weights_data->prv_memory_pd()));
+    bwd_bias_diff_iter.reset(new MKLDNNDiff<Dtype>(fwd_bias_data->usr_memory_pd(), fwd_bias_data->prv_memory_pd()));
+
+    // Names are for debugging purposes only.
+    bwd_top_diff    ->name = "bwd_top_diff      @ " + this->layer_param_.name();
+    bwd_bottom_diff ->name = "bwd_bottom_diff   @ " + this->layer_param_.name();
+    bwd_weights_diff->name = "bwd_weights_diff  @ " + this->layer_param_.name();
+    bwd_bias_diff   ->name = "bwd_bias_diff     @ " + this->layer_param_.name();
+
+    // ---- Create memory  ---------------------
+    top_diff_memory = bwd_top_diff->create_input_memory(top[0]);
+    if (propagate_down[0]) {
+        if (bwd_bottom_diff->conversion_needed())
+            bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+        bottom_diff_memory = bwd_bottom_diff->create_output_memory(bottom[0]);
+        convBwdData.reset(new convolution(*convBwdData_pd
+                            , *top_diff_memory, *weights_memory
+                            , *bottom_diff_memory));
+    }
+
+    if (this->param_propagate_down(0) || this->param_propagate_down(1)) {
+        if (Caffe::iter_size() > 1) {
+            // if (iter_size > 1) then diffs are accumulated across iterations
+            weights_diff_memory = bwd_weights_diff_iter->get_prv_memory();
+            bias_diff_memory = bwd_bias_diff_iter->get_prv_memory();
+        } else {
+            if (bwd_weights_diff->conversion_needed())
+                this->blobs_[0]->set_prv_diff_descriptor(bwd_weights_diff);
+            if (bwd_bias_diff->conversion_needed())
+                this->blobs_[1]->set_prv_diff_descriptor(bwd_bias_diff);
+            weights_diff_memory = bwd_weights_diff->create_output_memory(this->blobs_[0].get());
+            bias_diff_memory = bwd_bias_diff->create_output_memory(this->blobs_[1].get());
+        }
+        // Each primitive reads its inputs and writes a single output: the
+        // weights diff from the input and the top diff, the bias diff from
+        // the top diff alone.
+        convBwdWeights.reset(new convolution(*convBwdWeights_pd
+                            , *input_memory, *top_diff_memory
+                            , *weights_diff_memory));
+        convBwdBias.reset(new convolution(*convBwdBias_pd
+                            , *top_diff_memory, *bias_diff_memory));
+    }
+}
+
 template <typename Dtype>
 void MKLDNNConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
                                                 , const vector<bool>& propagate_down
                                                 , const vector<Blob<Dtype>*>& bottom)
 {
-    NOT_IMPLEMENTED;
+    VLOG(1) << "MKLDNNConvolutionLayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+    if (std::is_same<Dtype, double>::value) {
+        ConvolutionLayer<Dtype>::Backward_cpu(top, propagate_down, bottom);
+        return;
+    }
+
+    if( convBwdWeights_pd == NULL) {
+        InitConvolutionBwd(top, propagate_down, bottom);
+    } else {
+        bwd_top_diff->sync_blob_prv_data(top[0]);
+        // The forward pass has brought the input and the weights to the
+        // layouts used by the backward primitives already.
+        if (propagate_down[0] && bwd_bottom_diff->conversion_needed())
+            bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+        if (Caffe::iter_size() == 1) {
+            if (bwd_weights_diff->conversion_needed())
+                this->blobs_[0]->set_prv_diff_descriptor(bwd_weights_diff);
+            if (bwd_bias_diff->conversion_needed())
+                this->blobs_[1]->set_prv_diff_descriptor(bwd_bias_diff);
+        }
+    }
+    if (propagate_down[0])
+        stream().submit({*convBwdData}).wait();
+    if (this->param_propagate_down(0) || this->param_propagate_down(1)) {
+        stream().submit({*convBwdWeights, *convBwdBias}).wait();
+        if (Caffe::iter_size() > 1) {
+            accumulate_mkldnn_diff(this->blobs_[0].get(), bwd_weights_diff, bwd_weights_diff_iter);
+            accumulate_mkldnn_diff(this->blobs_[1].get(), bwd_bias_diff, bwd_bias_diff_iter);
+        }
+    }
 }
 
 #ifdef CPU_ONLY
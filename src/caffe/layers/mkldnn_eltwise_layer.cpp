@@ -0,0 +1,179 @@
+#ifdef MKLDNN_SUPPORTED
+#include <vector>
+
+#include "caffe/layer.hpp"
+#include "caffe/layers/mkldnn_layers.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+void MKLDNNEltwiseLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNEltwiseLayer<Dtype>::LayerSetUp: " << this->layer_param_.name();
+
+    Layer<Dtype>::LayerSetUp(bottom, top);
+
+    const EltwiseParameter& eltwise_param = this->layer_param_.eltwise_param();
+    CHECK(eltwise_param.operation() == EltwiseParameter_EltwiseOp_SUM)
+        << "MKLDNNEltwiseLayer supports only the SUM operation";
+    CHECK(eltwise_param.coeff_size() == 0
+        || eltwise_param.coeff_size() == bottom.size())
+        << "Eltwise Layer takes one coefficient per bottom blob.";
+    // Blob-wise coefficients for the elementwise operation.
+    coeffs_ = vector<double>(bottom.size(), 1);
+    for (int i = 0; i < eltwise_param.coeff_size(); ++i) {
+        coeffs_[i] = eltwise_param.coeff(i);
+    }
+}
+
+template <typename Dtype>
+void MKLDNNEltwiseLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom
+                                    ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNEltwiseLayer<Dtype>::Reshape: " << this->layer_param_.name();
+
+    CHECK_EQ(4, bottom[0]->num_axes()) << "Input must have 4 axes, "
+        << "corresponding to (num, channels, height, width)";
+    for (int i = 1; i < bottom.size(); ++i) {
+        CHECK(bottom[i]->shape() == bottom[0]->shape());
+    }
+    const uint32_t num = bottom[0]->num();
+    const uint32_t channels = bottom[0]->channels();
+    const uint32_t height = bottom[0]->height();
+    const uint32_t width = bottom[0]->width();
+    // The primitive is built for one input shape: have Forward recreate it
+    // when the shape changes.
+    if (sumFwd_pd != NULL && (num != num_ || channels != channels_
+                              || height != height_ || width != width_))
+        sumFwd_pd.reset();
+    num_ = num;
+    channels_ = channels;
+    height_ = height;
+    width_ = width;
+    top[0]->ReshapeLike(*bottom[0]);
+}
+
+template <typename Dtype>
+void MKLDNNEltwiseLayer<Dtype>::InitEltwise(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top)
+{
+    if (std::is_same<Dtype, double>::value) NOT_IMPLEMENTED;
+
+    uint32_t n  = this->num_;
+    uint32_t iw = this->width_;
+    uint32_t ih = this->height_;
+    uint32_t ic = this->channels_;
+
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+    memory::precision mpcsn = memory::precision::f32;
+    memory::format mfmt_nchw = memory::format::nchw;
+    typedef typename memory::primitive_desc MemPD; // short name for memory::primitive_desc
+
+    // ---- Choose the layout of the inputs -------------
+    // The private layout of the first input is used when all the private
+    // inputs share it, the others are converted to it; in any other case all
+    // the inputs are read in nchw.
+    shared_ptr<MemPD> usr_mpd(new MemPD({{{n, ic, ih, iw}}, mpcsn, mfmt_nchw}, cpu_engine));
+    shared_ptr<MemPD> prv_mpd(NULL);
+    shared_ptr<MKLDNNMemoryDescriptor<Dtype, false> > first_descr
+        = get_mkldnn_prv_descriptor<Dtype, false>(bottom[0]);
+    if (first_descr != NULL) {
+        prv_mpd = first_descr->prv_memory_pd();
+        for (int i = 1; i < bottom.size(); ++i) {
+            shared_ptr<MKLDNNMemoryDescriptor<Dtype, false> > mem_descr
+                = get_mkldnn_prv_descriptor<Dtype, false>(bottom[i]);
+            if (mem_descr != NULL && !first_descr->layout_compare(mem_descr)) {
+                prv_mpd.reset();
+                break;
+            }
+        }
+    }
+
+    // ---- Initialize memory descriptors -------------
+    vector<MemPD> srcs_mpd;
+    fwd_bottom_data.clear();
+    for (int i = 0; i < bottom.size(); ++i) {
+        fwd_bottom_data.push_back(shared_ptr<MKLDNNData<Dtype> >(
+                    new MKLDNNData<Dtype>(usr_mpd, prv_mpd)));
+        fwd_bottom_data[i]->name = "fwd_bottom_data   @ " + this->layer_param_.name();
+        srcs_mpd.push_back(prv_mpd ? *prv_mpd : *usr_mpd);
+    }
+    fwd_top_data.reset(new MKLDNNData<Dtype>(usr_mpd, prv_mpd));
+    fwd_top_data->name = "fwd_top_data      @ " + this->layer_param_.name();
+
+    // ---- Initialize sum primitive descriptor -------------
+    memory::desc output_md(prv_mpd ? prv_mpd->desc() : usr_mpd->desc());
+    sumFwd_pd.reset(new sum::primitive_desc(output_md, coeffs_, srcs_mpd));
+
+    // ---- Create memory  ---------------------
+    input_memory.clear();
+    vector<primitive::at> srcs;
+    for (int i = 0; i < bottom.size(); ++i) {
+        input_memory.push_back(fwd_bottom_data[i]->create_input_memory(bottom[i]));
+        srcs.push_back(*input_memory[i]);
+    }
+    if (fwd_top_data->conversion_needed())
+        top[0]->set_prv_data_descriptor(fwd_top_data);
+    output_memory = fwd_top_data->create_output_memory(top[0]);
+
+    // ---- Create sum --------------------
+    sumFwd.reset(new sum(*sumFwd_pd, srcs, *output_memory));
+}
+
+template <typename Dtype>
+void MKLDNNEltwiseLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNEltwiseLayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+
+    if (sumFwd_pd == NULL) {
+        InitEltwise(bottom, top);
+    } else {
+        for (int i = 0; i < bottom.size(); ++i)
+            fwd_bottom_data[i]->sync_blob_prv_data(bottom[i]);
+        if (fwd_top_data->conversion_needed())
+            top[0]->set_prv_data_descriptor(fwd_top_data);
+    }
+
+    stream().submit({*sumFwd}).wait();
+}
+
+template <typename Dtype>
+void MKLDNNEltwiseLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{
+    VLOG(1) << "MKLDNNEltwiseLayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+
+    const int count = top[0]->count();
+    const Dtype* top_diff = top[0]->cpu_diff();
+    for (int i = 0; i < bottom.size(); ++i) {
+        if (!propagate_down[i])
+            continue;
+        if (coeffs_[i] == Dtype(1)) {
+            caffe_copy(count, top_diff, bottom[i]->mutable_cpu_diff());
+        } else {
+            caffe_cpu_scale(count, Dtype(coeffs_[i]), top_diff, bottom[i]->mutable_cpu_diff());
+        }
+    }
+}
+
+#ifdef CPU_ONLY
+STUB_GPU(MKLDNNEltwiseLayer);
+#else
+template <typename Dtype>
+void MKLDNNEltwiseLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{ NOT_IMPLEMENTED; }
+
+template <typename Dtype>
+void MKLDNNEltwiseLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{ NOT_IMPLEMENTED; }
+#endif
+
+INSTANTIATE_CLASS(MKLDNNEltwiseLayer);
+}  // namespace caffe
+#endif  // #ifdef MKLDNN_SUPPORTED
@@ -153,6 +153,11 @@ void MKLDNNInnerProductLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bot
                                                 , const vector<Blob<Dtype>*>& top)
 {
     VLOG(1) << "MKLDNNInnerProductLayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+    if (std::is_same<Dtype, double>::value) {
+        // MKLDNN primitives are single precision only.
+        InnerProductLayer<Dtype>::Forward_cpu(bottom, top);
+        return;
+    }
 
     if( ipFwd_pd == NULL) {
         InitInnerProduct(bottom, top);
@@ -167,12 +172,112 @@ void MKLDNNInnerProductLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bot
     stream().submit({*ipFwd}).wait();
 }
 
+template <typename Dtype>
+void MKLDNNInnerProductLayer<Dtype>::InitInnerProductBwd(const vector<Blob<Dtype>*>& top
+                                                    , const vector<bool>& propagate_down
+                                                    , const vector<Blob<Dtype>*>& bottom)
+{
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+
+    // Backward primitives work on the layouts chosen for forward
+    memory::desc prv_input_md(ipFwd_pd->data.src_primitive_desc.memory_desc);
+    memory::desc prv_output_md(ipFwd_pd->data.dst_primitive_desc.memory_desc);
+    memory::desc prv_weights_md(ipFwd_pd->data.weights_primitive_desc.memory_desc);
+    memory::desc prv_bias_md(ipFwd_pd->data.bias_primitive_desc.memory_desc);
+
+    // Initialize inner_product primitive descriptors
+    inner_product::desc ipBwdData_desc(prop_kind::backward_data, prv_input_md, prv_weights_md
+                                                ,prv_bias_md, prv_output_md);
+    ipBwdData_pd.reset(new inner_product::primitive_desc(ipBwdData_desc, cpu_engine));
+    inner_product::desc ipBwdWeights_desc(prop_kind::backward_weights, prv_input_md, prv_weights_md
+                                                ,prv_bias_md, prv_output_md);
+    ipBwdWeights_pd.reset(new inner_product::primitive_desc(ipBwdWeights_desc, cpu_engine));
+    inner_product::desc ipBwdBias_desc(prop_kind::backward_bias, prv_input_md, prv_weights_md
+                                                ,prv_bias_md, prv_output_md);
+    ipBwdBias_pd.reset(new inner_product::primitive_desc(ipBwdBias_desc, cpu_engine));
+
+    // Diffs have the same usr and prv layouts as the data
+    bwd_top_diff.reset(new MKLDNNDiff<Dtype>(fwd_top_data->usr_memory_pd(), fwd_top_data->prv_memory_pd()));
+    bwd_bottom_diff.reset(new MKLDNNDiff<Dtype>(fwd_bottom_data->usr_memory_pd(), fwd_bottom_data->prv_memory_pd()));
+    bwd_weights_diff.reset(new MKLDNNDiff<Dtype>(fwd_weights_data->usr_memory_pd(), fwd_weights_data->prv_memory_pd()));
+    bwd_bias_diff.reset(new MKLDNNDiff<Dtype>(fwd_bias_data->usr_memory_pd(), fwd_bias_data->prv_memory_pd()));
+    bwd_weights_diff_iter.reset(new MKLDNNDiff<Dtype>(fwd_weights_data->usr_memory_pd(), fwd_weights_data->prv_memory_pd()));
+    bwd_bias_diff_iter.reset(new MKLDNNDiff<Dtype>(fwd_bias_data->usr_memory_pd(), fwd_bias_data->prv_memory_pd()));
+
+    // Names are for debugging purposes only.
+    bwd_top_diff    ->name = "bwd_top_diff      @ " + this->layer_param_.name();
+    bwd_bottom_diff ->name = "bwd_bottom_diff   @ " + this->layer_param_.name();
+    bwd_weights_diff->name = "bwd_weights_diff  @ " + this->layer_param_.name();
+    bwd_bias_diff   ->name = "bwd_bias_diff     @ " + this->layer_param_.name();
+
+    // ---- Create memory  ---------------------
+    top_diff_memory = bwd_top_diff->create_input_memory(top[0]);
+    if (propagate_down[0]) {
+        if (bwd_bottom_diff->conversion_needed())
+            bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+        bottom_diff_memory = bwd_bottom_diff->create_output_memory(bottom[0]);
+        ipBwdData.reset(new inner_product(*ipBwdData_pd
+                            , *top_diff_memory, *weights_memory
+                            , *bottom_diff_memory));
+    }
+
+    if (this->param_propagate_down(0) || this->param_propagate_down(1)) {
+        if (Caffe::iter_size() > 1) {
+            // if (iter_size > 1) then diffs are accumulated across iterations
+            weights_diff_memory = bwd_weights_diff_iter->get_prv_memory();
+            bias_diff_memory = bwd_bias_diff_iter->get_prv_memory();
+        } else {
+            if (bwd_weights_diff->conversion_needed())
+                this->blobs_[0]->set_prv_diff_descriptor(bwd_weights_diff);
+            if (bwd_bias_diff->conversion_needed())
+                this->blobs_[1]->set_prv_diff_descriptor(bwd_bias_diff);
+            weights_diff_memory = bwd_weights_diff->create_output_memory(this->blobs_[0].get());
+            bias_diff_memory = bwd_bias_diff->create_output_memory(this->blobs_[1].get());
+        }
+        // Each primitive reads its inputs and writes a single output: the
+        // weights diff from the input and the top diff, the bias diff from
+        // the top diff alone.
+        ipBwdWeights.reset(new inner_product(*ipBwdWeights_pd
+                            , *input_memory, *top_diff_memory
+                            , *weights_diff_memory));
+        ipBwdBias.reset(new inner_product(*ipBwdBias_pd
+                            , *top_diff_memory, *bias_diff_memory));
+    }
+}
+
 template <typename Dtype>
 void MKLDNNInnerProductLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
                                                 , const vector<bool>& propagate_down
                                                 , const vector<Blob<Dtype>*>& bottom)
 {
-    NOT_IMPLEMENTED;
+    VLOG(1) << "MKLDNNInnerProductLayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+    if (std::is_same<Dtype, double>::value) {
+        InnerProductLayer<Dtype>::Backward_cpu(top, propagate_down, bottom);
+        return;
+    }
+
+    if( ipBwdWeights_pd == NULL) {
+        InitInnerProductBwd(top, propagate_down, bottom);
+    } else {
+        bwd_top_diff->sync_blob_prv_data(top[0]);
+        if (propagate_down[0] && bwd_bottom_diff->conversion_needed())
+            bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+        if (Caffe::iter_size() == 1) {
+            if (bwd_weights_diff->conversion_needed())
+                this->blobs_[0]->set_prv_diff_descriptor(bwd_weights_diff);
+            if (bwd_bias_diff->conversion_needed())
+                this->blobs_[1]->set_prv_diff_descriptor(bwd_bias_diff);
+        }
+    }
+    if (propagate_down[0])
+        stream().submit({*ipBwdData}).wait();
+    if (this->param_propagate_down(0) || this->param_propagate_down(1)) {
+        stream().submit({*ipBwdWeights, *ipBwdBias}).wait();
+        if (Caffe::iter_size() > 1) {
+            accumulate_mkldnn_diff(this->blobs_[0].get(), bwd_weights_diff, bwd_weights_diff_iter);
+            accumulate_mkldnn_diff(this->blobs_[1].get(), bwd_bias_diff, bwd_bias_diff_iter);
+        }
+    }
 }
 
 #ifdef CPU_ONLY
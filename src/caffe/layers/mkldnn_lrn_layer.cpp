@@ -14,6 +14,14 @@ void MKLDNNLRNLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom
     VLOG(1) << "MKLDNNLRNLayer<Dtype>::LayerSetUp: " << this->layer_param_.name();
 
     Layer<Dtype>::LayerSetUp(bottom, top);
+    if (std::is_same<Dtype, double>::value) {
+        // MKLDNN primitives are single precision only.
+        LayerParameter caffe_param(this->layer_param_);
+        caffe_param.mutable_lrn_param()->set_engine(LRNParameter_Engine_CAFFE);
+        caffe_layer_.reset(new LRNLayer<Dtype>(caffe_param));
+        caffe_layer_->SetUp(bottom, top);
+        return;
+    }
 
     size_ = this->layer_param_.lrn_param().local_size();
     CHECK_EQ(size_ % 2, 1) << "LRN only supports odd values for local_size";
@@ -28,6 +36,10 @@ void MKLDNNLRNLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom
                                     ,const vector<Blob<Dtype>*>& top)
 {
     VLOG(1) << "MKLDNNLRNLayer<Dtype>::Reshape: " << this->layer_param_.name();
+    if (caffe_layer_) {
+        caffe_layer_->Reshape(bottom, top);
+        return;
+    }
     alpha_ = this->layer_param_.lrn_param().alpha();
     beta_ = this->layer_param_.lrn_param().beta();
 
@@ -123,6 +135,10 @@ void MKLDNNLRNLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
                                         ,const vector<Blob<Dtype>*>& top)
 {
     VLOG(1) << "MKLDNNLRNLayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+    if (caffe_layer_) {
+        caffe_layer_->Forward(bottom, top);
+        return;
+    }
     if( lrnFwd_pd == NULL) {
         InitLRN(bottom, top);
     } else {
@@ -134,11 +150,62 @@ void MKLDNNLRNLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
     stream().submit({*lrnFwd}).wait();
 }
 
+template <typename Dtype>
+void MKLDNNLRNLayer<Dtype>::InitLRNBwd(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{
+    // The backward primitive reuses the scratch filled by forward_training.
+    CHECK_EQ(this->phase_, TRAIN) << "MKLDNNLRNLayer backward requires TRAIN phase";
+    lrn::algorithm lrn_algorithm = (this->layer_param_.lrn_param().norm_region()
+                                    == LRNParameter_NormRegion_WITHIN_CHANNEL)
+                                    ? lrn::algorithm::within_channel : lrn::algorithm::across_channels;
+
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+    // ---- Diffs use the layout of the data -------------
+    shared_ptr<memory::primitive_desc> data_mpd = fwd_bottom_data->prv_memory_pd() ?
+            fwd_bottom_data->prv_memory_pd() : fwd_bottom_data->usr_memory_pd();
+    memory::desc data_md(data_mpd->desc());
+    bwd_top_diff.reset(new MKLDNNDiff<Dtype>(fwd_top_data->usr_memory_pd(), fwd_top_data->prv_memory_pd()));
+    bwd_bottom_diff.reset(new MKLDNNDiff<Dtype>(fwd_bottom_data->usr_memory_pd(), fwd_bottom_data->prv_memory_pd()));
+
+    // ---- Initialize LRN primitive descriptor -------------
+    lrn::desc lrnBwd_desc(prop_kind::backward_data, lrn_algorithm, data_md
+                            ,data_md, alpha_, beta_, size_);
+    lrnBwd_pd.reset(new lrn::primitive_desc(lrnBwd_desc, cpu_engine));
+
+    // ---- Create memory  ---------------------
+    top_diff_memory = bwd_top_diff->create_input_memory(top[0]);
+    if (bwd_bottom_diff->conversion_needed())
+        bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+    bottom_diff_memory = bwd_bottom_diff->create_output_memory(bottom[0]);
+
+    // ---- Create lrn --------------------
+    lrnBwd.reset(new lrn(*lrnBwd_pd, *input_memory, *top_diff_memory, *scratch_, *bottom_diff_memory));
+}
+
 template <typename Dtype>
 void MKLDNNLRNLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
                                         ,const vector<bool>& propagate_down
                                         ,const vector<Blob<Dtype>*>& bottom)
-{ NOT_IMPLEMENTED; }
+{
+    VLOG(1) << "MKLDNNLRNLayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+    if (caffe_layer_) {
+        caffe_layer_->Backward(top, propagate_down, bottom);
+        return;
+    }
+    if (!propagate_down[0])
+        return;
+    if( lrnBwd_pd == NULL) {
+        InitLRNBwd(top, propagate_down, bottom);
+    } else {
+        bwd_top_diff->sync_blob_prv_data(top[0]);
+        if (bwd_bottom_diff->conversion_needed())
+            bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+    }
+
+    stream().submit({*lrnBwd}).wait();
+}
 
 #ifdef CPU_ONLY
 STUB_GPU(MKLDNNLRNLayer);
@@ -19,6 +19,14 @@ void MKLDNNPoolingLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom
     VLOG(1) << "MKLDNNPoolingLayer<Dtype>::LayerSetUp: " << this->layer_param_.name();
 
     Layer<Dtype>::LayerSetUp(bottom, top);
+    if (std::is_same<Dtype, double>::value) {
+        // MKLDNN primitives are single precision only.
+        LayerParameter caffe_param(this->layer_param_);
+        caffe_param.mutable_pooling_param()->set_engine(PoolingParameter_Engine_CAFFE);
+        caffe_layer_.reset(new PoolingLayer<Dtype>(caffe_param));
+        caffe_layer_->SetUp(bottom, top);
+        return;
+    }
     PoolingParameter pool_param = this->layer_param_.pooling_param();
 
     if (pool_param.global_pooling()) {
@@ -98,6 +106,10 @@ void MKLDNNPoolingLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom
                                         ,const vector<Blob<Dtype>*>& top)
 {
     VLOG(1) << "MKLDNNPoolingLayer<Dtype>::Reshape: "  << this->layer_param_.name();
+    if (caffe_layer_) {
+        caffe_layer_->Reshape(bottom, top);
+        return;
+    }
 
     num_ = bottom[0]->num();
     channels_ = bottom[0]->channels();
@@ -125,10 +137,9 @@ void MKLDNNPoolingLayer<Dtype>::InitPooling(const vector<Blob<Dtype>*>& bottom,
 
     auto propagation = this->phase_ == TEST ? prop_kind::forward_scoring : prop_kind::forward_training;
 
-    pooling::algorithm pooling_algorithm;
     switch (this->layer_param_.pooling_param().pool()) {
     case PoolingParameter_PoolMethod_MAX:
-        pooling_algorithm = pooling::algorithm::max;
+        pooling_algorithm_ = pooling::algorithm::max;
         break;
     case PoolingParameter_PoolMethod_AVE:
         NOT_IMPLEMENTED;
@@ -191,7 +202,7 @@ void MKLDNNPoolingLayer<Dtype>::InitPooling(const vector<Blob<Dtype>*>& bottom,
     }
 
     // ---- Initialize pooling primitive descriptor -------------
-    pooling::desc poolingFwd_desc(propagation, pooling_algorithm, *input_md
+    pooling::desc poolingFwd_desc(propagation, pooling_algorithm_, *input_md
                                     ,*output_md, {sh, sw}, {kh, kw}, {ph, pw}, padding_kind::zero);
     poolingFwd_pd.reset(new pooling::primitive_desc(poolingFwd_desc, cpu_engine));
 
@@ -224,6 +235,10 @@ void MKLDNNPoolingLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
                                             ,const vector<Blob<Dtype>*>& top)
 {
     VLOG(1) << "MKLDNNPoolingLayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+    if (caffe_layer_) {
+        caffe_layer_->Forward(bottom, top);
+        return;
+    }
     if (NULL == poolingFwd_pd) {
         InitPooling(bottom, top);
     } else {
@@ -235,11 +250,68 @@ void MKLDNNPoolingLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
     stream().submit({*poolingFwd}).wait();
 }
 
+template <typename Dtype>
+void MKLDNNPoolingLayer<Dtype>::InitPoolingBwd(const vector<Blob<Dtype>*>& top
+                                            ,const vector<bool>& propagate_down
+                                            , const vector<Blob<Dtype>*>& bottom)
+{
+    // The backward primitive routes the diffs through the indices saved by forward_training.
+    CHECK_EQ(this->phase_, TRAIN) << "MKLDNNPoolingLayer backward requires TRAIN phase";
+
+    uint32_t kh = this->kernel_h_;
+    uint32_t kw = this->kernel_w_;
+    uint32_t sh = this->stride_h_;
+    uint32_t sw = this->stride_w_;
+    int32_t ph = this->pad_h_;
+    int32_t pw = this->pad_w_;
+
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+
+    // ---- Diffs use the layouts of the data -------------
+    memory::desc input_md(fwd_bottom_data->prv_memory_pd() ?
+            fwd_bottom_data->prv_memory_pd()->desc() : fwd_bottom_data->usr_memory_pd()->desc());
+    memory::desc output_md(fwd_top_data->prv_memory_pd() ?
+            fwd_top_data->prv_memory_pd()->desc() : fwd_top_data->usr_memory_pd()->desc());
+    bwd_top_diff.reset(new MKLDNNDiff<Dtype>(fwd_top_data->usr_memory_pd(), fwd_top_data->prv_memory_pd()));
+    bwd_bottom_diff.reset(new MKLDNNDiff<Dtype>(fwd_bottom_data->usr_memory_pd(), fwd_bottom_data->prv_memory_pd()));
+
+    // ---- Initialize pooling primitive descriptor -------------
+    pooling::desc poolingBwd_desc(prop_kind::backward_data, pooling_algorithm_, input_md
+                                    ,output_md, {sh, sw}, {kh, kw}, {ph, pw}, padding_kind::zero);
+    poolingBwd_pd.reset(new pooling::primitive_desc(poolingBwd_desc, cpu_engine));
+
+    // ---- Create memory  ---------------------
+    top_diff_memory = bwd_top_diff->create_input_memory(top[0]);
+    if (bwd_bottom_diff->conversion_needed())
+        bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+    bottom_diff_memory = bwd_bottom_diff->create_output_memory(bottom[0]);
+
+    // ---- Create pooling  --------------------
+    poolingBwd.reset(new pooling(*poolingBwd_pd, *top_diff_memory, *indices_memory, *bottom_diff_memory));
+}
+
 template <typename Dtype>
 void MKLDNNPoolingLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
                                             ,const vector<bool>& propagate_down
                                             , const vector<Blob<Dtype>*>& bottom)
-{ NOT_IMPLEMENTED; }
+{
+    VLOG(1) << "MKLDNNPoolingLayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+    if (caffe_layer_) {
+        caffe_layer_->Backward(top, propagate_down, bottom);
+        return;
+    }
+    if (!propagate_down[0])
+        return;
+    if (NULL == poolingBwd_pd) {
+        InitPoolingBwd(top, propagate_down, bottom);
+    } else {
+        bwd_top_diff->sync_blob_prv_data(top[0]);
+        if (bwd_bottom_diff->conversion_needed())
+            bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+    }
+
+    stream().submit({*poolingBwd}).wait();
+}
 
 #ifdef CPU_ONLY
 STUB_GPU(MKLDNNPoolingLayer);
@@ -13,6 +13,13 @@ void MKLDNNReLULayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom
     VLOG(1) << "MKLDNNReLULayer<Dtype>::LayerSetUp: " << this->layer_param_.name();
 
     NeuronLayer<Dtype>::LayerSetUp(bottom, top);
+    if (std::is_same<Dtype, double>::value) {
+        // MKLDNN primitives are single precision only.
+        LayerParameter caffe_param(this->layer_param_);
+        caffe_param.mutable_relu_param()->set_engine(ReLUParameter_Engine_CAFFE);
+        caffe_layer_.reset(new ReLULayer<Dtype>(caffe_param));
+        caffe_layer_->SetUp(bottom, top);
+    }
 }
 
 template <typename Dtype>
@@ -76,6 +83,17 @@ void MKLDNNReLULayer<Dtype>::InitReLU(const vector<Blob<Dtype>*>& bottom, const
 
     // ---- Create relu --------------------
     reluFwd.reset(new relu(*reluFwd_pd, *input_memory, *output_memory));
+
+    // In place, backward gets the output as src, which has the sign of the
+    // input only for negative_slope >= 0: otherwise keep a copy of the input.
+    bottom_copy.reset();
+    bottom_copy_memory.reset();
+    if (top[0] == bottom[0] && negative_slope < 0) {
+        shared_ptr<memory::primitive_desc> data_mpd = prv_mpd ? prv_mpd : usr_mpd;
+        bottom_copy_memory.reset(new memory(*data_mpd));
+        reorder::primitive_desc copy_pd(*data_mpd, *data_mpd);
+        bottom_copy.reset(new reorder(copy_pd, *input_memory, *bottom_copy_memory));
+    }
 }
 
 
@@ -84,6 +102,10 @@ void MKLDNNReLULayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
                                         ,const vector<Blob<Dtype>*>& top)
 {
     VLOG(1) << "MKLDNNReLULayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+    if (caffe_layer_) {
+        caffe_layer_->Forward(bottom, top);
+        return;
+    }
 
     if( reluFwd_pd == NULL) {
         InitReLU(bottom, top);
@@ -93,14 +115,65 @@ void MKLDNNReLULayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
             top[0]->set_prv_data_descriptor(fwd_top_data);
     }
 
-    stream().submit({*reluFwd}).wait();
+    if (bottom_copy)
+        stream().submit({*bottom_copy, *reluFwd}).wait();
+    else
+        stream().submit({*reluFwd}).wait();
+}
+
+template <typename Dtype>
+void MKLDNNReLULayer<Dtype>::InitReLUBwd(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{
+    Dtype negative_slope = this->layer_param_.relu_param().negative_slope();
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+
+    // ---- Diffs use the layout of the data -------------
+    memory::desc data_md(fwd_bottom_data->prv_memory_pd() ?
+            fwd_bottom_data->prv_memory_pd()->desc() : fwd_bottom_data->usr_memory_pd()->desc());
+    bwd_top_diff.reset(new MKLDNNDiff<Dtype>(fwd_top_data->usr_memory_pd(), fwd_top_data->prv_memory_pd()));
+    bwd_bottom_diff.reset(new MKLDNNDiff<Dtype>(fwd_bottom_data->usr_memory_pd(), fwd_bottom_data->prv_memory_pd()));
+
+    // ---- Initialize relu primitive descriptor -------------
+    relu::desc reluBwd_desc(prop_kind::backward_data, negative_slope, data_md, data_md);
+    reluBwd_pd.reset(new relu::primitive_desc(reluBwd_desc, cpu_engine));
+
+    // ---- Create memory  ---------------------
+    top_diff_memory = bwd_top_diff->create_input_memory(top[0]);
+    if (bwd_bottom_diff->conversion_needed())
+        bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+    bottom_diff_memory = bwd_bottom_diff->create_output_memory(bottom[0]);
+
+    // ---- Create relu --------------------
+    // In place, src is the output, or the copy of the input Forward keeps
+    // for a negative slope.
+    shared_ptr<memory> src_memory = bottom_copy_memory ? bottom_copy_memory : input_memory;
+    reluBwd.reset(new relu(*reluBwd_pd, *src_memory, *top_diff_memory, *bottom_diff_memory));
 }
 
 template <typename Dtype>
 void MKLDNNReLULayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
                                             ,const vector<bool>& propagate_down
                                             ,const vector<Blob<Dtype>*>& bottom)
-{ NOT_IMPLEMENTED; }
+{
+    VLOG(1) << "MKLDNNReLULayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+    if (caffe_layer_) {
+        caffe_layer_->Backward(top, propagate_down, bottom);
+        return;
+    }
+    if (!propagate_down[0])
+        return;
+    if( reluBwd_pd == NULL) {
+        InitReLUBwd(top, propagate_down, bottom);
+    } else {
+        bwd_top_diff->sync_blob_prv_data(top[0]);
+        if (bwd_bottom_diff->conversion_needed())
+            bottom[0]->set_prv_diff_descriptor(bwd_bottom_diff);
+    }
+
+    stream().submit({*reluBwd}).wait();
+}
 
 #ifdef CPU_ONLY
 STUB_GPU(MKLDNNReLULayer);
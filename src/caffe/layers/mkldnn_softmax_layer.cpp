@@ -0,0 +1,156 @@
+#ifdef MKLDNN_SUPPORTED
+#include <vector>
+
+#include "caffe/layer.hpp"
+#include "caffe/layers/mkldnn_layers.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+void MKLDNNSoftmaxLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNSoftmaxLayer<Dtype>::LayerSetUp: " << this->layer_param_.name();
+
+    Layer<Dtype>::LayerSetUp(bottom, top);
+}
+
+template <typename Dtype>
+void MKLDNNSoftmaxLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom
+                                    ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNSoftmaxLayer<Dtype>::Reshape: " << this->layer_param_.name();
+
+    CHECK(bottom[0]->num_axes() == 2 || bottom[0]->num_axes() == 4)
+        << "Input must have 2 axes (num, channels) or 4 axes (num, channels, height, width)";
+    softmax_axis_ = bottom[0]->CanonicalAxisIndex(this->layer_param_.softmax_param().axis());
+    // The primitive is built for one input shape: have Forward recreate it
+    // when the shape changes.
+    if (softmaxFwd_pd != NULL && bottom[0]->shape() != bottom_shape_)
+        softmaxFwd_pd.reset();
+    bottom_shape_ = bottom[0]->shape();
+    top[0]->ReshapeLike(*bottom[0]);
+}
+
+template <typename Dtype>
+void MKLDNNSoftmaxLayer<Dtype>::InitSoftmax(const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top)
+{
+    if (std::is_same<Dtype, double>::value) NOT_IMPLEMENTED;
+
+    auto propagation = this->phase_ == TEST ? prop_kind::forward_scoring : prop_kind::forward_training;
+
+    uint32_t n = bottom[0]->shape(0);
+    uint32_t c = bottom[0]->shape(1);
+    bool has_spatial = bottom[0]->num_axes() == 4;
+    tensor::dims input_tz = has_spatial ?
+        tensor::dims{n, c, static_cast<uint32_t>(bottom[0]->height())
+                    , static_cast<uint32_t>(bottom[0]->width())}
+        : tensor::dims{n, c};
+
+    engine cpu_engine = CpuEngine::Instance().get_engine();
+    memory::precision mpcsn = memory::precision::f32;
+    // ---- Initialize memory descriptors -------------
+    shared_ptr<memory::desc> input_md, output_md;
+    shared_ptr<memory::primitive_desc> usr_mpd(NULL), prv_mpd(NULL);
+    shared_ptr<MKLDNNMemoryDescriptor<Dtype, false> > mem_descr
+        = get_mkldnn_prv_descriptor<Dtype, false>(bottom[0]);
+    if (mem_descr != NULL) {
+        input_md.reset(new memory::desc(mem_descr->prv_memory_pd()->desc()));
+        usr_mpd = mem_descr->usr_memory_pd();
+        prv_mpd = mem_descr->prv_memory_pd();
+    } else {
+        memory::format mfmt = has_spatial ? memory::format::nchw : memory::format::nc;
+        input_md.reset(new memory::desc({input_tz}, mpcsn, mfmt));
+        usr_mpd.reset(new memory::primitive_desc(*input_md, cpu_engine));
+    }
+    output_md = input_md;
+    fwd_bottom_data.reset(new MKLDNNData<Dtype>(usr_mpd, prv_mpd));
+    fwd_top_data.reset(new MKLDNNData<Dtype>(usr_mpd, prv_mpd));
+
+    fwd_bottom_data->name = "fwd_bottom_data   @ " + this->layer_param_.name();
+    fwd_top_data->name =    "fwd_top_data      @ " + this->layer_param_.name();
+
+    // ---- Initialize softmax primitive descriptor -------------
+    softmax::desc softmaxFwd_desc(propagation, *input_md, softmax_axis_);
+    softmaxFwd_pd.reset(new softmax::primitive_desc(softmaxFwd_desc, cpu_engine));
+
+    // ---- Create memory  ---------------------
+    input_memory = fwd_bottom_data->create_input_memory(bottom[0]);
+    if (fwd_top_data->conversion_needed())
+        top[0]->set_prv_data_descriptor(fwd_top_data);
+    output_memory = fwd_top_data->create_output_memory(top[0]);
+
+    // ---- Create softmax --------------------
+    softmaxFwd.reset(new softmax(*softmaxFwd_pd, *input_memory, *output_memory));
+}
+
+template <typename Dtype>
+void MKLDNNSoftmaxLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNSoftmaxLayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+
+    if (softmaxFwd_pd == NULL) {
+        InitSoftmax(bottom, top);
+    } else {
+        fwd_bottom_data->sync_blob_prv_data(bottom[0]);
+        if (fwd_top_data->conversion_needed())
+            top[0]->set_prv_data_descriptor(fwd_top_data);
+    }
+
+    stream().submit({*softmaxFwd}).wait();
+}
+
+template <typename Dtype>
+void MKLDNNSoftmaxLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{
+    VLOG(1) << "MKLDNNSoftmaxLayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+    if (!propagate_down[0])
+        return;
+
+    // bottom_diff = (top_diff - dot(top_diff, top_data)) * top_data,
+    // with the dot product taken over the softmax axis.
+    const Dtype* top_diff = top[0]->cpu_diff();
+    const Dtype* top_data = top[0]->cpu_data();
+    Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
+    const int outer_num = bottom[0]->count(0, softmax_axis_);
+    const int channels = bottom[0]->shape(softmax_axis_);
+    const int inner_num = bottom[0]->count(softmax_axis_ + 1);
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int i = 0; i < outer_num; ++i) {
+        const int offset = i * channels * inner_num;
+        for (int k = 0; k < inner_num; ++k) {
+            Dtype dot = 0;
+            for (int j = 0; j < channels; ++j) {
+                dot += top_diff[offset + j * inner_num + k] * top_data[offset + j * inner_num + k];
+            }
+            for (int j = 0; j < channels; ++j) {
+                const int index = offset + j * inner_num + k;
+                bottom_diff[index] = (top_diff[index] - dot) * top_data[index];
+            }
+        }
+    }
+}
+
+#ifdef CPU_ONLY
+STUB_GPU(MKLDNNSoftmaxLayer);
+#else
+template <typename Dtype>
+void MKLDNNSoftmaxLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{ NOT_IMPLEMENTED; }
+
+template <typename Dtype>
+void MKLDNNSoftmaxLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{ NOT_IMPLEMENTED; }
+#endif
+
+INSTANTIATE_CLASS(MKLDNNSoftmaxLayer);
+}  // namespace caffe
+#endif  // #ifdef MKLDNN_SUPPORTED
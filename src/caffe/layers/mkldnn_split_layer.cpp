@@ -0,0 +1,80 @@
+#ifdef MKLDNN_SUPPORTED
+#include <vector>
+
+#include "caffe/layer.hpp"
+#include "caffe/layers/mkldnn_layers.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+void MKLDNNSplitLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom
+                                    ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNSplitLayer<Dtype>::Reshape: " << this->layer_param_.name();
+
+    for (int i = 0; i < top.size(); ++i) {
+        // Do not allow in-place computation in the SplitLayer.  Instead, share data
+        // by reference in the forward pass, and keep separate diff allocations in
+        // the backward pass.  (Technically, it should be possible to share the diff
+        // blob of the first split output with the input, but this seems to cause
+        // some strange effects in practice...)
+        CHECK_NE(top[i], bottom[0]) << this->type() << " Layer does not "
+            "allow in-place computation.";
+        top[i]->ReshapeLike(*bottom[0]);
+        CHECK_EQ(bottom[0]->count(), top[i]->count());
+    }
+}
+
+template <typename Dtype>
+void MKLDNNSplitLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{
+    VLOG(1) << "MKLDNNSplitLayer<Dtype>::Forward_cpu: " << this->layer_param_.name();
+
+    // Sharing the memory also shares the private descriptor, so the outputs
+    // keep the MKLDNN layout of the input without any reorder.
+    for (int i = 0; i < top.size(); ++i) {
+        top[i]->ShareData(*bottom[0]);
+    }
+}
+
+template <typename Dtype>
+void MKLDNNSplitLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{
+    VLOG(1) << "MKLDNNSplitLayer<Dtype>::Backward_cpu: " << this->layer_param_.name();
+    if (!propagate_down[0])
+        return;
+
+    // The top diffs may come in different layouts: sum them in the user one.
+    const int count = bottom[0]->count();
+    if (top.size() == 1) {
+        caffe_copy(count, top[0]->cpu_diff(), bottom[0]->mutable_cpu_diff());
+        return;
+    }
+    caffe_add(count, top[0]->cpu_diff(), top[1]->cpu_diff(), bottom[0]->mutable_cpu_diff());
+    for (int i = 2; i < top.size(); ++i) {
+        caffe_axpy(count, Dtype(1.), top[i]->cpu_diff(), bottom[0]->mutable_cpu_diff());
+    }
+}
+
+#ifdef CPU_ONLY
+STUB_GPU(MKLDNNSplitLayer);
+#else
+template <typename Dtype>
+void MKLDNNSplitLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom
+                                        ,const vector<Blob<Dtype>*>& top)
+{ NOT_IMPLEMENTED; }
+
+template <typename Dtype>
+void MKLDNNSplitLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top
+                                        ,const vector<bool>& propagate_down
+                                        ,const vector<Blob<Dtype>*>& bottom)
+{ NOT_IMPLEMENTED; }
+#endif
+
+INSTANTIATE_CLASS(MKLDNNSplitLayer);
+}  // namespace caffe
+#endif  // #ifdef MKLDNN_SUPPORTED
@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <vector>
 
 #include "caffe/layers/softmax_layer.hpp"
@@ -23,96 +25,143 @@ void SoftmaxLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
   scale_.Reshape(scale_dims);
 }
 
-template <typename Dtype>
-void SoftmaxLayer<Dtype>::Forward_cpu_fast_case(
-    const vector<Blob<Dtype>*>& bottom,
-    const vector<Blob<Dtype>*>& top) {
-  const Dtype* mult = sum_multiplier_.cpu_data();
-  int channels = bottom[0]->shape(softmax_axis_);
-  int dim = bottom[0]->count() / outer_num_;
-  // assert(dim == channels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-  for (int i = 0; i < outer_num_; ++i) {
-    const Dtype* bottom_data = bottom[0]->cpu_data() + i*dim;
-    Dtype *top_data = top[0]->mutable_cpu_data() + channels*i;
+// Inner positions normalized together when the softmax axis is not the
+// innermost one: the channels of a block stay in cache between the max, exp
+// and normalization steps, so the input is read from memory only once.
+const int kSoftmaxMaxBlock = 256;
+const int kSoftmaxBlockBytes = 256 * 1024;
 
-    caffe_copy(dim, bottom_data, top_data);
+// Softmax of one contiguous row of channels; returns the row max and the sum
+// of exp(x - max).
+template <typename Dtype>
+static void softmax_row(const int channels, const Dtype* x, Dtype* y,
+    Dtype* max_val, Dtype* sum) {
+  Dtype row_max = x[0];
+  for (int j = 1; j < channels; ++j) {
+    row_max = std::max(row_max, x[j]);
+  }
+  for (int j = 0; j < channels; ++j) {
+    y[j] = x[j] - row_max;
+  }
+  caffe_exp<Dtype>(channels, y, y);
+  Dtype row_sum = 0;
+  for (int j = 0; j < channels; ++j) {
+    row_sum += y[j];
+  }
+  const Dtype scale = Dtype(1) / row_sum;
+  for (int j = 0; j < channels; ++j) {
+    y[j] *= scale;
+  }
+  *max_val = row_max;
+  *sum = row_sum;
+}
 
-    Dtype scale_data = bottom_data[0];
-    for (int j = 1; j < channels; j++) {
-        scale_data = std::max(scale_data, bottom_data[j]);
+// Softmax over channels of n consecutive inner positions, the channels being
+// stride elements apart; vectorized over the inner positions.
+template <typename Dtype>
+static void softmax_block(const int channels, const int stride, const int n,
+    const Dtype* x, Dtype* y, Dtype* max_val, Dtype* sum) {
+  for (int k = 0; k < n; ++k) {
+    max_val[k] = x[k];
+  }
+  for (int j = 1; j < channels; ++j) {
+    const Dtype* x_j = x + j * stride;
+    for (int k = 0; k < n; ++k) {
+      max_val[k] = std::max(max_val[k], x_j[k]);
     }
-
-    // subtraction
-    for (int j = 0; j < channels; ++j)
-        top_data[j] -= scale_data*mult[j];
-
-    // exponentiation
-    caffe_exp<Dtype>(dim, top_data, top_data);
-
-    // sum after exp
-    scale_data = 0;
-    for (int j = 0; j < channels; ++j)
-        scale_data += top_data[j]*mult[j];
-
-    // division
-    for (int j = 0; j < channels; j++) {
-      caffe_div(inner_num_, top_data + j, &scale_data, top_data + j);
+  }
+  for (int k = 0; k < n; ++k) {
+    sum[k] = 0;
+  }
+  for (int j = 0; j < channels; ++j) {
+    const Dtype* x_j = x + j * stride;
+    Dtype* y_j = y + j * stride;
+    for (int k = 0; k < n; ++k) {
+      y_j[k] = x_j[k] - max_val[k];
+    }
+    caffe_exp<Dtype>(n, y_j, y_j);
+    for (int k = 0; k < n; ++k) {
+      sum[k] += y_j[k];
+    }
+  }
+  Dtype scale[kSoftmaxMaxBlock];
+  for (int k = 0; k < n; ++k) {
+    scale[k] = Dtype(1) / sum[k];
+  }
+  for (int j = 0; j < channels; ++j) {
+    Dtype* y_j = y + j * stride;
+    for (int k = 0; k < n; ++k) {
+      y_j[k] *= scale[k];
     }
   }
 }
 
 template <typename Dtype>
-void SoftmaxLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
-    const vector<Blob<Dtype>*>& top) {
+void SoftmaxLayer<Dtype>::ForwardWithLoss_cpu(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top,
+    const Dtype* label, bool has_ignore_label, int ignore_label, Dtype* loss,
+    int* count) {
+  CHECK(label == NULL || bottom[0] != top[0])
+      << "The loss needs the softmax input, which in-place computation "
+      << "overwrites.";
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
-  Dtype* scale_data = scale_.mutable_cpu_data();
-  int channels = bottom[0]->shape(softmax_axis_);
-  int dim = bottom[0]->count() / outer_num_;
-
-  if (inner_num_ == 1 && channels == dim) {
-      Forward_cpu_fast_case(bottom, top);
-      return;
-  }
+  const int channels = bottom[0]->shape(softmax_axis_);
+  const int dim = channels * inner_num_;
+  int block = kSoftmaxBlockBytes / (channels * sizeof(Dtype));
+  block = std::min(std::max(block, 16), kSoftmaxMaxBlock);
+  block = std::min(block, inner_num_);
+  const int num_blocks = (inner_num_ + block - 1) / block;
+  const int num_tasks = outer_num_ * num_blocks;
+  Dtype total_loss = 0;
+  int total_count = 0;
 
-  caffe_copy(bottom[0]->count(), bottom_data, top_data);
-  // We need to subtract the max to avoid numerical issues, compute the exp,
-  // and then normalize.
-  for (int i = 0; i < outer_num_; ++i) {
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel for reduction(+: total_loss, total_count)
 #endif
-    for (int k = 0; k < inner_num_; k++) {
-      Dtype max_val = bottom_data[i * dim + k];
-      for (int j = 1; j < channels; j++) {
-        Dtype value = bottom_data[i * dim + k + j * inner_num_];
-        if (max_val < value) max_val = value;
-      }
-      scale_data[k] = max_val;
+  for (int task = 0; task < num_tasks; ++task) {
+    const int i = task / num_blocks;
+    const int k0 = (task % num_blocks) * block;
+    const int n = std::min(block, inner_num_ - k0);
+    const Dtype* x = bottom_data + i * dim + k0;
+    Dtype* y = top_data + i * dim + k0;
+    Dtype max_val[kSoftmaxMaxBlock];
+    Dtype sum[kSoftmaxMaxBlock];
+    if (inner_num_ == 1) {
+      softmax_row(channels, x, y, max_val, sum);
+    } else {
+      softmax_block(channels, inner_num_, n, x, y, max_val, sum);
     }
-
-    // subtraction
-    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, channels, inner_num_,
-        1, -1., sum_multiplier_.cpu_data(), scale_data, 1., top_data);
-    // exponentiation
-    caffe_exp<Dtype>(dim, top_data, top_data);
-    // sum after exp
-    caffe_cpu_gemv<Dtype>(CblasTrans, channels, inner_num_, 1.,
-        top_data, sum_multiplier_.cpu_data(), 0., scale_data);
-    // division
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (int j = 0; j < channels; j++) {
-      caffe_div(inner_num_, top_data + j*inner_num_, scale_data,
-              top_data + j*inner_num_);
+    if (label == NULL) {
+      continue;
     }
-    top_data += channels*inner_num_;
+    // -log(prob) = log(sum) - (x - max), bounded like -log(FLT_MIN).
+    const Dtype* block_label = label + i * inner_num_ + k0;
+    for (int k = 0; k < n; ++k) {
+      const int label_value = static_cast<int>(block_label[k]);
+      if (has_ignore_label && label_value == ignore_label) {
+        continue;
+      }
+      DCHECK_GE(label_value, 0);
+      DCHECK_LT(label_value, channels);
+      const Dtype log_prob =
+          x[label_value * inner_num_ + k] - max_val[k] - log(sum[k]);
+      total_loss -= std::max(log_prob, Dtype(log(FLT_MIN)));
+      ++total_count;
+    }
+  }
+  if (loss) {
+    *loss = total_loss;
   }
+  if (count) {
+    *count = total_count;
+  }
+}
+
+template <typename Dtype>
+void SoftmaxLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+    const vector<Blob<Dtype>*>& top) {
+  ForwardWithLoss_cpu(bottom, top, NULL, false, 0, NULL, NULL);
 }
 
 template <typename Dtype>
@@ -88,13 +88,26 @@ Dtype SoftmaxWithLossLayer<Dtype>::get_normalizer(
 template <typename Dtype>
 void SoftmaxWithLossLayer<Dtype>::Forward_cpu(
     const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  const Dtype* label = bottom[1]->cpu_data();
+  int count = 0;
+  Dtype loss = 0;
+  // The reference softmax computes the loss along with the prob values.
+  SoftmaxLayer<Dtype>* softmax =
+      dynamic_cast<SoftmaxLayer<Dtype>*>(softmax_layer_.get());
+  if (softmax) {
+    softmax->ForwardWithLoss_cpu(softmax_bottom_vec_, softmax_top_vec_, label,
+        has_ignore_label_, ignore_label_, &loss, &count);
+    top[0]->mutable_cpu_data()[0] =
+        loss / get_normalizer(normalization_, count);
+    if (top.size() == 2) {
+      top[1]->ShareData(prob_);
+    }
+    return;
+  }
   // The forward pass computes the softmax prob values.
   softmax_layer_->Forward(softmax_bottom_vec_, softmax_top_vec_);
   const Dtype* prob_data = prob_.cpu_data();
-  const Dtype* label = bottom[1]->cpu_data();
   int dim = prob_.count() / outer_num_;
-  int count = 0;
-  Dtype loss = 0;
   for (int i = 0; i < outer_num_; ++i) {
     for (int j = 0; j < inner_num_; j++) {
       const int label_value = static_cast<int>(label[i * inner_num_ + j]);
@@ -0,0 +1,94 @@
+#include <boost/thread.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <algorithm>
+#include <vector>
+
+#include "caffe/layerwise_updater.hpp"
+#include "caffe/util/cpu_info.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+LayerwiseUpdater<Dtype>::LayerwiseUpdater(
+    shared_ptr<MultiSolver<Dtype> > solver)
+  : solver_(solver), in_flight_(0) {
+  Solver<Dtype>& root_solver = *solver_->root_solver();
+  CHECK_LT(root_solver.param().clip_gradients(), 0)
+      << "Gradient clipping needs all gradients before any update and "
+      << "cannot be used with layer_wise_update.";
+  root_solver.param().set_disabled_update(true);
+
+  Net<Dtype>& net = solver_->net();
+  const int num_layers = net.layers().size();
+  vector<int> last_layer(net.learnable_params().size(), num_layers);
+  for (int i = 0; i < num_layers; ++i) {
+    vector<int> param_ids = net.get_layer_learnable_param_ids(i);
+    for (int j = 0; j < param_ids.size(); ++j) {
+      last_layer[param_ids[j]] = std::min(last_layer[param_ids[j]], i);
+    }
+  }
+  ready_params_.resize(num_layers);
+  for (int param_id = 0; param_id < last_layer.size(); ++param_id) {
+    CHECK_LT(last_layer[param_id], num_layers);
+    ready_params_[last_layer[param_id]].push_back(param_id);
+  }
+  solver_->add_callback(this);
+  const int num_threads = root_solver.param().layer_wise_update_threads();
+  CHECK_GT(num_threads, 0) << "layer_wise_update_threads must be positive.";
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.push_back(shared_ptr<UpdateThread>(new UpdateThread(this)));
+    threads_.back()->StartInternalThread();
+  }
+}
+
+template <typename Dtype>
+LayerwiseUpdater<Dtype>::~LayerwiseUpdater() {
+  for (int i = 0; i < threads_.size(); ++i) {
+    threads_[i]->StopInternalThread();
+  }
+}
+
+template <typename Dtype>
+void LayerwiseUpdater<Dtype>::on_gradients_ready(int layer_id) {
+  const vector<int>& param_ids = ready_params_[layer_id];
+  for (int i = 0; i < param_ids.size(); ++i) {
+    pending_.push(param_ids[i]);
+    ++in_flight_;
+  }
+}
+
+template <typename Dtype>
+void LayerwiseUpdater<Dtype>::on_gradients_ready() {
+  // Wait for the updates of this iteration before the solver moves on.
+  for (; in_flight_ > 0; --in_flight_) {
+    done_.pop();
+  }
+}
+
+template <typename Dtype>
+void LayerwiseUpdater<Dtype>::UpdateThread::InternalThreadEntry() {
+#ifdef _OPENMP
+  // The threads share the compute cores with the backward pass running
+  // concurrently, each of them updating a single parameter serially.
+  caffe::cpu::OpenMpManager::bindCurrentThreadToComputeCores(false);
+  omp_set_num_threads(1);
+#endif
+  Solver<Dtype>& solver = *updater_->solver_->root_solver();
+  try {
+    while (!must_stop()) {
+      const int param_id = updater_->pending_.pop();
+      solver.ApplyUpdate(param_id);
+      // The solver only clears the diffs in its own ForwardBackward.
+      solver.net()->ClearParamDiffs(param_id);
+      updater_->done_.push(param_id);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+INSTANTIATE_CLASS(LayerwiseUpdater);
+
+}  // namespace caffe
@@ -135,8 +135,10 @@ Dtype* MKLDNNMemoryDescriptor<Dtype, is_diff>::get_blob_data_ptr(Blob<Dtype>* bl
                 boost::static_pointer_cast<MKLDNNMemoryDescriptor<Dtype, is_diff> >(prv_mem_descriptor);
 
         if (*current_descr->prv_memory_pd() !=  *this->prv_memory_pd()) {
-            // TODO: prv in blob and in this descrptor may have different layouts
-            NOT_IMPLEMENTED;
+            // The blob holds another private layout: convert through the user one.
+            VLOG(1) << "layout mismatch " << current_descr->name << " != " << this->name;
+            this->convert_to_prv(const_cast<Dtype*>(is_diff ? blob->cpu_diff() : blob->cpu_data()));
+            return static_cast<Dtype *>(this->prv_ptr());
         } else if (current_descr.get() != this) {
             VLOG(1) << "layout OK " << current_descr->name << " == " << this->name;
         }
@@ -168,9 +170,9 @@ shared_ptr<memory> MKLDNNMemoryDescriptor<Dtype, is_diff>::create_output_memory(
 {
     shared_ptr<memory> omem;
     if (this->conversion_needed()) {
-        if(blob->get_prv_data_descriptor() != NULL) {
-            shared_ptr<PrvMemDescr> prv_mem_descriptor = is_diff ?
-                (blob->get_prv_diff_descriptor()) : (blob->get_prv_data_descriptor());
+        shared_ptr<PrvMemDescr> prv_mem_descriptor = is_diff ?
+            (blob->get_prv_diff_descriptor()) : (blob->get_prv_data_descriptor());
+        if(prv_mem_descriptor != NULL) {
             CHECK_EQ(prv_mem_descriptor->get_descr_type(), PrvMemDescr::PRV_DESCR_MKLDNN);
             shared_ptr<MKLDNNMemoryDescriptor<Dtype, is_diff> > current_descr =
                 boost::static_pointer_cast<MKLDNNMemoryDescriptor<Dtype, is_diff> >(prv_mem_descriptor);
@@ -184,6 +186,44 @@ shared_ptr<memory> MKLDNNMemoryDescriptor<Dtype, is_diff>::create_output_memory(
     return omem;
 }
 
+template <typename Dtype, bool is_diff>
+shared_ptr<MKLDNNMemoryDescriptor<Dtype, is_diff> > get_mkldnn_prv_descriptor(Blob<Dtype>* blob)
+{
+    shared_ptr<MKLDNNMemoryDescriptor<Dtype, is_diff> > descr;
+    const Dtype* prv_ptr = is_diff ? blob->prv_diff() : blob->prv_data();
+    if (prv_ptr == NULL)
+        return descr;
+    shared_ptr<PrvMemDescr> prv_mem_descriptor = is_diff ?
+            (blob->get_prv_diff_descriptor()) : (blob->get_prv_data_descriptor());
+    if (prv_mem_descriptor->get_descr_type() == PrvMemDescr::PRV_DESCR_MKLDNN)
+        descr = boost::static_pointer_cast<MKLDNNMemoryDescriptor<Dtype, is_diff> >(prv_mem_descriptor);
+    return descr;
+}
+
+template <typename Dtype>
+void accumulate_mkldnn_diff(Blob<Dtype>* blob, shared_ptr<MKLDNNDiff<Dtype> > diff_descr
+                            , shared_ptr<MKLDNNDiff<Dtype> > diff_iter)
+{
+    if (diff_descr->conversion_needed()) {
+        // Brings the diff accumulated so far to the private layout.
+        diff_descr->get_blob_data_ptr(blob, true);
+        caffe_axpy<Dtype>((const int)blob->prv_diff_count(), 1, diff_iter->get_prv_ptr()
+                            , blob->mutable_prv_diff());
+    } else {
+        caffe_axpy<Dtype>((const int)blob->count(), 1, diff_iter->get_prv_ptr()
+                            , blob->mutable_cpu_diff());
+    }
+}
+
+template void accumulate_mkldnn_diff<float>(Blob<float>* blob, shared_ptr<MKLDNNDiff<float> > diff_descr
+                                            , shared_ptr<MKLDNNDiff<float> > diff_iter);
+template void accumulate_mkldnn_diff<double>(Blob<double>* blob, shared_ptr<MKLDNNDiff<double> > diff_descr
+                                            , shared_ptr<MKLDNNDiff<double> > diff_iter);
+template shared_ptr<MKLDNNMemoryDescriptor<float, false> > get_mkldnn_prv_descriptor<float, false>(Blob<float>* blob);
+template shared_ptr<MKLDNNMemoryDescriptor<float, true> > get_mkldnn_prv_descriptor<float, true>(Blob<float>* blob);
+template shared_ptr<MKLDNNMemoryDescriptor<double, false> > get_mkldnn_prv_descriptor<double, false>(Blob<double>* blob);
+template shared_ptr<MKLDNNMemoryDescriptor<double, true> > get_mkldnn_prv_descriptor<double, true>(Blob<double>* blob);
+
 template class MKLDNNMemoryDescriptor<double, true>;
 template class MKLDNNMemoryDescriptor<float, true>;
 template class MKLDNNMemoryDescriptor<float, false>;
@@ -15,6 +15,7 @@
 #include "caffe/util/cpu_info.hpp"
 #include "caffe/util/hdf5.hpp"
 #include "caffe/util/insert_splits.hpp"
+#include "caffe/util/mapped_weights.hpp"
 #include "caffe/util/math_functions.hpp"
 #include "caffe/util/upgrade_proto.hpp"
 
@@ -52,8 +53,10 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
       << "root_net_ needs to be set for all non-root solvers";
 
   #ifdef _OPENMP
-  static bool executed = false;
-  if (!executed) {
+  // Threads building nets of their own, such as inference replicas, bind
+  // themselves; rebinding them here would move them to the main team cores.
+  if (caffe::cpu::OpenMpManager::isMajorThread(
+      boost::this_thread::get_id())) {
     if (Caffe::mode() == Caffe::GPU) {
       caffe::cpu::OpenMpManager::setGpuEnabled();
     } else {
@@ -297,10 +300,58 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
   }
   ShareWeights();
   debug_info_ = param.debug_info();
+  fused_layer_ids_.assign(layers_.size(), -1);
+  if (param.fuse_elementwise()) {
+    FuseElementwiseLayers();
+  }
 
   LOG_IF(INFO, Caffe::root_solver()) << "Network initialization done.";
 }
 
+template <typename Dtype>
+void Net<Dtype>::FuseElementwiseLayers() {
+  for (int first = 0; first < layers_.size(); ) {
+    int last = first;
+    while (last < layers_.size() &&
+        FusedElementwiseLayer<Dtype>::CanFuse(layers_[last].get(),
+            bottom_vecs_[last], last == first) &&
+        top_vecs_[last].size() == 1 &&
+        blob_loss_weights_[top_id_vecs_[last][0]] == Dtype(0) &&
+        (last == first || bottom_vecs_[last][0] == top_vecs_[last - 1][0])) {
+      ++last;
+    }
+    --last;
+    if (last <= first) {
+      ++first;
+      continue;
+    }
+    LayerParameter fused_param;
+    fused_param.set_name(layer_names_[first] + "_to_" + layer_names_[last]);
+    fused_param.set_type("FusedElementwise");
+    fused_param.set_phase(phase_);
+    shared_ptr<FusedElementwiseLayer<Dtype> > fused_layer(
+        new FusedElementwiseLayer<Dtype>(fused_param,
+            vector<shared_ptr<Layer<Dtype> > >(
+                layers_.begin() + first, layers_.begin() + last + 1),
+            vector<vector<Blob<Dtype>*> >(
+                bottom_vecs_.begin() + first, bottom_vecs_.begin() + last + 1),
+            vector<vector<Blob<Dtype>*> >(
+                top_vecs_.begin() + first, top_vecs_.begin() + last + 1),
+            vector<bool>(layer_need_backward_.begin() + first,
+                layer_need_backward_.begin() + last + 1)));
+    fused_layer->SetUp(bottom_vecs_[first], top_vecs_[last]);
+    for (int layer_id = first; layer_id <= last; ++layer_id) {
+      fused_layer_ids_[layer_id] = fused_layers_.size();
+    }
+    fused_layers_.push_back(fused_layer);
+    fused_layer_ranges_.push_back(make_pair(first, last));
+    LOG_IF(INFO, Caffe::root_solver())
+        << "Fusing layers " << layer_names_[first] << " to "
+        << layer_names_[last];
+    first = last + 1;
+  }
+}
+
 template <typename Dtype>
 void Net<Dtype>::FilterNet(const NetParameter& param,
     NetParameter* param_filtered) {
@@ -564,6 +615,20 @@ Dtype Net<Dtype>::ForwardFromTo(int start, int end) {
   CHECK_LT(end, layers_.size());
   Dtype loss = 0;
   for (int i = start; i <= end; ++i) {
+    // A fused chain runs as a whole when the range covers all of it; a range
+    // splitting the chain, such as the per-layer ForwardFromTo(i, i) of
+    // MultiSolver, runs its layers one by one, and so does debug_info, which
+    // reports every layer.
+    const int fused_id = fused_layer_ids_[i];
+    if (fused_id >= 0 && !debug_info_ &&
+        fused_layer_ranges_[fused_id].first == i &&
+        fused_layer_ranges_[fused_id].second <= end) {
+      const int last = fused_layer_ranges_[fused_id].second;
+      loss += fused_layers_[fused_id]->Forward(bottom_vecs_[i],
+          top_vecs_[last]);
+      i = last;
+      continue;
+    }
     // LOG(ERROR) << "Forwarding " << layer_names_[i];
     Dtype layer_loss = layers_[i]->Forward(bottom_vecs_[i], top_vecs_[i]);
     loss += layer_loss;
@@ -609,6 +674,18 @@ void Net<Dtype>::BackwardFromTo(int start, int end) {
   CHECK_GE(end, 0);
   CHECK_LT(start, layers_.size());
   for (int i = start; i >= end; --i) {
+    const int fused_id = fused_layer_ids_[i];
+    if (fused_id >= 0 && !debug_info_ &&
+        fused_layer_ranges_[fused_id].second == i &&
+        fused_layer_ranges_[fused_id].first >= end) {
+      const int first = fused_layer_ranges_[fused_id].first;
+      if (layer_need_backward_[i]) {
+        fused_layers_[fused_id]->Backward(
+            top_vecs_[i], bottom_need_backward_[first], bottom_vecs_[first]);
+      }
+      i = first;
+      continue;
+    }
     if (layer_need_backward_[i]) {
       layers_[i]->Backward(
           top_vecs_[i], bottom_need_backward_[i], bottom_vecs_[i]);
@@ -698,6 +775,16 @@ void Net<Dtype>::UpdateDebugInfo(const int param_id) {
 
 template <typename Dtype>
 void Net<Dtype>::ShareTrainedLayersWith(const Net* other) {
+  ShareOrCopyTrainedLayers(other, false);
+}
+
+template <typename Dtype>
+void Net<Dtype>::CopyTrainedLayersFrom(const Net* other) {
+  ShareOrCopyTrainedLayers(other, true);
+}
+
+template <typename Dtype>
+void Net<Dtype>::ShareOrCopyTrainedLayers(const Net* other, bool copy) {
   int num_source_layers = other->layers().size();
   for (int i = 0; i < num_source_layers; ++i) {
     Layer<Dtype>* source_layer = other->layers()[i].get();
@@ -723,7 +810,11 @@ void Net<Dtype>::ShareTrainedLayersWith(const Net* other) {
           << source_layer_name << "'; shape mismatch.  Source param shape is "
           << source_blob->shape_string() << "; target param shape is "
           << target_blobs[j]->shape_string();
-      target_blobs[j]->ShareData(*source_blob);
+      if (copy) {
+        target_blobs[j]->CopyFrom(*source_blob);
+      } else {
+        target_blobs[j]->ShareData(*source_blob);
+      }
     }
   }
 }
@@ -762,6 +853,10 @@ void Net<Dtype>::Reshape() {
   for (int i = 0; i < layers_.size(); ++i) {
     layers_[i]->Reshape(bottom_vecs_[i], top_vecs_[i]);
   }
+  for (int i = 0; i < fused_layers_.size(); ++i) {
+    fused_layers_[i]->Reshape(bottom_vecs_[fused_layer_ranges_[i].first],
+        top_vecs_[fused_layer_ranges_[i].second]);
+  }
 }
 
 template <typename Dtype>
@@ -807,6 +902,9 @@ void Net<Dtype>::CopyTrainedLayersFrom(const string trained_filename) {
   if (trained_filename.size() >= 3 &&
       trained_filename.compare(trained_filename.size() - 3, 3, ".h5") == 0) {
     CopyTrainedLayersFromHDF5(trained_filename);
+  } else if (trained_filename.size() >= 4 &&
+      trained_filename.compare(trained_filename.size() - 4, 4, ".map") == 0) {
+    CopyTrainedLayersFromMapped(trained_filename);
   } else {
     CopyTrainedLayersFromBinaryProto(trained_filename);
   }
@@ -870,6 +968,55 @@ void Net<Dtype>::CopyTrainedLayersFromHDF5(const string trained_filename) {
   H5Fclose(file_hid);
 }
 
+template <typename Dtype>
+void Net<Dtype>::CopyTrainedLayersFromMapped(const string trained_filename) {
+  shared_ptr<MappedWeights> weights(new MappedWeights(trained_filename));
+  const NetParameter& index = weights->index();
+  const bool map_data = weights->element_size() == sizeof(Dtype);
+  if (!map_data) {
+    LOG(INFO) << "Precision of " << trained_filename << " differs from the "
+              << "net's, copying weights instead of mapping them";
+  }
+  for (int i = 0; i < index.layer_size(); ++i) {
+    const LayerParameter& source_layer = index.layer(i);
+    const string& source_layer_name = source_layer.name();
+    if (!layer_names_index_.count(source_layer_name)) {
+      LOG(INFO) << "Ignoring source layer " << source_layer_name;
+      continue;
+    }
+    int target_layer_id = layer_names_index_[source_layer_name];
+    DLOG(INFO) << "Mapping source layer " << source_layer_name;
+    vector<shared_ptr<Blob<Dtype> > >& target_blobs =
+        layers_[target_layer_id]->blobs();
+    CHECK_EQ(target_blobs.size(), source_layer.blobs_size())
+        << "Incompatible number of blobs for layer " << source_layer_name;
+    for (int j = 0; j < target_blobs.size(); ++j) {
+      CHECK(target_blobs[j]->ShapeEquals(source_layer.blobs(j)))
+          << "Cannot copy param " << j << " weights from layer '"
+          << source_layer_name << "'; shape mismatch.";
+      void* source_data = weights->blob_data(i, j);
+      if (map_data) {
+        // The blob memory keeps the map alive, also in the nets sharing it.
+        target_blobs[j]->data()->set_cpu_data(source_data, weights);
+        continue;
+      }
+      const int count = target_blobs[j]->count();
+      Dtype* target_data = target_blobs[j]->mutable_cpu_data();
+      if (weights->element_size() == sizeof(float)) {
+        const float* data = static_cast<const float*>(source_data);
+        for (int k = 0; k < count; ++k) {
+          target_data[k] = data[k];
+        }
+      } else {
+        const double* data = static_cast<const double*>(source_data);
+        for (int k = 0; k < count; ++k) {
+          target_data[k] = data[k];
+        }
+      }
+    }
+  }
+}
+
 template <typename Dtype>
 void Net<Dtype>::ToProto(NetParameter* param, bool write_diff) const {
   param->Clear();
@@ -993,7 +1140,10 @@ vector<int> Net<Dtype>::get_layer_learnable_param_ids(int layer_id) const {
   vector<int> ret;
   for (int i = 0; i < layer_param_ids.size(); ++i) {
     ret.push_back(learnable_param_ids_[layer_param_ids[i]]);
-    CHECK(params_[layer_param_ids[i]].get() == learnable_params_[ret.back()]);
+    // Shared params map to the learnable param of their owner.
+    const int owner = param_owners_[layer_param_ids[i]];
+    CHECK(params_[owner < 0 ? layer_param_ids[i] : owner].get()
+        == learnable_params_[ret.back()]);
   }
   return ret;
 }
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cfloat>
 #include <numeric>
+#include <vector>
 #include "boost/make_shared.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/serialization/bitfield.hpp"
@@ -71,6 +72,61 @@ bool decode_simple(Dtype* dest,
   return true;
 }
 
+template <bool SingleThreaded, typename Dtype>
+void encode_bf16(const Dtype* data, BlobUpdate* msg, uint32_t size) {
+  vector<uint16_t> buffer(size);
+  if (SingleThreaded) {
+    for (int i = 0; i < size; ++i) {
+      buffer[i] = caffe_float_to_bf16(static_cast<float>(data[i]));
+    }
+  } else {
+    caffe_cpu_to_bf16(size, data, &buffer.front());
+  }
+  msg->set_data(&buffer.front(), size * sizeof(uint16_t));
+}
+
+template <bool SingleThreaded, typename Dtype>
+bool decode_bf16(Dtype* dest,
+                 uint32_t max_size,
+                 const BlobUpdate& update,
+                 Dtype alpha,
+                 Dtype beta) {
+  uint32_t encoded_elements = update.data().size() / sizeof(uint16_t);
+  if (max_size < encoded_elements) {
+    LOG(ERROR) << "ignoring received data for layer: "
+               << update.info().layer_id()
+               << " because part is over destination blob: "
+               << "(available elements: " << max_size << ", "
+               << "encoded elements: " << encoded_elements << ")";
+    return false;
+  }
+
+  const uint16_t* src =
+    reinterpret_cast<const uint16_t*>(update.data().c_str());
+  if ((alpha == 1.0) && (beta == 0.0)) {
+    if (SingleThreaded) {
+      for (int i = 0; i < encoded_elements; ++i) {
+        dest[i] = caffe_bf16_to_float(src[i]);
+      }
+    } else {
+      caffe_cpu_from_bf16(encoded_elements, src, dest);
+    }
+    return true;
+  }
+  if (SingleThreaded) {
+    for (int i = 0; i < encoded_elements; ++i) {
+      dest[i] = caffe_bf16_to_float(src[i]) * alpha + dest[i] * beta;
+    }
+  } else {
+    // accumulate in full precision
+    vector<Dtype> values(encoded_elements);
+    caffe_cpu_from_bf16(encoded_elements, src, &values.front());
+    caffe_cpu_axpby<Dtype>(encoded_elements, alpha, &values.front(), beta,
+        dest);
+  }
+  return true;
+}
+
 template <typename Dtype>
 void encode_averaging(Dtype* data, BlobUpdate* msg, uint32_t size) {
   ThresholdCompressionConfig& config =
@@ -177,6 +233,11 @@ struct BlobCodecImpl : BlobCodec<Dtype> {
                uint32_t(src->count())) - start_element;
     msg->mutable_info()->set_part(part);
     *msg->mutable_compression_param() = param.outgoing_compression();
+    // Only gradients are sent as bf16, params keep their full precision.
+    if ((what != BlobEncoding::GRADS) &&
+        (param.outgoing_compression().algo() == COMPRESSION_BF16)) {
+      msg->mutable_compression_param()->set_algo(COMPRESSION_NONE);
+    }
 
     const Dtype* data =
       ((what == BlobEncoding::GRADS) ?
@@ -191,8 +252,10 @@ struct BlobCodecImpl : BlobCodec<Dtype> {
       << ", starting from: " << start_element
       << ", total size: " << src->count();
 
-    if (param.outgoing_compression().algo() == COMPRESSION_AVERAGING) {
+    if (msg->compression_param().algo() == COMPRESSION_AVERAGING) {
       encode_averaging(data, msg, size);
+    } else if (msg->compression_param().algo() == COMPRESSION_BF16) {
+      encode_bf16<SingleThreaded>(data, msg, size);
     } else {
       encode_simple(data, msg, size);
     }
@@ -205,7 +268,10 @@ struct BlobCodecImpl : BlobCodec<Dtype> {
                       typename BlobCodec<Dtype>::What what,
                       Dtype alpha,
                       Dtype beta) const {
-    if (update.data().size() % sizeof(Dtype) != 0) {
+    const size_t element_size =
+      (update.compression_param().algo() == COMPRESSION_BF16) ?
+        sizeof(uint16_t) : sizeof(Dtype);
+    if (update.data().size() % element_size != 0) {
       LOG(ERROR) << "ignoring received data for layer: "
                  << update.info().layer_id()
                  << " because data is corrupted, data size is not divisable"
@@ -222,7 +288,7 @@ struct BlobCodecImpl : BlobCodec<Dtype> {
 
     DLOG(INFO) << "decoding " <<
       ((what == BlobEncoding::GRADS) ? "grads" : "params")
-      << ", number of elements: " << (update.data().size() / sizeof(Dtype))
+      << ", number of elements: " << (update.data().size() / element_size)
       << ", part: " << update.info().part()
       << ", starting from: " << update.info().part() * elements_per_part
       << ", total size: " << dest->count();
@@ -230,6 +296,9 @@ struct BlobCodecImpl : BlobCodec<Dtype> {
       return decode_averaging(
         data, max_size, elements_per_part, update, alpha, beta);
     }
+    if (update.compression_param().algo() == COMPRESSION_BF16) {
+      return decode_bf16<SingleThreaded>(data, max_size, update, alpha, beta);
+    }
     return decode_simple<SingleThreaded>(
         data, max_size, elements_per_part, update, alpha, beta);
   }
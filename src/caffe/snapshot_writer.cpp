@@ -0,0 +1,50 @@
+#include <boost/thread.hpp>
+#include <cstdio>
+#include <string>
+
+#include "caffe/snapshot_writer.hpp"
+
+namespace caffe {
+
+SnapshotWriter::SnapshotWriter()
+  : in_flight_(0) {
+  StartInternalThread();
+}
+
+SnapshotWriter::~SnapshotWriter() {
+  Wait();
+  StopInternalThread();
+}
+
+void SnapshotWriter::Write(shared_ptr<Message> proto, const string& filename) {
+  shared_ptr<Job> job(new Job());
+  job->proto = proto;
+  job->filename = filename;
+  pending_.push(job);
+  ++in_flight_;
+}
+
+void SnapshotWriter::Wait() {
+  for (; in_flight_ > 0; --in_flight_) {
+    done_.pop();
+  }
+}
+
+void SnapshotWriter::InternalThreadEntry() {
+  try {
+    while (!must_stop()) {
+      shared_ptr<Job> job = pending_.pop();
+      const string temp_filename = job->filename + ".tmp";
+      WriteProtoToBinaryFile(*job->proto, temp_filename);
+      CHECK_EQ(std::rename(temp_filename.c_str(), job->filename.c_str()), 0)
+          << "Failed to move snapshot to " << job->filename;
+      LOG(INFO) << "Snapshot " << job->filename << " written";
+      job->proto.reset();
+      done_.push(job);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+}  // namespace caffe
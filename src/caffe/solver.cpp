@@ -1,10 +1,14 @@
+#include <boost/thread.hpp>
 #include <cstdio>
 #include <string>
 #include <vector>
 
 #include "boost/bind.hpp"
 #include "caffe/internode/mpiutil.hpp"
+#include "caffe/layers/base_data_layer.hpp"
 #include "caffe/solver.hpp"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/cpu_info.hpp"
 #include "caffe/util/format.hpp"
 #include "caffe/util/hdf5.hpp"
 #include "caffe/util/io.hpp"
@@ -58,8 +62,36 @@ void Solver<Dtype>::Init(const SolverParameter& param) {
   if (Caffe::root_solver() && param_.random_seed() >= 0) {
     Caffe::set_random_seed(param_.random_seed());
   }
+  CHECK_GE(param_.data_cores(), -1) << "data_cores should be -1 or more.";
+  CHECK_GE(param_.test_cores(), 0) << "test_cores should be non-negative.";
+#ifdef _OPENMP
+  // Net::Init binds the compute threads to the cores left
+  if (Caffe::mode() == Caffe::CPU && Caffe::root_solver() &&
+      param_.test_async() && param_.test_cores() > 0) {
+    cpu::OpenMpManager::setNumberOfTestCores(param_.test_cores());
+  }
+  if (Caffe::mode() == Caffe::CPU && Caffe::root_solver() &&
+      param_.data_cores() != 0) {
+    cpu::OpenMpManager::setNumberOfDataCores(
+        param_.data_cores() > 0 ? param_.data_cores() : 1);
+  }
+#endif
+  data_cores_iters_ = 0;
+  data_cores_iteration_us_ = 0;
+  data_cores_wait_us_ = -1;
   // Scaffolding code
   InitTrainNet();
+  if (Caffe::mode() == Caffe::CPU && param_.data_cores() != 0) {
+    // Only prefetch threads run on the data cores
+    const vector<shared_ptr<Layer<Dtype> > >& layers = net_->layers();
+    for (int i = 0; i < layers.size(); ++i) {
+      const BasePrefetchingDataLayer<Dtype>* layer =
+          dynamic_cast<const BasePrefetchingDataLayer<Dtype>*>(
+              layers[i].get());
+      CHECK(!layer || layer->is_started()) << "data_cores needs "
+          << "data_param.cpu_prefetch in layer " << layer->layer_param().name();
+    }
+  }
   if (Caffe::root_solver()) {
     InitTestNets();
     LOG(INFO) << "Solver scaffolding done.";
@@ -229,6 +261,8 @@ void Solver<Dtype>::Step(int iters) {
       }
     }
 
+    CPUTimer iteration_timer;
+    iteration_timer.Start();
     for (int i = 0; i < callbacks_.size(); ++i) {
       callbacks_[i]->on_start();
     }
@@ -273,6 +307,7 @@ void Solver<Dtype>::Step(int iters) {
     if (!param().disabled_update()) {
       ApplyUpdate();
     }
+    TuneDataCores(iteration_timer.MicroSeconds());
 
     // Increment the internal iter_ counter -- its value should always indicate
     // the number of times the weights have been updated.
@@ -295,6 +330,40 @@ void Solver<Dtype>::Step(int iters) {
   }
 }
 
+// Number of iterations between two adjustments of the data cores
+static const int kDataCoresTuneInterval = 20;
+
+template <typename Dtype>
+void Solver<Dtype>::TuneDataCores(double iteration_us) {
+#ifdef _OPENMP
+  if (param_.data_cores() != -1 || Caffe::mode() != Caffe::CPU ||
+      !Caffe::root_solver()) {
+    return;
+  }
+  data_cores_iteration_us_ += iteration_us;
+  if (++data_cores_iters_ < kDataCoresTuneInterval) {
+    return;
+  }
+  int64_t wait_us = 0;
+  const vector<shared_ptr<Layer<Dtype> > >& layers = net_->layers();
+  for (int i = 0; i < layers.size(); ++i) {
+    const BasePrefetchingDataLayer<Dtype>* layer =
+        dynamic_cast<const BasePrefetchingDataLayer<Dtype>*>(layers[i].get());
+    if (layer) {
+      wait_us += layer->prefetch_stats().wait_us;
+    }
+  }
+  // Skips the first interval, which includes filling the prefetch queues
+  if (data_cores_wait_us_ >= 0) {
+    cpu::OpenMpManager::tuneNumberOfDataCores(
+        (wait_us - data_cores_wait_us_) / data_cores_iteration_us_);
+  }
+  data_cores_wait_us_ = wait_us;
+  data_cores_iteration_us_ = 0;
+  data_cores_iters_ = 0;
+#endif
+}
+
 template <typename Dtype>
 void Solver<Dtype>::Solve(const char* resume_file) {
   CHECK(Caffe::root_solver());
@@ -319,7 +388,9 @@ void Solver<Dtype>::Solve(const char* resume_file) {
       && (!param_.snapshot() || iter_ % param_.snapshot() != 0)) {
     Snapshot();
   }
+  WaitForSnapshots();
   if (requested_early_exit_) {
+    WaitForTests();
     LOG(INFO) << "Optimization stopped early.";
     return;
   }
@@ -346,43 +417,70 @@ void Solver<Dtype>::Solve(const char* resume_file) {
   if (param_.test_interval() && iter_ % param_.test_interval() == 0) {
     TestAll();
   }
+  WaitForTests();
   LOG(INFO) << "Optimization Done.";
 }
 
 template <typename Dtype>
 void Solver<Dtype>::TestAll() {
+  if (param_.test_async()) {
+    if (!async_tester_) {
+      async_tester_.reset(new AsyncTester<Dtype>(this));
+    }
+    // The previous test still runs on the weights copied for it
+    async_tester_->Wait();
+    for (int test_net_id = 0; test_net_id < test_nets_.size(); ++test_net_id) {
+      test_nets_[test_net_id]->CopyTrainedLayersFrom(net_.get());
+    }
+    async_tester_->Test(iter_);
+    return;
+  }
   for (int test_net_id = 0;
        test_net_id < test_nets_.size() && !requested_early_exit_;
        ++test_net_id) {
-    Test(test_net_id);
+    Test(test_net_id, iter_);
   }
 }
 
 template <typename Dtype>
-void Solver<Dtype>::Test(const int test_net_id) {
+void Solver<Dtype>::WaitForTests() {
+  if (async_tester_) {
+    async_tester_->Wait();
+  }
+}
+
+template <typename Dtype>
+void Solver<Dtype>::Test(const int test_net_id, const int tested_iter) {
   CHECK(Caffe::root_solver());
-  LOG(INFO) << "Iteration " << iter_
+  LOG(INFO) << "Iteration " << tested_iter
             << ", Testing net (#" << test_net_id << ")";
-  CHECK_NOTNULL(test_nets_[test_net_id].get())->
-      ShareTrainedLayersWith(net_.get());
+  // Asynchronous tests run on weights copied by TestAll, and leave requested
+  // actions to the training loop.
+  const bool async = param_.test_async();
+  if (!async) {
+    CHECK_NOTNULL(test_nets_[test_net_id].get())->
+        ShareTrainedLayersWith(net_.get());
+  }
   vector<Dtype> test_score;
   vector<int> test_score_output_id;
   const shared_ptr<Net<Dtype> >& test_net = test_nets_[test_net_id];
   Dtype loss = 0;
   for (int i = 0; i < param_.test_iter(test_net_id); ++i) {
-    SolverAction::Enum request = GetRequestedAction();
-    // Check to see if stoppage of testing/training has been requested.
-    while (request != SolverAction::NONE) {
-        if (SolverAction::SNAPSHOT == request) {
-          Snapshot();
-        } else if (SolverAction::STOP == request) {
-          requested_early_exit_ = true;
-        }
-        request = GetRequestedAction();
-    }
-    if (requested_early_exit_) {
-      // break out of test loop.
-      break;
+    if (!async) {
+      SolverAction::Enum request = GetRequestedAction();
+      // Check to see if stoppage of testing/training has been requested.
+      while (request != SolverAction::NONE) {
+          if (SolverAction::SNAPSHOT == request) {
+            Snapshot();
+          } else if (SolverAction::STOP == request) {
+            requested_early_exit_ = true;
+          }
+          request = GetRequestedAction();
+      }
+      if (requested_early_exit_) {
+        // break out of test loop.
+        break;
+      }
     }
 
     Dtype iter_loss;
@@ -409,7 +507,7 @@ void Solver<Dtype>::Test(const int test_net_id) {
       }
     }
   }
-  if (requested_early_exit_) {
+  if (!async && requested_early_exit_) {
     LOG(INFO)     << "Test interrupted.";
     return;
   }
@@ -436,6 +534,9 @@ void Solver<Dtype>::Test(const int test_net_id) {
 template <typename Dtype>
 void Solver<Dtype>::Snapshot() {
   CHECK(Caffe::root_solver());
+  // Keep at most one snapshot in flight, so that staged copies of the
+  // parameters do not pile up when writing is slower than the interval.
+  WaitForSnapshots();
   string model_filename;
   switch (param_.snapshot_format()) {
   case caffe::SolverParameter_SnapshotFormat_BINARYPROTO:
@@ -451,6 +552,26 @@ void Solver<Dtype>::Snapshot() {
   SnapshotSolverState(model_filename);
 }
 
+template <typename Dtype>
+void Solver<Dtype>::WaitForSnapshots() {
+  if (snapshot_writer_) {
+    snapshot_writer_->Wait();
+  }
+}
+
+template <typename Dtype>
+void Solver<Dtype>::WriteSnapshotProto(shared_ptr<Message> proto,
+    const string& filename) {
+  if (!param_.snapshot_async()) {
+    WriteProtoToBinaryFile(*proto, filename);
+    return;
+  }
+  if (!snapshot_writer_) {
+    snapshot_writer_.reset(new SnapshotWriter());
+  }
+  snapshot_writer_->Write(proto, filename);
+}
+
 template <typename Dtype>
 void Solver<Dtype>::CheckSnapshotWritePermissions() {
   if (Caffe::root_solver() && param_.snapshot()) {
@@ -479,9 +600,9 @@ template <typename Dtype>
 string Solver<Dtype>::SnapshotToBinaryProto() {
   string model_filename = SnapshotFilename(".caffemodel");
   LOG(INFO) << "Snapshotting to binary proto file " << model_filename;
-  NetParameter net_param;
-  net_->ToProto(&net_param, param_.snapshot_diff());
-  WriteProtoToBinaryFile(net_param, model_filename);
+  shared_ptr<NetParameter> net_param(new NetParameter());
+  net_->ToProto(net_param.get(), param_.snapshot_diff());
+  WriteSnapshotProto(net_param, model_filename);
   return model_filename;
 }
 
@@ -496,6 +617,7 @@ string Solver<Dtype>::SnapshotToHDF5() {
 template <typename Dtype>
 void Solver<Dtype>::Restore(const char* state_file) {
   CHECK(Caffe::root_solver());
+  WaitForSnapshots();
   string state_filename(state_file);
   if (state_filename.size() >= 3 &&
       state_filename.compare(state_filename.size() - 3, 3, ".h5") == 0) {
@@ -519,6 +641,53 @@ void Solver<Dtype>::UpdateSmoothedLoss(Dtype loss, int start_iter,
   }
 }
 
+template <typename Dtype>
+AsyncTester<Dtype>::AsyncTester(Solver<Dtype>* solver)
+  : solver_(solver), in_flight_(0) {
+  StartInternalThread();
+}
+
+template <typename Dtype>
+AsyncTester<Dtype>::~AsyncTester() {
+  Wait();
+  StopInternalThread();
+}
+
+template <typename Dtype>
+void AsyncTester<Dtype>::Test(int tested_iter) {
+  pending_.push(tested_iter);
+  ++in_flight_;
+}
+
+template <typename Dtype>
+void AsyncTester<Dtype>::Wait() {
+  for (; in_flight_ > 0; --in_flight_) {
+    done_.pop();
+  }
+}
+
+template <typename Dtype>
+void AsyncTester<Dtype>::InternalThreadEntry() {
+#ifdef _OPENMP
+  if (Caffe::mode() == Caffe::CPU) {
+    cpu::OpenMpManager::bindCurrentThreadToTestCores();
+  }
+#endif
+  try {
+    while (!must_stop()) {
+      const int tested_iter = pending_.pop();
+      for (int test_net_id = 0; test_net_id < solver_->test_nets_.size();
+           ++test_net_id) {
+        solver_->Test(test_net_id, tested_iter);
+      }
+      done_.push(tested_iter);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
 INSTANTIATE_CLASS(Solver);
+INSTANTIATE_CLASS(AsyncTester);
 
 }  // namespace caffe
@@ -106,6 +106,31 @@ void AdaDeltaSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
   }
 }
 
+template <typename Dtype>
+void AdaDeltaSolver<Dtype>::FusedUpdate(int param_id, Dtype rate,
+    const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff) {
+  const vector<Blob<Dtype>*>& net_params = this->net_->learnable_params();
+  const int N = net_params[param_id]->count();
+  const Dtype delta = this->param_.delta();
+  const Dtype momentum = this->param_.momentum();
+  const Dtype local_rate = rate * this->net_->params_lr()[param_id];
+  // history of gradients and history of updates
+  Dtype* h = this->history_[param_id]->mutable_cpu_data();
+  Dtype* h2 =
+      this->history_[net_params.size() + param_id]->mutable_cpu_data();
+#ifdef _OPENMP
+  #pragma omp parallel for simd if (caffe_cpu_run_parallel(N))
+#endif
+  for (int i = 0; i < N; ++i) {
+    const Dtype g = grad(diff[i], data[i]);
+    h[i] = momentum * h[i] + (Dtype(1) - momentum) * g * g;
+    const Dtype u = g * std::sqrt((h2[i] + delta) / (h[i] + delta));
+    h2[i] = momentum * h2[i] + (Dtype(1) - momentum) * u * u;
+    diff[i] = local_rate * u;
+    data[i] -= local_rate * u;
+  }
+}
+
 INSTANTIATE_CLASS(AdaDeltaSolver);
 REGISTER_SOLVER_CLASS(AdaDelta);
 
@@ -64,6 +64,26 @@ void AdaGradSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
   }
 }
 
+template <typename Dtype>
+void AdaGradSolver<Dtype>::FusedUpdate(int param_id, Dtype rate,
+    const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff) {
+  CHECK(Caffe::root_solver());
+  const int N = this->net_->learnable_params()[param_id]->count();
+  const Dtype delta = this->param_.delta();
+  const Dtype local_rate = rate * this->net_->params_lr()[param_id];
+  Dtype* h = this->history_[param_id]->mutable_cpu_data();
+#ifdef _OPENMP
+  #pragma omp parallel for simd if (caffe_cpu_run_parallel(N))
+#endif
+  for (int i = 0; i < N; ++i) {
+    const Dtype g = grad(diff[i], data[i]);
+    h[i] += g * g;
+    const Dtype u = local_rate * g / (std::sqrt(h[i]) + delta);
+    diff[i] = u;
+    data[i] -= u;
+  }
+}
+
 INSTANTIATE_CLASS(AdaGradSolver);
 REGISTER_SOLVER_CLASS(AdaGrad);
 
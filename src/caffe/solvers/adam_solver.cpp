@@ -88,6 +88,34 @@ void AdamSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
   }
 }
 
+template <typename Dtype>
+void AdamSolver<Dtype>::FusedUpdate(int param_id, Dtype rate,
+    const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff) {
+  const vector<Blob<Dtype>*>& net_params = this->net_->learnable_params();
+  const int N = net_params[param_id]->count();
+  const Dtype local_rate = rate * this->net_->params_lr()[param_id];
+  const Dtype beta1 = this->param_.momentum();
+  const Dtype beta2 = this->param_.momentum2();
+  const int t = this->iter_ + 1;
+  const Dtype correction = std::sqrt(Dtype(1) - pow(beta2, t)) /
+      (Dtype(1.) - pow(beta1, t));
+  const Dtype eps_hat = this->param_.delta();
+  const Dtype step = local_rate * correction;
+  Dtype* m = this->history_[param_id]->mutable_cpu_data();
+  Dtype* v = this->history_[param_id + net_params.size()]->mutable_cpu_data();
+#ifdef _OPENMP
+  #pragma omp parallel for simd if (caffe_cpu_run_parallel(N))
+#endif
+  for (int i = 0; i < N; ++i) {
+    const Dtype g = grad(diff[i], data[i]);
+    m[i] = beta1 * m[i] + (Dtype(1) - beta1) * g;
+    v[i] = beta2 * v[i] + (Dtype(1) - beta2) * g * g;
+    const Dtype u = step * m[i] / (std::sqrt(v[i]) + eps_hat);
+    diff[i] = u;
+    data[i] -= u;
+  }
+}
+
 INSTANTIATE_CLASS(AdamSolver);
 REGISTER_SOLVER_CLASS(Adam);
 
@@ -0,0 +1,98 @@
+#include <string>
+#include <vector>
+
+#include "caffe/sgd_solvers.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+void LAMBSolver<Dtype>::Regularize(int param_id) {
+  // L2 weight decay is decoupled from the moments and added to the update
+  // in ComputeUpdateValue.
+  if (this->param_.regularization_type() == "L2") { return; }
+  SGDSolver<Dtype>::Regularize(param_id);
+}
+
+template <typename Dtype>
+void LAMBSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
+  // Adam step: diff <- local_rate * correction * m / (sqrt(v) + delta)
+  AdamSolver<Dtype>::ComputeUpdateValue(param_id, rate);
+  Blob<Dtype>* param = this->net_->learnable_params()[param_id];
+  const Dtype local_rate = rate * this->net_->params_lr()[param_id];
+  const Dtype local_decay = (this->param_.regularization_type() == "L2") ?
+      this->param_.weight_decay() *
+      this->net_->params_weight_decay()[param_id] : Dtype(0);
+  if (local_decay) {
+    switch (Caffe::mode()) {
+    case Caffe::CPU:
+      caffe_axpy(param->count(), local_rate * local_decay,
+          param->cpu_data(), param->mutable_cpu_diff());
+      break;
+    case Caffe::GPU:
+#ifndef CPU_ONLY
+      caffe_gpu_axpy(param->count(), local_rate * local_decay,
+          param->gpu_data(), param->mutable_gpu_diff());
+#else
+      NO_GPU;
+#endif
+      break;
+    default:
+      LOG(FATAL) << "Unknown caffe mode: " << Caffe::mode();
+    }
+  }
+  // diff holds local_rate * update, so the trust ratio ||w|| / ||update||
+  // is local_rate * ||w|| / ||diff||.
+  const Dtype sumsq_data = param->sumsq_data();
+  const Dtype sumsq_diff = param->sumsq_diff();
+  if (sumsq_data > 0 && sumsq_diff > 0) {
+    param->scale_diff(local_rate * std::sqrt(sumsq_data / sumsq_diff));
+  }
+}
+
+template <typename Dtype>
+void LAMBSolver<Dtype>::FusedUpdate(int param_id, Dtype rate,
+    const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff) {
+  const vector<Blob<Dtype>*>& net_params = this->net_->learnable_params();
+  const int N = net_params[param_id]->count();
+  const Dtype local_rate = rate * this->net_->params_lr()[param_id];
+  const Dtype beta1 = this->param_.momentum();
+  const Dtype beta2 = this->param_.momentum2();
+  const int t = this->iter_ + 1;
+  const Dtype correction = std::sqrt(Dtype(1) - pow(beta2, t)) /
+      (Dtype(1.) - pow(beta1, t));
+  const Dtype eps_hat = this->param_.delta();
+  const Dtype local_decay = grad.l2_decay;
+  FusedGradient<Dtype> moment_grad = grad;
+  moment_grad.l2_decay = Dtype(0);
+  Dtype* m = this->history_[param_id]->mutable_cpu_data();
+  Dtype* v = this->history_[param_id + net_params.size()]->mutable_cpu_data();
+  // Update the moments and leave the unscaled update in diff.
+#ifdef _OPENMP
+  #pragma omp parallel for simd if (caffe_cpu_run_parallel(N))
+#endif
+  for (int i = 0; i < N; ++i) {
+    const Dtype g = moment_grad(diff[i], data[i]);
+    m[i] = beta1 * m[i] + (Dtype(1) - beta1) * g;
+    v[i] = beta2 * v[i] + (Dtype(1) - beta2) * g * g;
+    diff[i] =
+        correction * m[i] / (std::sqrt(v[i]) + eps_hat) + local_decay * data[i];
+  }
+  const Dtype sumsq_data = caffe_cpu_sumsq(N, data);
+  const Dtype sumsq_update = caffe_cpu_sumsq(N, diff);
+  const Dtype trust = (sumsq_data > 0 && sumsq_update > 0) ?
+      std::sqrt(sumsq_data / sumsq_update) : Dtype(1);
+  const Dtype step = local_rate * trust;
+#ifdef _OPENMP
+  #pragma omp parallel for simd if (caffe_cpu_run_parallel(N))
+#endif
+  for (int i = 0; i < N; ++i) {
+    diff[i] *= step;
+    data[i] -= diff[i];
+  }
+}
+
+INSTANTIATE_CLASS(LAMBSolver);
+REGISTER_SOLVER_CLASS(LAMB);
+
+}  // namespace caffe
@@ -0,0 +1,50 @@
+#include <vector>
+
+#include "caffe/sgd_solvers.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+Dtype LARSSolver<Dtype>::TrustRatio(Dtype sumsq_data, Dtype sumsq_diff) {
+  // Keep the global rate for all-zero weights or gradients, e.g. biases
+  // before their first update.
+  if (sumsq_data <= 0 || sumsq_diff <= 0) {
+    return Dtype(1);
+  }
+  return this->param_.lars_eta() * std::sqrt(sumsq_data / sumsq_diff);
+}
+
+template <typename Dtype>
+void LARSSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
+  // The diff is already normalized and regularized at this point.
+  Blob<Dtype>* param = this->net_->learnable_params()[param_id];
+  const Dtype trust = TrustRatio(param->sumsq_data(), param->sumsq_diff());
+  SGDSolver<Dtype>::ComputeUpdateValue(param_id, rate * trust);
+}
+
+template <typename Dtype>
+void LARSSolver<Dtype>::FusedUpdate(int param_id, Dtype rate,
+    const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff) {
+  const int N = this->net_->learnable_params()[param_id]->count();
+  // Regularize the gradient in place so that its norm can be taken, the
+  // momentum update then applies it as is.
+#ifdef _OPENMP
+  #pragma omp parallel for simd if (caffe_cpu_run_parallel(N))
+#endif
+  for (int i = 0; i < N; ++i) {
+    diff[i] = grad(diff[i], data[i]);
+  }
+  FusedGradient<Dtype> identity;
+  identity.scale = Dtype(1);
+  identity.l2_decay = Dtype(0);
+  identity.l1_decay = Dtype(0);
+  const Dtype trust =
+      TrustRatio(caffe_cpu_sumsq(N, data), caffe_cpu_sumsq(N, diff));
+  SGDSolver<Dtype>::FusedUpdate(param_id, rate * trust, identity, data, diff);
+}
+
+INSTANTIATE_CLASS(LARSSolver);
+REGISTER_SOLVER_CLASS(LARS);
+
+}  // namespace caffe
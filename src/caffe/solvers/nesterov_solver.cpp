@@ -56,6 +56,27 @@ void NesterovSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
   }
 }
 
+template <typename Dtype>
+void NesterovSolver<Dtype>::FusedUpdate(int param_id, Dtype rate,
+    const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff) {
+  const int N = this->net_->learnable_params()[param_id]->count();
+  const Dtype momentum = this->param_.momentum();
+  const Dtype local_rate = rate * this->net_->params_lr()[param_id];
+  Dtype* h = this->history_[param_id]->mutable_cpu_data();
+#ifdef _OPENMP
+  #pragma omp parallel for simd if (caffe_cpu_run_parallel(N))
+#endif
+  for (int i = 0; i < N; ++i) {
+    const Dtype g = grad(diff[i], data[i]);
+    const Dtype h_prev = h[i];
+    h[i] = momentum * h_prev + local_rate * g;
+    // step back then over step
+    const Dtype u = (Dtype(1) + momentum) * h[i] - momentum * h_prev;
+    diff[i] = u;
+    data[i] -= u;
+  }
+}
+
 INSTANTIATE_CLASS(NesterovSolver);
 REGISTER_SOLVER_CLASS(Nesterov);
 
@@ -64,6 +64,26 @@ void RMSPropSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
   }
 }
 
+template <typename Dtype>
+void RMSPropSolver<Dtype>::FusedUpdate(int param_id, Dtype rate,
+    const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff) {
+  const int N = this->net_->learnable_params()[param_id]->count();
+  const Dtype delta = this->param_.delta();
+  const Dtype rms_decay = this->param_.rms_decay();
+  const Dtype local_rate = rate * this->net_->params_lr()[param_id];
+  Dtype* h = this->history_[param_id]->mutable_cpu_data();
+#ifdef _OPENMP
+  #pragma omp parallel for simd if (caffe_cpu_run_parallel(N))
+#endif
+  for (int i = 0; i < N; ++i) {
+    const Dtype g = grad(diff[i], data[i]);
+    h[i] = rms_decay * h[i] + (Dtype(1) - rms_decay) * g * g;
+    const Dtype u = local_rate * g / (std::sqrt(h[i]) + delta);
+    diff[i] = u;
+    data[i] -= u;
+  }
+}
+
 INSTANTIATE_CLASS(RMSPropSolver);
 REGISTER_SOLVER_CLASS(RMSProp);
 
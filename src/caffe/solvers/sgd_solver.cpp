@@ -23,8 +23,15 @@ namespace caffe {
 //
 // where base_lr, max_iter, gamma, step, stepvalue and power are defined
 // in the solver parameter protocol buffer, and iter is the current iteration.
+//
+// During the first warmup_iter iterations the rate is replaced according to
+// the warmup policy:
+//    - linear: return warmup_start_lr +
+//      (rate - warmup_start_lr) * iter / warmup_iter
+//    - constant: return warmup_start_lr
 template <typename Dtype>
 Dtype SGDSolver<Dtype>::GetLearningRate() {
+  boost::mutex::scoped_lock lock(learning_rate_mutex_);
   Dtype rate;
   const string& lr_policy = this->param_.lr_policy();
   if (lr_policy == "fixed") {
@@ -59,6 +66,18 @@ Dtype SGDSolver<Dtype>::GetLearningRate() {
   } else {
     LOG(FATAL) << "Unknown learning rate policy: " << lr_policy;
   }
+  if (this->iter_ < this->param_.warmup_iter()) {
+    const string& warmup_policy = this->param_.warmup_policy();
+    const Dtype start_lr = this->param_.warmup_start_lr();
+    if (warmup_policy == "linear") {
+      rate = start_lr + (rate - start_lr) *
+          Dtype(this->iter_) / Dtype(this->param_.warmup_iter());
+    } else if (warmup_policy == "constant") {
+      rate = start_lr;
+    } else {
+      LOG(FATAL) << "Unknown warmup policy: " << warmup_policy;
+    }
+  }
   return rate;
 }
 
@@ -116,6 +135,29 @@ template <typename Dtype>
 void SGDSolver<Dtype>::ApplyUpdate(int param_id) {
   CHECK(Caffe::root_solver());
   Dtype rate = GetLearningRate();
+  // ApplyUpdate() is not called when updates are applied per parameter:
+  // log the rate once per iteration here instead.
+  if (this->param_.disabled_update() && param_id == 0 &&
+      this->param_.display() && this->iter_ % this->param_.display() == 0) {
+    LOG(INFO) << "Iteration " << this->iter_ << ", lr = " << rate;
+  }
+
+  if (Caffe::mode() == Caffe::CPU) {
+    // Work in the private layout when both data and diff already live there
+    // with matching layouts, as Blob::Update would.
+    Blob<Dtype>* param = this->net_->learnable_params()[param_id];
+    const bool use_prv = param->prv_data() && param->prv_diff()
+        && (param->prv_data_count() == param->count())
+        && (param->prv_diff_count() == param->count())
+        && param->get_prv_data_descriptor()->layout_compare(
+            param->get_prv_diff_descriptor());
+    Dtype* data = use_prv ? param->mutable_prv_data()
+                          : param->mutable_cpu_data();
+    Dtype* diff = use_prv ? param->mutable_prv_diff()
+                          : param->mutable_cpu_diff();
+    FusedUpdate(param_id, rate, GetFusedGradient(param_id), data, diff);
+    return;
+  }
 
   Normalize(param_id);
   Regularize(param_id);
@@ -224,6 +266,48 @@ void SGDSolver<Dtype>::Regularize(int param_id) {
   }
 }
 
+template <typename Dtype>
+FusedGradient<Dtype> SGDSolver<Dtype>::GetFusedGradient(int param_id) {
+  const vector<float>& net_params_weight_decay =
+      this->net_->params_weight_decay();
+  const string& regularization_type = this->param_.regularization_type();
+  Dtype local_decay =
+      this->param_.weight_decay() * net_params_weight_decay[param_id];
+  FusedGradient<Dtype> grad;
+  grad.scale = Dtype(1.) / this->param_.iter_size();
+  grad.l2_decay = Dtype(0);
+  grad.l1_decay = Dtype(0);
+  if (local_decay) {
+    if (regularization_type == "L2") {
+      grad.l2_decay = local_decay;
+    } else if (regularization_type == "L1") {
+      grad.l1_decay = local_decay;
+    } else {
+      LOG(FATAL) << "Unknown regularization type: " << regularization_type;
+    }
+  }
+  return grad;
+}
+
+template <typename Dtype>
+void SGDSolver<Dtype>::FusedUpdate(int param_id, Dtype rate,
+    const FusedGradient<Dtype>& grad, Dtype* data, Dtype* diff) {
+  const int N = this->net_->learnable_params()[param_id]->count();
+  const Dtype momentum = this->param_.momentum();
+  const Dtype local_rate = rate * this->net_->params_lr()[param_id];
+  Dtype* h = history_[param_id]->mutable_cpu_data();
+#ifdef _OPENMP
+  #pragma omp parallel for simd if (caffe_cpu_run_parallel(N))
+#endif
+  for (int i = 0; i < N; ++i) {
+    const Dtype g = grad(diff[i], data[i]);
+    const Dtype u = momentum * h[i] + local_rate * g;
+    h[i] = u;
+    diff[i] = u;
+    data[i] -= u;
+  }
+}
+
 #ifndef CPU_ONLY
 template <typename Dtype>
 void sgd_update_gpu(int N, Dtype* g, Dtype* h, Dtype momentum,
@@ -293,20 +377,20 @@ void SGDSolver<Dtype>::SnapshotSolverState(const string& model_filename) {
 template <typename Dtype>
 void SGDSolver<Dtype>::SnapshotSolverStateToBinaryProto(
     const string& model_filename) {
-  SolverState state;
-  state.set_iter(this->iter_);
-  state.set_learned_net(model_filename);
-  state.set_current_step(this->current_step_);
-  state.clear_history();
+  shared_ptr<SolverState> state(new SolverState());
+  state->set_iter(this->iter_);
+  state->set_learned_net(model_filename);
+  state->set_current_step(this->current_step_);
+  state->clear_history();
   for (int i = 0; i < history_.size(); ++i) {
     // Add history
-    BlobProto* history_blob = state.add_history();
+    BlobProto* history_blob = state->add_history();
     history_[i]->ToProto(history_blob);
   }
   string snapshot_filename = Solver<Dtype>::SnapshotFilename(".solverstate");
   LOG(INFO)
     << "Snapshotting solver state to binary proto file " << snapshot_filename;
-  WriteProtoToBinaryFile(state, snapshot_filename.c_str());
+  this->WriteSnapshotProto(state, snapshot_filename);
 }
 
 template <typename Dtype>
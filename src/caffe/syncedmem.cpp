@@ -103,6 +103,13 @@ void SyncedMemory::set_cpu_data(void* data) {
   cpu_ptr_ = data;
   head_ = HEAD_AT_CPU;
   own_cpu_data_ = false;
+  cpu_data_owner_.reset();
+}
+
+void SyncedMemory::set_cpu_data(void* data, shared_ptr<void> owner) {
+  set_cpu_data(data);
+  boost::mutex::scoped_lock lock(mtx);
+  cpu_data_owner_ = owner;
 }
 
 const void* SyncedMemory::gpu_data() {
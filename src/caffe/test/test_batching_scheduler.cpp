@@ -0,0 +1,257 @@
+#include <boost/thread.hpp>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+#include "caffe/batching_scheduler.hpp"
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/layer_factory.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/cpu_info.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+// Outputs, for each item of its bottom, the affinity of the thread running
+// it, one value per CPU, followed by the size of the OpenMP teams that
+// thread starts.
+template <typename Dtype>
+class BatchAffinityProbeLayer : public Layer<Dtype> {
+ public:
+  explicit BatchAffinityProbeLayer(const LayerParameter& param)
+      : Layer<Dtype>(param) {}
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+    top[0]->Reshape(bottom[0]->shape(0), CPU_SETSIZE + 1, 1, 1);
+  }
+  virtual inline const char* type() const { return "BatchAffinityProbe"; }
+
+ protected:
+  virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+    cpu_set_t cpu_set;
+    CHECK_EQ(sched_getaffinity(0, sizeof(cpu_set), &cpu_set), 0);
+    for (int n = 0; n < top[0]->num(); ++n) {
+      Dtype* top_data = top[0]->mutable_cpu_data() + top[0]->offset(n);
+      for (int i = 0; i < CPU_SETSIZE; ++i) {
+        top_data[i] = CPU_ISSET(i, &cpu_set) ? 1 : 0;
+      }
+#ifdef _OPENMP
+      top_data[CPU_SETSIZE] = omp_get_max_threads();
+#else
+      top_data[CPU_SETSIZE] = 1;
+#endif
+    }
+  }
+  virtual void Backward_cpu(const vector<Blob<Dtype>*>& top,
+      const vector<bool>& propagate_down,
+      const vector<Blob<Dtype>*>& bottom) {}
+};
+
+REGISTER_LAYER_CLASS(BatchAffinityProbe);
+
+template <typename Dtype>
+class BatchingSchedulerTest : public ::testing::Test {
+ protected:
+  void InitNet(const string& data_layer) {
+    const string proto =
+        "name: 'TestNetwork' " + data_layer +
+        "layer { "
+        "  name: 'innerproduct' "
+        "  type: 'InnerProduct' "
+        "  inner_product_param { "
+        "    num_output: 10 "
+        "    weight_filler { type: 'gaussian' std: 0.1 } "
+        "    bias_filler { type: 'gaussian' std: 0.1 } "
+        "  } "
+        "  bottom: 'data' "
+        "  top: 'innerproduct' "
+        "} ";
+    NetParameter param;
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+    param.mutable_state()->set_phase(TEST);
+    Caffe::set_random_seed(1701);
+    net_.reset(new Net<Dtype>(param));
+    // Reference net with the same weights, run one item at a time.
+    Caffe::set_random_seed(1701);
+    reference_net_.reset(new Net<Dtype>(param));
+  }
+
+  void InitInputNet() {
+    InitNet(
+        "layer { "
+        "  name: 'data' "
+        "  type: 'Input' "
+        "  top: 'data' "
+        "  input_param { shape { dim: 1 dim: 3 dim: 4 dim: 5 } } "
+        "} ");
+  }
+
+  void InitMemoryDataNet() {
+    InitNet(
+        "layer { "
+        "  name: 'data' "
+        "  type: 'MemoryData' "
+        "  top: 'data' "
+        "  top: 'label' "
+        "  memory_data_param { "
+        "    batch_size: 1 channels: 3 height: 4 width: 5 "
+        "  } "
+        "} ");
+  }
+
+  void Expected(const Blob<Dtype>& input, Blob<Dtype>* expected) {
+    boost::mutex::scoped_lock lock(mutex_);
+    shared_ptr<MemoryDataLayer<Dtype> > memory_data_layer =
+        boost::dynamic_pointer_cast<MemoryDataLayer<Dtype> >(
+            reference_net_->layers()[0]);
+    Dtype label = 0;
+    if (memory_data_layer) {
+      memory_data_layer->Reset(const_cast<Dtype*>(input.cpu_data()), &label,
+          1);
+    } else {
+      reference_net_->input_blobs()[0]->CopyFrom(input);
+    }
+    Blob<Dtype>* output = reference_net_->blob_by_name("innerproduct").get();
+    reference_net_->Forward();
+    expected->CopyFrom(*output, false, true);
+  }
+
+ public:
+  static void BindAndGet(cpu_set_t* affinity, int* num_threads) {
+#ifdef _OPENMP
+    cpu::OpenMpManager::bindCurrentThreadToComputeCores(true);
+    *num_threads = omp_get_max_threads();
+#endif
+    CHECK_EQ(sched_getaffinity(0, sizeof(*affinity), affinity), 0);
+  }
+
+  // Sends num_requests random items through the scheduler and compares the
+  // outputs with the reference net.
+  void RunRequests(BatchingScheduler<Dtype>* scheduler, int num_requests) {
+    for (int i = 0; i < num_requests; ++i) {
+      Blob<Dtype> input(1, 3, 4, 5);
+      FillerParameter filler_param;
+      GaussianFiller<Dtype> filler(filler_param);
+      filler.Fill(&input);
+      vector<shared_ptr<Blob<Dtype> > > outputs;
+      vector<Blob<Dtype>*> output_vec;
+      for (int j = 0; j < net_->num_outputs(); ++j) {
+        outputs.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+        output_vec.push_back(outputs[j].get());
+      }
+      scheduler->Forward(input, output_vec);
+
+      Blob<Dtype> expected;
+      Expected(input, &expected);
+      int index = 0;
+      while (net_->output_blobs()[index] !=
+             net_->blob_by_name("innerproduct").get()) {
+        ++index;
+      }
+      const Blob<Dtype>& output = *output_vec[index];
+      ASSERT_EQ(expected.shape(), output.shape());
+      for (int j = 0; j < output.count(); ++j) {
+        EXPECT_NEAR(expected.cpu_data()[j], output.cpu_data()[j], 1e-5);
+      }
+    }
+  }
+
+ protected:
+  shared_ptr<Net<Dtype> > net_;
+  shared_ptr<Net<Dtype> > reference_net_;
+  boost::mutex mutex_;
+};
+
+TYPED_TEST_CASE(BatchingSchedulerTest, TestDtypes);
+
+TYPED_TEST(BatchingSchedulerTest, TestForward) {
+  this->InitInputNet();
+  BatchingScheduler<TypeParam> scheduler(this->net_, 4, 1000);
+  this->RunRequests(&scheduler, 5);
+  const BatchingStats stats = scheduler.stats();
+  EXPECT_EQ(stats.requests, 5);
+  EXPECT_EQ(stats.batches, 5);
+}
+
+TYPED_TEST(BatchingSchedulerTest, TestConcurrentClients) {
+  this->InitInputNet();
+  const int kNumClients = 4;
+  const int kNumRequests = 10;
+  // Generous deadline so that concurrent requests end up in one batch.
+  BatchingScheduler<TypeParam> scheduler(this->net_, kNumClients, 100000);
+  boost::thread_group clients;
+  for (int i = 0; i < kNumClients; ++i) {
+    clients.create_thread(boost::bind(
+        &BatchingSchedulerTest<TypeParam>::RunRequests, this, &scheduler,
+        kNumRequests));
+  }
+  clients.join_all();
+  const BatchingStats stats = scheduler.stats();
+  EXPECT_EQ(stats.requests, kNumClients * kNumRequests);
+  EXPECT_LT(stats.batches, kNumClients * kNumRequests);
+  EXPECT_GT(stats.mean_batch_size, 1);
+  EXPECT_LE(stats.latency_p50, stats.latency_p90);
+  EXPECT_LE(stats.latency_p90, stats.latency_p99);
+}
+
+TYPED_TEST(BatchingSchedulerTest, TestMemoryData) {
+  this->InitMemoryDataNet();
+  const int kNumClients = 3;
+  BatchingScheduler<TypeParam> scheduler(this->net_, kNumClients, 100000);
+  boost::thread_group clients;
+  for (int i = 0; i < kNumClients; ++i) {
+    clients.create_thread(boost::bind(
+        &BatchingSchedulerTest<TypeParam>::RunRequests, this, &scheduler, 5));
+  }
+  clients.join_all();
+  EXPECT_EQ(scheduler.stats().requests, kNumClients * 5);
+}
+
+TYPED_TEST(BatchingSchedulerTest, TestThreadAffinity) {
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(
+      "layer { "
+      "  name: 'data' "
+      "  type: 'Input' "
+      "  top: 'data' "
+      "  input_param { shape { dim: 1 dim: 3 dim: 4 dim: 5 } } "
+      "} "
+      "layer { "
+      "  name: 'probe' "
+      "  type: 'BatchAffinityProbe' "
+      "  bottom: 'data' "
+      "  top: 'probe' "
+      "} ", &param));
+  param.mutable_state()->set_phase(TEST);
+  shared_ptr<Net<TypeParam> > net(new Net<TypeParam>(param));
+  BatchingScheduler<TypeParam> scheduler(net, 4, 1000);
+  // The affinity and team size of a thread bound to the compute cores.
+  cpu_set_t expected_set;
+  int expected_threads = 1;
+  boost::thread bound_thread(&BatchingSchedulerTest<TypeParam>::BindAndGet,
+      &expected_set, &expected_threads);
+  bound_thread.join();
+  Blob<TypeParam> input(1, 3, 4, 5);
+  Blob<TypeParam> output;
+  vector<Blob<TypeParam>*> output_vec(1, &output);
+  scheduler.Forward(input, output_vec);
+  ASSERT_EQ(output.count(), CPU_SETSIZE + 1);
+  for (int i = 0; i < CPU_SETSIZE; ++i) {
+    const TypeParam expected = CPU_ISSET(i, &expected_set) ? 1 : 0;
+    EXPECT_EQ(expected, output.cpu_data()[i]) << "CPU " << i;
+  }
+  EXPECT_EQ(expected_threads, output.cpu_data()[CPU_SETSIZE]);
+}
+
+}  // namespace caffe
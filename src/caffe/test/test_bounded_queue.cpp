@@ -0,0 +1,118 @@
+#include <boost/thread.hpp>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/bounded_queue.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class BoundedQueueTest : public ::testing::Test {
+ public:
+  // Pushes the values [begin, end).
+  static void Produce(BoundedQueue<int>* queue, int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      queue->push(i);
+    }
+  }
+
+  static void Consume(BoundedQueue<int>* queue, int count,
+      vector<int>* seen) {
+    for (int i = 0; i < count; ++i) {
+      ++(*seen)[queue->pop()];
+    }
+  }
+
+  static void PopForever(BoundedQueue<int>* queue, bool* interrupted) {
+    try {
+      queue->pop();
+    } catch (boost::thread_interrupted&) {
+      *interrupted = true;
+    }
+  }
+
+ protected:
+  void RunContended(int capacity, int spin_count) {
+    const int kNumThreads = 4;
+    const int kNumItems = 2000;
+    BoundedQueue<int> queue(capacity, spin_count);
+    vector<vector<int> > seen(kNumThreads,
+        vector<int>(kNumThreads * kNumItems, 0));
+    boost::thread_group threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.create_thread(boost::bind(&BoundedQueueTest::Produce, &queue,
+          i * kNumItems, (i + 1) * kNumItems));
+      threads.create_thread(boost::bind(&BoundedQueueTest::Consume, &queue,
+          kNumItems, &seen[i]));
+    }
+    threads.join_all();
+    EXPECT_EQ(queue.size(), 0);
+    for (int j = 0; j < kNumThreads * kNumItems; ++j) {
+      int count = 0;
+      for (int i = 0; i < kNumThreads; ++i) {
+        count += seen[i][j];
+      }
+      EXPECT_EQ(count, 1) << "Value " << j;
+    }
+  }
+};
+
+TEST_F(BoundedQueueTest, TestCapacity) {
+  EXPECT_EQ(BoundedQueue<int>(1).capacity(), 1);
+  EXPECT_EQ(BoundedQueue<int>(3).capacity(), 4);
+  EXPECT_EQ(BoundedQueue<int>(64).capacity(), 64);
+}
+
+TEST_F(BoundedQueueTest, TestPushPop) {
+  BoundedQueue<int> queue(4);
+  EXPECT_EQ(queue.size(), 0);
+  for (int lap = 0; lap < 3; ++lap) {
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_TRUE(queue.try_push(lap * 4 + i));
+    }
+    EXPECT_FALSE(queue.try_push(-1));
+    EXPECT_EQ(queue.size(), 4);
+    int t;
+    EXPECT_TRUE(queue.try_peek(&t));
+    EXPECT_EQ(t, lap * 4);
+    EXPECT_EQ(queue.peek(), lap * 4);
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_EQ(queue.pop(), lap * 4 + i);
+    }
+    EXPECT_FALSE(queue.try_pop(&t));
+    EXPECT_FALSE(queue.try_peek(&t));
+    EXPECT_EQ(queue.size(), 0);
+  }
+}
+
+TEST_F(BoundedQueueTest, TestTimeout) {
+  BoundedQueue<int> queue(2, 0);
+  int t;
+  EXPECT_FALSE(queue.try_pop(&t, 1000));
+  queue.push(7);
+  EXPECT_TRUE(queue.try_pop(&t, 1000));
+  EXPECT_EQ(t, 7);
+}
+
+TEST_F(BoundedQueueTest, TestContended) {
+  RunContended(64, 1000);
+}
+
+TEST_F(BoundedQueueTest, TestContendedBlocking) {
+  // Small queue without spinning, so that both sides sleep often.
+  RunContended(2, 0);
+}
+
+TEST_F(BoundedQueueTest, TestInterrupt) {
+  BoundedQueue<int> queue(2);
+  bool interrupted = false;
+  boost::thread thread(&BoundedQueueTest::PopForever, &queue, &interrupted);
+  thread.interrupt();
+  thread.join();
+  EXPECT_TRUE(interrupted);
+}
+
+}  // namespace caffe
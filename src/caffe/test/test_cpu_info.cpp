@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "gtest/gtest.h"
 
 #include "caffe/util/cpu_info.hpp"
@@ -229,6 +231,38 @@ TEST(CpuInfo, testCollectionForSpeedRecognitionMhz) {
   EXPECT_EQ(collection.getProcessorSpeedMHz(), 2400);
 }
 
+#ifdef _OPENMP
+TEST(OpenMpManager, testNumberOfDataCoresLeavesComputeCore) {
+  OpenMpManager::setNumberOfDataCores(1000000);
+  unsigned maxNumberOfDataCores = OpenMpManager::getNumberOfDataCores();
+  EXPECT_LT(maxNumberOfDataCores, 1000000);
+
+  OpenMpManager::setNumberOfDataCores(0);
+  EXPECT_EQ(OpenMpManager::getNumberOfDataCores(), 0);
+  OpenMpManager::setNumberOfDataCores(maxNumberOfDataCores);
+  EXPECT_EQ(OpenMpManager::getNumberOfDataCores(), maxNumberOfDataCores);
+  OpenMpManager::setNumberOfDataCores(0);
+}
+TEST(OpenMpManager, testNumberOfTestCoresLeavesComputeCore) {
+  OpenMpManager::setNumberOfDataCores(1000000);
+  unsigned maxNumberOfDataCores = OpenMpManager::getNumberOfDataCores();
+  OpenMpManager::setNumberOfDataCores(0);
+
+  // Test cores take their share of the cores left for data
+  OpenMpManager::setNumberOfTestCores(1);
+  unsigned numberOfTestCores = OpenMpManager::getNumberOfTestCores();
+  EXPECT_EQ(numberOfTestCores, std::min(1u, maxNumberOfDataCores));
+  OpenMpManager::setNumberOfDataCores(1000000);
+  EXPECT_EQ(OpenMpManager::getNumberOfDataCores() + numberOfTestCores,
+    maxNumberOfDataCores);
+
+  OpenMpManager::setNumberOfTestCores(0);
+  EXPECT_EQ(OpenMpManager::getNumberOfTestCores(), 0);
+  EXPECT_EQ(OpenMpManager::getNumberOfDataCores(), maxNumberOfDataCores);
+  OpenMpManager::setNumberOfDataCores(0);
+}
+#endif  // _OPENMP
+
 }  // namespace cpu
 }  // namespace caffe
 
@@ -11,6 +11,7 @@
 #include "caffe/layers/data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/db.hpp"
+#include "caffe/util/db_recordio.hpp"
 #include "caffe/util/io.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -39,11 +40,14 @@ class DataLayerTest : public MultiDeviceTest<TypeParam> {
 
   // Fill the DB with data: if unique_pixels, each pixel is unique but
   // all images are the same; else each image is unique but all pixels within
-  // an image are the same.
-  void Fill(const bool unique_pixels, DataParameter_DB backend) {
+  // an image are the same. With shard_records, a RECORDIO db gets a shard
+  // per shard_records records.
+  void Fill(const bool unique_pixels, DataParameter_DB backend,
+      int shard_records = 0) {
     backend_ = backend;
     LOG(INFO) << "Using temporary dataset " << *filename_;
-    scoped_ptr<db::DB> db(db::GetDB(backend));
+    scoped_ptr<db::DB> db(shard_records > 0 ?
+        new db::RecordIO(1) : db::GetDB(backend));
     db->Open(*filename_, db::NEW);
     scoped_ptr<db::Transaction> txn(db->NewTransaction());
     for (int i = 0; i < 5; ++i) {
@@ -62,6 +66,9 @@ class DataLayerTest : public MultiDeviceTest<TypeParam> {
       string out;
       CHECK(datum.SerializeToString(&out));
       txn->Put(ss.str(), out);
+      if (shard_records > 0 && (i + 1) % shard_records == 0) {
+        txn->Commit();
+      }
     }
     txn->Commit();
     db->Close();
@@ -105,6 +112,75 @@ class DataLayerTest : public MultiDeviceTest<TypeParam> {
     }
   }
 
+  // Reads the 5 records in two partitions, through two layers in the same
+  // process. Partition 0 reads records[0] and partition 1 records[1].
+  void TestReadPartitions(const int records[2][3]) {
+    LayerParameter param;
+    param.set_phase(TEST);
+    DataParameter* data_param = param.mutable_data_param();
+    data_param->set_batch_size(3);
+    data_param->set_source(filename_->c_str());
+    data_param->set_backend(backend_);
+    data_param->set_num_partitions(2);
+    vector<shared_ptr<DataLayer<Dtype> > > layers;
+    for (int partition = 0; partition < 2; ++partition) {
+      data_param->set_partition(partition);
+      layers.push_back(shared_ptr<DataLayer<Dtype> >(
+          new DataLayer<Dtype>(param)));
+      layers.back()->SetUp(blob_bottom_vec_, blob_top_vec_);
+    }
+    const int sizes[2] = {3, 2};
+    for (int partition = 0; partition < 2; ++partition) {
+      int item = 0;
+      for (int iter = 0; iter < 4; ++iter) {
+        layers[partition]->Forward(blob_bottom_vec_, blob_top_vec_);
+        for (int i = 0; i < 3; ++i, ++item) {
+          EXPECT_EQ(records[partition][item % sizes[partition]],
+              blob_top_label_->cpu_data()[i])
+              << "partition " << partition << " iter " << iter;
+        }
+      }
+    }
+  }
+
+  // Reads through each configuration of the prefetch pipeline, which must
+  // all deliver the records in order.
+  void TestReadPipeline() {
+    const bool cpu_prefetch[] = {false, true, true, true};
+    const int decode_threads[] = {1, 0, 1, 3};
+    for (int k = 0; k < 4; ++k) {
+      LayerParameter param;
+      param.set_phase(TRAIN);
+      DataParameter* data_param = param.mutable_data_param();
+      data_param->set_batch_size(5);
+      data_param->set_source(filename_->c_str());
+      data_param->set_backend(backend_);
+      data_param->set_cpu_prefetch(cpu_prefetch[k]);
+      data_param->set_decode_threads(decode_threads[k]);
+      data_param->set_transform_threads(2);
+
+      DataLayer<Dtype> layer(param);
+      layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+      for (int iter = 0; iter < 10; ++iter) {
+        layer.Forward(blob_bottom_vec_, blob_top_vec_);
+        for (int i = 0; i < 5; ++i) {
+          EXPECT_EQ(i, blob_top_label_->cpu_data()[i]) << "config " << k;
+          EXPECT_EQ(i, blob_top_data_->cpu_data()[i * 24]) << "config " << k;
+        }
+      }
+      const PrefetchStats stats = layer.prefetch_stats();
+      EXPECT_GE(stats.batches, 10) << "config " << k;
+      EXPECT_GE(stats.read_us, 0);
+      EXPECT_GE(stats.decode_us, 0);
+      EXPECT_GE(stats.transform_us, 0);
+      EXPECT_GE(stats.wait_us, 0);
+      if (!cpu_prefetch[k]) {
+        // Forward transforms the batches itself, which counts as waiting
+        EXPECT_GE(stats.wait_us, stats.transform_us) << "config " << k;
+      }
+    }
+  }
+
   void TestReshape(DataParameter_DB backend) {
     const int num_inputs = 5;
     // Save data of varying shapes.
@@ -356,6 +432,19 @@ TYPED_TEST(DataLayerTest, TestReadLevelDB) {
   this->TestRead();
 }
 
+TYPED_TEST(DataLayerTest, TestReadPipelineLevelDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LEVELDB);
+  this->TestReadPipeline();
+}
+
+TYPED_TEST(DataLayerTest, TestReadPartitionsLevelDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LEVELDB);
+  const int records[2][3] = {{0, 2, 4}, {1, 3, -1}};
+  this->TestReadPartitions(records);
+}
+
 TYPED_TEST(DataLayerTest, TestReshapeLevelDB) {
   this->TestReshape(DataParameter_DB_LEVELDB);
 }
@@ -396,6 +485,19 @@ TYPED_TEST(DataLayerTest, TestReadLMDB) {
   this->TestRead();
 }
 
+TYPED_TEST(DataLayerTest, TestReadPipelineLMDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LMDB);
+  this->TestReadPipeline();
+}
+
+TYPED_TEST(DataLayerTest, TestReadPartitionsLMDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LMDB);
+  const int records[2][3] = {{0, 2, 4}, {1, 3, -1}};
+  this->TestReadPartitions(records);
+}
+
 TYPED_TEST(DataLayerTest, TestReshapeLMDB) {
   this->TestReshape(DataParameter_DB_LMDB);
 }
@@ -429,5 +531,43 @@ TYPED_TEST(DataLayerTest, TestReadCropTestLMDB) {
 }
 
 #endif  // USE_LMDB
+
+TYPED_TEST(DataLayerTest, TestReadRecordIO) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_RECORDIO);
+  this->TestRead();
+}
+
+TYPED_TEST(DataLayerTest, TestReadPipelineRecordIO) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_RECORDIO);
+  this->TestReadPipeline();
+}
+
+TYPED_TEST(DataLayerTest, TestReadPartitionsRecordIO) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  // Shards {0, 1}, {2, 3} and {4}, partitioned by shard
+  this->Fill(unique_pixels, DataParameter_DB_RECORDIO, 2);
+  const int records[2][3] = {{0, 1, 4}, {2, 3, -1}};
+  this->TestReadPartitions(records);
+}
+
+TYPED_TEST(DataLayerTest, TestReadPartitionsOneShardRecordIO) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  // A single shard for two partitions, partitioned by record
+  this->Fill(unique_pixels, DataParameter_DB_RECORDIO);
+  const int records[2][3] = {{0, 2, 4}, {1, 3, -1}};
+  this->TestReadPartitions(records);
+}
+
+TYPED_TEST(DataLayerTest, TestReshapeRecordIO) {
+  this->TestReshape(DataParameter_DB_RECORDIO);
+}
+
+TYPED_TEST(DataLayerTest, TestReadCropTrainRecordIO) {
+  const bool unique_pixels = true;  // all images the same; pixels different
+  this->Fill(unique_pixels, DataParameter_DB_RECORDIO);
+  this->TestReadCrop(TRAIN);
+}
 }  // namespace caffe
 #endif  // USE_OPENCV
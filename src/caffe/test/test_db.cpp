@@ -57,8 +57,13 @@ struct TypeLMDB {
 };
 DataParameter_DB TypeLMDB::backend = DataParameter_DB_LMDB;
 
+struct TypeRecordIO {
+  static DataParameter_DB backend;
+};
+DataParameter_DB TypeRecordIO::backend = DataParameter_DB_RECORDIO;
+
 // typedef ::testing::Types<TypeLmdb> TestTypes;
-typedef ::testing::Types<TypeLevelDB, TypeLMDB> TestTypes;
+typedef ::testing::Types<TypeLevelDB, TypeLMDB, TypeRecordIO> TestTypes;
 
 TYPED_TEST_CASE(DBTest, TestTypes);
 
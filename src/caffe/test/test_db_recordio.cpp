@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "boost/scoped_ptr.hpp"
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/db_recordio.hpp"
+#include "caffe/util/format.hpp"
+#include "caffe/util/io.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+using boost::scoped_ptr;
+
+class RecordIOTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    MakeTempDir(&source_);
+    source_ += "/db";
+  }
+
+  static string Key(int i) {
+    return format_int(i, 8);
+  }
+
+  // Values of varying sizes, some larger than a read block.
+  static string Value(int i) {
+    const size_t size = i % 10 == 9 ? db::RecordIOCursor::kBlockSize + i :
+        i * 37;
+    return string(size, static_cast<char>('a' + i % 26));
+  }
+
+  // Writes records [begin, end), committing every commit_size records.
+  void Write(db::RecordIO* db, int begin, int end, int commit_size) {
+    scoped_ptr<db::Transaction> txn(db->NewTransaction());
+    for (int i = begin; i < end; ++i) {
+      txn->Put(Key(i), Value(i));
+      if ((i - begin + 1) % commit_size == 0) {
+        txn->Commit();
+      }
+    }
+    txn->Commit();
+  }
+
+  // Reads one epoch, checking each record, and returns the keys read.
+  vector<int> ReadEpoch(db::Cursor* cursor) {
+    vector<int> keys;
+    for (; cursor->valid(); cursor->Next()) {
+      const int i = atoi(cursor->key().c_str());
+      EXPECT_EQ(cursor->key(), Key(i));
+      EXPECT_TRUE(cursor->value() == Value(i)) << "Record " << i;
+      keys.push_back(i);
+    }
+    return keys;
+  }
+
+  string source_;
+};
+
+TEST_F(RecordIOTest, TestGetDB) {
+  scoped_ptr<db::DB> db(db::GetDB(DataParameter_DB_RECORDIO));
+  EXPECT_TRUE(dynamic_cast<db::RecordIO*>(db.get()));
+  db.reset(db::GetDB("recordio"));
+  EXPECT_TRUE(dynamic_cast<db::RecordIO*>(db.get()));
+}
+
+TEST_F(RecordIOTest, TestEmpty) {
+  db::RecordIO db;
+  db.Open(source_, db::NEW);
+  db.Close();
+  db.Open(source_, db::READ);
+  scoped_ptr<db::Cursor> cursor(db.NewCursor());
+  EXPECT_FALSE(cursor->valid());
+}
+
+TEST_F(RecordIOTest, TestReadSequential) {
+  const int kNumRecords = 50;
+  {
+    // Small shards, so that records span several of them
+    db::RecordIO db(16 << 10);
+    db.Open(source_, db::NEW);
+    Write(&db, 0, kNumRecords, 7);
+  }
+  db::RecordIO db;
+  db.Open(source_, db::READ);
+  EXPECT_GT(db.shards().size(), 1);
+  int64_t records = 0;
+  for (int i = 0; i < db.shards().size(); ++i) {
+    records += db.shards()[i].records;
+  }
+  EXPECT_EQ(records, kNumRecords);
+  scoped_ptr<db::Cursor> cursor(db.NewCursor());
+  for (int epoch = 0; epoch < 2; ++epoch) {
+    vector<int> keys = ReadEpoch(cursor.get());
+    ASSERT_EQ(keys.size(), kNumRecords);
+    for (int i = 0; i < kNumRecords; ++i) {
+      EXPECT_EQ(keys[i], i);
+    }
+    cursor->SeekToFirst();
+  }
+}
+
+TEST_F(RecordIOTest, TestAppend) {
+  {
+    db::RecordIO db;
+    db.Open(source_, db::NEW);
+    Write(&db, 0, 10, 4);
+  }
+  {
+    db::RecordIO db;
+    db.Open(source_, db::WRITE);
+    Write(&db, 10, 20, 4);
+  }
+  db::RecordIO db;
+  db.Open(source_, db::READ);
+  EXPECT_EQ(db.shards().size(), 2);
+  scoped_ptr<db::Cursor> cursor(db.NewCursor());
+  vector<int> keys = ReadEpoch(cursor.get());
+  ASSERT_EQ(keys.size(), 20);
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(keys[i], i);
+  }
+}
+
+TEST_F(RecordIOTest, TestReadWhileWriting) {
+  db::RecordIO writer;
+  writer.Open(source_, db::NEW);
+  scoped_ptr<db::Transaction> txn(writer.NewTransaction());
+  txn->Put(Key(0), Value(0));
+  txn->Put(Key(1), Value(1));
+  txn->Commit();
+  // Not committed, so not visible to readers
+  txn->Put(Key(2), Value(2));
+  db::RecordIO db;
+  db.Open(source_, db::READ);
+  scoped_ptr<db::Cursor> cursor(db.NewCursor());
+  EXPECT_EQ(ReadEpoch(cursor.get()).size(), 2);
+}
+
+TEST_F(RecordIOTest, TestShuffleShards) {
+  const int kNumRecords = 60;
+  {
+    // One shard per commit
+    db::RecordIO db(1);
+    db.Open(source_, db::NEW);
+    Write(&db, 0, kNumRecords, 3);
+  }
+  Caffe::set_random_seed(1701);
+  db::RecordIO db;
+  db.Open(source_, db::READ);
+  db.set_shuffle_shards(true);
+  scoped_ptr<db::Cursor> cursor(db.NewCursor());
+  vector<int> first = ReadEpoch(cursor.get());
+  cursor->SeekToFirst();
+  vector<int> second = ReadEpoch(cursor.get());
+  ASSERT_EQ(first.size(), kNumRecords);
+  ASSERT_EQ(second.size(), kNumRecords);
+  EXPECT_FALSE(first == second);
+  // Every record once per epoch, in order within a shard of 3 records
+  vector<int> seen(kNumRecords, 0);
+  for (int i = 0; i < kNumRecords; ++i) {
+    ++seen[first[i]];
+    if (i % 3 > 0) {
+      EXPECT_EQ(first[i], first[i - 1] + 1);
+    }
+  }
+  for (int i = 0; i < kNumRecords; ++i) {
+    EXPECT_EQ(seen[i], 1) << "Record " << i;
+  }
+}
+
+TEST_F(RecordIOTest, TestPartition) {
+  {
+    // One shard per commit
+    db::RecordIO db(1);
+    db.Open(source_, db::NEW);
+    Write(&db, 0, 15, 3);
+  }
+  db::RecordIO db;
+  db.Open(source_, db::READ);
+  // Partition 1 of 2 reads shards 1 and 3
+  db.set_partition(1, 2);
+  scoped_ptr<db::Cursor> cursor(db.NewCursor());
+  vector<int> keys = ReadEpoch(cursor.get());
+  const int expected[] = {3, 4, 5, 9, 10, 11};
+  ASSERT_EQ(keys.size(), 6);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(keys[i], expected[i]);
+  }
+}
+
+TEST_F(RecordIOTest, TestPartitionFewerShards) {
+  {
+    // Shards {0, 1, 2} and {3, 4, 5}
+    db::RecordIO db(1);
+    db.Open(source_, db::NEW);
+    Write(&db, 0, 6, 3);
+  }
+  db::RecordIO db;
+  db.Open(source_, db::READ);
+  // Partition 1 of 3 reads records 1 and 4, whatever the order of the shards
+  db.set_partition(1, 3);
+  db.set_shuffle_shards(true);
+  scoped_ptr<db::Cursor> cursor(db.NewCursor());
+  for (int epoch = 0; epoch < 4; ++epoch) {
+    vector<int> keys = ReadEpoch(cursor.get());
+    std::sort(keys.begin(), keys.end());
+    ASSERT_EQ(keys.size(), 2);
+    EXPECT_EQ(keys[0], 1);
+    EXPECT_EQ(keys[1], 4);
+    cursor->SeekToFirst();
+  }
+}
+
+}  // namespace caffe
@@ -1,5 +1,9 @@
 #include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "gtest/gtest.h"
 
 #include "caffe/blob.hpp"
@@ -154,6 +158,40 @@ TYPED_TEST(DeconvolutionLayerTest, TestGradient) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(DeconvolutionLayerTest, TestGradientBatchedWeightGemm) {
+  typedef typename TypeParam::Dtype Dtype;
+#ifdef _OPENMP
+  // weight_cpu_gemm gathers up to one image per OpenMP thread into a single
+  // GEMM; with two threads, the three images take a batch of two and one
+  // image alone.
+  const int max_threads = omp_get_max_threads();
+  omp_set_num_threads(2);
+#endif
+  this->blob_bottom_->Reshape(3, 3, 6, 4);
+  this->blob_bottom_2_->Reshape(3, 3, 6, 4);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_bottom_);
+  filler.Fill(this->blob_bottom_2_);
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  this->blob_bottom_vec_.push_back(this->blob_bottom_2_);
+  this->blob_top_vec_.push_back(this->blob_top_2_);
+  convolution_param->add_kernel_size(2);
+  convolution_param->add_stride(1);
+  convolution_param->set_num_output(1);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  DeconvolutionLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+#ifdef _OPENMP
+  omp_set_num_threads(max_threads);
+#endif
+}
+
 TYPED_TEST(DeconvolutionLayerTest, TestNDAgainst2D) {
   typedef typename TypeParam::Dtype Dtype;
   const int kernel_h = 11;
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/net.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class FusedElementwiseLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  FusedElementwiseLayerTest() : seed_(1701) {}
+
+  // Builds the net with and without fuse_elementwise, runs Forward and
+  // Backward on both with the same inputs, weights and output diff, and
+  // checks that they agree.
+  void RunChain(const string& layers_proto, const string& output) {
+    const string proto =
+        "name: 'FusedNet' "
+        "force_backward: true "
+        "layer { "
+        "  name: 'data' "
+        "  type: 'Input' "
+        "  top: 'data' "
+        "  top: 'data2' "
+        "  input_param { "
+        "    shape { dim: 2 dim: 3 dim: 17 dim: 31 } "
+        "    shape { dim: 2 dim: 3 dim: 17 dim: 31 } "
+        "  } "
+        "} " + layers_proto;
+    NetParameter param;
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+    Caffe::set_random_seed(seed_);
+    ref_net_.reset(new Net<Dtype>(param));
+    param.set_fuse_elementwise(true);
+    fused_net_.reset(new Net<Dtype>(param));
+    NetParameter weights;
+    ref_net_->ToProto(&weights);
+    fused_net_->CopyTrainedLayersFrom(weights);
+
+    FillerParameter filler_param;
+    filler_param.set_std(1);
+    GaussianFiller<Dtype> filler(filler_param);
+    const char* inputs[] = {"data", "data2"};
+    for (int i = 0; i < 2; ++i) {
+      Blob<Dtype>* ref_input = ref_net_->blob_by_name(inputs[i]).get();
+      filler.Fill(ref_input);
+      fused_net_->blob_by_name(inputs[i])->CopyFrom(*ref_input);
+    }
+    ref_net_->Forward();
+    fused_net_->Forward();
+    Blob<Dtype>* ref_output = ref_net_->blob_by_name(output).get();
+    Blob<Dtype>* fused_output = fused_net_->blob_by_name(output).get();
+    ExpectBlobsNear(*ref_output, *fused_output, false);
+
+    Blob<Dtype> top_diff(ref_output->shape());
+    filler.Fill(&top_diff);
+    ref_output->CopyFrom(top_diff, true);
+    fused_output->CopyFrom(top_diff, true);
+    ref_net_->Backward();
+    fused_net_->Backward();
+    for (int i = 0; i < 2; ++i) {
+      ExpectBlobsNear(*ref_net_->blob_by_name(inputs[i]),
+          *fused_net_->blob_by_name(inputs[i]), true);
+    }
+    const vector<Blob<Dtype>*>& ref_params = ref_net_->learnable_params();
+    const vector<Blob<Dtype>*>& fused_params = fused_net_->learnable_params();
+    ASSERT_EQ(ref_params.size(), fused_params.size());
+    for (int i = 0; i < ref_params.size(); ++i) {
+      ExpectBlobsNear(*ref_params[i], *fused_params[i], true);
+    }
+  }
+
+  void ExpectBlobsNear(const Blob<Dtype>& expected, const Blob<Dtype>& actual,
+      bool diff) {
+    ASSERT_EQ(expected.count(), actual.count());
+    const Dtype* expected_data =
+        diff ? expected.cpu_diff() : expected.cpu_data();
+    const Dtype* actual_data = diff ? actual.cpu_diff() : actual.cpu_data();
+    for (int i = 0; i < expected.count(); ++i) {
+      const Dtype tolerance =
+          1e-4 * std::max(Dtype(1), static_cast<Dtype>(fabs(expected_data[i])));
+      EXPECT_NEAR(expected_data[i], actual_data[i], tolerance);
+    }
+  }
+
+  int seed_;
+  shared_ptr<Net<Dtype> > ref_net_;
+  shared_ptr<Net<Dtype> > fused_net_;
+};
+
+TYPED_TEST_CASE(FusedElementwiseLayerTest, TestDtypesAndDevices);
+
+TYPED_TEST(FusedElementwiseLayerTest, TestScaleReLUInPlace) {
+  this->RunChain(
+      "layer { "
+      "  name: 'scale' "
+      "  type: 'Scale' "
+      "  bottom: 'data' "
+      "  top: 'data' "
+      "  scale_param { "
+      "    bias_term: true "
+      "    filler { type: 'gaussian' std: 1 } "
+      "    bias_filler { type: 'gaussian' std: 1 } "
+      "  } "
+      "} "
+      "layer { "
+      "  name: 'relu' "
+      "  type: 'ReLU' "
+      "  bottom: 'data' "
+      "  top: 'data' "
+      "  relu_param { negative_slope: 0.1 } "
+      "} ",
+      "data");
+}
+
+TYPED_TEST(FusedElementwiseLayerTest, TestEltwiseSumChain) {
+  this->RunChain(
+      "layer { "
+      "  name: 'sum' "
+      "  type: 'Eltwise' "
+      "  bottom: 'data' "
+      "  bottom: 'data2' "
+      "  top: 'sum' "
+      "  eltwise_param { operation: SUM coeff: 0.5 coeff: -2 } "
+      "} "
+      "layer { "
+      "  name: 'relu' "
+      "  type: 'ReLU' "
+      "  bottom: 'sum' "
+      "  top: 'sum' "
+      "} "
+      "layer { "
+      "  name: 'bias' "
+      "  type: 'Bias' "
+      "  bottom: 'sum' "
+      "  top: 'biased' "
+      "  bias_param { axis: 2 num_axes: 1 "
+      "    filler { type: 'gaussian' std: 1 } } "
+      "} "
+      "layer { "
+      "  name: 'tanh' "
+      "  type: 'TanH' "
+      "  bottom: 'biased' "
+      "  top: 'out' "
+      "} ",
+      "out");
+}
+
+TYPED_TEST(FusedElementwiseLayerTest, TestPowerExpLog) {
+  this->RunChain(
+      "layer { "
+      "  name: 'power' "
+      "  type: 'Power' "
+      "  bottom: 'data' "
+      "  top: 'power' "
+      "  power_param { power: 2 scale: 0.5 shift: 0.1 } "
+      "} "
+      "layer { "
+      "  name: 'exp' "
+      "  type: 'Exp' "
+      "  bottom: 'power' "
+      "  top: 'exp' "
+      "  exp_param { base: 2 scale: -0.3 shift: 0.5 } "
+      "} "
+      "layer { "
+      "  name: 'log' "
+      "  type: 'Log' "
+      "  bottom: 'exp' "
+      "  top: 'log' "
+      "  log_param { base: 10 scale: 2 shift: 1 } "
+      "} ",
+      "log");
+}
+
+TYPED_TEST(FusedElementwiseLayerTest, TestNeuronChain) {
+  this->RunChain(
+      "layer { "
+      "  name: 'sigmoid' "
+      "  type: 'Sigmoid' "
+      "  bottom: 'data' "
+      "  top: 'sigmoid' "
+      "} "
+      "layer { "
+      "  name: 'scale' "
+      "  type: 'Scale' "
+      "  bottom: 'sigmoid' "
+      "  top: 'scale' "
+      "  scale_param { filler { type: 'gaussian' std: 2 } } "
+      "} "
+      "layer { "
+      "  name: 'elu' "
+      "  type: 'ELU' "
+      "  bottom: 'scale' "
+      "  top: 'elu' "
+      "  elu_param { alpha: 0.5 } "
+      "} "
+      "layer { "
+      "  name: 'absval' "
+      "  type: 'AbsVal' "
+      "  bottom: 'elu' "
+      "  top: 'absval' "
+      "} "
+      "layer { "
+      "  name: 'bnll' "
+      "  type: 'BNLL' "
+      "  bottom: 'absval' "
+      "  top: 'bnll' "
+      "} ",
+      "bnll");
+  // The intermediate tops hold the values of the unfused net.
+  const char* intermediates[] = {"sigmoid", "scale", "elu", "absval"};
+  for (int i = 0; i < 4; ++i) {
+    this->ExpectBlobsNear(*this->ref_net_->blob_by_name(intermediates[i]),
+        *this->fused_net_->blob_by_name(intermediates[i]), false);
+  }
+}
+
+TYPED_TEST(FusedElementwiseLayerTest, TestPartialRange) {
+  this->RunChain(
+      "layer { "
+      "  name: 'sigmoid' "
+      "  type: 'Sigmoid' "
+      "  bottom: 'data' "
+      "  top: 'sigmoid' "
+      "} "
+      "layer { "
+      "  name: 'tanh' "
+      "  type: 'TanH' "
+      "  bottom: 'sigmoid' "
+      "  top: 'tanh' "
+      "} ",
+      "tanh");
+  // Running a range that splits the chain falls back to the unfused layers.
+  this->fused_net_->ForwardFromTo(0, 1);
+  this->fused_net_->ForwardFromTo(2, 2);
+  this->ExpectBlobsNear(*this->ref_net_->blob_by_name("sigmoid"),
+      *this->fused_net_->blob_by_name("sigmoid"), false);
+  this->ExpectBlobsNear(*this->ref_net_->blob_by_name("tanh"),
+      *this->fused_net_->blob_by_name("tanh"), false);
+}
+
+}  // namespace caffe
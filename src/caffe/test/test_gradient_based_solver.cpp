@@ -26,7 +26,8 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
  protected:
   GradientBasedSolverTest() :
       seed_(1701), num_(4), channels_(3), height_(10), width_(10),
-      share_(false) {
+      share_(false), regularization_type_("L2"), warmup_iter_(0),
+      warmup_start_lr_(0), snapshot_async_(false) {
         input_file_ = new string(
         CMAKE_SOURCE_DIR "caffe/test/test_data/solver_data_list.txt" CMAKE_EXT);
       }
@@ -42,6 +43,10 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
   // TODO this is brittle and the hdf5 file should be checked instead.
   int num_, channels_, height_, width_;
   bool share_;
+  string regularization_type_;
+  int warmup_iter_;
+  Dtype warmup_start_lr_;
+  bool snapshot_async_;
   Dtype delta_;  // Stability constant for RMSProp, AdaGrad, AdaDelta and Adam
 
   // Test data: check out generate_sample_data.py in the same directory.
@@ -172,15 +177,23 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
        "} ";
     if (weight_decay != 0) {
       proto << "weight_decay: " << weight_decay << " ";
+      proto << "regularization_type: '" << regularization_type_ << "' ";
     }
     if (momentum != 0) {
       proto << "momentum: " << momentum << " ";
     }
+    if (warmup_iter_ > 0) {
+      proto << "warmup_iter: " << warmup_iter_ << " "
+            << "warmup_start_lr: " << warmup_start_lr_ << " ";
+    }
     MakeTempDir(&snapshot_prefix_);
     proto << "snapshot_prefix: '" << snapshot_prefix_ << "/' ";
     if (snapshot) {
       proto << "snapshot: " << num_iters << " ";
     }
+    if (snapshot_async_) {
+      proto << "snapshot_async: true ";
+    }
     Caffe::set_random_seed(this->seed_);
     this->InitSolverFromProtoString(proto.str());
     if (from_snapshot != NULL) {
@@ -221,11 +234,17 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
   // using the analytical formula for the least squares gradient.
   // updated_params will store the updated weight and bias results,
   // using the blobs' diffs to hold the update values themselves.
-  void ComputeLeastSquaresUpdate(const Dtype learning_rate,
+  void ComputeLeastSquaresUpdate(const Dtype base_learning_rate,
       const Dtype weight_decay, const Dtype momentum, const int num_iters,
       vector<shared_ptr<Blob<Dtype> > >* updated_params) {
     const int N = num_;
     const int D = channels_ * height_ * width_;
+    // The update is computed at iteration num_iters - 1.
+    Dtype learning_rate = base_learning_rate;
+    if (num_iters - 1 < warmup_iter_) {
+      learning_rate = warmup_start_lr_ + (base_learning_rate -
+          warmup_start_lr_) * Dtype(num_iters - 1) / Dtype(warmup_iter_);
+    }
 
     // Run a forward pass, and manually compute the update values from the
     // result.
@@ -283,12 +302,19 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
       // Scale the gradient over the N samples.
       grad /= N;
       // Add the weight decay to the gradient.
-      grad += weight_decay *
-          ((i == D) ? bias.cpu_data()[0] : weights.cpu_data()[i]);
+      const Dtype param_value =
+          (i == D) ? bias.cpu_data()[0] : weights.cpu_data()[i];
+      if (regularization_type_ == "L1") {
+        grad += weight_decay *
+            ((Dtype(0) < param_value) - (param_value < Dtype(0)));
+      } else {
+        grad += weight_decay * param_value;
+      }
       // Finally, compute update.
       const vector<shared_ptr<Blob<Dtype> > >& history = solver_->history();
       if (solver_->type() != string("AdaDelta")
-          && solver_->type() != string("Adam")) {
+          && solver_->type() != string("Adam")
+          && solver_->type() != string("LAMB")) {
         ASSERT_EQ(2, history.size());  // 1 blob for weights, 1 for bias
       } else {
         ASSERT_EQ(4, history.size());  // additional blobs for update history
@@ -332,6 +358,26 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
             std::sqrt(Dtype(1) - pow(momentum2, num_iters)) /
             (Dtype(1.) - pow(momentum, num_iters));
         update_value = alpha_t * val_m / (std::sqrt(val_v) + delta_);
+      } else if (solver_->type() == string("LARS")) {
+        // Keep the regularized gradient; the trust ratio needs the norms
+        // over the whole blob and is applied below.
+        update_value = grad;
+      } else if (solver_->type() == string("LAMB")) {
+        // Weight decay is decoupled from the moments.
+        const Dtype g = grad - weight_decay * param_value;
+        const Dtype momentum2 = 0.999;
+        const Dtype m = history_value;
+        const Dtype v = (i == D) ?
+            history[1 + num_param_blobs]->cpu_data()[0] :
+            history[0 + num_param_blobs]->cpu_data()[i];
+        const Dtype val_m = (1 - momentum) * g + momentum * m;
+        const Dtype val_v = (1 - momentum2) * g * g + momentum2 * v;
+        const Dtype correction =
+            std::sqrt(Dtype(1) - pow(momentum2, num_iters)) /
+            (Dtype(1.) - pow(momentum, num_iters));
+        // Unscaled update; the trust ratio is applied below.
+        update_value = correction * val_m / (std::sqrt(val_v) + delta_)
+            + weight_decay * param_value;
       } else {
         LOG(FATAL) << "Unknown solver type: " << solver_->type();
       }
@@ -344,6 +390,41 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
             weights.cpu_data()[i] - update_value;
       }
     }
+    if (solver_->type() == string("LARS")
+        || solver_->type() == string("LAMB")) {
+      ApplyTrustRatio(weights, *solver_->history()[0], learning_rate,
+          momentum, &updated_weights);
+      ApplyTrustRatio(bias, *solver_->history()[1], learning_rate,
+          momentum, &updated_bias);
+    }
+  }
+
+  // Scales the update of one param blob, held unscaled in the diff of
+  // updated, by the LARS or LAMB trust ratio.
+  void ApplyTrustRatio(const Blob<Dtype>& param, const Blob<Dtype>& history,
+      const Dtype learning_rate, const Dtype momentum,
+      Blob<Dtype>* updated) {
+    Dtype sumsq_data = 0;
+    Dtype sumsq_update = 0;
+    for (int i = 0; i < param.count(); ++i) {
+      sumsq_data += param.cpu_data()[i] * param.cpu_data()[i];
+      sumsq_update += updated->cpu_diff()[i] * updated->cpu_diff()[i];
+    }
+    Dtype trust = 1;
+    if (sumsq_data > 0 && sumsq_update > 0) {
+      trust = std::sqrt(sumsq_data / sumsq_update);
+      if (solver_->type() == string("LARS")) {
+        trust *= solver_->param().lars_eta();
+      }
+    }
+    for (int i = 0; i < param.count(); ++i) {
+      Dtype update_value = learning_rate * trust * updated->cpu_diff()[i];
+      if (solver_->type() == string("LARS")) {
+        update_value += momentum * history.cpu_data()[i];
+      }
+      updated->mutable_cpu_diff()[i] = update_value;
+      updated->mutable_cpu_data()[i] = param.cpu_data()[i] - update_value;
+    }
   }
 
   void CheckLeastSquaresUpdate(
@@ -592,6 +673,31 @@ TYPED_TEST(SGDSolverTest, TestLeastSquaresUpdateWithWeightDecay) {
   }
 }
 
+TYPED_TEST(SGDSolverTest, TestLeastSquaresUpdateWithL1WeightDecay) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  this->regularization_type_ = "L1";
+  for (int i = 0; i <= kNumIters; ++i) {
+    this->TestLeastSquaresUpdate(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
+TYPED_TEST(SGDSolverTest, TestLeastSquaresUpdateWithWarmup) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  this->warmup_iter_ = 3;
+  this->warmup_start_lr_ = 0.001;
+  for (int i = 0; i <= kNumIters; ++i) {
+    this->TestLeastSquaresUpdate(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
 TYPED_TEST(SGDSolverTest, TestLeastSquaresUpdateWithWeightDecayMultiIter) {
   typedef typename TypeParam::Dtype Dtype;
   const Dtype kLearningRate = 0.01;
@@ -682,6 +788,18 @@ TYPED_TEST(SGDSolverTest, TestSnapshot) {
   }
 }
 
+TYPED_TEST(SGDSolverTest, TestSnapshotAsync) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  this->snapshot_async_ = true;
+  for (int i = 1; i <= kNumIters; ++i) {
+    this->TestSnapshot(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
 TYPED_TEST(SGDSolverTest, TestSnapshotShare) {
   typedef typename TypeParam::Dtype Dtype;
   const Dtype kLearningRate = 0.01;
@@ -1262,4 +1380,126 @@ TYPED_TEST(RMSPropSolverTest, TestSnapshotShare) {
   }
 }
 
+template <typename TypeParam>
+class LARSSolverTest : public GradientBasedSolverTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  virtual void InitSolver(const SolverParameter& param) {
+    SolverParameter new_param = param;
+    new_param.set_lars_eta(0.1);
+    this->solver_.reset(new LARSSolver<Dtype>(new_param));
+  }
+};
+
+TYPED_TEST_CASE(LARSSolverTest, TestDtypesAndDevices);
+
+TYPED_TEST(LARSSolverTest, TestLARSLeastSquaresUpdate) {
+  this->TestLeastSquaresUpdate();
+}
+
+TYPED_TEST(LARSSolverTest, TestLARSLeastSquaresUpdateWithEverything) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.1;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  for (int i = 0; i <= kNumIters; ++i) {
+    this->TestLeastSquaresUpdate(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
+TYPED_TEST(LARSSolverTest, TestLARSLeastSquaresUpdateWithWarmup) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.1;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  this->warmup_iter_ = 3;
+  this->warmup_start_lr_ = 0.01;
+  for (int i = 0; i <= kNumIters; ++i) {
+    this->TestLeastSquaresUpdate(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
+TYPED_TEST(LARSSolverTest, TestLeastSquaresUpdateWithEverythingAccum) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.1;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  const int kIterSize = 2;
+  this->CheckAccumulation(kLearningRate, kWeightDecay, kMomentum, kNumIters,
+      kIterSize);
+}
+
+TYPED_TEST(LARSSolverTest, TestSnapshot) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.1;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  for (int i = 1; i <= kNumIters; ++i) {
+    this->TestSnapshot(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
+template <typename TypeParam>
+class LAMBSolverTest : public GradientBasedSolverTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  virtual void InitSolver(const SolverParameter& param) {
+    SolverParameter new_param = param;
+    const Dtype momentum = 0.9;
+    new_param.set_momentum(momentum);
+    const Dtype momentum2 = 0.999;
+    new_param.set_momentum2(momentum2);
+    this->solver_.reset(new LAMBSolver<Dtype>(new_param));
+  }
+};
+
+TYPED_TEST_CASE(LAMBSolverTest, TestDtypesAndDevices);
+
+TYPED_TEST(LAMBSolverTest, TestLAMBLeastSquaresUpdate) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0;
+  const Dtype kMomentum = 0.9;
+  this->TestLeastSquaresUpdate(kLearningRate, kWeightDecay, kMomentum);
+}
+
+TYPED_TEST(LAMBSolverTest, TestLAMBLeastSquaresUpdateWithEverything) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  for (int i = 0; i <= kNumIters; ++i) {
+    this->TestLeastSquaresUpdate(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
+TYPED_TEST(LAMBSolverTest, TestLeastSquaresUpdateWithEverythingAccum) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  const int kIterSize = 2;
+  this->CheckAccumulation(kLearningRate, kWeightDecay, kMomentum, kNumIters,
+      kIterSize);
+}
+
+TYPED_TEST(LAMBSolverTest, TestSnapshot) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  for (int i = 1; i <= kNumIters; ++i) {
+    this->TestSnapshot(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
 }  // namespace caffe
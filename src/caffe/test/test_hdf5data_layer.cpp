@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -42,6 +43,88 @@ class HDF5DataLayerTest : public MultiDeviceTest<TypeParam> {
     delete filename;
   }
 
+  // Reads the rows in order, by chunks of chunk_rows rows if not 0.
+  void TestRead(int chunk_rows) {
+    // Create LayerParameter with the known parameters.
+    // The data file we are reading has 10 rows and 8 columns,
+    // with values from 0 to 10*8 reshaped in row-major order.
+    LayerParameter param;
+    param.add_top("data");
+    param.add_top("label");
+    param.add_top("label2");
+
+    HDF5DataParameter* hdf5_data_param = param.mutable_hdf5_data_param();
+    int batch_size = 5;
+    hdf5_data_param->set_batch_size(batch_size);
+    hdf5_data_param->set_source(*filename);
+    hdf5_data_param->set_chunk_rows(chunk_rows);
+    int num_cols = 8;
+    int height = 6;
+    int width = 5;
+
+    // Test that the layer setup got the correct parameters.
+    HDF5DataLayer<Dtype> layer(param);
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+    EXPECT_EQ(blob_top_data_->num(), batch_size);
+    EXPECT_EQ(blob_top_data_->channels(), num_cols);
+    EXPECT_EQ(blob_top_data_->height(), height);
+    EXPECT_EQ(blob_top_data_->width(), width);
+
+    EXPECT_EQ(blob_top_label_->num_axes(), 2);
+    EXPECT_EQ(blob_top_label_->shape(0), batch_size);
+    EXPECT_EQ(blob_top_label_->shape(1), 1);
+
+    EXPECT_EQ(blob_top_label2_->num_axes(), 2);
+    EXPECT_EQ(blob_top_label2_->shape(0), batch_size);
+    EXPECT_EQ(blob_top_label2_->shape(1), 1);
+
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+
+    // Go through the data 10 times (5 batches).
+    const int data_size = num_cols * height * width;
+    for (int iter = 0; iter < 10; ++iter) {
+      layer.Forward(blob_bottom_vec_, blob_top_vec_);
+
+      // On even iterations, we're reading the first half of the data.
+      // On odd iterations, we're reading the second half of the data.
+      // NB: label is 1-indexed
+      int label_offset = 1 + ((iter % 2 == 0) ? 0 : batch_size);
+      int label2_offset = 1 + label_offset;
+      int data_offset = (iter % 2 == 0) ? 0 : batch_size * data_size;
+
+      // Every two iterations we are reading the second file,
+      // which has the same labels, but data is offset by total data size,
+      // which is 2400 (see generate_sample_data).
+      int file_offset = (iter % 4 < 2) ? 0 : 2400;
+
+      for (int i = 0; i < batch_size; ++i) {
+        EXPECT_EQ(
+          label_offset + i,
+          blob_top_label_->cpu_data()[i]);
+        EXPECT_EQ(
+          label2_offset + i,
+          blob_top_label2_->cpu_data()[i]);
+      }
+      for (int i = 0; i < batch_size; ++i) {
+        for (int j = 0; j < num_cols; ++j) {
+          for (int h = 0; h < height; ++h) {
+            for (int w = 0; w < width; ++w) {
+              int idx = (
+                i * num_cols * height * width +
+                j * height * width +
+                h * width + w);
+              EXPECT_EQ(
+                file_offset + data_offset + idx,
+                blob_top_data_->cpu_data()[idx])
+                << "debug: i " << i << " j " << j
+                << " iter " << iter;
+            }
+          }
+        }
+      }
+    }
+  }
+
   string* filename;
   Blob<Dtype>* const blob_top_data_;
   Blob<Dtype>* const blob_top_label_;
@@ -53,83 +136,60 @@ class HDF5DataLayerTest : public MultiDeviceTest<TypeParam> {
 TYPED_TEST_CASE(HDF5DataLayerTest, TestDtypesAndDevices);
 
 TYPED_TEST(HDF5DataLayerTest, TestRead) {
+  this->TestRead(0);
+}
+
+TYPED_TEST(HDF5DataLayerTest, TestReadChunks) {
+  // Chunks do not divide the 10 rows of a file
+  this->TestRead(3);
+}
+
+TYPED_TEST(HDF5DataLayerTest, TestReadChunksShuffled) {
   typedef typename TypeParam::Dtype Dtype;
-  // Create LayerParameter with the known parameters.
-  // The data file we are reading has 10 rows and 8 columns,
-  // with values from 0 to 10*8 reshaped in row-major order.
   LayerParameter param;
   param.add_top("data");
   param.add_top("label");
   param.add_top("label2");
-
   HDF5DataParameter* hdf5_data_param = param.mutable_hdf5_data_param();
-  int batch_size = 5;
+  const int batch_size = 5;
   hdf5_data_param->set_batch_size(batch_size);
   hdf5_data_param->set_source(*(this->filename));
-  int num_cols = 8;
-  int height = 6;
-  int width = 5;
-
-  // Test that the layer setup got the correct parameters.
+  hdf5_data_param->set_chunk_rows(4);
+  hdf5_data_param->set_shuffle(true);
   HDF5DataLayer<Dtype> layer(param);
-  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
-  EXPECT_EQ(this->blob_top_data_->num(), batch_size);
-  EXPECT_EQ(this->blob_top_data_->channels(), num_cols);
-  EXPECT_EQ(this->blob_top_data_->height(), height);
-  EXPECT_EQ(this->blob_top_data_->width(), width);
-
-  EXPECT_EQ(this->blob_top_label_->num_axes(), 2);
-  EXPECT_EQ(this->blob_top_label_->shape(0), batch_size);
-  EXPECT_EQ(this->blob_top_label_->shape(1), 1);
-
-  EXPECT_EQ(this->blob_top_label2_->num_axes(), 2);
-  EXPECT_EQ(this->blob_top_label2_->shape(0), batch_size);
-  EXPECT_EQ(this->blob_top_label2_->shape(1), 1);
-
   layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
 
-  // Go through the data 10 times (5 batches).
-  const int data_size = num_cols * height * width;
-  for (int iter = 0; iter < 10; ++iter) {
-    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
-
-    // On even iterations, we're reading the first half of the data.
-    // On odd iterations, we're reading the second half of the data.
-    // NB: label is 1-indexed
-    int label_offset = 1 + ((iter % 2 == 0) ? 0 : batch_size);
-    int label2_offset = 1 + label_offset;
-    int data_offset = (iter % 2 == 0) ? 0 : batch_size * data_size;
-
-    // Every two iterations we are reading the second file,
-    // which has the same labels, but data is offset by total data size,
-    // which is 2400 (see generate_sample_data).
-    int file_offset = (iter % 4 < 2) ? 0 : 2400;
-
-    for (int i = 0; i < batch_size; ++i) {
-      EXPECT_EQ(
-        label_offset + i,
-        this->blob_top_label_->cpu_data()[i]);
-      EXPECT_EQ(
-        label2_offset + i,
-        this->blob_top_label2_->cpu_data()[i]);
-    }
-    for (int i = 0; i < batch_size; ++i) {
-      for (int j = 0; j < num_cols; ++j) {
-        for (int h = 0; h < height; ++h) {
-          for (int w = 0; w < width; ++w) {
-            int idx = (
-              i * num_cols * height * width +
-              j * height * width +
-              h * width + w);
-            EXPECT_EQ(
-              file_offset + data_offset + idx,
-              this->blob_top_data_->cpu_data()[idx])
-              << "debug: i " << i << " j " << j
-              << " iter " << iter;
-          }
-        }
+  // Each epoch outputs the 10 rows of both files once. Rows are identified
+  // by their first data value, the second file being offset by 2400.
+  const int data_size = 8 * 6 * 5;
+  const int num_rows = 20;
+  vector<int> first_epoch;
+  for (int epoch = 0; epoch < 3; ++epoch) {
+    vector<int> rows;
+    for (int iter = 0; iter < num_rows / batch_size; ++iter) {
+      layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+      for (int i = 0; i < batch_size; ++i) {
+        const int row = this->blob_top_data_->cpu_data()[i * data_size] /
+            data_size;
+        EXPECT_EQ(row % 10 + 1, this->blob_top_label_->cpu_data()[i]);
+        EXPECT_EQ(row % 10 + 2, this->blob_top_label2_->cpu_data()[i]);
+        rows.push_back(row);
       }
     }
+    vector<int> sorted(rows);
+    std::sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < num_rows; ++i) {
+      EXPECT_EQ(i, sorted[i]);
+    }
+    // Rows of a file are not interleaved with the other file
+    for (int i = 0; i < num_rows; ++i) {
+      EXPECT_EQ(rows[i] / 10, rows[i / 10 * 10] / 10);
+    }
+    if (epoch == 0) {
+      first_epoch = rows;
+    } else {
+      EXPECT_FALSE(rows == first_epoch);
+    }
   }
 }
 
@@ -6,6 +6,7 @@
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
 #include "caffe/layers/im2col_layer.hpp"
+#include "caffe/util/im2col.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
 #include "caffe/test/test_gradient_check_util.hpp"
@@ -143,6 +144,34 @@ TYPED_TEST(Im2colLayerTest, TestDilatedGradientForceND) {
                                   this->blob_top_vec_);
 }
 
+TYPED_TEST(Im2colLayerTest, TestColStride) {
+  typedef typename TypeParam::Dtype Dtype;
+  const int channels = 3, height = 6, width = 5;
+  const int kernel = 3, pad = 1, stride = 2;
+  const int num = this->blob_bottom_->num();
+  const int spatial = 3 * 3;
+  const int rows = channels * kernel * kernel;
+  // The columns of all the images side by side, and of each one alone.
+  Blob<Dtype> side_by_side(1, 1, rows, num * spatial);
+  Blob<Dtype> col(1, 1, rows, spatial);
+  for (int n = 0; n < num; ++n) {
+    im2col_cpu(this->blob_bottom_->cpu_data() + this->blob_bottom_->offset(n),
+        channels, height, width, kernel, kernel, pad, pad, stride, stride, 1,
+        1, side_by_side.mutable_cpu_data() + n * spatial, num * spatial);
+  }
+  for (int n = 0; n < num; ++n) {
+    im2col_cpu(this->blob_bottom_->cpu_data() + this->blob_bottom_->offset(n),
+        channels, height, width, kernel, kernel, pad, pad, stride, stride, 1,
+        1, col.mutable_cpu_data());
+    for (int r = 0; r < rows; ++r) {
+      for (int i = 0; i < spatial; ++i) {
+        EXPECT_EQ(col.cpu_data()[r * spatial + i],
+            side_by_side.cpu_data()[r * num * spatial + n * spatial + i]);
+      }
+    }
+  }
+}
+
 TYPED_TEST(Im2colLayerTest, TestRect) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
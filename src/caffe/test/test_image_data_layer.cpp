@@ -146,6 +146,39 @@ TYPED_TEST(ImageDataLayerTest, TestRead) {
   }
 }
 
+TYPED_TEST(ImageDataLayerTest, TestReadAheadCached) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter param;
+  ImageDataParameter* image_data_param = param.mutable_image_data_param();
+  image_data_param->set_batch_size(3);
+  image_data_param->set_source(this->filename_.c_str());
+  image_data_param->set_shuffle(false);
+  image_data_param->set_reader_threads(2);
+  image_data_param->set_readahead(2);
+  image_data_param->set_image_cache_size(1);
+  ImageDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(this->blob_top_data_->num(), 3);
+  EXPECT_EQ(this->blob_top_data_->height(), 360);
+  EXPECT_EQ(this->blob_top_data_->width(), 480);
+  // Batches span the end of the list, all items are the same cached image
+  Blob<Dtype> first;
+  for (int iter = 0; iter < 4; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ((iter * 3 + i) % 5, this->blob_top_label_->cpu_data()[i]);
+    }
+    if (iter == 0) {
+      first.CopyFrom(*this->blob_top_data_, false, true);
+    }
+    const int size = first.count() / 3;
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(0, memcmp(first.cpu_data(),
+          this->blob_top_data_->cpu_data() + i * size, size * sizeof(Dtype)));
+    }
+  }
+}
+
 TYPED_TEST(ImageDataLayerTest, TestResize) {
   typedef typename TypeParam::Dtype Dtype;
   std::string file_name = std::string(EXAMPLES_SOURCE_DIR) +
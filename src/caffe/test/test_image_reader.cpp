@@ -0,0 +1,111 @@
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/format.hpp"
+#include "caffe/util/image_reader.hpp"
+#include "caffe/util/io.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class AsyncFileReaderTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    MakeTempDir(&folder_);
+    // Sizes around the O_DIRECT alignment
+    const size_t kAlignment = AsyncFileReader::kAlignment;
+    const size_t sizes[] = {0, 1, 1000, kAlignment, kAlignment + 1,
+        5 * kAlignment - 3, 1 << 20};
+    for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+      string contents(sizes[i], ' ');
+      for (size_t j = 0; j < contents.size(); ++j) {
+        contents[j] = static_cast<char>((i * 131 + j * 7) % 256);
+      }
+      const string path = folder_ + "/file_" + format_int(i);
+      std::ofstream out(path.c_str(), std::ios::binary);
+      out.write(contents.data(), contents.size());
+      paths_.push_back(path);
+      contents_.push_back(contents);
+    }
+  }
+
+  void TestRead(bool direct_io) {
+    AsyncFileReader reader(3, direct_io);
+    vector<shared_ptr<FileRead> > reads;
+    for (int epoch = 0; epoch < 2; ++epoch) {
+      for (int i = 0; i < paths_.size(); ++i) {
+        reads.push_back(reader.Read(paths_[i]));
+      }
+    }
+    reads.push_back(reader.Read(folder_ + "/missing"));
+    for (int i = 0; i < reads.size() - 1; ++i) {
+      EXPECT_EQ(reads[i]->path(), paths_[i % paths_.size()]);
+      ASSERT_TRUE(reads[i]->Wait());
+      EXPECT_TRUE(reads[i]->contents() == contents_[i % paths_.size()])
+          << "File " << reads[i]->path();
+      // Waiting again returns at once
+      EXPECT_TRUE(reads[i]->Wait());
+    }
+    EXPECT_FALSE(reads.back()->Wait());
+  }
+
+  string folder_;
+  vector<string> paths_;
+  vector<string> contents_;
+};
+
+TEST_F(AsyncFileReaderTest, TestRead) {
+  TestRead(false);
+}
+
+TEST_F(AsyncFileReaderTest, TestReadDirect) {
+  TestRead(true);
+}
+
+TEST_F(AsyncFileReaderTest, TestDestroyWithPendingReads) {
+  vector<shared_ptr<FileRead> > reads;
+  {
+    AsyncFileReader reader(2, false);
+    for (int i = 0; i < 100; ++i) {
+      reads.push_back(reader.Read(paths_[i % paths_.size()]));
+    }
+  }
+  EXPECT_EQ(reads.size(), 100);
+}
+
+#ifdef USE_OPENCV
+TEST(ImageCacheTest, TestEvictLeastRecentlyUsed) {
+  ImageCache cache(2);
+  cv::Mat a(2, 3, CV_8UC3, cv::Scalar(1, 2, 3));
+  cv::Mat b(4, 5, CV_8UC1, cv::Scalar(4));
+  cv::Mat c(1, 1, CV_8UC1, cv::Scalar(5));
+  cv::Mat image;
+  EXPECT_FALSE(cache.Get("a", &image));
+  cache.Put("a", a);
+  cache.Put("b", b);
+  EXPECT_TRUE(cache.Get("a", &image));
+  EXPECT_EQ(image.data, a.data);
+  // b is now the least recently used
+  cache.Put("c", c);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_FALSE(cache.Get("b", &image));
+  EXPECT_TRUE(cache.Get("a", &image));
+  EXPECT_TRUE(cache.Get("c", &image));
+  EXPECT_EQ(image.data, c.data);
+}
+
+TEST(ImageCacheTest, TestDisabled) {
+  ImageCache cache(0);
+  cv::Mat image(2, 2, CV_8UC1, cv::Scalar(1));
+  cache.Put("a", image);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_FALSE(cache.Get("a", &image));
+}
+#endif  // USE_OPENCV
+
+}  // namespace caffe
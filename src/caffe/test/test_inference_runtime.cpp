@@ -0,0 +1,186 @@
+#include <boost/thread.hpp>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/inference_runtime.hpp"
+#include "caffe/layer_factory.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/cpu_info.hpp"
+#include "caffe/util/io.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+// Outputs the affinity of the thread running it, one value per CPU, followed
+// by the size of the OpenMP teams that thread starts.
+template <typename Dtype>
+class AffinityProbeLayer : public Layer<Dtype> {
+ public:
+  explicit AffinityProbeLayer(const LayerParameter& param)
+      : Layer<Dtype>(param) {}
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+    top[0]->Reshape(1, 1, 1, CPU_SETSIZE + 1);
+  }
+  virtual inline const char* type() const { return "AffinityProbe"; }
+
+ protected:
+  virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+    cpu_set_t cpu_set;
+    CHECK_EQ(sched_getaffinity(0, sizeof(cpu_set), &cpu_set), 0);
+    Dtype* top_data = top[0]->mutable_cpu_data();
+    for (int i = 0; i < CPU_SETSIZE; ++i) {
+      top_data[i] = CPU_ISSET(i, &cpu_set) ? 1 : 0;
+    }
+#ifdef _OPENMP
+    top_data[CPU_SETSIZE] = omp_get_max_threads();
+#else
+    top_data[CPU_SETSIZE] = 1;
+#endif
+  }
+  virtual void Backward_cpu(const vector<Blob<Dtype>*>& top,
+      const vector<bool>& propagate_down,
+      const vector<Blob<Dtype>*>& bottom) {}
+};
+
+REGISTER_LAYER_CLASS(AffinityProbe);
+
+template <typename Dtype>
+class InferenceRuntimeTest : public ::testing::Test {
+ protected:
+  InferenceRuntimeTest() {
+    const string proto =
+        "name: 'TestNetwork' "
+        "layer { "
+        "  name: 'data' "
+        "  type: 'Input' "
+        "  top: 'data' "
+        "  input_param { shape { dim: 2 dim: 3 dim: 4 dim: 5 } } "
+        "} "
+        "layer { "
+        "  name: 'innerproduct' "
+        "  type: 'InnerProduct' "
+        "  inner_product_param { "
+        "    num_output: 10 "
+        "    weight_filler { type: 'gaussian' std: 0.1 } "
+        "    bias_filler { type: 'gaussian' std: 0.1 } "
+        "  } "
+        "  bottom: 'data' "
+        "  top: 'innerproduct' "
+        "} "
+        "layer { "
+        "  name: 'relu' "
+        "  type: 'ReLU' "
+        "  bottom: 'innerproduct' "
+        "  top: 'innerproduct' "
+        "} ";
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param_));
+    // Reference net, whose weights the runtime loads.
+    Caffe::set_random_seed(1701);
+    net_.reset(new Net<Dtype>(param_));
+    NetParameter trained;
+    net_->ToProto(&trained);
+    MakeTempFilename(&weights_file_);
+    WriteProtoToBinaryFile(trained, weights_file_);
+  }
+
+ public:
+  // Runs num_requests random inputs through the runtime and compares the
+  // outputs with the reference net.
+  static void BindAndGet(const cpu_set_t* set, cpu_set_t* affinity) {
+#ifdef _OPENMP
+    cpu::OpenMpManager::bindCurrentThreadToCpuSet(set);
+#endif
+    CHECK_EQ(sched_getaffinity(0, sizeof(*affinity), affinity), 0);
+  }
+
+  void RunRequests(InferenceRuntime<Dtype>* runtime, int num_requests) {
+    for (int i = 0; i < num_requests; ++i) {
+      Blob<Dtype> input(i % 3 + 1, 3, 4, 5);
+      FillerParameter filler_param;
+      GaussianFiller<Dtype> filler(filler_param);
+      filler.Fill(&input);
+      Blob<Dtype> output;
+      vector<Blob<Dtype>*> input_vec(1, &input);
+      vector<Blob<Dtype>*> output_vec(1, &output);
+      runtime->Forward(input_vec, output_vec);
+
+      boost::mutex::scoped_lock lock(mutex_);
+      net_->input_blobs()[0]->CopyFrom(input, false, true);
+      const Blob<Dtype>* expected = net_->Forward()[0];
+      ASSERT_EQ(expected->shape(), output.shape());
+      for (int j = 0; j < output.count(); ++j) {
+        EXPECT_NEAR(expected->cpu_data()[j], output.cpu_data()[j], 1e-5);
+      }
+    }
+  }
+
+ protected:
+  NetParameter param_;
+  shared_ptr<Net<Dtype> > net_;
+  string weights_file_;
+  boost::mutex mutex_;
+};
+
+TYPED_TEST_CASE(InferenceRuntimeTest, TestDtypes);
+
+TYPED_TEST(InferenceRuntimeTest, TestForward) {
+  InferenceRuntime<TypeParam> runtime(this->param_, this->weights_file_, 1);
+  EXPECT_EQ(runtime.num_replicas(), 1);
+  this->RunRequests(&runtime, 5);
+}
+
+TYPED_TEST(InferenceRuntimeTest, TestConcurrentReplicas) {
+  const int kNumReplicas = 3;
+  InferenceRuntime<TypeParam> runtime(this->param_, this->weights_file_,
+      kNumReplicas);
+  EXPECT_EQ(runtime.num_replicas(), kNumReplicas);
+  boost::thread_group clients;
+  for (int i = 0; i < kNumReplicas; ++i) {
+    clients.create_thread(boost::bind(
+        &InferenceRuntimeTest<TypeParam>::RunRequests, this, &runtime, 10));
+  }
+  clients.join_all();
+}
+
+TYPED_TEST(InferenceRuntimeTest, TestReplicaAffinity) {
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(
+      "layer { name: 'probe' type: 'AffinityProbe' top: 'probe' } ",
+      &param));
+  InferenceRuntime<TypeParam> runtime(param, "", 1);
+  const cpu_set_t& replica_set = runtime.replica_cpu_set(0);
+  // The affinity a thread gets from binding to the replica cores, which
+  // leaves it unchanged when thread binding is not allowed.
+  cpu_set_t expected_set;
+  boost::thread bound_thread(&InferenceRuntimeTest<TypeParam>::BindAndGet,
+      &replica_set, &expected_set);
+  bound_thread.join();
+  Blob<TypeParam> output;
+  vector<Blob<TypeParam>*> input_vec;
+  vector<Blob<TypeParam>*> output_vec(1, &output);
+  runtime.Forward(input_vec, output_vec);
+  ASSERT_EQ(output.count(), CPU_SETSIZE + 1);
+  for (int i = 0; i < CPU_SETSIZE; ++i) {
+    const TypeParam expected = CPU_ISSET(i, &expected_set) ? 1 : 0;
+    EXPECT_EQ(expected, output.cpu_data()[i]) << "CPU " << i;
+  }
+#ifdef _OPENMP
+  EXPECT_EQ(CPU_COUNT(&replica_set), output.cpu_data()[CPU_SETSIZE]);
+#endif
+}
+
+}  // namespace caffe
@@ -0,0 +1,153 @@
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/layerwise_updater.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class LayerwiseUpdaterTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  // Trains a small net, in which ip1 and ip2 share their weights, and
+  // returns the solver.
+  shared_ptr<Solver<Dtype> > Train(const string& type, bool layer_wise,
+      const string& lr_policy) {
+    const string proto =
+        "max_iter: 5 "
+        "base_lr: 0.01 "
+        "lr_policy: '" + lr_policy + "' "
+        "gamma: 0.5 "
+        "stepvalue: 2 "
+        "stepvalue: 4 "
+        "momentum: 0.9 "
+        "weight_decay: 0.001 "
+        "snapshot_after_train: false "
+        "net_param { "
+        "  name: 'TestNetwork' "
+        "  layer { "
+        "    name: 'data' "
+        "    type: 'DummyData' "
+        "    dummy_data_param { "
+        "      shape { dim: 4 dim: 6 } "
+        "      shape { dim: 4 dim: 3 } "
+        "      data_filler { type: 'gaussian' std: 1.0 } "
+        "      data_filler { type: 'gaussian' std: 1.0 } "
+        "    } "
+        "    top: 'data' "
+        "    top: 'targets' "
+        "  } "
+        "  layer { "
+        "    name: 'ip1' "
+        "    type: 'InnerProduct' "
+        "    param { name: 'shared' } "
+        "    inner_product_param { "
+        "      num_output: 6 "
+        "      bias_term: false "
+        "      weight_filler { type: 'gaussian' std: 0.5 } "
+        "    } "
+        "    bottom: 'data' "
+        "    top: 'ip1' "
+        "  } "
+        "  layer { "
+        "    name: 'relu' "
+        "    type: 'ReLU' "
+        "    bottom: 'ip1' "
+        "    top: 'ip1' "
+        "  } "
+        "  layer { "
+        "    name: 'ip2' "
+        "    type: 'InnerProduct' "
+        "    param { name: 'shared' } "
+        "    inner_product_param { "
+        "      num_output: 6 "
+        "      bias_term: false "
+        "    } "
+        "    bottom: 'ip1' "
+        "    top: 'ip2' "
+        "  } "
+        "  layer { "
+        "    name: 'ip3' "
+        "    type: 'InnerProduct' "
+        "    inner_product_param { "
+        "      num_output: 3 "
+        "      weight_filler { type: 'gaussian' std: 0.5 } "
+        "      bias_filler { type: 'gaussian' std: 0.5 } "
+        "    } "
+        "    bottom: 'ip2' "
+        "    top: 'ip3' "
+        "  } "
+        "  layer { "
+        "    name: 'loss' "
+        "    type: 'EuclideanLoss' "
+        "    bottom: 'ip3' "
+        "    bottom: 'targets' "
+        "  } "
+        "} ";
+    SolverParameter param;
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+    param.set_type(type);
+    param.set_layer_wise_update(layer_wise);
+    Caffe::set_random_seed(1701);
+    shared_ptr<Solver<Dtype> > solver(
+        SolverRegistry<Dtype>::CreateSolver(param));
+    if (layer_wise) {
+      shared_ptr<MultiSolver<Dtype> > multi_solver(
+          new MultiSolver<Dtype>(solver));
+      LayerwiseUpdater<Dtype> updater(multi_solver);
+      // Starting the update threads draws from the random generator.
+      Caffe::set_random_seed(1702);
+      multi_solver->Solve();
+    } else {
+      Caffe::set_random_seed(1702);
+      solver->Solve();
+    }
+    return solver;
+  }
+
+  void CheckSameParams(const string& type,
+      const string& lr_policy = "fixed") {
+    shared_ptr<Solver<Dtype> > expected = Train(type, false, lr_policy);
+    shared_ptr<Solver<Dtype> > actual = Train(type, true, lr_policy);
+    const vector<Blob<Dtype>*>& expected_params =
+        expected->net()->learnable_params();
+    const vector<Blob<Dtype>*>& actual_params =
+        actual->net()->learnable_params();
+    ASSERT_EQ(expected_params.size(), actual_params.size());
+    for (int i = 0; i < expected_params.size(); ++i) {
+      ASSERT_EQ(expected_params[i]->count(), actual_params[i]->count());
+      for (int j = 0; j < expected_params[i]->count(); ++j) {
+        EXPECT_NEAR(expected_params[i]->cpu_data()[j],
+            actual_params[i]->cpu_data()[j], 1e-5)
+            << "param " << i << " differed at dim " << j;
+      }
+    }
+  }
+};
+
+typedef ::testing::Types<CPUDevice<float>, CPUDevice<double> > TestDtypesCPU;
+TYPED_TEST_CASE(LayerwiseUpdaterTest, TestDtypesCPU);
+
+TYPED_TEST(LayerwiseUpdaterTest, TestSGDMatchesSerialUpdate) {
+  this->CheckSameParams("SGD");
+}
+
+TYPED_TEST(LayerwiseUpdaterTest, TestAdamMatchesSerialUpdate) {
+  this->CheckSameParams("Adam");
+}
+
+TYPED_TEST(LayerwiseUpdaterTest, TestMultistepMatchesSerialUpdate) {
+  // The update threads all step the learning rate schedule.
+  this->CheckSameParams("SGD", "multistep");
+}
+
+}  // namespace caffe
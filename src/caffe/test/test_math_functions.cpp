@@ -1,6 +1,8 @@
 #include <stdint.h>  // for uint32_t & uint64_t
 #include <time.h>
 #include <cmath>  // for std::fabs
+#include <limits>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -66,6 +68,19 @@ TYPED_TEST(CPUMathFunctionsTest, TestAsum) {
   EXPECT_LT((cpu_asum - std_asum) / std_asum, 1e-2);
 }
 
+TYPED_TEST(CPUMathFunctionsTest, TestSumsq) {
+  int n = this->blob_bottom_->count();
+  const TypeParam* x = this->blob_bottom_->cpu_data();
+  TypeParam std_sumsq = 0;
+  for (int i = 0; i < n; ++i) {
+    std_sumsq += x[i] * x[i];
+  }
+  TypeParam cpu_sumsq = caffe_cpu_sumsq<TypeParam>(n, x);
+  EXPECT_LT(std::fabs(cpu_sumsq - std_sumsq) / std_sumsq, 1e-4);
+  EXPECT_EQ(caffe_cpu_sumsq<TypeParam>(0, x), 0);
+  EXPECT_EQ(caffe_cpu_sumsq<TypeParam>(1, x), x[0] * x[0]);
+}
+
 TYPED_TEST(CPUMathFunctionsTest, TestSign) {
   int n = this->blob_bottom_->count();
   const TypeParam* x = this->blob_bottom_->cpu_data();
@@ -119,6 +134,103 @@ TYPED_TEST(CPUMathFunctionsTest, TestCopy) {
   }
 }
 
+TYPED_TEST(CPUMathFunctionsTest, TestExp) {
+  const int n = this->blob_bottom_->count();
+  // Spread the inputs over [-80, 80] or so to cover the range reduction.
+  caffe_scal(n, TypeParam(20), this->blob_bottom_->mutable_cpu_data());
+  const TypeParam* bottom_data = this->blob_bottom_->cpu_data();
+  TypeParam* top_data = this->blob_top_->mutable_cpu_data();
+  caffe_exp(n, bottom_data, top_data);
+  for (int i = 0; i < n; ++i) {
+    const TypeParam expected = std::exp(bottom_data[i]);
+    EXPECT_NEAR(expected, top_data[i],
+        1e-6 * expected + std::numeric_limits<TypeParam>::min());
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestExpSpecialValues) {
+  const TypeParam inf = std::numeric_limits<TypeParam>::infinity();
+  const TypeParam x[] = {std::numeric_limits<TypeParam>::quiet_NaN(), inf,
+      -inf, 88.5, 89, 1000, -1000};
+  TypeParam y[7];
+  caffe_exp(7, x, y);
+  EXPECT_TRUE(y[0] != y[0]);
+  EXPECT_EQ(inf, y[1]);
+  EXPECT_EQ(0, y[2]);
+  EXPECT_NEAR(std::exp(x[3]), y[3], 1e-6 * std::exp(x[3]));
+  EXPECT_EQ(std::exp(x[4]), y[4]);
+  EXPECT_EQ(inf, y[5]);
+  EXPECT_EQ(0, y[6]);
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestLog) {
+  const int n = this->blob_bottom_->count();
+  // Spread the inputs over many binades, and add a denormal.
+  TypeParam* bottom_data = this->blob_bottom_->mutable_cpu_data();
+  for (int i = 0; i < n; ++i) {
+    bottom_data[i] = std::exp(TypeParam(20) * bottom_data[i]);
+  }
+  bottom_data[0] = std::numeric_limits<TypeParam>::min() / 1000;
+  TypeParam* top_data = this->blob_top_->mutable_cpu_data();
+  caffe_log(n, bottom_data, top_data);
+  for (int i = 0; i < n; ++i) {
+    const TypeParam expected = std::log(bottom_data[i]);
+    EXPECT_NEAR(expected, top_data[i], 1e-6 * std::fabs(expected) + 1e-7);
+  }
+  const TypeParam inf = std::numeric_limits<TypeParam>::infinity();
+  const TypeParam x[] = {0, inf, -1,
+      std::numeric_limits<TypeParam>::quiet_NaN()};
+  TypeParam y[4];
+  caffe_log(4, x, y);
+  EXPECT_EQ(-inf, y[0]);
+  EXPECT_EQ(inf, y[1]);
+  EXPECT_TRUE(y[2] != y[2]);
+  EXPECT_TRUE(y[3] != y[3]);
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestTanh) {
+  const int n = this->blob_bottom_->count();
+  const TypeParam* bottom_data = this->blob_bottom_->cpu_data();
+  TypeParam* top_data = this->blob_top_->mutable_cpu_data();
+  caffe_tanh(n, bottom_data, top_data);
+  for (int i = 0; i < n; ++i) {
+    const TypeParam expected = std::tanh(bottom_data[i]);
+    EXPECT_NEAR(expected, top_data[i], 1e-6 * std::fabs(expected) + 1e-7);
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestSigmoid) {
+  const int n = this->blob_bottom_->count();
+  caffe_scal(n, TypeParam(10), this->blob_bottom_->mutable_cpu_data());
+  const TypeParam* bottom_data = this->blob_bottom_->cpu_data();
+  TypeParam* top_data = this->blob_top_->mutable_cpu_data();
+  caffe_sigmoid(n, bottom_data, top_data);
+  for (int i = 0; i < n; ++i) {
+    const TypeParam expected = 1. / (1. + std::exp(-bottom_data[i]));
+    EXPECT_NEAR(expected, top_data[i], 1e-6 * expected);
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestBf16RoundTrip) {
+  const int n = this->blob_bottom_->count();
+  const TypeParam* bottom_data = this->blob_bottom_->cpu_data();
+  TypeParam* top_data = this->blob_top_->mutable_cpu_data();
+  vector<uint16_t> bf16(n);
+  caffe_cpu_to_bf16(n, bottom_data, &bf16.front());
+  caffe_cpu_from_bf16(n, &bf16.front(), top_data);
+  for (int i = 0; i < n; ++i) {
+    // 8 significant bits, rounded to nearest
+    EXPECT_NEAR(bottom_data[i], top_data[i],
+        std::fabs(bottom_data[i]) / 256 + std::numeric_limits<float>::min());
+  }
+  // Values representable in bf16 convert exactly.
+  caffe_cpu_to_bf16(n, top_data, &bf16.front());
+  caffe_cpu_from_bf16(n, &bf16.front(), this->blob_bottom_->mutable_cpu_diff());
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(top_data[i], this->blob_bottom_->cpu_diff()[i]);
+  }
+}
+
 #ifndef CPU_ONLY
 
 template <typename Dtype>
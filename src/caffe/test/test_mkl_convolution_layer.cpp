@@ -6,6 +6,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/layers/conv_layer.hpp"
 #include "caffe/layers/mkl_layers.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -267,6 +268,51 @@ TYPED_TEST(MKLConvolutionLayerTest, TestSimpleConvolutionMKL) {
 #endif
 }
 
+TYPED_TEST(MKLConvolutionLayerTest, TestAlternatingBatchSizeMKL) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_stride(2);
+  convolution_param->set_num_output(4);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  shared_ptr<Layer<Dtype> > layer(
+      new MKLConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // Caffe engine layer with the same weights, as the reference.
+  convolution_param->set_engine(ConvolutionParameter_Engine_CAFFE);
+  shared_ptr<Layer<Dtype> > caffe_layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  vector<Blob<Dtype>*> ref_top_vec(1,
+      this->MakeReferenceTop(this->blob_top_));
+  caffe_layer->SetUp(this->blob_bottom_vec_, ref_top_vec);
+  for (int i = 0; i < layer->blobs().size(); ++i) {
+    caffe_layer->blobs()[i]->ShareData(*layer->blobs()[i]);
+  }
+  // Switch back and forth between batch sizes, as when serving requests,
+  // so that cached primitives are reused and evicted.
+  const int batch_sizes[] = {2, 4, 2, 1, 4};
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  for (int b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); ++b) {
+    this->blob_bottom_->Reshape(batch_sizes[b], 3, 6, 4);
+    filler.Fill(this->blob_bottom_);
+    layer->Reshape(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    EXPECT_EQ(this->blob_top_->num(), batch_sizes[b]);
+    caffe_layer->Reshape(this->blob_bottom_vec_, ref_top_vec);
+    caffe_layer->Forward(this->blob_bottom_vec_, ref_top_vec);
+    const Dtype* top_data = this->blob_top_->cpu_data();
+    const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+    for (int i = 0; i < this->blob_top_->count(); ++i) {
+      EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+    }
+  }
+}
+
 #if 0
 TYPED_TEST(MKLConvolutionLayerTest, TestDilatedConvolutionMKL) {
   typedef typename TypeParam::Dtype Dtype;
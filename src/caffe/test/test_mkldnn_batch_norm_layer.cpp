@@ -0,0 +1,122 @@
+#ifdef MKLDNN_SUPPORTED
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/layers/batch_norm_layer.hpp"
+#include "caffe/layers/mkldnn_layers.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+#include "caffe/test/test_gradient_check_util.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class MKLDNNBatchNormLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  MKLDNNBatchNormLayerTest()
+      : blob_bottom_(new Blob<Dtype>(5, 2, 3, 4)),
+        blob_top_(new Blob<Dtype>()),
+        blob_ref_top_(new Blob<Dtype>()) {
+    Caffe::set_random_seed(1701);
+    FillerParameter filler_param;
+    filler_param.set_mean(3);
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(this->blob_bottom_);
+    blob_bottom_vec_.push_back(blob_bottom_);
+    blob_top_vec_.push_back(blob_top_);
+    blob_ref_top_vec_.push_back(blob_ref_top_);
+  }
+  virtual ~MKLDNNBatchNormLayerTest() {
+    delete blob_bottom_;
+    delete blob_top_;
+    delete blob_ref_top_;
+  }
+
+  // Runs MKLDNNBatchNormLayer and BatchNormLayer with the same parameters
+  // and checks that outputs and accumulated statistics match.
+  void CompareWithReference(const LayerParameter& layer_param) {
+    BatchNormLayer<Dtype> ref_layer(layer_param);
+    ref_layer.SetUp(this->blob_bottom_vec_, this->blob_ref_top_vec_);
+    MKLDNNBatchNormLayer<Dtype> layer(layer_param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    for (int i = 0; i < 3; ++i) {
+      layer.blobs()[i]->CopyFrom(*ref_layer.blobs()[i]);
+    }
+    ref_layer.Forward(this->blob_bottom_vec_, this->blob_ref_top_vec_);
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+
+    for (int i = 0; i < this->blob_top_->count(); ++i) {
+      EXPECT_NEAR(this->blob_ref_top_->cpu_data()[i],
+          this->blob_top_->cpu_data()[i], 1e-4);
+    }
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < layer.blobs()[i]->count(); ++j) {
+        EXPECT_NEAR(ref_layer.blobs()[i]->cpu_data()[j],
+            layer.blobs()[i]->cpu_data()[j], 1e-4);
+      }
+    }
+  }
+
+  Blob<Dtype>* const blob_bottom_;
+  Blob<Dtype>* const blob_top_;
+  Blob<Dtype>* const blob_ref_top_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+  vector<Blob<Dtype>*> blob_ref_top_vec_;
+};
+
+typedef ::testing::Types<CPUDevice<float> > TestDtypesCPU;
+TYPED_TEST_CASE(MKLDNNBatchNormLayerTest, TestDtypesCPU);
+
+TYPED_TEST(MKLDNNBatchNormLayerTest, TestForwardBatchStats) {
+  LayerParameter layer_param;
+  layer_param.mutable_batch_norm_param()->set_use_global_stats(false);
+  this->CompareWithReference(layer_param);
+}
+
+TYPED_TEST(MKLDNNBatchNormLayerTest, TestForwardGlobalStats) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  layer_param.set_phase(TEST);
+  BatchNormLayer<Dtype> ref_layer(layer_param);
+  ref_layer.SetUp(this->blob_bottom_vec_, this->blob_ref_top_vec_);
+  // Stored statistics, scaled by the moving average factor.
+  FillerParameter filler_param;
+  filler_param.set_min(0.5);
+  filler_param.set_max(2);
+  UniformFiller<Dtype> filler(filler_param);
+  filler.Fill(ref_layer.blobs()[0].get());
+  filler.Fill(ref_layer.blobs()[1].get());
+  ref_layer.blobs()[2]->mutable_cpu_data()[0] = 1.5;
+
+  MKLDNNBatchNormLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int i = 0; i < 3; ++i) {
+    layer.blobs()[i]->CopyFrom(*ref_layer.blobs()[i]);
+  }
+  ref_layer.Forward(this->blob_bottom_vec_, this->blob_ref_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(this->blob_ref_top_->cpu_data()[i],
+        this->blob_top_->cpu_data()[i], 1e-4);
+  }
+}
+
+TYPED_TEST(MKLDNNBatchNormLayerTest, TestGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  layer_param.mutable_batch_norm_param()->set_use_global_stats(false);
+  MKLDNNBatchNormLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-4);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
+}  // namespace caffe
+#endif  // #ifdef MKLDNN_SUPPORTED
@@ -0,0 +1,128 @@
+#ifdef MKLDNN_SUPPORTED
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/layers/mkldnn_layers.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+#include "caffe/test/test_gradient_check_util.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class MKLDNNConcatLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  MKLDNNConcatLayerTest()
+      : blob_bottom_0_(new Blob<Dtype>(2, 8, 6, 5)),
+        blob_bottom_1_(new Blob<Dtype>(2, 16, 6, 5)),
+        blob_top_(new Blob<Dtype>()) {
+    Caffe::set_random_seed(1701);
+    FillerParameter filler_param;
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(this->blob_bottom_0_);
+    filler.Fill(this->blob_bottom_1_);
+    blob_bottom_vec_.push_back(blob_bottom_0_);
+    blob_bottom_vec_.push_back(blob_bottom_1_);
+    blob_top_vec_.push_back(blob_top_);
+  }
+  virtual ~MKLDNNConcatLayerTest() {
+    delete blob_bottom_0_; delete blob_bottom_1_; delete blob_top_;
+  }
+
+  // Checks that top is the channel concatenation of the bottom blobs.
+  void CheckConcat(const vector<Blob<Dtype>*>& bottom, Blob<Dtype>* top) {
+    int offset = 0;
+    for (int i = 0; i < bottom.size(); ++i) {
+      for (int n = 0; n < top->num(); ++n) {
+        for (int c = 0; c < bottom[i]->channels(); ++c) {
+          for (int h = 0; h < top->height(); ++h) {
+            for (int w = 0; w < top->width(); ++w) {
+              EXPECT_EQ(bottom[i]->data_at(n, c, h, w),
+                  top->data_at(n, c + offset, h, w));
+            }
+          }
+        }
+      }
+      offset += bottom[i]->channels();
+    }
+  }
+
+  Blob<Dtype>* const blob_bottom_0_;
+  Blob<Dtype>* const blob_bottom_1_;
+  Blob<Dtype>* const blob_top_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+typedef ::testing::Types<CPUDevice<float> > TestDtypesCPU;
+TYPED_TEST_CASE(MKLDNNConcatLayerTest, TestDtypesCPU);
+
+TYPED_TEST(MKLDNNConcatLayerTest, TestSetupChannels) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  MKLDNNConcatLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(this->blob_top_->num(), 2);
+  EXPECT_EQ(this->blob_top_->channels(), 24);
+  EXPECT_EQ(this->blob_top_->height(), 6);
+  EXPECT_EQ(this->blob_top_->width(), 5);
+}
+
+TYPED_TEST(MKLDNNConcatLayerTest, TestForward) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  MKLDNNConcatLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  this->CheckConcat(this->blob_bottom_vec_, this->blob_top_);
+}
+
+TYPED_TEST(MKLDNNConcatLayerTest, TestForwardPrivateLayout) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Concatenate the outputs of MKLDNN convolutions, which are kept in the
+  // private layout chosen by the convolution primitive.
+  LayerParameter conv_param;
+  conv_param.mutable_convolution_param()->add_kernel_size(3);
+  conv_param.mutable_convolution_param()->add_pad(1);
+  conv_param.mutable_convolution_param()->set_num_output(16);
+  conv_param.mutable_convolution_param()->mutable_weight_filler()->set_type("gaussian");
+  conv_param.mutable_convolution_param()->mutable_bias_filler()->set_type("gaussian");
+  Blob<Dtype> conv_top_0, conv_top_1;
+  vector<Blob<Dtype>*> conv_bottom_vec_0(1, this->blob_bottom_0_);
+  vector<Blob<Dtype>*> conv_bottom_vec_1(1, this->blob_bottom_1_);
+  vector<Blob<Dtype>*> conv_top_vec_0(1, &conv_top_0);
+  vector<Blob<Dtype>*> conv_top_vec_1(1, &conv_top_1);
+  MKLDNNConvolutionLayer<Dtype> conv_0(conv_param);
+  conv_0.SetUp(conv_bottom_vec_0, conv_top_vec_0);
+  conv_0.Forward(conv_bottom_vec_0, conv_top_vec_0);
+  MKLDNNConvolutionLayer<Dtype> conv_1(conv_param);
+  conv_1.SetUp(conv_bottom_vec_1, conv_top_vec_1);
+  conv_1.Forward(conv_bottom_vec_1, conv_top_vec_1);
+
+  vector<Blob<Dtype>*> bottom_vec;
+  bottom_vec.push_back(&conv_top_0);
+  bottom_vec.push_back(&conv_top_1);
+  LayerParameter layer_param;
+  MKLDNNConcatLayer<Dtype> layer(layer_param);
+  layer.SetUp(bottom_vec, this->blob_top_vec_);
+  layer.Forward(bottom_vec, this->blob_top_vec_);
+  this->CheckConcat(bottom_vec, this->blob_top_);
+}
+
+TYPED_TEST(MKLDNNConcatLayerTest, TestGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  MKLDNNConcatLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-2);
+  checker.CheckGradient(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
+}  // namespace caffe
+#endif  // #ifdef MKLDNN_SUPPORTED
@@ -66,6 +66,27 @@ TYPED_TEST(MKLDNNNeuronLayerTest, TestReLUGradient) {
   checker.CheckGradientEltwise(&layer, this->blob_bottom_vec_,
       this->blob_top_vec_);
 }
+
+TYPED_TEST(MKLDNNNeuronLayerTest, TestReLUInPlaceNegativeSlopeGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  layer_param.mutable_relu_param()->set_negative_slope(-0.5);
+  MKLDNNReLULayer<Dtype> layer(layer_param);
+  Blob<Dtype> input;
+  input.CopyFrom(*this->blob_bottom_, false, true);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_bottom_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_bottom_vec_);
+  caffe_set(this->blob_bottom_->count(), Dtype(1),
+      this->blob_bottom_->mutable_cpu_diff());
+  vector<bool> propagate_down(1, true);
+  layer.Backward(this->blob_bottom_vec_, propagate_down,
+      this->blob_bottom_vec_);
+  const Dtype* input_data = input.cpu_data();
+  const Dtype* bottom_diff = this->blob_bottom_->cpu_diff();
+  for (int i = 0; i < input.count(); ++i) {
+    EXPECT_EQ(input_data[i] > 0 ? Dtype(1) : Dtype(-0.5), bottom_diff[i]);
+  }
+}
 #endif
 
 }  // namespace caffe
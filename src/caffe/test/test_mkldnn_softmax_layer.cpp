@@ -0,0 +1,100 @@
+#ifdef MKLDNN_SUPPORTED
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/layers/mkldnn_layers.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+#include "caffe/test/test_gradient_check_util.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class MKLDNNSoftmaxLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  MKLDNNSoftmaxLayerTest()
+      : blob_bottom_(new Blob<Dtype>(2, 10, 2, 3)),
+        blob_top_(new Blob<Dtype>()) {
+    Caffe::set_random_seed(1701);
+    FillerParameter filler_param;
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(this->blob_bottom_);
+    blob_bottom_vec_.push_back(blob_bottom_);
+    blob_top_vec_.push_back(blob_top_);
+  }
+  virtual ~MKLDNNSoftmaxLayerTest() { delete blob_bottom_; delete blob_top_; }
+
+  // Checks the output against softmax computed over the channels.
+  void CheckSoftmax() {
+    const int inner_num = this->blob_bottom_->count(2);
+    const int channels = this->blob_bottom_->shape(1);
+    const Dtype* bottom_data = this->blob_bottom_->cpu_data();
+    const Dtype* top_data = this->blob_top_->cpu_data();
+    for (int i = 0; i < this->blob_bottom_->shape(0); ++i) {
+      for (int k = 0; k < inner_num; ++k) {
+        const int offset = i * channels * inner_num + k;
+        Dtype sum = 0;
+        for (int j = 0; j < channels; ++j) {
+          sum += exp(bottom_data[offset + j * inner_num]);
+        }
+        for (int j = 0; j < channels; ++j) {
+          EXPECT_NEAR(exp(bottom_data[offset + j * inner_num]) / sum,
+              top_data[offset + j * inner_num], 1e-4);
+        }
+      }
+    }
+  }
+
+  Blob<Dtype>* const blob_bottom_;
+  Blob<Dtype>* const blob_top_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+typedef ::testing::Types<CPUDevice<float> > TestDtypesCPU;
+TYPED_TEST_CASE(MKLDNNSoftmaxLayerTest, TestDtypesCPU);
+
+TYPED_TEST(MKLDNNSoftmaxLayerTest, TestForward) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  MKLDNNSoftmaxLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  this->CheckSoftmax();
+}
+
+TYPED_TEST(MKLDNNSoftmaxLayerTest, TestForward2D) {
+  typedef typename TypeParam::Dtype Dtype;
+  vector<int> shape(2);
+  shape[0] = 4;
+  shape[1] = 1000;
+  this->blob_bottom_->Reshape(shape);
+  FillerParameter filler_param;
+  filler_param.set_std(5);
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_bottom_);
+  LayerParameter layer_param;
+  MKLDNNSoftmaxLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  this->CheckSoftmax();
+}
+
+TYPED_TEST(MKLDNNSoftmaxLayerTest, TestGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  MKLDNNSoftmaxLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
+}  // namespace caffe
+#endif  // #ifdef MKLDNN_SUPPORTED
@@ -0,0 +1,99 @@
+#ifdef MKLDNN_SUPPORTED
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/layers/mkldnn_layers.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+#include "caffe/test/test_gradient_check_util.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class MKLDNNSplitLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  MKLDNNSplitLayerTest()
+      : blob_bottom_(new Blob<Dtype>(2, 8, 6, 5)),
+        blob_top_a_(new Blob<Dtype>()),
+        blob_top_b_(new Blob<Dtype>()) {
+    Caffe::set_random_seed(1701);
+    FillerParameter filler_param;
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(this->blob_bottom_);
+    blob_bottom_vec_.push_back(blob_bottom_);
+    blob_top_vec_.push_back(blob_top_a_);
+    blob_top_vec_.push_back(blob_top_b_);
+  }
+  virtual ~MKLDNNSplitLayerTest() {
+    delete blob_bottom_;
+    delete blob_top_a_;
+    delete blob_top_b_;
+  }
+  Blob<Dtype>* const blob_bottom_;
+  Blob<Dtype>* const blob_top_a_;
+  Blob<Dtype>* const blob_top_b_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+typedef ::testing::Types<CPUDevice<float> > TestDtypesCPU;
+TYPED_TEST_CASE(MKLDNNSplitLayerTest, TestDtypesCPU);
+
+TYPED_TEST(MKLDNNSplitLayerTest, TestForward) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  MKLDNNSplitLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int i = 0; i < this->blob_bottom_->count(); ++i) {
+    Dtype bottom_value = this->blob_bottom_->cpu_data()[i];
+    EXPECT_EQ(bottom_value, this->blob_top_a_->cpu_data()[i]);
+    EXPECT_EQ(bottom_value, this->blob_top_b_->cpu_data()[i]);
+  }
+}
+
+TYPED_TEST(MKLDNNSplitLayerTest, TestForwardPrivateLayout) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter conv_param;
+  conv_param.mutable_convolution_param()->add_kernel_size(3);
+  conv_param.mutable_convolution_param()->add_pad(1);
+  conv_param.mutable_convolution_param()->set_num_output(16);
+  conv_param.mutable_convolution_param()->mutable_weight_filler()->set_type("gaussian");
+  conv_param.mutable_convolution_param()->mutable_bias_filler()->set_type("gaussian");
+  Blob<Dtype> conv_top;
+  vector<Blob<Dtype>*> conv_top_vec(1, &conv_top);
+  MKLDNNConvolutionLayer<Dtype> conv(conv_param);
+  conv.SetUp(this->blob_bottom_vec_, conv_top_vec);
+  conv.Forward(this->blob_bottom_vec_, conv_top_vec);
+
+  LayerParameter layer_param;
+  MKLDNNSplitLayer<Dtype> layer(layer_param);
+  layer.SetUp(conv_top_vec, this->blob_top_vec_);
+  layer.Forward(conv_top_vec, this->blob_top_vec_);
+  // The outputs keep the private layout of the input.
+  EXPECT_EQ(conv_top.prv_data(), this->blob_top_a_->prv_data());
+  EXPECT_EQ(conv_top.prv_data(), this->blob_top_b_->prv_data());
+  for (int i = 0; i < conv_top.count(); ++i) {
+    Dtype bottom_value = conv_top.cpu_data()[i];
+    EXPECT_EQ(bottom_value, this->blob_top_a_->cpu_data()[i]);
+    EXPECT_EQ(bottom_value, this->blob_top_b_->cpu_data()[i]);
+  }
+}
+
+TYPED_TEST(MKLDNNSplitLayerTest, TestGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  MKLDNNSplitLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-2);
+  checker.CheckGradientEltwise(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
+}  // namespace caffe
+#endif  // #ifdef MKLDNN_SUPPORTED
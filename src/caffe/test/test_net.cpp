@@ -10,6 +10,7 @@
 #include "caffe/filler.hpp"
 #include "caffe/net.hpp"
 #include "caffe/util/io.hpp"
+#include "caffe/util/mapped_weights.hpp"
 #include "caffe/util/math_functions.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -1342,6 +1343,55 @@ TYPED_TEST(NetTest, TestSharedWeightsResume) {
   }
 }
 
+TYPED_TEST(NetTest, TestSharedWeightsResumeMapped) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_random_seed(this->seed_);
+  this->InitDiffDataSharedWeightsNet();
+  this->net_->ForwardBackward();
+  this->net_->Update();
+  Blob<Dtype> shared_params;
+  shared_params.CopyFrom(*this->net_->layers()[1]->blobs()[0], false, true);
+  const int count = shared_params.count();
+  NetParameter net_param;
+  this->net_->ToProto(&net_param);
+
+  // Write the weights in both precisions; the one matching Dtype is mapped,
+  // the other one converted.
+  for (int use_double = false; use_double <= true; ++use_double) {
+    string filename;
+    MakeTempFilename(&filename);
+    filename += ".map";
+    if (use_double) {
+      WriteMappedWeights<double>(net_param, filename);
+    } else {
+      WriteMappedWeights<float>(net_param, filename);
+    }
+    Caffe::set_random_seed(this->seed_);
+    this->InitDiffDataSharedWeightsNet();
+    this->net_->CopyTrainedLayersFrom(filename);
+    Blob<Dtype>* ip1_weights = this->net_->layers()[1]->blobs()[0].get();
+    Blob<Dtype>* ip2_weights = this->net_->layers()[2]->blobs()[0].get();
+    EXPECT_EQ(ip1_weights->cpu_data(), ip2_weights->cpu_data());
+    for (int i = 0; i < count; ++i) {
+      EXPECT_FLOAT_EQ(shared_params.cpu_data()[i], ip1_weights->cpu_data()[i]);
+    }
+    // Writing to mapped weights must not fail nor modify the file.
+    this->net_->ForwardBackward();
+    this->net_->Update();
+    // A net sharing the weights keeps them valid after the owner is gone.
+    Blob<Dtype> updated_params;
+    updated_params.CopyFrom(*ip1_weights, false, true);
+    shared_ptr<Net<Dtype> > owner = this->net_;
+    this->InitDiffDataSharedWeightsNet();
+    this->net_->ShareTrainedLayersWith(owner.get());
+    owner.reset();
+    ip1_weights = this->net_->layers()[1]->blobs()[0].get();
+    for (int i = 0; i < count; ++i) {
+      EXPECT_EQ(updated_params.cpu_data()[i], ip1_weights->cpu_data()[i]);
+    }
+  }
+}
+
 TYPED_TEST(NetTest, TestParamPropagateDown) {
   typedef typename TypeParam::Dtype Dtype;
   const bool kBiasTerm = true, kForceBackward = false;
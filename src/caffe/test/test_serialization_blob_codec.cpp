@@ -305,6 +305,60 @@ TYPED_TEST(BlobCodecTest, encode_decode_4width_data_alpha_0_beta_1) {
           sizeof(float)*dstblob.count()));
 }
 
+TYPED_TEST(BlobCodecTest, encode_decode_bf16_diff) {
+  BlobUpdate msg;
+  Blob<float> srcblob;
+  Blob<float> dstblob;
+  vector<int> v = boost::assign::list_of(1)(1)(1)(5);
+  srcblob.Reshape(v);
+  dstblob.Reshape(v);
+  vector<float> diff = boost::assign::list_of(1.0)(-2.2)(3.3)(0.0)(1010.1);
+  vector<float> diff_one = boost::assign::list_of(1.0)(1.0)(1.0)(1.0)(1.0);
+
+  caffe_copy<float>(srcblob.count(), &diff.front(),
+          srcblob.mutable_cpu_diff());
+  caffe_copy<float>(dstblob.count(), &diff_one.front(),
+          dstblob.mutable_cpu_diff());
+
+  MultinodeParameter param;
+  param.mutable_outgoing_compression()->set_algo(COMPRESSION_BF16);
+  shared_ptr<BlobCodec<float> > codec =
+    BlobCodec<float>::create_codec(param, true);
+
+  codec->encode(&msg, &srcblob, BlobEncoding::GRADS, msg.info().part());
+  EXPECT_EQ(sizeof(uint16_t) * diff.size(), msg.data().size());
+  EXPECT_TRUE(codec->decode(msg, &dstblob, BlobEncoding::GRADS, 0.5f, 1.0f));
+
+  for (int i = 0; i < diff.size(); ++i) {
+    EXPECT_NEAR(1.0f + 0.5f * diff[i], dstblob.cpu_diff()[i],
+        fabs(diff[i]) / 256);
+  }
+}
+
+TYPED_TEST(BlobCodecTest, encode_decode_bf16_data_full_precision) {
+  BlobUpdate msg;
+  Blob<float> srcblob;
+  Blob<float> dstblob;
+  vector<int> v = boost::assign::list_of(1)(1)(1)(5);
+  srcblob.Reshape(v);
+  dstblob.Reshape(v);
+  vector<float> data = boost::assign::list_of(1.0)(-2.2)(3.3)(0.0)(1010.1);
+
+  caffe_copy<float>(srcblob.count(), &data.front(),
+          srcblob.mutable_cpu_data());
+
+  MultinodeParameter param;
+  param.mutable_outgoing_compression()->set_algo(COMPRESSION_BF16);
+  shared_ptr<BlobCodec<float> > codec =
+    BlobCodec<float>::create_codec(param, true);
+
+  codec->encode(&msg, &srcblob, BlobEncoding::PARAMS, msg.info().part());
+  EXPECT_EQ(sizeof(float) * data.size(), msg.data().size());
+  EXPECT_TRUE(codec->decode(msg, &dstblob, BlobEncoding::PARAMS, 1.0f, 0.0f));
+
+  EXPECT_EQ(0, memcmp(srcblob.cpu_data(), dstblob.cpu_data(),
+          sizeof(float)*dstblob.count()));
+}
 
 }  // namespace
 }  // namespace caffe
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -32,6 +33,42 @@ class SoftmaxLayerTest : public MultiDeviceTest<TypeParam> {
     blob_top_vec_.push_back(blob_top_);
   }
   virtual ~SoftmaxLayerTest() { delete blob_bottom_; delete blob_top_; }
+
+  // Checks the softmax over axis 1 of a bottom of the given shape against a
+  // direct computation.
+  void TestForwardShape(const int num, const int channels, const int height,
+      const int width) {
+    typedef typename TypeParam::Dtype Dtype;
+    blob_bottom_->Reshape(num, channels, height, width);
+    FillerParameter filler_param;
+    filler_param.set_std(5);
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(blob_bottom_);
+    LayerParameter layer_param;
+    SoftmaxLayer<Dtype> layer(layer_param);
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+    layer.Forward(blob_bottom_vec_, blob_top_vec_);
+    for (int i = 0; i < num; ++i) {
+      for (int k = 0; k < height; ++k) {
+        for (int l = 0; l < width; ++l) {
+          Dtype max_val = blob_bottom_->data_at(i, 0, k, l);
+          for (int j = 1; j < channels; ++j) {
+            max_val = std::max(max_val, blob_bottom_->data_at(i, j, k, l));
+          }
+          Dtype scale = 0;
+          for (int j = 0; j < channels; ++j) {
+            scale += exp(blob_bottom_->data_at(i, j, k, l) - max_val);
+          }
+          for (int j = 0; j < channels; ++j) {
+            EXPECT_NEAR(blob_top_->data_at(i, j, k, l),
+                exp(blob_bottom_->data_at(i, j, k, l) - max_val) / scale,
+                1e-5) << "debug: " << i << " " << j << " " << k << " " << l;
+          }
+        }
+      }
+    }
+  }
+
   Blob<Dtype>* const blob_bottom_;
   Blob<Dtype>* const blob_top_;
   vector<Blob<Dtype>*> blob_bottom_vec_;
@@ -74,6 +111,15 @@ TYPED_TEST(SoftmaxLayerTest, TestForward) {
   }
 }
 
+TYPED_TEST(SoftmaxLayerTest, TestForwardChannelsOnly) {
+  this->TestForwardShape(7, 1000, 1, 1);
+}
+
+TYPED_TEST(SoftmaxLayerTest, TestForwardLargeSpatial) {
+  // Spans several blocks of inner positions, the last one partial.
+  this->TestForwardShape(2, 21, 17, 37);
+}
+
 TYPED_TEST(SoftmaxLayerTest, TestGradient) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
 #include <vector>
 
@@ -61,6 +63,41 @@ TYPED_TEST(SoftmaxWithLossLayerTest, TestGradient) {
       this->blob_top_vec_, 0);
 }
 
+TYPED_TEST(SoftmaxWithLossLayerTest, TestForward) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  layer_param.mutable_loss_param()->set_ignore_label(3);
+  SoftmaxWithLossLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  // Recompute the loss from the output of a separate softmax.
+  Blob<Dtype> prob;
+  vector<Blob<Dtype>*> softmax_bottom_vec(1, this->blob_bottom_data_);
+  vector<Blob<Dtype>*> softmax_top_vec(1, &prob);
+  SoftmaxLayer<Dtype> softmax_layer((LayerParameter()));
+  softmax_layer.SetUp(softmax_bottom_vec, softmax_top_vec);
+  softmax_layer.Forward(softmax_bottom_vec, softmax_top_vec);
+  const Dtype* label = this->blob_bottom_label_->cpu_data();
+  Dtype loss = 0;
+  int count = 0;
+  for (int i = 0; i < prob.num(); ++i) {
+    for (int k = 0; k < prob.height(); ++k) {
+      for (int l = 0; l < prob.width(); ++l) {
+        const int label_value = static_cast<int>(
+            label[(i * prob.height() + k) * prob.width() + l]);
+        if (label_value == 3) {
+          continue;
+        }
+        loss -= log(std::max(prob.data_at(i, label_value, k, l),
+            Dtype(FLT_MIN)));
+        ++count;
+      }
+    }
+  }
+  EXPECT_NEAR(loss / count, this->blob_top_loss_->cpu_data()[0],
+      1e-4 * loss / count);
+}
+
 TYPED_TEST(SoftmaxWithLossLayerTest, TestForwardIgnoreLabel) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -9,6 +9,7 @@
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/sgd_solvers.hpp"
 #include "caffe/solver.hpp"
+#include "caffe/util/math_functions.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
 
@@ -106,4 +107,74 @@ TYPED_TEST(SolverTest, TestInitTrainTestNets) {
   EXPECT_TRUE(this->solver_->test_nets()[1]->has_layer("accuracy"));
 }
 
+TYPED_TEST(SolverTest, TestAsyncTestNetsCopyWeights) {
+  typedef typename TypeParam::Dtype Dtype;
+  const string& proto =
+     "test_interval: 10 "
+     "test_iter: 2 "
+     "test_async: true "
+     "max_iter: 20 "
+     "base_lr: 0.01 "
+     "lr_policy: 'fixed' "
+     "snapshot_after_train: false "
+     "net_param { "
+     "  name: 'TestNetwork' "
+     "  layer { "
+     "    name: 'data' "
+     "    type: 'DummyData' "
+     "    dummy_data_param { "
+     "      shape { dim: 5 dim: 3 } "
+     "      shape { dim: 5 } "
+     "      data_filler { type: 'gaussian' } "
+     "      data_filler { type: 'constant' value: 1 } "
+     "    } "
+     "    top: 'data' "
+     "    top: 'label' "
+     "  } "
+     "  layer { "
+     "    name: 'innerprod' "
+     "    type: 'InnerProduct' "
+     "    inner_product_param { "
+     "      num_output: 4 "
+     "      weight_filler { type: 'gaussian' } "
+     "    } "
+     "    bottom: 'data' "
+     "    top: 'innerprod' "
+     "  } "
+     "  layer { "
+     "    name: 'loss' "
+     "    type: 'SoftmaxWithLoss' "
+     "    bottom: 'innerprod' "
+     "    bottom: 'label' "
+     "  } "
+     "} ";
+  this->InitSolverFromProtoString(proto);
+  ASSERT_EQ(1, this->solver_->test_nets().size());
+  const vector<Blob<Dtype>*>& params =
+      this->solver_->net()->learnable_params();
+  const vector<Blob<Dtype>*>& test_params =
+      this->solver_->test_nets()[0]->learnable_params();
+  ASSERT_EQ(params.size(), test_params.size());
+  this->solver_->TestAll();
+  this->solver_->WaitForTests();
+  for (int i = 0; i < params.size(); ++i) {
+    // The test net holds a copy of the weights
+    EXPECT_NE(params[i]->cpu_data(), test_params[i]->cpu_data());
+    for (int j = 0; j < params[i]->count(); ++j) {
+      EXPECT_EQ(params[i]->cpu_data()[j], test_params[i]->cpu_data()[j]);
+    }
+  }
+  // Training does not change the copy until the next test
+  caffe_set(params[0]->count(), Dtype(7), params[0]->mutable_cpu_data());
+  EXPECT_NE(Dtype(7), test_params[0]->cpu_data()[0]);
+  // Tests during and after training copy the latest weights
+  this->solver_->Solve();
+  EXPECT_EQ(20, this->solver_->iter());
+  for (int i = 0; i < params.size(); ++i) {
+    for (int j = 0; j < params[i]->count(); ++j) {
+      EXPECT_EQ(params[i]->cpu_data()[j], test_params[i]->cpu_data()[j]);
+    }
+  }
+}
+
 }  // namespace caffe
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -40,6 +41,41 @@ TEST_F(SyncedMemoryTest, TestAllocationCPU) {
   EXPECT_TRUE(mem.mutable_cpu_data());
 }
 
+TEST_F(SyncedMemoryTest, TestHostMemoryPoolReuse) {
+  HostMemoryPool& pool = HostMemoryPool::Get();
+  pool.set_max_cached_bytes(64 << 20);
+  const size_t kSizes[] = {10, 1000, 100000, 8 << 20};
+  for (int i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+    void* ptr = pool.Allocate(kSizes[i]);
+    EXPECT_EQ(reinterpret_cast<size_t>(ptr) % 64, 0);
+    memset(ptr, 1, kSizes[i]);
+    HostMemoryStats before = pool.stats();
+    pool.Free(ptr);
+    HostMemoryStats freed = pool.stats();
+    EXPECT_LT(freed.bytes_in_use, before.bytes_in_use);
+    EXPECT_GT(freed.bytes_cached, before.bytes_cached);
+    // Same size class, served from the cache.
+    void* reused = pool.Allocate(kSizes[i] - 1);
+    EXPECT_EQ(ptr, reused);
+    HostMemoryStats after = pool.stats();
+    EXPECT_EQ(after.hits, before.hits + 1);
+    EXPECT_EQ(after.bytes_in_use, before.bytes_in_use);
+    EXPECT_GE(after.peak_bytes_in_use, after.bytes_in_use);
+    pool.Free(reused);
+  }
+  pool.ReleaseCached();
+  EXPECT_EQ(pool.stats().bytes_cached, 0);
+}
+
+TEST_F(SyncedMemoryTest, TestHostMemoryPoolNoCaching) {
+  HostMemoryPool& pool = HostMemoryPool::Get();
+  pool.set_max_cached_bytes(0);
+  void* ptr = pool.Allocate(1000);
+  pool.Free(ptr);
+  EXPECT_EQ(pool.stats().bytes_cached, 0);
+  pool.set_max_cached_bytes(64 << 20);
+}
+
 #ifndef CPU_ONLY  // GPU test
 
 TEST_F(SyncedMemoryTest, TestAllocationGPU) {
@@ -1,10 +1,13 @@
 #include <boost/thread.hpp>
 #include <string>
 
+#include "caffe/batching_scheduler.hpp"
 #include "caffe/data_reader.hpp"
-#include "caffe/layers/base_data_layer.hpp"
+#include "caffe/inference_runtime.hpp"
 #include "caffe/parallel.hpp"
+#include "caffe/snapshot_writer.hpp"
 #include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/image_reader.hpp"
 
 namespace caffe {
 
@@ -41,6 +44,26 @@ bool BlockingQueue<T>::try_pop(T* t) {
   return true;
 }
 
+template<typename T>
+bool BlockingQueue<T>::try_pop(T* t, int timeout_us) {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  const boost::system_time deadline = boost::get_system_time() +
+      boost::posix_time::microseconds(timeout_us);
+
+  while (queue_.empty()) {
+    if (!sync_->condition_.timed_wait(lock, deadline)) {
+      if (queue_.empty()) {
+        return false;
+      }
+      break;
+    }
+  }
+
+  *t = queue_.front();
+  queue_.pop();
+  return true;
+}
+
 template<typename T>
 T BlockingQueue<T>::pop(const string& log_on_wait) {
   boost::mutex::scoped_lock lock(sync_->mutex_);
@@ -86,12 +109,16 @@ size_t BlockingQueue<T>::size() const {
   return queue_.size();
 }
 
-template class BlockingQueue<Batch<float>*>;
-template class BlockingQueue<Batch<double>*>;
-template class BlockingQueue<std::string*>;
 template class BlockingQueue<shared_ptr<DataReader::QueuePair> >;
 template class BlockingQueue<P2PSync<float>*>;
 template class BlockingQueue<P2PSync<double>*>;
 template class BlockingQueue<Element*>;
+template class BlockingQueue<int>;
+template class BlockingQueue<shared_ptr<SnapshotWriter::Job> >;
+template class BlockingQueue<InferenceRequest<float>*>;
+template class BlockingQueue<InferenceRequest<double>*>;
+template class BlockingQueue<BatchRequest<float>*>;
+template class BlockingQueue<BatchRequest<double>*>;
+template class BlockingQueue<shared_ptr<FileRead> >;
 
 }  // namespace caffe
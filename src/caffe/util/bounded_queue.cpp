@@ -0,0 +1,289 @@
+#include <boost/thread.hpp>
+#include <stdint.h>
+#include <string>
+
+#include "caffe/layers/base_data_layer.hpp"
+#include "caffe/layers/data_layer.hpp"
+#include "caffe/layers/hdf5_data_layer.hpp"
+#include "caffe/util/bounded_queue.hpp"
+
+namespace caffe {
+
+namespace {
+
+template<typename T>
+inline T load_acquire(const T* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template<typename T>
+inline T load_relaxed(const T* p) {
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+template<typename T>
+inline void store_release(T* p, T value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+inline void cpu_relax() {
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__("pause");
+#endif
+}
+
+// Counts the calling thread as sleeping on the queue while in scope, also
+// when the wait is interrupted.
+class WaitingScope {
+ public:
+  explicit WaitingScope(int* waiting) : waiting_(waiting) {
+    __atomic_add_fetch(waiting_, 1, __ATOMIC_SEQ_CST);
+    // Pairs with the fence in notify(): either the waker sees the count, or
+    // the queue state read after this point includes its change.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  }
+  ~WaitingScope() {
+    __atomic_sub_fetch(waiting_, 1, __ATOMIC_SEQ_CST);
+  }
+
+ private:
+  int* waiting_;
+};
+
+}  // namespace
+
+template<typename T>
+class BoundedQueue<T>::sync {
+ public:
+  boost::mutex mutex_;
+  boost::condition_variable not_empty_;
+  boost::condition_variable not_full_;
+
+  // Unlocked attempts, the public calls add the wake-ups.
+  static bool enqueue(BoundedQueue<T>* q, const T& t);
+  static bool dequeue(BoundedQueue<T>* q, T* t);
+  static bool front(BoundedQueue<T>* q, T* t);
+};
+
+template<typename T>
+bool BoundedQueue<T>::sync::enqueue(BoundedQueue<T>* q, const T& t) {
+  size_t pos = load_relaxed(&q->enqueue_pos_);
+  Cell* cell;
+  for (;;) {
+    cell = &q->buffer_[pos & q->mask_];
+    const size_t seq = load_acquire(&cell->sequence);
+    const intptr_t diff = static_cast<intptr_t>(seq) -
+        static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      // Slot free for this position, claim it
+      if (__atomic_compare_exchange_n(&q->enqueue_pos_, &pos, pos + 1, true,
+          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Slot still holds the element from the previous lap
+      return false;
+    } else {
+      pos = load_relaxed(&q->enqueue_pos_);
+    }
+  }
+  cell->data = t;
+  store_release(&cell->sequence, pos + 1);
+  return true;
+}
+
+template<typename T>
+bool BoundedQueue<T>::sync::dequeue(BoundedQueue<T>* q, T* t) {
+  size_t pos = load_relaxed(&q->dequeue_pos_);
+  Cell* cell;
+  for (;;) {
+    cell = &q->buffer_[pos & q->mask_];
+    const size_t seq = load_acquire(&cell->sequence);
+    const intptr_t diff = static_cast<intptr_t>(seq) -
+        static_cast<intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&q->dequeue_pos_, &pos, pos + 1, true,
+          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = load_relaxed(&q->dequeue_pos_);
+    }
+  }
+  *t = cell->data;
+  // Do not keep a reference to the element, e.g. for shared_ptr
+  cell->data = T();
+  store_release(&cell->sequence, pos + q->mask_ + 1);
+  return true;
+}
+
+template<typename T>
+bool BoundedQueue<T>::sync::front(BoundedQueue<T>* q, T* t) {
+  const size_t pos = load_acquire(&q->dequeue_pos_);
+  const Cell* cell = &q->buffer_[pos & q->mask_];
+  if (load_acquire(&cell->sequence) != pos + 1) {
+    return false;
+  }
+  *t = cell->data;
+  return true;
+}
+
+template<typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity, int spin_count)
+    : enqueue_pos_(0), dequeue_pos_(0), consumers_waiting_(0),
+      producers_waiting_(0), spin_count_(spin_count), sync_(new sync()) {
+  CHECK_GT(capacity, 0);
+  CHECK_GE(spin_count, 0);
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  mask_ = size - 1;
+  buffer_ = new Cell[size];
+  for (size_t i = 0; i < size; ++i) {
+    buffer_[i].sequence = i;
+  }
+}
+
+template<typename T>
+BoundedQueue<T>::~BoundedQueue() {
+  delete[] buffer_;
+}
+
+template<typename T>
+void BoundedQueue<T>::notify(int* waiting, bool for_element) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (load_relaxed(waiting) == 0) {
+    return;
+  }
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  if (for_element) {
+    sync_->not_empty_.notify_all();
+  } else {
+    sync_->not_full_.notify_all();
+  }
+}
+
+template<typename T>
+bool BoundedQueue<T>::try_push(const T& t) {
+  if (!sync::enqueue(this, t)) {
+    return false;
+  }
+  notify(&consumers_waiting_, true);
+  return true;
+}
+
+template<typename T>
+void BoundedQueue<T>::push(const T& t) {
+  for (int i = 0; i < spin_count_; ++i) {
+    if (try_push(t)) {
+      return;
+    }
+    cpu_relax();
+  }
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    WaitingScope scope(&producers_waiting_);
+    while (!sync::enqueue(this, t)) {
+      sync_->not_full_.wait(lock);
+    }
+  }
+  notify(&consumers_waiting_, true);
+}
+
+template<typename T>
+bool BoundedQueue<T>::try_pop(T* t) {
+  if (!sync::dequeue(this, t)) {
+    return false;
+  }
+  notify(&producers_waiting_, false);
+  return true;
+}
+
+template<typename T>
+bool BoundedQueue<T>::try_pop(T* t, int timeout_us) {
+  if (try_pop(t)) {
+    return true;
+  }
+  const boost::system_time deadline = boost::get_system_time() +
+      boost::posix_time::microseconds(timeout_us);
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    WaitingScope scope(&consumers_waiting_);
+    while (!sync::dequeue(this, t)) {
+      if (!sync_->not_empty_.timed_wait(lock, deadline)) {
+        if (!sync::dequeue(this, t)) {
+          return false;
+        }
+        break;
+      }
+    }
+  }
+  notify(&producers_waiting_, false);
+  return true;
+}
+
+template<typename T>
+T BoundedQueue<T>::pop(const string& log_on_wait) {
+  T t;
+  for (int i = 0; i < spin_count_; ++i) {
+    if (try_pop(&t)) {
+      return t;
+    }
+    cpu_relax();
+  }
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    WaitingScope scope(&consumers_waiting_);
+    while (!sync::dequeue(this, &t)) {
+      if (!log_on_wait.empty()) {
+        LOG_EVERY_N(INFO, 1000)<< log_on_wait;
+      }
+      sync_->not_empty_.wait(lock);
+    }
+  }
+  notify(&producers_waiting_, false);
+  return t;
+}
+
+template<typename T>
+bool BoundedQueue<T>::try_peek(T* t) {
+  return sync::front(this, t);
+}
+
+template<typename T>
+T BoundedQueue<T>::peek() {
+  T t;
+  for (int i = 0; i < spin_count_; ++i) {
+    if (sync::front(this, &t)) {
+      return t;
+    }
+    cpu_relax();
+  }
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  WaitingScope scope(&consumers_waiting_);
+  while (!sync::front(this, &t)) {
+    sync_->not_empty_.wait(lock);
+  }
+  return t;
+}
+
+template<typename T>
+size_t BoundedQueue<T>::size() const {
+  // Dequeue position first, so that it cannot be ahead of the other
+  const size_t dequeue_pos = load_acquire(&dequeue_pos_);
+  const size_t enqueue_pos = load_acquire(&enqueue_pos_);
+  return enqueue_pos - dequeue_pos;
+}
+
+template class BoundedQueue<Batch<float>*>;
+template class BoundedQueue<Batch<double>*>;
+template class BoundedQueue<std::string*>;
+template class BoundedQueue<DecodedBatch*>;
+template class BoundedQueue<HDF5Chunk<float>*>;
+template class BoundedQueue<HDF5Chunk<double>*>;
+template class BoundedQueue<int>;
+
+}  // namespace caffe
@@ -1,8 +1,10 @@
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <fstream>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "caffe/util/cpu_info.hpp"
@@ -231,7 +233,9 @@ void Collection::updateCpuInformation(const Processor &processor,
    remaining cores are dedicated for OpenMP threads. Each OpenMP thread owns
    one core for exclusive use. The number of OpenMP threads is then limited
    to the number of available cores minus one. The amount of CPU cores may
-   be limited by system eg. when numactl was used. */
+   be limited by system eg. when numactl was used. The last cores can also
+   be reserved for data loading threads, then OpenMP threads only use the
+   remaining ones. */
 
 #include <omp.h>
 #include <sched.h>
@@ -253,7 +257,13 @@ static const unsigned numberOfOpenMpEnvVars =
 
 OpenMpManager::OpenMpManager(Collection *collection) :
                              mainThreadId(boost::this_thread::get_id()),
-                             collection(*collection) {
+                             collection(*collection),
+                             numberOfDataCores(0),
+                             insufficientDataCores(0),
+                             dataCoresVersion(0),
+                             numberOfTestCores(0) {
+  CPU_ZERO(&dataCoreSet);
+  CPU_ZERO(&testCoreSet);
   getOpenMpEnvVars();
   getCurrentCpuSet();
   getCurrentCoreSet();
@@ -386,9 +396,19 @@ bool OpenMpManager::isThreadsBindAllowed() {
   return !isAnyOpenMpEnvVarSpecified && !isGpuEnabled;
 }
 
-// Limit of threads to number of logical cores available
+// Limit of threads to number of logical cores available for compute
 void OpenMpManager::setOpenMpThreadNumberLimit() {
-  omp_set_num_threads(CPU_COUNT(&currentCoreSet));
+  boost::mutex::scoped_lock lock(dataCoresMutex);
+  omp_set_num_threads(CPU_COUNT(&currentCoreSet) - numberOfDataCores -
+    numberOfTestCores);
+}
+
+void OpenMpManager::selectLogicalCores(unsigned begin, unsigned end,
+    cpu_set_t *set) {
+  CPU_ZERO(set);
+  for (unsigned logicalCoreId = begin; logicalCoreId < end; logicalCoreId++) {
+    CPU_SET(getPhysicalCoreId(logicalCoreId), set);
+  }
 }
 
 void OpenMpManager::bindCurrentThreadToLogicalCoreCpu(unsigned logicalCoreId) {
@@ -435,6 +455,12 @@ void OpenMpManager::printVerboseInformation() {
 
   LOG(INFO) << "Number of OpenMP threads: "
     << omp_get_max_threads();
+
+  LOG(INFO) << "Number of cores reserved for data loading: "
+    << getNumberOfDataCores();
+
+  LOG(INFO) << "Number of cores reserved for testing: "
+    << getNumberOfTestCores();
 }
 
 unsigned OpenMpManager::getProcessorSpeedMHz() {
@@ -442,6 +468,214 @@ unsigned OpenMpManager::getProcessorSpeedMHz() {
   return openMpManager.collection.getProcessorSpeedMHz();
 }
 
+/* Function getPartitionCpuSet() orders available cores by socket, so that
+   no partition spans two sockets when the number of partitions is a
+   multiple of the number of sockets. With more partitions than cores,
+   partitions share cores. */
+
+void OpenMpManager::getPartitionCpuSet(unsigned partitionId,
+    unsigned numberOfPartitions, cpu_set_t *set) {
+  OpenMpManager &openMpManager = getInstance();
+  CHECK_LT(partitionId, numberOfPartitions);
+
+  std::vector<std::pair<unsigned, unsigned> > cores;
+  unsigned numberOfProcessors =
+    openMpManager.collection.getNumberOfProcessors();
+  for (int processorId = 0; processorId < numberOfProcessors; processorId++) {
+    if (CPU_ISSET(processorId, &openMpManager.currentCoreSet)) {
+      cores.push_back(std::make_pair(getSocketId(processorId), processorId));
+    }
+  }
+  std::sort(cores.begin(), cores.end());
+  CHECK(!cores.empty());
+
+  unsigned numberOfCores = cores.size();
+  unsigned begin = numberOfCores * partitionId / numberOfPartitions;
+  unsigned end = numberOfCores * (partitionId + 1) / numberOfPartitions;
+  end = std::max(end, begin + 1);
+
+  CPU_ZERO(set);
+  for (unsigned i = begin; i < end; i++) {
+    CPU_SET(cores[i].second, set);
+  }
+}
+
+unsigned OpenMpManager::getSocketId(unsigned processorId) {
+  OpenMpManager &openMpManager = getInstance();
+  if (processorId >= openMpManager.collection.getNumberOfProcessors()) {
+    return 0;
+  }
+  return openMpManager.collection.getProcessor(processorId).physicalId;
+}
+
+void OpenMpManager::bindCurrentThreadToCpuSet(const cpu_set_t *set) {
+  OpenMpManager &openMpManager = getInstance();
+  omp_set_num_threads(CPU_COUNT(set));
+  if (!openMpManager.isThreadsBindAllowed())
+    return;
+
+  sched_setaffinity(0, sizeof(*set), set);
+  #pragma omp parallel
+  {
+    int cpuIndex = omp_get_thread_num();
+    int processorId = 0;
+    for (; processorId < CPU_SETSIZE; processorId++) {
+      if (CPU_ISSET(processorId, set) && !cpuIndex--) {
+        break;
+      }
+    }
+
+    cpu_set_t threadSet;
+    CPU_ZERO(&threadSet);
+    CPU_SET(processorId, &threadSet);
+    sched_setaffinity(0, sizeof(threadSet), &threadSet);
+  }
+}
+
+/* Test cores are the last logical cores and data cores the ones just before,
+   so that the compute team, bound to logical cores from the first one, can
+   use all the others, and tuning the data cores never moves the test cores.
+   At least one core is always left for compute. */
+
+void OpenMpManager::setNumberOfTestCores(unsigned numberOfCores) {
+  OpenMpManager &openMpManager = getInstance();
+  unsigned numberOfCoresAvailable = CPU_COUNT(&openMpManager.currentCoreSet);
+  numberOfCores = std::min(numberOfCores, numberOfCoresAvailable - 1);
+
+  boost::mutex::scoped_lock lock(openMpManager.dataCoresMutex);
+  openMpManager.numberOfTestCores = numberOfCores;
+  openMpManager.selectLogicalCores(numberOfCoresAvailable - numberOfCores,
+    numberOfCoresAvailable, &openMpManager.testCoreSet);
+  if (openMpManager.numberOfDataCores)
+    openMpManager.updateDataCoreSet(openMpManager.numberOfDataCores);
+}
+
+unsigned OpenMpManager::getNumberOfTestCores() {
+  OpenMpManager &openMpManager = getInstance();
+  boost::mutex::scoped_lock lock(openMpManager.dataCoresMutex);
+  return openMpManager.numberOfTestCores;
+}
+
+void OpenMpManager::bindCurrentThreadToTestCores() {
+  OpenMpManager &openMpManager = getInstance();
+  cpu_set_t set;
+  {
+    boost::mutex::scoped_lock lock(openMpManager.dataCoresMutex);
+    if (openMpManager.numberOfTestCores) {
+      set = openMpManager.testCoreSet;
+    } else {
+      // No reserved cores, the test team shares the compute cores instead
+      // of staying on the core of the thread that started it.
+      openMpManager.selectLogicalCores(0,
+        CPU_COUNT(&openMpManager.currentCoreSet) -
+        openMpManager.numberOfDataCores, &set);
+    }
+  }
+  bindCurrentThreadToCpuSet(&set);
+}
+
+void OpenMpManager::setNumberOfDataCores(unsigned numberOfCores) {
+  OpenMpManager &openMpManager = getInstance();
+  boost::mutex::scoped_lock lock(openMpManager.dataCoresMutex);
+  unsigned numberOfCoresAvailable = CPU_COUNT(&openMpManager.currentCoreSet) -
+    openMpManager.numberOfTestCores;
+  numberOfCores = std::min(numberOfCores, numberOfCoresAvailable - 1);
+  if (numberOfCores != openMpManager.numberOfDataCores)
+    openMpManager.updateDataCoreSet(numberOfCores);
+}
+
+// Called with dataCoresMutex held, clamps numberOfCores to the cores left
+// by the test cores and compute.
+void OpenMpManager::updateDataCoreSet(unsigned numberOfCores) {
+  unsigned numberOfCoresAvailable = CPU_COUNT(&currentCoreSet) -
+    numberOfTestCores;
+  numberOfDataCores = std::min(numberOfCores, numberOfCoresAvailable - 1);
+  selectLogicalCores(numberOfCoresAvailable - numberOfDataCores,
+    numberOfCoresAvailable, &dataCoreSet);
+  dataCoresVersion++;
+}
+
+unsigned OpenMpManager::getNumberOfDataCores() {
+  OpenMpManager &openMpManager = getInstance();
+  boost::mutex::scoped_lock lock(openMpManager.dataCoresMutex);
+  return openMpManager.numberOfDataCores;
+}
+
+/* Function tuneNumberOfDataCores() adds a core while compute waits for data
+   more than 5% of the time. It removes one while compute hardly waits, but
+   never down to a number of cores already found too few, so that it settles
+   instead of oscillating. */
+
+void OpenMpManager::tuneNumberOfDataCores(double waitRatio) {
+  OpenMpManager &openMpManager = getInstance();
+  if (!openMpManager.isThreadsBindAllowed())
+    return;
+
+  unsigned numberOfCores = getNumberOfDataCores();
+  if (waitRatio > 0.05) {
+    openMpManager.insufficientDataCores =
+      std::max(openMpManager.insufficientDataCores, numberOfCores);
+    setNumberOfDataCores(numberOfCores + 1);
+  } else if (waitRatio < 0.01 &&
+             numberOfCores > openMpManager.insufficientDataCores + 1) {
+    setNumberOfDataCores(numberOfCores - 1);
+  }
+
+  if (getNumberOfDataCores() != numberOfCores) {
+    LOG(INFO) << "Waiting for data " << waitRatio * 100 << "% of the time, "
+      << "using " << getNumberOfDataCores() << " data cores";
+    bindOpenMpThreads();
+  }
+}
+
+void OpenMpManager::bindCurrentThreadToDataCores(unsigned *bindingVersion,
+    bool bindOpenMpTeam) {
+  OpenMpManager &openMpManager = getInstance();
+  if (!openMpManager.isThreadsBindAllowed())
+    return;
+
+  cpu_set_t set;
+  unsigned numberOfCores;
+  {
+    boost::mutex::scoped_lock lock(openMpManager.dataCoresMutex);
+    if (*bindingVersion == openMpManager.dataCoresVersion)
+      return;
+    *bindingVersion = openMpManager.dataCoresVersion;
+    set = openMpManager.dataCoreSet;
+    numberOfCores = openMpManager.numberOfDataCores;
+  }
+
+  if (!numberOfCores) {
+    // Back to the default binding of background threads
+    bindCurrentThreadToNonPrimaryCoreIfPossible();
+    if (bindOpenMpTeam)
+      omp_set_num_threads(CPU_COUNT(&openMpManager.currentCoreSet));
+  } else if (bindOpenMpTeam) {
+    bindCurrentThreadToCpuSet(&set);
+  } else {
+    sched_setaffinity(0, sizeof(set), &set);
+  }
+}
+
+void OpenMpManager::bindCurrentThreadToComputeCores(bool bindOpenMpTeam) {
+  OpenMpManager &openMpManager = getInstance();
+  if (!openMpManager.isThreadsBindAllowed())
+    return;
+
+  cpu_set_t set;
+  {
+    boost::mutex::scoped_lock lock(openMpManager.dataCoresMutex);
+    openMpManager.selectLogicalCores(0,
+      CPU_COUNT(&openMpManager.currentCoreSet) -
+      openMpManager.numberOfDataCores - openMpManager.numberOfTestCores, &set);
+  }
+
+  if (bindOpenMpTeam)
+    bindCurrentThreadToCpuSet(&set);
+  else
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
 #endif  // _OPENMP
 
 }  // namespace cpu
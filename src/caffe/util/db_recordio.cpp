@@ -0,0 +1,244 @@
+#include "caffe/util/db_recordio.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/util/format.hpp"
+#include "caffe/util/rng.hpp"
+
+namespace caffe { namespace db {
+
+const uint32_t RecordIOCursor::kMagic;
+const size_t RecordIOCursor::kHeaderSize;
+const size_t RecordIOCursor::kBlockSize;
+const int64_t RecordIO::kDefaultShardSize;
+
+RecordIOCursor::RecordIOCursor(const string& source,
+    const vector<RecordIOShard>& shards, bool shuffle_shards, int partition,
+    int num_partitions)
+    : source_(source), shards_(shards), shuffle_shards_(shuffle_shards),
+      partition_(partition), num_partitions_(num_partitions), position_(0),
+      index_(0), fd_(-1), file_offset_(0), buffer_(kBlockSize), record_(0),
+      end_(0), key_size_(0), value_size_(0), valid_(false) {
+  int64_t start = 0;
+  for (int i = 0; i < shards_.size(); ++i) {
+    order_.push_back(i);
+    shard_starts_.push_back(start);
+    start += shards_[i].records;
+  }
+  SeekToFirst();
+}
+
+void RecordIOCursor::SeekToFirst() {
+  if (shuffle_shards_) {
+    shuffle(order_.begin(), order_.end());
+  }
+  OpenShard(0);
+  ReadRecord();
+}
+
+void RecordIOCursor::Next() {
+  CHECK(valid_);
+  record_ += kHeaderSize + key_size_ + value_size_;
+  ++index_;
+  ReadRecord();
+}
+
+void RecordIOCursor::OpenShard(int position) {
+  CloseShard();
+  position_ = position;
+  file_offset_ = 0;
+  record_ = 0;
+  end_ = 0;
+  if (position_ >= order_.size()) {
+    return;
+  }
+  index_ = shard_starts_[order_[position_]];
+  const string path = source_ + "/" + shards_[order_[position_]].name;
+  fd_ = open(path.c_str(), O_RDONLY);
+  CHECK_NE(fd_, -1) << "File not found: " << path;
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+void RecordIOCursor::CloseShard() {
+  if (fd_ != -1) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+bool RecordIOCursor::Fill(size_t size) {
+  if (end_ - record_ >= size) {
+    return true;
+  }
+  // Moves the start of the record to the front of the buffer, which only
+  // grows for records larger than a block.
+  memmove(&buffer_[0], &buffer_[0] + record_, end_ - record_);
+  end_ -= record_;
+  record_ = 0;
+  if (buffer_.size() < size) {
+    buffer_.resize(size);
+  }
+  const RecordIOShard& shard = shards_[order_[position_]];
+  while (end_ < size) {
+    const size_t count = std::min<int64_t>(buffer_.size() - end_,
+        shard.bytes - file_offset_);
+    if (count == 0) {
+      return false;
+    }
+    const ssize_t n = read(fd_, &buffer_[end_], count);
+    CHECK_GT(n, 0) << "Failed to read " << source_ << "/" << shard.name;
+    end_ += n;
+    file_offset_ += n;
+  }
+  // Reads the next block in the background while this one is parsed
+  if (file_offset_ < shard.bytes) {
+    posix_fadvise(fd_, file_offset_, kBlockSize, POSIX_FADV_WILLNEED);
+  }
+  return true;
+}
+
+void RecordIOCursor::ReadRecord() {
+  while (position_ < order_.size()) {
+    if (Fill(kHeaderSize)) {
+      const string& name = shards_[order_[position_]].name;
+      uint32_t header[3];
+      memcpy(header, &buffer_[record_], kHeaderSize);
+      CHECK_EQ(header[0], kMagic) << "Corrupted record in " << source_ << "/"
+          << name;
+      key_size_ = header[1];
+      value_size_ = header[2];
+      CHECK(Fill(kHeaderSize + key_size_ + value_size_))
+          << "Truncated record in " << source_ << "/" << name;
+      if (index_ % num_partitions_ == partition_) {
+        valid_ = true;
+        return;
+      }
+      record_ += kHeaderSize + key_size_ + value_size_;
+      ++index_;
+      continue;
+    }
+    CHECK_EQ(end_, record_) << "Truncated record in " << source_ << "/"
+        << shards_[order_[position_]].name;
+    OpenShard(position_ + 1);
+  }
+  valid_ = false;
+}
+
+void RecordIOTransaction::Put(const string& key, const string& value) {
+  const uint32_t header[3] = {RecordIOCursor::kMagic,
+      static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size())};
+  batch_.append(reinterpret_cast<const char*>(header), sizeof(header));
+  batch_.append(key);
+  batch_.append(value);
+  ++records_;
+}
+
+void RecordIOTransaction::Commit() {
+  if (records_ > 0) {
+    db_->Append(batch_, records_);
+  }
+  batch_.clear();
+  records_ = 0;
+}
+
+void RecordIO::Open(const string& source, Mode mode) {
+  source_ = source;
+  mode_ = mode;
+  shards_.clear();
+  if (mode == NEW) {
+    CHECK_EQ(mkdir(source.c_str(), 0744), 0) << "mkdir " << source << " failed";
+    WriteIndex();
+  } else {
+    ReadIndex();
+  }
+  LOG(INFO) << "Opened recordio " << source;
+}
+
+RecordIOCursor* RecordIO::NewCursor() {
+  if (shards_.size() < num_partitions_) {
+    LOG(INFO) << "Fewer shards than partitions in " << source_
+              << ", partitioning by record";
+    return new RecordIOCursor(source_, shards_, shuffle_shards_, partition_,
+        num_partitions_);
+  }
+  vector<RecordIOShard> shards;
+  for (int i = partition_; i < shards_.size(); i += num_partitions_) {
+    shards.push_back(shards_[i]);
+  }
+  return new RecordIOCursor(source_, shards, shuffle_shards_, 0, 1);
+}
+
+void RecordIO::set_partition(int partition, int num_partitions) {
+  CHECK_GT(num_partitions, 0);
+  CHECK_GE(partition, 0);
+  CHECK_LT(partition, num_partitions);
+  partition_ = partition;
+  num_partitions_ = num_partitions;
+}
+
+void RecordIO::Close() {
+  if (file_ != NULL) {
+    fclose(file_);
+    file_ = NULL;
+  }
+}
+
+void RecordIO::Append(const string& records, int64_t count) {
+  // Writes start a new shard after opening, existing shards are never changed
+  if (file_ == NULL || shards_.back().bytes >= shard_size_) {
+    Close();
+    RecordIOShard shard;
+    shard.name = "shard_" + format_int(shards_.size(), 5);
+    shard.records = 0;
+    shard.bytes = 0;
+    const string path = source_ + "/" + shard.name;
+    file_ = fopen(path.c_str(), "wb");
+    CHECK(file_) << "Failed to open " << path;
+    shards_.push_back(shard);
+  }
+  CHECK_EQ(fwrite(records.data(), 1, records.size(), file_), records.size())
+      << "Failed to write to " << source_ << "/" << shards_.back().name;
+  CHECK_EQ(fflush(file_), 0) << "Failed to write to " << source_ << "/"
+      << shards_.back().name;
+  shards_.back().records += count;
+  shards_.back().bytes += records.size();
+  WriteIndex();
+}
+
+void RecordIO::ReadIndex() {
+  const string path = source_ + "/index";
+  std::ifstream in(path.c_str());
+  CHECK(in.is_open()) << "File not found: " << path;
+  RecordIOShard shard;
+  while (in >> shard.name >> shard.records >> shard.bytes) {
+    shards_.push_back(shard);
+  }
+  CHECK(in.eof()) << "Failed to parse " << path;
+}
+
+void RecordIO::WriteIndex() {
+  // Replaces the index at once, for readers of a db being written
+  const string path = source_ + "/index";
+  const string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp.c_str());
+    for (int i = 0; i < shards_.size(); ++i) {
+      out << shards_[i].name << " " << shards_[i].records << " "
+          << shards_[i].bytes << "\n";
+    }
+    CHECK(out.good()) << "Failed to write " << tmp;
+  }
+  CHECK_EQ(rename(tmp.c_str(), path.c_str()), 0) << "Failed to write "
+      << path;
+}
+
+}  // namespace db
+}  // namespace caffe
@@ -5,11 +5,9 @@
 
 namespace caffe {
 
-// Verifies format of data stored in HDF5 file and reshapes blob accordingly.
-template <typename Dtype>
-void hdf5_load_nd_dataset_helper(
-    hid_t file_id, const char* dataset_name_, int min_dim, int max_dim,
-    Blob<Dtype>* blob) {
+// Verifies format of data stored in HDF5 file and returns its shape.
+vector<int> hdf5_get_nd_dataset_shape(
+    hid_t file_id, const char* dataset_name_, int min_dim, int max_dim) {
   // Verify that the dataset exists.
   CHECK(H5LTfind_dataset(file_id, dataset_name_))
       << "Failed to find HDF5 dataset " << dataset_name_;
@@ -60,7 +58,16 @@ void hdf5_load_nd_dataset_helper(
   for (int i = 0; i < dims.size(); ++i) {
     blob_dims[i] = dims[i];
   }
-  blob->Reshape(blob_dims);
+  return blob_dims;
+}
+
+// Verifies format of data stored in HDF5 file and reshapes blob accordingly.
+template <typename Dtype>
+void hdf5_load_nd_dataset_helper(
+    hid_t file_id, const char* dataset_name_, int min_dim, int max_dim,
+    Blob<Dtype>* blob) {
+  blob->Reshape(
+      hdf5_get_nd_dataset_shape(file_id, dataset_name_, min_dim, max_dim));
 }
 
 template <>
@@ -81,6 +88,51 @@ void hdf5_load_nd_dataset<double>(hid_t file_id, const char* dataset_name_,
   CHECK_GE(status, 0) << "Failed to read double dataset " << dataset_name_;
 }
 
+// Reads num_rows rows from row_begin, as a hyperslab of the first dimension.
+template <typename Dtype>
+static void hdf5_load_nd_dataset_rows_helper(
+    hid_t file_id, const char* dataset_name_, int min_dim, int max_dim,
+    int row_begin, int num_rows, hid_t mem_type, Blob<Dtype>* blob) {
+  vector<int> shape =
+      hdf5_get_nd_dataset_shape(file_id, dataset_name_, min_dim, max_dim);
+  CHECK_GE(row_begin, 0);
+  CHECK_LE(row_begin + num_rows, shape[0])
+      << "Rows out of range for dataset " << dataset_name_;
+  shape[0] = num_rows;
+  blob->Reshape(shape);
+  std::vector<hsize_t> offset(shape.size(), 0);
+  std::vector<hsize_t> count(shape.begin(), shape.end());
+  offset[0] = row_begin;
+  hid_t dataset = H5Dopen2(file_id, dataset_name_, H5P_DEFAULT);
+  CHECK_GE(dataset, 0) << "Failed to open dataset " << dataset_name_;
+  hid_t file_space = H5Dget_space(dataset);
+  herr_t status = H5Sselect_hyperslab(file_space, H5S_SELECT_SET,
+      offset.data(), NULL, count.data(), NULL);
+  CHECK_GE(status, 0) << "Failed to select rows of dataset " << dataset_name_;
+  hid_t mem_space = H5Screate_simple(count.size(), count.data(), NULL);
+  status = H5Dread(dataset, mem_type, mem_space, file_space, H5P_DEFAULT,
+      blob->mutable_cpu_data());
+  CHECK_GE(status, 0) << "Failed to read rows of dataset " << dataset_name_;
+  H5Sclose(mem_space);
+  H5Sclose(file_space);
+  H5Dclose(dataset);
+}
+
+template <>
+void hdf5_load_nd_dataset_rows<float>(hid_t file_id, const char* dataset_name_,
+    int min_dim, int max_dim, int row_begin, int num_rows, Blob<float>* blob) {
+  hdf5_load_nd_dataset_rows_helper(file_id, dataset_name_, min_dim, max_dim,
+      row_begin, num_rows, H5T_NATIVE_FLOAT, blob);
+}
+
+template <>
+void hdf5_load_nd_dataset_rows<double>(hid_t file_id,
+    const char* dataset_name_, int min_dim, int max_dim, int row_begin,
+    int num_rows, Blob<double>* blob) {
+  hdf5_load_nd_dataset_rows_helper(file_id, dataset_name_, min_dim, max_dim,
+      row_begin, num_rows, H5T_NATIVE_DOUBLE, blob);
+}
+
 template <>
 void hdf5_save_nd_dataset<float>(
     const hid_t file_id, const string& dataset_name, const Blob<float>& blob,
@@ -0,0 +1,246 @@
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#ifdef USE_MKL
+#include <mkl_service.h>
+#endif
+
+#include "caffe/util/host_memory_pool.hpp"
+
+namespace caffe {
+
+namespace {
+
+// The header in front of every block keeps the memory handed out aligned
+// to 64 bytes, as mkl_malloc does.
+const size_t kHeaderSize = 64;
+const size_t kMinBlockSize = 64;
+// Blocks of at least this size are mapped directly, so that they can be
+// bound to a node and backed by huge pages.
+const size_t kLargeBlockSize = 2 << 20;
+const int kMaxNodes = 64;
+const size_t kDefaultMaxCachedBytes = size_t(1) << 30;
+
+struct BlockHeader {
+  size_t bytes;
+  int node;
+};
+
+// Rounds size up to its size class, four classes per power of two.
+size_t BlockSize(size_t size) {
+  if (size <= kMinBlockSize) {
+    return kMinBlockSize;
+  }
+  size_t power = kMinBlockSize;
+  while (power * 2 < size) {
+    power *= 2;
+  }
+  const size_t step = power / 4;
+  return (size + step - 1) / step * step;
+}
+
+int NumNodes() {
+  int num_nodes = 0;
+  char path[64];
+  while (num_nodes < kMaxNodes) {
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d",
+        num_nodes);
+    if (access(path, F_OK) != 0) {
+      break;
+    }
+    ++num_nodes;
+  }
+  return std::max(num_nodes, 1);
+}
+
+}  // namespace
+
+HostMemoryPool& HostMemoryPool::Get() {
+  // Never destroyed, as blobs may still be freed during static destruction.
+  static HostMemoryPool* pool = new HostMemoryPool();
+  return *pool;
+}
+
+HostMemoryPool::HostMemoryPool()
+  : max_cached_bytes_(kDefaultMaxCachedBytes), huge_pages_(false) {
+  const int num_nodes = NumNodes();
+  for (int i = 0; i < num_nodes; ++i) {
+    arenas_.push_back(shared_ptr<Arena>(new Arena()));
+  }
+  const char* max_cached_mb = getenv("CAFFE_HOST_POOL_MAX_CACHED_MB");
+  if (max_cached_mb) {
+    max_cached_bytes_ = static_cast<size_t>(atol(max_cached_mb)) << 20;
+  }
+  const char* huge_pages = getenv("CAFFE_HOST_POOL_HUGE_PAGES");
+  if (huge_pages) {
+    huge_pages_ = atoi(huge_pages) != 0;
+  }
+}
+
+void* HostMemoryPool::Allocate(size_t size) {
+  const size_t bytes = BlockSize(size);
+  const int node = CurrentNode();
+  void* block = NULL;
+  {
+    Arena& arena = *arenas_[node];
+    boost::mutex::scoped_lock lock(arena.mutex);
+    std::map<size_t, std::vector<void*> >::iterator it =
+        arena.free_blocks.find(bytes);
+    if (it != arena.free_blocks.end() && !it->second.empty()) {
+      block = it->second.back();
+      it->second.pop_back();
+    }
+  }
+  {
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    ++stats_.allocations;
+    if (block) {
+      ++stats_.hits;
+      stats_.bytes_cached -= bytes;
+    }
+    stats_.bytes_in_use += bytes;
+    stats_.peak_bytes_in_use =
+        std::max(stats_.peak_bytes_in_use, stats_.bytes_in_use);
+  }
+  if (!block) {
+    block = SystemAllocate(bytes, node);
+    BlockHeader* header = static_cast<BlockHeader*>(block);
+    header->bytes = bytes;
+    header->node = node;
+  }
+  return static_cast<char*>(block) + kHeaderSize;
+}
+
+void HostMemoryPool::Free(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  void* block = static_cast<char*>(ptr) - kHeaderSize;
+  const BlockHeader* header = static_cast<const BlockHeader*>(block);
+  const size_t bytes = header->bytes;
+  bool cache;
+  {
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    stats_.bytes_in_use -= bytes;
+    cache = stats_.bytes_cached + bytes <= max_cached_bytes_;
+    if (cache) {
+      stats_.bytes_cached += bytes;
+    }
+  }
+  if (cache) {
+    Arena& arena = *arenas_[header->node];
+    boost::mutex::scoped_lock lock(arena.mutex);
+    arena.free_blocks[bytes].push_back(block);
+  } else {
+    SystemFree(block, bytes);
+  }
+}
+
+void HostMemoryPool::ReleaseCached() {
+  for (int i = 0; i < arenas_.size(); ++i) {
+    std::map<size_t, std::vector<void*> > free_blocks;
+    {
+      boost::mutex::scoped_lock lock(arenas_[i]->mutex);
+      free_blocks.swap(arenas_[i]->free_blocks);
+    }
+    size_t released = 0;
+    for (std::map<size_t, std::vector<void*> >::iterator it =
+         free_blocks.begin(); it != free_blocks.end(); ++it) {
+      for (int j = 0; j < it->second.size(); ++j) {
+        SystemFree(it->second[j], it->first);
+        released += it->first;
+      }
+    }
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    stats_.bytes_cached -= released;
+  }
+}
+
+HostMemoryStats HostMemoryPool::stats() {
+  boost::mutex::scoped_lock lock(stats_mutex_);
+  return stats_;
+}
+
+void HostMemoryPool::set_max_cached_bytes(size_t bytes) {
+  {
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    max_cached_bytes_ = bytes;
+  }
+  if (stats().bytes_cached > bytes) {
+    ReleaseCached();
+  }
+}
+
+void HostMemoryPool::set_huge_pages(bool enable) {
+  huge_pages_ = enable;
+}
+
+int HostMemoryPool::CurrentNode() const {
+  if (arenas_.size() == 1) {
+    return 0;
+  }
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 ||
+      node >= arenas_.size()) {
+    return 0;
+  }
+  return node;
+}
+
+void* HostMemoryPool::SystemAllocate(size_t bytes, int node) {
+  const size_t total = bytes + kHeaderSize;
+  void* block = NULL;
+  if (total >= kLargeBlockSize) {
+    block = mmap(NULL, total, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(block != MAP_FAILED) << "host allocation of size " << bytes
+        << " failed";
+#ifdef MADV_HUGEPAGE
+    if (huge_pages_) {
+      madvise(block, total, MADV_HUGEPAGE);
+    }
+#endif
+#ifdef SYS_mbind
+    if (arenas_.size() > 1) {
+      // Best effort: prefer the node of the allocating thread rather than
+      // the one of whichever thread first touches the pages.
+      const int kMpolPreferred = 1;
+      unsigned long nodemask = 1UL << node;  // NOLINT(runtime/int)
+      syscall(SYS_mbind, block, total, kMpolPreferred, &nodemask,
+          sizeof(nodemask) * 8, 0);
+    }
+#endif
+    return block;
+  }
+#ifdef USE_MKL
+  block = mkl_malloc(total, 64);
+#else
+  if (posix_memalign(&block, 64, total) != 0) {
+    block = NULL;
+  }
+#endif
+  CHECK(block) << "host allocation of size " << bytes << " failed";
+  return block;
+}
+
+void HostMemoryPool::SystemFree(void* block, size_t bytes) {
+  const size_t total = bytes + kHeaderSize;
+  if (total >= kLargeBlockSize) {
+    munmap(block, total);
+    return;
+  }
+#ifdef USE_MKL
+  mkl_free(block);
+#else
+  free(block);
+#endif
+}
+
+}  // namespace caffe
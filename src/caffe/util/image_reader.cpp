@@ -0,0 +1,165 @@
+#include <boost/thread.hpp>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "caffe/util/cpu_info.hpp"
+#include "caffe/util/image_reader.hpp"
+
+namespace caffe {
+
+const size_t AsyncFileReader::kAlignment;
+
+bool FileRead::Wait() {
+  if (!done_) {
+    ready_.pop();
+    done_ = true;
+  }
+  return ok_;
+}
+
+AsyncFileReader::AsyncFileReader(int threads, bool direct_io)
+    : direct_io_(direct_io) {
+  CHECK_GT(threads, 0);
+  for (int i = 0; i < threads; ++i) {
+    threads_.push_back(shared_ptr<boost::thread>(new boost::thread(
+        &AsyncFileReader::Entry, this)));
+  }
+}
+
+AsyncFileReader::~AsyncFileReader() {
+  for (int i = 0; i < threads_.size(); ++i) {
+    threads_[i]->interrupt();
+  }
+  for (int i = 0; i < threads_.size(); ++i) {
+    threads_[i]->join();
+  }
+}
+
+shared_ptr<FileRead> AsyncFileReader::Read(const string& path) {
+  shared_ptr<FileRead> read(new FileRead(path));
+  pending_.push(read);
+  return read;
+}
+
+void AsyncFileReader::Entry() {
+#ifdef _OPENMP
+  // Off the core of the main thread, like InternalThread, until cores are
+  // reserved for data loading, then on those
+  cpu::OpenMpManager::bindCurrentThreadToNonPrimaryCoreIfPossible();
+  unsigned data_cores_version = 0;
+#endif
+  try {
+    for (;;) {
+      shared_ptr<FileRead> read = pending_.pop();
+#ifdef _OPENMP
+      cpu::OpenMpManager::bindCurrentThreadToDataCores(&data_cores_version,
+          false);
+#endif
+      read->ok_ = ReadFile(read->path_, direct_io_, &read->contents_);
+      read->ready_.push(0);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+#ifdef O_DIRECT
+// Reads with O_DIRECT, returns false if not supported for the file.
+static bool ReadFileDirect(const string& path, string* contents) {
+  const int fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  // Buffer, offsets and sizes must be aligned, the last read stops short at
+  // the end of the file.
+  const size_t size = ok ? st.st_size : 0;
+  const size_t kAlignment = AsyncFileReader::kAlignment;
+  const size_t aligned = (size + kAlignment - 1) / kAlignment * kAlignment;
+  void* buffer = NULL;
+  ok = ok && posix_memalign(&buffer, kAlignment,
+      std::max(aligned, kAlignment)) == 0;
+  size_t done = 0;
+  while (ok && done < size) {
+    const ssize_t n = read(fd, static_cast<char*>(buffer) + done,
+        aligned - done);
+    ok = n > 0 && (done + n >= size || n % kAlignment == 0);
+    done += std::max<ssize_t>(n, 0);
+  }
+  if (ok) {
+    contents->assign(static_cast<char*>(buffer), size);
+  }
+  free(buffer);
+  close(fd);
+  return ok;
+}
+#endif  // O_DIRECT
+
+bool AsyncFileReader::ReadFile(const string& path, bool direct_io,
+    string* contents) {
+#ifdef O_DIRECT
+  if (direct_io && ReadFileDirect(path, contents)) {
+    return true;
+  }
+#endif  // O_DIRECT
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  if (ok) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    contents->resize(st.st_size);
+  }
+  size_t done = 0;
+  while (ok && done < contents->size()) {
+    const ssize_t n = read(fd, &(*contents)[done], contents->size() - done);
+    ok = n > 0;
+    done += std::max<ssize_t>(n, 0);
+  }
+  close(fd);
+  return ok;
+}
+
+#ifdef USE_OPENCV
+bool ImageCache::Get(const string& key, cv::Mat* image) {
+  boost::mutex::scoped_lock lock(mutex_);
+  std::map<string, Entries::iterator>::iterator it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  *image = it->second->second;
+  return true;
+}
+
+void ImageCache::Put(const string& key, const cv::Mat& image) {
+  if (capacity_ <= 0) {
+    return;
+  }
+  boost::mutex::scoped_lock lock(mutex_);
+  std::map<string, Entries::iterator>::iterator it = index_.find(key);
+  if (it != index_.end()) {
+    entries_.splice(entries_.begin(), entries_, it->second);
+    it->second->second = image;
+    return;
+  }
+  entries_.push_front(std::make_pair(key, image));
+  index_[key] = entries_.begin();
+  if (static_cast<int>(index_.size()) > capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+#endif  // USE_OPENCV
+
+}  // namespace caffe
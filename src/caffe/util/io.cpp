@@ -90,6 +90,29 @@ cv::Mat ReadImageToCVMat(const string& filename,
   return cv_img;
 }
 
+cv::Mat DecodeImageToCVMat(const string& buffer,
+    const int height, const int width, const bool is_color) {
+  cv::Mat cv_img;
+  int cv_read_flag = (is_color ? CV_LOAD_IMAGE_COLOR :
+    CV_LOAD_IMAGE_GRAYSCALE);
+  if (buffer.empty()) {
+    return cv_img;
+  }
+  // Decodes in place, without copying the buffer
+  const cv::Mat raw(1, buffer.size(), CV_8UC1,
+      const_cast<char*>(buffer.data()));
+  cv::Mat cv_img_origin = cv::imdecode(raw, cv_read_flag);
+  if (!cv_img_origin.data) {
+    return cv_img_origin;
+  }
+  if (height > 0 && width > 0) {
+    cv::resize(cv_img_origin, cv_img, cv::Size(width, height));
+  } else {
+    cv_img = cv_img_origin;
+  }
+  return cv_img;
+}
+
 cv::Mat ReadImageToCVMat(const string& filename,
     const int height, const int width) {
   return ReadImageToCVMat(filename, height, width, true);
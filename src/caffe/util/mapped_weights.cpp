@@ -0,0 +1,165 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/util/mapped_weights.hpp"
+
+namespace caffe {
+
+namespace {
+
+const char kMagic[8] = {'C', 'A', 'F', 'F', 'E', 'M', 'A', 'P'};
+const uint32_t kVersion = 1;
+const size_t kPageSize = 4096;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t element_size;
+  uint64_t index_size;
+  uint64_t data_offset;
+};
+
+size_t Align(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Number of values of a blob, from either the shape or the legacy 4D fields.
+size_t BlobProtoCount(const BlobProto& proto) {
+  if (proto.has_num() || proto.has_channels() ||
+      proto.has_height() || proto.has_width()) {
+    return static_cast<size_t>(proto.num()) * proto.channels() *
+        proto.height() * proto.width();
+  }
+  size_t count = 1;
+  for (int i = 0; i < proto.shape().dim_size(); ++i) {
+    count *= proto.shape().dim(i);
+  }
+  return count;
+}
+
+// Assigns each blob of the index its offset in the file.
+size_t ComputeOffsets(const NetParameter& index, size_t data_offset,
+    int element_size, vector<vector<size_t> >* offsets) {
+  offsets->resize(index.layer_size());
+  size_t offset = data_offset;
+  for (int i = 0; i < index.layer_size(); ++i) {
+    const LayerParameter& layer = index.layer(i);
+    (*offsets)[i].resize(layer.blobs_size());
+    for (int j = 0; j < layer.blobs_size(); ++j) {
+      offset = Align(offset, kMappedWeightsAlignment);
+      (*offsets)[i][j] = offset;
+      offset += BlobProtoCount(layer.blobs(j)) * element_size;
+    }
+  }
+  return offset;
+}
+
+}  // namespace
+
+MappedWeights::MappedWeights(const string& filename)
+  : filename_(filename), addr_(NULL), size_(0), element_size_(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Couldn't open " << filename;
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "Couldn't stat " << filename;
+  size_ = st.st_size;
+  CHECK_GE(size_, sizeof(Header)) << filename << " is not a weights map";
+  addr_ = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  CHECK(addr_ != MAP_FAILED) << "Couldn't map " << filename;
+
+  const Header* header = static_cast<const Header*>(addr_);
+  CHECK_EQ(memcmp(header->magic, kMagic, sizeof(kMagic)), 0)
+      << filename << " is not a weights map";
+  CHECK_EQ(header->version, kVersion)
+      << "Unsupported weights map version in " << filename;
+  CHECK(header->element_size == sizeof(float) ||
+        header->element_size == sizeof(double))
+      << "Unsupported element size in " << filename;
+  element_size_ = header->element_size;
+  CHECK_LE(sizeof(Header) + header->index_size, size_)
+      << "Truncated weights map " << filename;
+  CHECK(index_.ParseFromArray(static_cast<const char*>(addr_) + sizeof(Header),
+      header->index_size)) << "Couldn't parse the index of " << filename;
+  CHECK_LE(ComputeOffsets(index_, header->data_offset, element_size_,
+      &offsets_), size_) << "Truncated weights map " << filename;
+}
+
+MappedWeights::~MappedWeights() {
+  munmap(addr_, size_);
+}
+
+void* MappedWeights::blob_data(int i, int j) const {
+  return static_cast<char*>(addr_) + offsets_[i][j];
+}
+
+template <typename Dtype>
+void WriteMappedWeights(const NetParameter& param, const string& filename) {
+  // The index keeps the shapes, in their original form, but none of the data.
+  NetParameter index;
+  index.set_name(param.name());
+  for (int i = 0; i < param.layer_size(); ++i) {
+    const LayerParameter& source_layer = param.layer(i);
+    LayerParameter* layer = index.add_layer();
+    layer->set_name(source_layer.name());
+    layer->set_type(source_layer.type());
+    for (int j = 0; j < source_layer.blobs_size(); ++j) {
+      BlobProto* blob = layer->add_blobs();
+      *blob = source_layer.blobs(j);
+      blob->clear_data();
+      blob->clear_diff();
+      blob->clear_double_data();
+      blob->clear_double_diff();
+    }
+  }
+  string index_string;
+  CHECK(index.SerializeToString(&index_string));
+
+  Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.element_size = sizeof(Dtype);
+  header.index_size = index_string.size();
+  header.data_offset = Align(sizeof(header) + index_string.size(), kPageSize);
+  vector<vector<size_t> > offsets;
+  ComputeOffsets(index, header.data_offset, sizeof(Dtype), &offsets);
+
+  std::ofstream output(filename.c_str(),
+      std::ios::out | std::ios::trunc | std::ios::binary);
+  CHECK(output.good()) << "Couldn't open " << filename;
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  output.write(index_string.data(), index_string.size());
+  const vector<char> padding(kPageSize, 0);
+  output.write(&padding[0],
+      header.data_offset - sizeof(header) - index_string.size());
+  size_t offset = header.data_offset;
+  for (int i = 0; i < param.layer_size(); ++i) {
+    const LayerParameter& source_layer = param.layer(i);
+    for (int j = 0; j < source_layer.blobs_size(); ++j) {
+      Blob<Dtype> blob;
+      blob.FromProto(source_layer.blobs(j), true);
+      CHECK_EQ(blob.count(), BlobProtoCount(index.layer(i).blobs(j)));
+      output.write(&padding[0], offsets[i][j] - offset);
+      output.write(reinterpret_cast<const char*>(blob.cpu_data()),
+          blob.count() * sizeof(Dtype));
+      offset = offsets[i][j] + blob.count() * sizeof(Dtype);
+    }
+  }
+  CHECK(output.good()) << "Failed to write " << filename;
+}
+
+template void WriteMappedWeights<float>(const NetParameter& param,
+    const string& filename);
+template void WriteMappedWeights<double>(const NetParameter& param,
+    const string& filename);
+
+}  // namespace caffe
@@ -11,7 +11,9 @@
 #include <boost/random.hpp>
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
+#include <vector>
 
 #include "caffe/common.hpp"
 #include "caffe/util/cpu_info.hpp"
@@ -125,6 +127,20 @@ void caffe_add_scalar(const int N, const double alpha, double* Y) {
   }
 }
 
+bool caffe_cpu_run_parallel(const int N) {
+#ifdef _OPENMP
+  int nthr = omp_get_max_threads();
+  int threshold = nthr * caffe::cpu::OpenMpManager::getProcessorSpeedMHz() / 3;
+  return
+    (caffe::cpu::OpenMpManager::isMajorThread(boost::this_thread::get_id())) &&
+    (N >= threshold) &&
+    (omp_in_parallel() == 0) &&
+    (Caffe::mode() != Caffe::GPU);
+#else
+  return false;
+#endif
+}
+
 template <typename Dtype>
 void caffe_cpu_copy(const int N, const Dtype* X, Dtype* Y) {
   if (X == Y) return;
@@ -290,24 +306,254 @@ void caffe_sqr<double>(const int n, const double* a, double* y) {
   vdSqr(n, a, y);
 }
 
+// Runs kernel over [0, n) split across the OpenMP threads. Transcendental
+// functions cost much more per element than a copy, so the threshold is
+// lower than the one of caffe_set and caffe_cpu_copy.
+template <typename Dtype>
+static void caffe_cpu_parallel_unary(const int n, const Dtype* a, Dtype* y,
+    void (*kernel)(const int, const Dtype*, Dtype*)) {
+  if (n <= 0) return;
+#ifdef _OPENMP
+  const int nthr = omp_get_max_threads();
+  const int threshold =
+      nthr * caffe::cpu::OpenMpManager::getProcessorSpeedMHz() / 48;
+  const bool run_parallel = (nthr > 1) &&
+    (omp_in_parallel() == 0) &&
+    (n >= threshold) &&
+    (Caffe::mode() != Caffe::GPU) &&
+    (caffe::cpu::OpenMpManager::isMajorThread(boost::this_thread::get_id()));
+
+  if (run_parallel) {
+#   pragma omp parallel num_threads(nthr)
+    {
+      const int ithr = omp_get_thread_num();
+      const int avg_amount = (n + nthr - 1) / nthr;
+      const int my_offset = ithr * avg_amount;
+      const int my_amount = std::min(my_offset + avg_amount, n) - my_offset;
+      if (my_amount > 0) {
+        kernel(my_amount, a + my_offset, y + my_offset);
+      }
+    }
+    return;
+  }
+#endif
+  kernel(n, a, y);
+}
+
+#ifndef USE_MKL
+// Cephes-style single precision approximations, written without branches so
+// that the loops calling them get vectorized. They stay within a few ulp of
+// the libm results.
+
+// Returns c ? a : b as a bitwise blend; a conditional expression would be
+// kept as a branch since the compiler may not evaluate both arms.
+static inline float select_float(const bool c, const float a, const float b) {
+  union { float f; int i; } bits_a, bits_b, bits;
+  bits_a.f = a;
+  bits_b.f = b;
+  const int mask = -static_cast<int>(c);
+  bits.i = (bits_a.i & mask) | (bits_b.i & ~mask);
+  return bits.f;
+}
+
+static inline float pow2i(const int k) {
+  union { int i; float f; } bits;
+  bits.i = (k + 127) << 23;
+  return bits.f;
+}
+
+static inline float exp_approx(const float a) {
+  // Below -104 the result underflows to zero, above log(FLT_MAX) it
+  // overflows to +inf; NaN is returned unchanged.
+  const float overflow = 88.7228391116729996f;
+  float x = select_float(a != a, 0.f, a);
+  x = select_float(x < -104.f, -104.f, x);
+  x = select_float(x > overflow, overflow, x);
+  // exp(x) = 2^k * exp(r) with r = x - k * ln(2) in [-ln(2) / 2, ln(2) / 2].
+  const float fk = x * 1.44269504088896341f + 0.5f;
+  int k = static_cast<int>(fk);
+  k -= (k > fk);
+  const float kf = static_cast<float>(k);
+  float r = x - kf * 0.693359375f;
+  r -= kf * -2.12194440e-4f;
+  float p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.f;
+  // Apply 2^k in two steps so that k in [-150, 128] stays in the exponent
+  // range; results below FLT_MIN get denormalized by the last product.
+  float y = p * pow2i(k >> 1) * pow2i(k - (k >> 1));
+  y = select_float(a > overflow, std::numeric_limits<float>::infinity(), y);
+  return select_float(a != a, a, y);
+}
+
+static inline float log_approx(const float a) {
+  // Scale denormals up so that the exponent bits give the full exponent.
+  const bool denormal = a < std::numeric_limits<float>::min();
+  union { float f; int i; } bits;
+  bits.f = select_float(denormal, a * 8388608.f, a);
+  // a = m * 2^e with m in [sqrt(0.5), sqrt(2)), log(a) = e * ln(2) + log(m).
+  int e = ((bits.i >> 23) & 0xff) - 126 - 23 * denormal;
+  bits.i = (bits.i & 0x807fffff) | 0x3f000000;
+  const bool below_sqrt_half = bits.f < 0.707106781186547524f;
+  e -= below_sqrt_half;
+  const float m = select_float(below_sqrt_half, bits.f + bits.f, bits.f) - 1.f;
+  const float z = m * m;
+  float p = 7.0376836292e-2f;
+  p = p * m - 1.1514610310e-1f;
+  p = p * m + 1.1676998740e-1f;
+  p = p * m - 1.2420140846e-1f;
+  p = p * m + 1.4249322787e-1f;
+  p = p * m - 1.6668057665e-1f;
+  p = p * m + 2.0000714765e-1f;
+  p = p * m - 2.4999993993e-1f;
+  p = p * m + 3.3333331174e-1f;
+  const float fe = static_cast<float>(e);
+  float y = p * m * z + fe * -2.12194440e-4f - 0.5f * z;
+  y = m + y + fe * 0.693359375f;
+  // log(0) = -inf, log(+inf) = +inf, NaN for negative inputs and NaN.
+  y = select_float(a == 0.f, -std::numeric_limits<float>::infinity(), y);
+  y = select_float(a == std::numeric_limits<float>::infinity(), a, y);
+  return select_float(a < 0.f || a != a,
+      std::numeric_limits<float>::quiet_NaN(), y);
+}
+
+static inline float tanh_approx(const float x) {
+  // Odd polynomial for |x| < 0.625, 1 - 2 / (exp(2|x|) + 1) above.
+  const float z = x * x;
+  float p = -5.70498872745e-3f;
+  p = p * z + 2.06390887954e-2f;
+  p = p * z - 5.37397155531e-2f;
+  p = p * z + 1.33314422036e-1f;
+  p = p * z - 3.33332819422e-1f;
+  const float odd = p * z * x + x;
+  const float ax = std::fabs(x);
+  const float saturating =
+      copysignf(1.f - 2.f / (exp_approx(2.f * ax) + 1.f), x);
+  return select_float(ax < 0.625f, odd, saturating);
+}
+#endif
+
+static void exp_kernel(const int n, const float* a, float* y) {
+#ifdef USE_MKL
+  vsExp(n, a, y);
+#else
+#ifdef _OPENMP
+  #pragma omp simd
+#endif
+  for (int i = 0; i < n; ++i) {
+    y[i] = exp_approx(a[i]);
+  }
+#endif
+}
+
+static void exp_kernel(const int n, const double* a, double* y) {
+  vdExp(n, a, y);
+}
+
+static void log_kernel(const int n, const float* a, float* y) {
+#ifdef USE_MKL
+  vsLn(n, a, y);
+#else
+#ifdef _OPENMP
+  #pragma omp simd
+#endif
+  for (int i = 0; i < n; ++i) {
+    y[i] = log_approx(a[i]);
+  }
+#endif
+}
+
+static void log_kernel(const int n, const double* a, double* y) {
+  vdLn(n, a, y);
+}
+
+static void tanh_kernel(const int n, const float* a, float* y) {
+#ifdef USE_MKL
+  vsTanh(n, a, y);
+#else
+#ifdef _OPENMP
+  #pragma omp simd
+#endif
+  for (int i = 0; i < n; ++i) {
+    y[i] = tanh_approx(a[i]);
+  }
+#endif
+}
+
+static void tanh_kernel(const int n, const double* a, double* y) {
+  vdTanh(n, a, y);
+}
+
+template <typename Dtype>
+static void sigmoid_from_exp_kernel(const int n, const Dtype* a, Dtype* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = -a[i];
+  }
+  exp_kernel(n, y, y);
+  for (int i = 0; i < n; ++i) {
+    y[i] = Dtype(1) / (Dtype(1) + y[i]);
+  }
+}
+
+static void sigmoid_kernel(const int n, const float* a, float* y) {
+#ifdef USE_MKL
+  sigmoid_from_exp_kernel(n, a, y);
+#else
+#ifdef _OPENMP
+  #pragma omp simd
+#endif
+  for (int i = 0; i < n; ++i) {
+    y[i] = 1.f / (1.f + exp_approx(-a[i]));
+  }
+#endif
+}
+
+static void sigmoid_kernel(const int n, const double* a, double* y) {
+  sigmoid_from_exp_kernel(n, a, y);
+}
+
 template <>
 void caffe_exp<float>(const int n, const float* a, float* y) {
-  vsExp(n, a, y);
+  caffe_cpu_parallel_unary(n, a, y, exp_kernel);
 }
 
 template <>
 void caffe_exp<double>(const int n, const double* a, double* y) {
-  vdExp(n, a, y);
+  caffe_cpu_parallel_unary(n, a, y, exp_kernel);
 }
 
 template <>
 void caffe_log<float>(const int n, const float* a, float* y) {
-  vsLn(n, a, y);
+  caffe_cpu_parallel_unary(n, a, y, log_kernel);
 }
 
 template <>
 void caffe_log<double>(const int n, const double* a, double* y) {
-  vdLn(n, a, y);
+  caffe_cpu_parallel_unary(n, a, y, log_kernel);
+}
+
+template <>
+void caffe_tanh<float>(const int n, const float* a, float* y) {
+  caffe_cpu_parallel_unary(n, a, y, tanh_kernel);
+}
+
+template <>
+void caffe_tanh<double>(const int n, const double* a, double* y) {
+  caffe_cpu_parallel_unary(n, a, y, tanh_kernel);
+}
+
+template <>
+void caffe_sigmoid<float>(const int n, const float* a, float* y) {
+  caffe_cpu_parallel_unary(n, a, y, sigmoid_kernel);
+}
+
+template <>
+void caffe_sigmoid<double>(const int n, const double* a, double* y) {
+  caffe_cpu_parallel_unary(n, a, y, sigmoid_kernel);
 }
 
 template <>
@@ -515,6 +761,42 @@ size_t caffe_cpu_asum<size_t>(const int n, const size_t* x) {
   return 0;
 }
 
+template <typename Dtype>
+Dtype caffe_cpu_sumsq(const int n, const Dtype* x) {
+  // Blocks of a fixed size are summed independently and added in order, so
+  // that, unlike with an OpenMP reduction, the result depends neither on the
+  // number of threads nor on their timing.
+  const int block = 4096;
+  const int num_blocks = (n + block - 1) / block;
+  vector<Dtype> partial(num_blocks);
+#ifdef _OPENMP
+  #pragma omp parallel for if (num_blocks > 1 && caffe_cpu_run_parallel(n))
+#endif
+  for (int b = 0; b < num_blocks; ++b) {
+    const int end = std::min(n - b * block, block);
+    const Dtype* xb = x + b * block;
+    Dtype sum = 0;
+#ifdef _OPENMP
+    #pragma omp simd reduction(+: sum)
+#endif
+    for (int i = 0; i < end; ++i) {
+      sum += xb[i] * xb[i];
+    }
+    partial[b] = sum;
+  }
+  Dtype sum = 0;
+  for (int b = 0; b < num_blocks; ++b) {
+    sum += partial[b];
+  }
+  return sum;
+}
+
+template
+float caffe_cpu_sumsq<float>(const int n, const float* x);
+
+template
+double caffe_cpu_sumsq<double>(const int n, const double* x);
+
 template <>
 void caffe_cpu_scale<float>(const int n, const float alpha, const float *x,
                             float* y) {
@@ -529,4 +811,36 @@ void caffe_cpu_scale<double>(const int n, const double alpha, const double *x,
   cblas_dscal(n, alpha, y, 1);
 }
 
+template <typename Dtype>
+void caffe_cpu_to_bf16(const int n, const Dtype* x, uint16_t* y) {
+#ifdef _OPENMP
+  #pragma omp parallel for if (caffe_cpu_run_parallel(n))
+#endif
+  for (int i = 0; i < n; ++i) {
+    y[i] = caffe_float_to_bf16(static_cast<float>(x[i]));
+  }
+}
+
+template
+void caffe_cpu_to_bf16<float>(const int n, const float* x, uint16_t* y);
+
+template
+void caffe_cpu_to_bf16<double>(const int n, const double* x, uint16_t* y);
+
+template <typename Dtype>
+void caffe_cpu_from_bf16(const int n, const uint16_t* x, Dtype* y) {
+#ifdef _OPENMP
+  #pragma omp parallel for if (caffe_cpu_run_parallel(n))
+#endif
+  for (int i = 0; i < n; ++i) {
+    y[i] = caffe_bf16_to_float(x[i]);
+  }
+}
+
+template
+void caffe_cpu_from_bf16<float>(const int n, const uint16_t* x, float* y);
+
+template
+void caffe_cpu_from_bf16<double>(const int n, const uint16_t* x, double* y);
+
 }  // namespace caffe
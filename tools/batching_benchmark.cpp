@@ -0,0 +1,98 @@
+// This program measures the throughput and latency of serving single-item
+// requests through a BatchingScheduler. Several client threads each send
+// random inputs, one at a time, and the scheduler groups them into batches.
+// Usage:
+//    batching_benchmark [FLAGS] NET_PROTO_FILE
+//
+// The net must take its input through one Input layer or a MemoryDataLayer;
+// its batch dimension is ignored.
+
+#include <boost/thread.hpp>
+#include <string>
+#include <vector>
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/batching_scheduler.hpp"
+#include "caffe/caffe.hpp"
+#include "caffe/filler.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+DEFINE_string(weights, "",
+    "Optional: the pretrained weights to load into the net");
+DEFINE_int32(clients, 8, "Number of client threads sending requests");
+DEFINE_int32(requests, 100, "Number of requests sent by each client");
+DEFINE_int32(max_batch_size, 8, "Largest batch the requests are grouped into");
+DEFINE_int32(max_latency_us, 2000,
+    "Longest time a request waits for its batch to fill, in microseconds");
+
+void RunClient(BatchingScheduler<float>* scheduler, const vector<int>& shape,
+    int num_outputs, int num_requests) {
+  Blob<float> input(shape);
+  FillerParameter filler_param;
+  GaussianFiller<float> filler(filler_param);
+  filler.Fill(&input);
+  vector<shared_ptr<Blob<float> > > outputs;
+  vector<Blob<float>*> output;
+  for (int i = 0; i < num_outputs; ++i) {
+    outputs.push_back(shared_ptr<Blob<float> >(new Blob<float>()));
+    output.push_back(outputs[i].get());
+  }
+  for (int i = 0; i < num_requests; ++i) {
+    scheduler->Forward(input, output);
+  }
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Measure the throughput and latency of batched\n"
+        "single-item inference.\n"
+        "Usage:\n"
+        "    batching_benchmark [FLAGS] NET_PROTO_FILE\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc < 2) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/batching_benchmark");
+    return 1;
+  }
+
+  Caffe::set_mode(Caffe::CPU);
+  shared_ptr<Net<float> > net(new Net<float>(argv[1], TEST));
+  if (!FLAGS_weights.empty()) {
+    net->CopyTrainedLayersFrom(FLAGS_weights);
+  }
+  BatchingScheduler<float> scheduler(net, FLAGS_max_batch_size,
+      FLAGS_max_latency_us);
+  vector<int> shape = scheduler.item_shape();
+  shape.insert(shape.begin(), 1);
+
+  const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+  boost::thread_group clients;
+  for (int i = 0; i < FLAGS_clients; ++i) {
+    clients.create_thread(boost::bind(&RunClient, &scheduler, shape,
+        net->num_outputs(), FLAGS_requests));
+  }
+  clients.join_all();
+  const float seconds = (boost::posix_time::microsec_clock::universal_time()
+      - start).total_microseconds() / 1e6f;
+
+  const BatchingStats stats = scheduler.stats();
+  LOG(INFO) << "Requests: " << stats.requests << " in " << stats.batches
+      << " batches, mean batch size " << stats.mean_batch_size;
+  LOG(INFO) << "Throughput: " << stats.requests / seconds << " requests/s";
+  LOG(INFO) << "Latency (ms): mean " << stats.latency_mean << ", p50 "
+      << stats.latency_p50 << ", p90 " << stats.latency_p90 << ", p99 "
+      << stats.latency_p99;
+  return 0;
+}
@@ -15,6 +15,7 @@ namespace bp = boost::python;
 #include "boost/make_shared.hpp"
 #include "caffe/caffe.hpp"
 #include "caffe/internode/mpiutil.hpp"
+#include "caffe/layerwise_updater.hpp"
 #include "caffe/multinode/multinode.hpp"
 #include "caffe/util/signal_handler.h"
 
@@ -269,6 +270,12 @@ int train() {
   } else if (gpus.size() > 1) {
     caffe::P2PSync<float> sync(solver, NULL, solver->param());
     sync.Run(gpus);
+  } else if (solver->param().layer_wise_update()) {
+    shared_ptr<caffe::MultiSolver<float> >
+        multi_solver(new caffe::MultiSolver<float>(solver));
+    caffe::LayerwiseUpdater<float> updater(multi_solver);
+    LOG(INFO) << "Starting Optimization with layer-wise updates";
+    multi_solver->Solve();
   } else {
     LOG(INFO) << "Starting Optimization";
     solver->Solve();
@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <boost/thread.hpp>
 #include <algorithm>
 #include <string>
 #include <utility>
@@ -9,9 +10,15 @@
 #include "glog/logging.h"
 
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/bounded_queue.hpp"
 #include "caffe/util/db.hpp"
 #include "caffe/util/io.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace caffe;  // NOLINT(build/namespaces)
 
 using std::max;
@@ -19,7 +26,29 @@ using std::pair;
 using boost::scoped_ptr;
 
 DEFINE_string(backend, "lmdb",
-        "The backend {leveldb, lmdb} containing the images");
+        "The backend {leveldb, lmdb, recordio} containing the images");
+DEFINE_int32(threads, 0,
+    "Number of threads decoding the images, 0 for the OpenMP default");
+
+// Records are read by chunks on a separate thread, while the OpenMP threads
+// decode the previous chunk and add it to their own partial sums.
+static const int kChunkSize = 1000;
+
+#ifdef USE_OPENCV
+static void ReadChunks(db::Cursor* cursor, vector<vector<string> >* chunks,
+    BoundedQueue<int>* free_chunks, BoundedQueue<int>* full_chunks) {
+  while (cursor->valid()) {
+    const int index = free_chunks->pop();
+    vector<string>& chunk = (*chunks)[index];
+    chunk.clear();
+    for (; cursor->valid() && chunk.size() < kChunkSize; cursor->Next()) {
+      chunk.push_back(cursor->value());
+    }
+    full_chunks->push(index);
+  }
+  full_chunks->push(-1);
+}
+#endif  // USE_OPENCV
 
 int main(int argc, char** argv) {
   ::google::InitGoogleLogging(argv[0]);
@@ -60,51 +89,93 @@ int main(int argc, char** argv) {
   sum_blob.set_height(datum.height());
   sum_blob.set_width(datum.width());
   const int data_size = datum.channels() * datum.height() * datum.width();
-  int size_in_datum = std::max<int>(datum.data().size(),
-                                    datum.float_data_size());
-  for (int i = 0; i < size_in_datum; ++i) {
-    sum_blob.add_data(0.);
+  const int size_in_datum = std::max<int>(datum.data().size(),
+                                          datum.float_data_size());
+
+#ifdef _OPENMP
+  if (FLAGS_threads > 0) {
+    omp_set_num_threads(FLAGS_threads);
   }
+  const int max_threads = omp_get_max_threads();
+#else
+  const int max_threads = 1;
+#endif
+  // Partial sums of each thread, added in thread order at the end
+  vector<vector<double> > sums(max_threads,
+      vector<double>(size_in_datum, 0.));
+  // One chunk is read while the other one is decoded
+  vector<vector<string> > chunks(2);
+  BoundedQueue<int> free_chunks(chunks.size());
+  BoundedQueue<int> full_chunks(chunks.size());
+  for (int i = 0; i < chunks.size(); ++i) {
+    free_chunks.push(i);
+  }
+  boost::thread reader(&ReadChunks, cursor.get(), &chunks, &free_chunks,
+      &full_chunks);
+
   LOG(INFO) << "Starting Iteration";
-  while (cursor->valid()) {
-    Datum datum;
-    datum.ParseFromString(cursor->value());
-    DecodeDatumNative(&datum);
-
-    const std::string& data = datum.data();
-    size_in_datum = std::max<int>(datum.data().size(),
-        datum.float_data_size());
-    CHECK_EQ(size_in_datum, data_size) << "Incorrect data field size " <<
-        size_in_datum;
-    if (data.size() != 0) {
-      CHECK_EQ(data.size(), size_in_datum);
-      for (int i = 0; i < size_in_datum; ++i) {
-        sum_blob.set_data(i, sum_blob.data(i) + (uint8_t)data[i]);
-      }
-    } else {
-      CHECK_EQ(datum.float_data_size(), size_in_datum);
-      for (int i = 0; i < size_in_datum; ++i) {
-        sum_blob.set_data(i, sum_blob.data(i) +
-            static_cast<float>(datum.float_data(i)));
+  CPUTimer timer;
+  timer.Start();
+  for (int index = full_chunks.pop(); index >= 0; index = full_chunks.pop()) {
+    const vector<string>& chunk = chunks[index];
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+#ifdef _OPENMP
+      vector<double>& sum = sums[omp_get_thread_num()];
+      #pragma omp for schedule(dynamic)
+#else
+      vector<double>& sum = sums[0];
+#endif
+      for (int j = 0; j < chunk.size(); ++j) {
+        Datum datum;
+        datum.ParseFromString(chunk[j]);
+        DecodeDatumNative(&datum);
+
+        const std::string& data = datum.data();
+        const int datum_size = std::max<int>(datum.data().size(),
+            datum.float_data_size());
+        CHECK_EQ(datum_size, data_size) << "Incorrect data field size " <<
+            datum_size;
+        if (data.size() != 0) {
+          CHECK_EQ(data.size(), datum_size);
+          for (int i = 0; i < datum_size; ++i) {
+            sum[i] += (uint8_t)data[i];
+          }
+        } else {
+          CHECK_EQ(datum.float_data_size(), datum_size);
+          for (int i = 0; i < datum_size; ++i) {
+            sum[i] += static_cast<float>(datum.float_data(i));
+          }
+        }
       }
     }
-    ++count;
-    if (count % 10000 == 0) {
-      LOG(INFO) << "Processed " << count << " files.";
+    const int previous_count = count;
+    count += chunk.size();
+    free_chunks.push(index);
+    if (count / 10000 != previous_count / 10000) {
+      LOG(INFO) << "Processed " << count << " files, "
+          << count * 1000. / timer.MilliSeconds() << " files/s.";
     }
-    cursor->Next();
   }
+  reader.join();
 
   if (count % 10000 != 0) {
-    LOG(INFO) << "Processed " << count << " files.";
+    LOG(INFO) << "Processed " << count << " files, "
+        << count * 1000. / timer.MilliSeconds() << " files/s.";
   }
 
   if (count == 0) {
     LOG(FATAL) << "Division by zero 'count' value possible.";
   }
 
-  for (int i = 0; i < sum_blob.data_size(); ++i) {
-    sum_blob.set_data(i, sum_blob.data(i) / count);
+  for (int i = 0; i < size_in_datum; ++i) {
+    double sum = 0;
+    for (int t = 0; t < max_threads; ++t) {
+      sum += sums[t][i];
+    }
+    sum_blob.add_data(sum / count);
   }
   // Write to disk
   if (argc == 3) {
@@ -8,6 +8,7 @@
 //   subfolder1/file1.JPEG 7
 //   ....
 
+#include <boost/thread.hpp>
 #include <algorithm>
 #include <fstream>  // NOLINT(readability/streams)
 #include <string>
@@ -19,11 +20,17 @@
 #include "glog/logging.h"
 
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/bounded_queue.hpp"
 #include "caffe/util/db.hpp"
 #include "caffe/util/format.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/rng.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace caffe;  // NOLINT(build/namespaces)
 using std::pair;
 using boost::scoped_ptr;
@@ -33,7 +40,7 @@ DEFINE_bool(gray, false,
 DEFINE_bool(shuffle, false,
     "Randomly shuffle the order of images and their labels");
 DEFINE_string(backend, "lmdb",
-        "The backend {lmdb, leveldb} for storing the result");
+        "The backend {lmdb, leveldb, recordio} for storing the result");
 DEFINE_int32(resize_width, 0, "Width images are resized to");
 DEFINE_int32(resize_height, 0, "Height images are resized to");
 DEFINE_bool(check_size, false,
@@ -42,6 +49,80 @@ DEFINE_bool(encoded, false,
     "When this option is on, the encoded image will be save in datum");
 DEFINE_string(encode_type, "",
     "Optional: What type should we encode the image as ('png','jpg',...).");
+DEFINE_int32(threads, 0,
+    "Number of threads reading the images, 0 for the OpenMP default");
+
+// Images are converted by chunks across the OpenMP threads, while a single
+// thread writes the previous chunk to the db, in the order of the list. The
+// db transaction is committed after each chunk.
+static const int kChunkSize = 1000;
+
+struct Chunk {
+  // Key and serialized Datum of each image, the key is empty if the image
+  // could not be read.
+  vector<string> keys;
+  vector<string> values;
+  // Size of the image and size of its data field, for check_size.
+  vector<int> image_sizes;
+  vector<int> data_sizes;
+};
+
+#ifdef USE_OPENCV
+static void WriteChunks(db::DB* db, vector<Chunk>* chunks,
+    BoundedQueue<int>* free_chunks, BoundedQueue<int>* full_chunks,
+    bool check_size) {
+  scoped_ptr<db::Transaction> txn(db->NewTransaction());
+  int count = 0;
+  int data_size = 0;
+  bool data_size_initialized = false;
+  CPUTimer timer;
+  timer.Start();
+  for (int index = full_chunks->pop(); index >= 0;
+       index = full_chunks->pop()) {
+    const Chunk& chunk = (*chunks)[index];
+    for (int i = 0; i < chunk.keys.size(); ++i) {
+      if (chunk.keys[i].empty()) continue;
+      if (check_size) {
+        if (!data_size_initialized) {
+          data_size = chunk.image_sizes[i];
+          data_size_initialized = true;
+        } else {
+          CHECK_EQ(chunk.data_sizes[i], data_size)
+              << "Incorrect data field size " << chunk.data_sizes[i];
+        }
+      }
+      // Put in db
+      txn->Put(chunk.keys[i], chunk.values[i]);
+      ++count;
+    }
+    free_chunks->push(index);
+    // Commit db
+    txn->Commit();
+    txn.reset(db->NewTransaction());
+    LOG(INFO) << "Processed " << count << " files, "
+        << count * 1000. / timer.MilliSeconds() << " files/s.";
+  }
+}
+
+// Reads one image into a serialized Datum, returns false if it fails.
+static bool ConvertImage(const string& filename, int label, bool encoded,
+    const string& encode_type, Datum* datum) {
+  const bool is_color = !FLAGS_gray;
+  const int resize_height = std::max<int>(0, FLAGS_resize_height);
+  const int resize_width = std::max<int>(0, FLAGS_resize_width);
+  std::string enc = encode_type;
+  if (encoded && !enc.size()) {
+    // Guess the encoding type from the file name
+    size_t p = filename.rfind('.');
+    if ( p == filename.npos )
+      LOG(WARNING) << "Failed to guess the encoding of '" << filename << "'";
+    enc = filename.substr(p);
+    std::transform(enc.begin(), enc.end(), enc.begin(), ::tolower);
+  }
+  return ReadImageToDatum(filename, label, resize_height, resize_width,
+      is_color, enc, datum);
+}
+#endif  // USE_OPENCV
 
 int main(int argc, char** argv) {
 #ifdef USE_OPENCV
@@ -66,7 +147,6 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  const bool is_color = !FLAGS_gray;
   const bool check_size = FLAGS_check_size;
   const bool encoded = FLAGS_encoded;
   const string encode_type = FLAGS_encode_type;
@@ -91,67 +171,56 @@ int main(int argc, char** argv) {
   if (encode_type.size() && !encoded)
     LOG(INFO) << "encode_type specified, assuming encoded=true.";
 
-  int resize_height = std::max<int>(0, FLAGS_resize_height);
-  int resize_width = std::max<int>(0, FLAGS_resize_width);
-
   // Create new DB
   scoped_ptr<db::DB> db(db::GetDB(FLAGS_backend));
   db->Open(argv[3], db::NEW);
-  scoped_ptr<db::Transaction> txn(db->NewTransaction());
+
+#ifdef _OPENMP
+  if (FLAGS_threads > 0) {
+    omp_set_num_threads(FLAGS_threads);
+  }
+#endif
+  // One chunk is converted while the other one is written
+  vector<Chunk> chunks(2);
+  BoundedQueue<int> free_chunks(chunks.size());
+  BoundedQueue<int> full_chunks(chunks.size());
+  for (int i = 0; i < chunks.size(); ++i) {
+    free_chunks.push(i);
+  }
+  boost::thread writer(&WriteChunks, db.get(), &chunks, &free_chunks,
+      &full_chunks, check_size);
 
   // Storing to db
   std::string root_folder(argv[1]);
-  Datum datum;
-  int count = 0;
-  int data_size = 0;
-  bool data_size_initialized = false;
-
-  for (int line_id = 0; line_id < lines.size(); ++line_id) {
-    bool status;
-    std::string enc = encode_type;
-    if (encoded && !enc.size()) {
-      // Guess the encoding type from the file name
-      string fn = lines[line_id].first;
-      size_t p = fn.rfind('.');
-      if ( p == fn.npos )
-        LOG(WARNING) << "Failed to guess the encoding of '" << fn << "'";
-      enc = fn.substr(p);
-      std::transform(enc.begin(), enc.end(), enc.begin(), ::tolower);
-    }
-    status = ReadImageToDatum(root_folder + lines[line_id].first,
-        lines[line_id].second, resize_height, resize_width, is_color,
-        enc, &datum);
-    if (status == false) continue;
-    if (check_size) {
-      if (!data_size_initialized) {
-        data_size = datum.channels() * datum.height() * datum.width();
-        data_size_initialized = true;
-      } else {
-        const std::string& data = datum.data();
-        CHECK_EQ(data.size(), data_size) << "Incorrect data field size "
-            << data.size();
+  for (int begin = 0; begin < lines.size(); begin += kChunkSize) {
+    const int end = std::min<int>(begin + kChunkSize, lines.size());
+    const int index = free_chunks.pop();
+    Chunk& chunk = chunks[index];
+    chunk.keys.assign(end - begin, "");
+    chunk.values.resize(end - begin);
+    chunk.image_sizes.resize(end - begin);
+    chunk.data_sizes.resize(end - begin);
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int line_id = begin; line_id < end; ++line_id) {
+      const int i = line_id - begin;
+      Datum datum;
+      if (!ConvertImage(root_folder + lines[line_id].first,
+          lines[line_id].second, encoded, encode_type, &datum)) {
+        continue;
       }
+      chunk.image_sizes[i] = datum.channels() * datum.height() * datum.width();
+      chunk.data_sizes[i] = datum.data().size();
+      CHECK(datum.SerializeToString(&chunk.values[i]));
+      // sequential
+      chunk.keys[i] = caffe::format_int(line_id, 8) + "_" +
+          lines[line_id].first;
     }
-    // sequential
-    string key_str = caffe::format_int(line_id, 8) + "_" + lines[line_id].first;
-
-    // Put in db
-    string out;
-    CHECK(datum.SerializeToString(&out));
-    txn->Put(key_str, out);
-
-    if (++count % 1000 == 0) {
-      // Commit db
-      txn->Commit();
-      txn.reset(db->NewTransaction());
-      LOG(INFO) << "Processed " << count << " files.";
-    }
-  }
-  // write the last batch
-  if (count % 1000 != 0) {
-    txn->Commit();
-    LOG(INFO) << "Processed " << count << " files.";
+    full_chunks.push(index);
   }
+  full_chunks.push(-1);
+  writer.join();
 #else
   LOG(FATAL) << "This tool requires OpenCV; compile with USE_OPENCV.";
 #endif  // USE_OPENCV
@@ -0,0 +1,37 @@
+// This is a script to convert trained weights to the memory-mappable weights
+// map format, which Net::CopyTrainedLayersFrom maps instead of parsing.
+// Usage:
+//    convert_weights_to_map net_proto_file_in weights_map_file_out [double]
+// The weights are stored as float unless "double" is given; the output file
+// name should end with ".map".
+
+#include <cstring>
+#include <string>
+
+#include "caffe/caffe.hpp"
+#include "caffe/util/mapped_weights.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = 1;  // Print output to stderr (while still logging)
+  ::google::InitGoogleLogging(argv[0]);
+  if ((argc != 3 && argc != 4) || (argc == 4 && strcmp(argv[3], "double"))) {
+    LOG(ERROR) << "Usage: "
+        << "convert_weights_to_map net_proto_file_in weights_map_file_out "
+        << "[double]";
+    return 1;
+  }
+
+  NetParameter net_param;
+  ReadNetParamsFromBinaryFileOrDie(argv[1], &net_param);
+  if (argc == 4) {
+    WriteMappedWeights<double>(net_param, argv[2]);
+  } else {
+    WriteMappedWeights<float>(net_param, argv[2]);
+  }
+
+  LOG(INFO) << "Wrote weights map to " << argv[2];
+  return 0;
+}
@@ -1,24 +1,313 @@
+#include <boost/thread.hpp>
+#include <stdint.h>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "boost/algorithm/string.hpp"
+#include "boost/bind.hpp"
+#include "gflags/gflags.h"
 #include "google/protobuf/text_format.h"
 
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/net.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/bounded_queue.hpp"
+#include "caffe/util/cpu_info.hpp"
 #include "caffe/util/db.hpp"
+#include "caffe/util/db_recordio.hpp"
 #include "caffe/util/format.hpp"
 #include "caffe/util/io.hpp"
+#include "caffe/util/upgrade_proto.hpp"
 
 using caffe::Blob;
+using caffe::BoundedQueue;
 using caffe::Caffe;
 using caffe::Datum;
 using caffe::Net;
+using caffe::NetParameter;
 using std::string;
+using std::vector;
 namespace db = caffe::db;
 
+DEFINE_int32(replicas, 1,
+    "Number of nets extracting features in parallel, each one reading a "
+    "disjoint part of the sources of the Data layers. In GPU mode, replicas "
+    "run on consecutive devices from DEVICE_ID. num_mini_batches must be a "
+    "multiple of it.");
+DEFINE_int32(queue_size, 4,
+    "Number of mini-batches per replica waiting to be written");
+
+// Forward passes run on one thread per replica, while the main thread
+// serializes and writes the features of the previous mini-batches.
+
+// Features of one mini-batch of a replica.
+template<typename Dtype>
+struct FeatureBatch {
+  int replica;
+  int batch_index;
+  // Shape and data of each feature blob
+  vector<vector<int> > shapes;
+  vector<vector<Dtype> > data;
+};
+
+template<typename Dtype>
+struct Replica {
+  int index;
+  NetParameter net_param;
+  string pretrained_binary_proto;
+  vector<string> blob_names;
+  int num_mini_batches;
+  int device_id;
+  // Cores of the replica in CPU mode.
+  cpu_set_t cpu_set;
+  vector<FeatureBatch<Dtype> >* batches;
+  BoundedQueue<int>* free_batches;
+  BoundedQueue<int>* full_batches;
+};
+
+template<typename Dtype>
+void RunReplica(const Replica<Dtype>* replica) {
+  if (replica->device_id >= 0) {
+    Caffe::SetDevice(replica->device_id);
+    Caffe::set_mode(Caffe::GPU);
+  } else {
+    Caffe::set_mode(Caffe::CPU);
+  }
+  Net<Dtype> net(replica->net_param);
+  net.CopyTrainedLayersFrom(replica->pretrained_binary_proto);
+#ifdef _OPENMP
+  // Once the net is built, so that nothing in its construction moves this
+  // thread off the cores of the replica. The data threads of the net bind
+  // themselves, and the activations, allocated by the first Forward, still
+  // land on the cores of the replica.
+  if (replica->device_id < 0) {
+    caffe::cpu::OpenMpManager::bindCurrentThreadToCpuSet(&replica->cpu_set);
+  }
+#endif
+  for (size_t i = 0; i < replica->blob_names.size(); i++) {
+    CHECK(net.has_blob(replica->blob_names[i]))
+        << "Unknown feature blob name " << replica->blob_names[i]
+        << " in the network " << replica->net_param.name();
+  }
+  for (int batch_index = 0; batch_index < replica->num_mini_batches;
+       ++batch_index) {
+    net.Forward();
+    const int index = replica->free_batches->pop();
+    FeatureBatch<Dtype>& batch = (*replica->batches)[index];
+    batch.replica = replica->index;
+    batch.batch_index = batch_index;
+    batch.shapes.resize(replica->blob_names.size());
+    batch.data.resize(replica->blob_names.size());
+    for (size_t i = 0; i < replica->blob_names.size(); ++i) {
+      const boost::shared_ptr<Blob<Dtype> > feature_blob =
+          net.blob_by_name(replica->blob_names[i]);
+      batch.shapes[i] = feature_blob->shape();
+      batch.data[i].assign(feature_blob->cpu_data(),
+          feature_blob->cpu_data() + feature_blob->count());
+    }
+    replica->full_batches->push(index);
+  }
+}
+
+// Index in the source of the records read by the replicas. Replicas read the
+// records i with i % replicas == replica, or with a RECORDIO source of at
+// least one shard per replica, the shards i with i % replicas == replica.
+class InputIndex {
+ public:
+  explicit InputIndex(int replicas) : replicas_(replicas), records_(0) {}
+
+  void set_shards(const vector<db::RecordIOShard>& shards) {
+    replica_records_.assign(replicas_, 0);
+    records_ = 0;
+    if (shards.size() < replicas_) {
+      // Partitioned by record
+      local_starts_.clear();
+      starts_.clear();
+      for (int i = 0; i < shards.size(); ++i) {
+        records_ += shards[i].records;
+      }
+      for (int r = 0; r < replicas_; ++r) {
+        replica_records_[r] = (records_ - r + replicas_ - 1) / replicas_;
+      }
+      return;
+    }
+    local_starts_.assign(replicas_, vector<int64_t>());
+    starts_.assign(replicas_, vector<int64_t>());
+    for (int i = 0; i < shards.size(); ++i) {
+      const int r = i % replicas_;
+      local_starts_[r].push_back(replica_records_[r]);
+      starts_[r].push_back(records_);
+      replica_records_[r] += shards[i].records;
+      records_ += shards[i].records;
+    }
+  }
+
+  // Index of the record-th record read by the replica, counting the records
+  // of later epochs after the whole source.
+  int64_t operator()(int replica, int64_t record) const {
+    if (replica_records_.empty()) {
+      return record * replicas_ + replica;
+    }
+    const int64_t epoch = record / replica_records_[replica];
+    const int64_t local = record % replica_records_[replica];
+    if (starts_.empty()) {
+      return epoch * records_ + local * replicas_ + replica;
+    }
+    const vector<int64_t>& local_starts = local_starts_[replica];
+    const int shard = std::upper_bound(local_starts.begin(),
+        local_starts.end(), local) - local_starts.begin() - 1;
+    return epoch * records_ + starts_[replica][shard] +
+        local - local_starts[shard];
+  }
+
+ private:
+  int replicas_;
+  int64_t records_;
+  // Per replica, index of its first record in each of its shards, among its
+  // records and in the source; empty when partitioned by record.
+  vector<vector<int64_t> > local_starts_, starts_;
+  // Per replica, number of records read per epoch.
+  vector<int64_t> replica_records_;
+};
+
+// Destination of the features of one blob, items can be written in any
+// order.
+template<typename Dtype>
+class FeatureWriter {
+ public:
+  virtual ~FeatureWriter() {}
+  virtual void Write(int64_t index, const vector<int>& shape,
+      const Dtype* features) = 0;
+  virtual void Close() = 0;
+};
+
+// Writes Datum records to a db, keyed by item index.
+template<typename Dtype>
+class DBFeatureWriter : public FeatureWriter<Dtype> {
+ public:
+  DBFeatureWriter(const string& db_type, const string& name)
+      : db_(db::GetDB(db_type)), count_(0) {
+    db_->Open(name, db::NEW);
+    txn_.reset(db_->NewTransaction());
+  }
+  virtual void Write(int64_t index, const vector<int>& shape,
+      const Dtype* features) {
+    Datum datum;
+    datum.set_channels(shape.size() > 1 ? shape[1] : 1);
+    datum.set_height(shape.size() > 2 ? shape[2] : 1);
+    datum.set_width(shape.size() > 3 ? shape[3] : 1);
+    const int dim = datum.channels() * datum.height() * datum.width();
+    datum.mutable_float_data()->Reserve(dim);
+    for (int d = 0; d < dim; ++d) {
+      datum.add_float_data(features[d]);
+    }
+    string out;
+    CHECK(datum.SerializeToString(&out));
+    txn_->Put(caffe::format_int(index, 10), out);
+    if (++count_ % 1000 == 0) {
+      txn_->Commit();
+      txn_.reset(db_->NewTransaction());
+    }
+  }
+  virtual void Close() {
+    txn_->Commit();
+    db_->Close();
+  }
+
+ protected:
+  boost::shared_ptr<db::DB> db_;
+  boost::shared_ptr<db::Transaction> txn_;
+  int64_t count_;
+};
+
+// Writes the features as rows of a float32 .npy array, which numpy can map
+// in memory, e.g. np.load(name, mmap_mode='r'). Rows are written at the
+// position of their index; the header is completed by Close().
+template<typename Dtype>
+class NpyFeatureWriter : public FeatureWriter<Dtype> {
+ public:
+  explicit NpyFeatureWriter(const string& name)
+      : name_(name), file_(fopen(name.c_str(), "wb")), rows_(0), dim_(0),
+        position_(0) {
+    CHECK(file_) << "Failed to open " << name;
+    WriteHeader();
+  }
+  virtual void Write(int64_t index, const vector<int>& shape,
+      const Dtype* features) {
+    if (rows_ == 0) {
+      shape_.assign(shape.begin() + 1, shape.end());
+      dim_ = 1;
+      for (int i = 0; i < shape_.size(); ++i) {
+        dim_ *= shape_[i];
+      }
+      row_.resize(dim_);
+    }
+    CHECK(shape.size() == shape_.size() + 1 &&
+        std::equal(shape_.begin(), shape_.end(), shape.begin() + 1))
+        << "Features of varying shapes cannot be written to " << name_;
+    for (int d = 0; d < dim_; ++d) {
+      row_[d] = features[d];
+    }
+    // Seeking flushes the stream, rows written in order do not need it
+    const int64_t offset = kHeaderSize + index * dim_ * sizeof(float);
+    if (offset != position_) {
+      CHECK_EQ(fseeko(file_, offset, SEEK_SET), 0)
+          << "Failed to write " << name_;
+    }
+    CHECK_EQ(fwrite(&row_[0], sizeof(float), dim_, file_), dim_)
+        << "Failed to write " << name_;
+    position_ = offset + dim_ * sizeof(float);
+    rows_ = std::max(rows_, index + 1);
+  }
+  virtual void Close() {
+    WriteHeader();
+    CHECK_EQ(fclose(file_), 0) << "Failed to write " << name_;
+    file_ = NULL;
+  }
+
+  // The header is padded to a fixed size, so that it can be rewritten once
+  // the number of rows is known.
+  static const int kHeaderSize = 128;
+
+ protected:
+  void WriteHeader() {
+    std::ostringstream dict;
+    dict << "{'descr': '<f4', 'fortran_order': False, 'shape': (" << rows_
+        << ",";
+    for (int i = 0; i < shape_.size(); ++i) {
+      dict << (i ? ", " : " ") << shape_[i];
+    }
+    dict << "), }";
+    string header = dict.str();
+    const int header_length = kHeaderSize - 10;
+    CHECK_LT(header.size(), header_length) << "Shape too long for " << name_;
+    header.resize(header_length - 1, ' ');
+    header += '\n';
+    const char magic[] = "\x93NUMPY\x01\x00";
+    const uint16_t length = header_length;
+    CHECK_EQ(fseeko(file_, 0, SEEK_SET), 0) << "Failed to write " << name_;
+    CHECK_EQ(fwrite(magic, 1, 8, file_), 8) << "Failed to write " << name_;
+    CHECK_EQ(fwrite(&length, 2, 1, file_), 1) << "Failed to write " << name_;
+    CHECK_EQ(fwrite(header.data(), 1, header.size(), file_), header.size())
+        << "Failed to write " << name_;
+    position_ = kHeaderSize;
+  }
+
+  string name_;
+  FILE* file_;
+  int64_t rows_;
+  vector<int> shape_;
+  int dim_;
+  vector<float> row_;
+  // Position of the stream in the file.
+  int64_t position_;
+};
+
 template<typename Dtype>
 int feature_extraction_pipeline(int argc, char** argv);
 
@@ -30,37 +319,44 @@ int main(int argc, char** argv) {
 template<typename Dtype>
 int feature_extraction_pipeline(int argc, char** argv) {
   ::google::InitGoogleLogging(argv[0]);
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
   const int num_required_args = 7;
   if (argc < num_required_args) {
     LOG(ERROR)<<
     "This program takes in a trained network and an input data layer, and then"
     " extract features of the input data produced by the net.\n"
-    "Usage: extract_features  pretrained_net_param"
+    "Usage: extract_features [--replicas=N] [--queue_size=N]"
+    "  pretrained_net_param"
     "  feature_extraction_proto_file  extract_feature_blob_name1[,name2,...]"
     "  save_feature_dataset_name1[,name2,...]  num_mini_batches  db_type"
     "  [CPU/GPU] [DEVICE_ID=0]\n"
     "Note: you can extract multiple features in one pass by specifying"
     " multiple feature blob names and dataset names separated by ','."
     " The names cannot contain white space characters and the number of blobs"
-    " and datasets must be equal.";
+    " and datasets must be equal.\n"
+    "db_type is leveldb, lmdb, recordio, or npy to write each feature as a"
+    " float32 array file of one row per input.";
     return 1;
   }
   int arg_pos = num_required_args;
 
   arg_pos = num_required_args;
+  int device_id = -1;
   if (argc > arg_pos && strcmp(argv[arg_pos], "GPU") == 0) {
     LOG(ERROR)<< "Using GPU";
-    int device_id = 0;
+    device_id = 0;
     if (argc > arg_pos + 1) {
       device_id = atoi(argv[arg_pos + 1]);
       CHECK_GE(device_id, 0);
     }
     LOG(ERROR) << "Using Device_id=" << device_id;
-    Caffe::SetDevice(device_id);
-    Caffe::set_mode(Caffe::GPU);
   } else {
     LOG(ERROR) << "Using CPU";
-    Caffe::set_mode(Caffe::CPU);
   }
 
   arg_pos = 0;  // the name of the executable
@@ -94,9 +390,9 @@ int feature_extraction_pipeline(int argc, char** argv) {
    }
    */
   std::string feature_extraction_proto(argv[++arg_pos]);
-  boost::shared_ptr<Net<Dtype> > feature_extraction_net(
-      new Net<Dtype>(feature_extraction_proto, caffe::TEST));
-  feature_extraction_net->CopyTrainedLayersFrom(pretrained_binary_proto);
+  NetParameter net_param;
+  caffe::ReadNetParamsFromTextFileOrDie(feature_extraction_proto, &net_param);
+  net_param.mutable_state()->set_phase(caffe::TEST);
 
   std::string extract_feature_blob_names(argv[++arg_pos]);
   std::vector<std::string> blob_names;
@@ -110,72 +406,112 @@ int feature_extraction_pipeline(int argc, char** argv) {
       " the number of blob names and dataset names must be equal";
   size_t num_features = blob_names.size();
 
-  for (size_t i = 0; i < num_features; i++) {
-    CHECK(feature_extraction_net->has_blob(blob_names[i]))
-        << "Unknown feature blob name " << blob_names[i]
-        << " in the network " << feature_extraction_proto;
-  }
-
   int num_mini_batches = atoi(argv[++arg_pos]);
+  const int replicas = FLAGS_replicas;
+  CHECK_GT(replicas, 0);
+  CHECK_EQ(num_mini_batches % replicas, 0)
+      << "num_mini_batches must be a multiple of replicas";
 
-  std::vector<boost::shared_ptr<db::DB> > feature_dbs;
-  std::vector<boost::shared_ptr<db::Transaction> > txns;
-  const char* db_type = argv[++arg_pos];
+  std::vector<boost::shared_ptr<FeatureWriter<Dtype> > > writers;
+  const string db_type = argv[++arg_pos];
   for (size_t i = 0; i < num_features; ++i) {
     LOG(INFO)<< "Opening dataset " << dataset_names[i];
-    boost::shared_ptr<db::DB> db(db::GetDB(db_type));
-    db->Open(dataset_names.at(i), db::NEW);
-    feature_dbs.push_back(db);
-    boost::shared_ptr<db::Transaction> txn(db->NewTransaction());
-    txns.push_back(txn);
+    if (db_type == "npy") {
+      writers.push_back(boost::shared_ptr<FeatureWriter<Dtype> >(
+          new NpyFeatureWriter<Dtype>(dataset_names[i])));
+    } else {
+      writers.push_back(boost::shared_ptr<FeatureWriter<Dtype> >(
+          new DBFeatureWriter<Dtype>(db_type, dataset_names[i])));
+    }
+  }
+
+  // Each replica reads a disjoint part of the sources of its Data layers,
+  // item n of its mini-batch b is its record b * batch_size + n.
+  InputIndex input_index(replicas);
+  CHECK_GT(FLAGS_queue_size, 0);
+  vector<FeatureBatch<Dtype> > batches(replicas * FLAGS_queue_size);
+  BoundedQueue<int> free_batches(batches.size());
+  BoundedQueue<int> full_batches(batches.size());
+  for (int i = 0; i < batches.size(); ++i) {
+    free_batches.push(i);
+  }
+  vector<Replica<Dtype> > replica_params(replicas);
+  boost::thread_group threads;
+  for (int r = 0; r < replicas; ++r) {
+    Replica<Dtype>& replica = replica_params[r];
+    replica.index = r;
+    replica.net_param = net_param;
+    int data_layers = 0;
+    for (int l = 0; l < net_param.layer_size(); ++l) {
+      if (net_param.layer(l).type() == "Data") {
+        caffe::DataParameter* data_param =
+            replica.net_param.mutable_layer(l)->mutable_data_param();
+        data_param->set_num_partitions(replicas);
+        data_param->set_partition(r);
+        // The Data layers read the same records, the first one gives their
+        // index in the source.
+        if (r == 0 && data_layers == 0 && replicas > 1 &&
+            data_param->backend() == caffe::DataParameter_DB_RECORDIO) {
+          CHECK(!data_param->shuffle_shards())
+              << "Replicas cannot index the records of shuffled shards";
+          db::RecordIO source;
+          source.Open(data_param->source(), db::READ);
+          input_index.set_shards(source.shards());
+        }
+        ++data_layers;
+      }
+    }
+    CHECK(replicas == 1 || data_layers > 0)
+        << "Replicas read disjoint parts of the sources of Data layers, "
+        << feature_extraction_proto << " has none";
+    replica.pretrained_binary_proto = pretrained_binary_proto;
+    replica.blob_names = blob_names;
+    replica.num_mini_batches = num_mini_batches / replicas;
+    replica.device_id = device_id >= 0 ? device_id + r : -1;
+#ifdef _OPENMP
+    if (device_id < 0) {
+      caffe::cpu::OpenMpManager::getPartitionCpuSet(r, replicas,
+          &replica.cpu_set);
+    }
+#endif
+    replica.batches = &batches;
+    replica.free_batches = &free_batches;
+    replica.full_batches = &full_batches;
+    threads.create_thread(boost::bind(&RunReplica<Dtype>, &replica));
   }
 
   LOG(ERROR)<< "Extracting Features";
 
-  Datum datum;
-  std::vector<int> image_indices(num_features, 0);
-  for (int batch_index = 0; batch_index < num_mini_batches; ++batch_index) {
-    feature_extraction_net->Forward();
+  caffe::CPUTimer timer;
+  timer.Start();
+  int64_t num_items = 0;
+  for (int b = 0; b < num_mini_batches; ++b) {
+    const int index = full_batches.pop();
+    const FeatureBatch<Dtype>& batch = batches[index];
     for (int i = 0; i < num_features; ++i) {
-      const boost::shared_ptr<Blob<Dtype> > feature_blob =
-        feature_extraction_net->blob_by_name(blob_names[i]);
-      int batch_size = feature_blob->num();
-      int dim_features = feature_blob->count() / batch_size;
-      const Dtype* feature_blob_data;
+      const vector<int>& shape = batch.shapes[i];
+      const int batch_size = shape[0];
+      const int dim_features = batch.data[i].size() / batch_size;
       for (int n = 0; n < batch_size; ++n) {
-        datum.set_height(feature_blob->height());
-        datum.set_width(feature_blob->width());
-        datum.set_channels(feature_blob->channels());
-        datum.clear_data();
-        datum.clear_float_data();
-        feature_blob_data = feature_blob->cpu_data() +
-            feature_blob->offset(n);
-        for (int d = 0; d < dim_features; ++d) {
-          datum.add_float_data(feature_blob_data[d]);
-        }
-        string key_str = caffe::format_int(image_indices[i], 10);
-
-        string out;
-        CHECK(datum.SerializeToString(&out));
-        txns.at(i)->Put(key_str, out);
-        ++image_indices[i];
-        if (image_indices[i] % 1000 == 0) {
-          txns.at(i)->Commit();
-          txns.at(i).reset(feature_dbs.at(i)->NewTransaction());
-          LOG(ERROR)<< "Extracted features of " << image_indices[i] <<
-              " query images for feature blob " << blob_names[i];
-        }
-      }  // for (int n = 0; n < batch_size; ++n)
-    }  // for (int i = 0; i < num_features; ++i)
-  }  // for (int batch_index = 0; batch_index < num_mini_batches; ++batch_index)
-  // write the last batch
-  for (int i = 0; i < num_features; ++i) {
-    if (image_indices[i] % 1000 != 0) {
-      txns.at(i)->Commit();
+        const int64_t item = input_index(batch.replica,
+            static_cast<int64_t>(batch.batch_index) * batch_size + n);
+        writers[i]->Write(item, shape, &batch.data[i][n * dim_features]);
+      }
+      if (i == 0) {
+        num_items += batch_size;
+      }
+    }
+    free_batches.push(index);
+    if (b % 10 == 9) {
+      LOG(ERROR)<< "Extracted features of " << num_items << " query images, "
+          << num_items * 1000. / timer.MilliSeconds() << " images/s";
     }
-    LOG(ERROR)<< "Extracted features of " << image_indices[i] <<
+  }
+  threads.join_all();
+  for (int i = 0; i < num_features; ++i) {
+    writers[i]->Close();
+    LOG(ERROR)<< "Extracted features of " << num_items <<
         " query images for feature blob " << blob_names[i];
-    feature_dbs.at(i)->Close();
   }
 
   LOG(ERROR)<< "Successfully extracted the features!";
@@ -0,0 +1,121 @@
+// This program measures the throughput of the queues used in the data
+// pipeline under contention. Producer threads push integers that consumer
+// threads pop, through a BlockingQueue and then through a BoundedQueue.
+// Usage:
+//    queue_benchmark [FLAGS]
+
+#include <boost/thread.hpp>
+#include <string>
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/bounded_queue.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+DEFINE_int32(producers, 4, "Number of threads pushing to the queue");
+DEFINE_int32(consumers, 4, "Number of threads popping from the queue");
+DEFINE_int32(items, 1000000, "Number of items pushed by each producer");
+DEFINE_int32(capacity, 1024, "Capacity of the bounded queue");
+DEFINE_int32(spin_count, 1000,
+    "Attempts of the bounded queue before a thread sleeps");
+
+// BlockingQueue is unbounded, a second queue of tokens keeps the number of
+// items in flight at the same capacity as the bounded queue.
+struct Blocking {
+  BlockingQueue<int> full;
+  BlockingQueue<int> free;
+
+  explicit Blocking(int capacity) {
+    for (int i = 0; i < capacity; ++i) {
+      free.push(0);
+    }
+  }
+  void push(int t) {
+    free.pop();
+    full.push(t);
+  }
+  int pop() {
+    const int t = full.pop();
+    free.push(0);
+    return t;
+  }
+};
+
+struct Bounded {
+  BoundedQueue<int> queue;
+
+  explicit Bounded(int capacity) : queue(capacity, FLAGS_spin_count) {}
+  void push(int t) {
+    queue.push(t);
+  }
+  int pop() {
+    return queue.pop();
+  }
+};
+
+template <typename Queue>
+void Produce(Queue* queue, int count) {
+  for (int i = 0; i < count; ++i) {
+    queue->push(i);
+  }
+}
+
+template <typename Queue>
+void Consume(Queue* queue, int count) {
+  for (int i = 0; i < count; ++i) {
+    queue->pop();
+  }
+}
+
+template <typename Queue>
+void Run(const string& name) {
+  Queue queue(FLAGS_capacity);
+  const int total = FLAGS_producers * FLAGS_items;
+  const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+  boost::thread_group threads;
+  for (int i = 0; i < FLAGS_producers; ++i) {
+    threads.create_thread(boost::bind(&Produce<Queue>, &queue, FLAGS_items));
+  }
+  for (int i = 0; i < FLAGS_consumers; ++i) {
+    // Spread the items evenly, the first consumers take the remainder
+    const int count = total / FLAGS_consumers +
+        (i < total % FLAGS_consumers ? 1 : 0);
+    threads.create_thread(boost::bind(&Consume<Queue>, &queue, count));
+  }
+  threads.join_all();
+  const float seconds = (boost::posix_time::microsec_clock::universal_time()
+      - start).total_microseconds() / 1e6f;
+  LOG(INFO) << name << ": " << total << " items in " << seconds << " s, "
+      << total / seconds << " ops/s";
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Measure the throughput of data pipeline queues\n"
+        "under contention.\n"
+        "Usage:\n"
+        "    queue_benchmark [FLAGS]\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  CHECK_GT(FLAGS_producers, 0);
+  CHECK_GT(FLAGS_consumers, 0);
+  CHECK_GT(FLAGS_capacity, 0);
+  LOG(INFO) << FLAGS_producers << " producers, " << FLAGS_consumers
+      << " consumers, capacity " << FLAGS_capacity;
+  Run<Blocking>("BlockingQueue");
+  Run<Bounded>("BoundedQueue");
+  return 0;
+}